@@ -0,0 +1,172 @@
+// BatchMath kernels at every SIMD level the CPU supports, against the scalar
+// Matrix4 and Vector3 methods they replace: points through vectorTrans,
+// matrix arrays through matrixMult (pairwise and against a shared matrix on
+// either side) and directions through normalize, with some zero-length ones.
+//
+// Each kernel is timed next to the scalar loop, and its results must match
+// the loop bit for bit; any difference fails the run.
+//
+//   bench_batchmath [--count N] [--output file.json]
+#include "../Engine/BatchMath.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct KernelResult {
+    const char* name;
+    double scalarLoopMs = 0.0;
+    double ms[3] = {};        // Per SimdLevel
+    size_t mismatches[3] = {};
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t countMismatches(const float* a, const float* b, size_t count) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (std::memcmp(&a[i], &b[i], sizeof(float)) != 0) mismatches++;
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    size_t count = (1 << 20) + 5;
+    const char* outputPath = "bench_batchmath.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--count") == 0 && hasValue) {
+            count = std::max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--count N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    // Counts that are not a multiple of 8 also run the kernels' scalar tails
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    Matrix4 shared;
+    for (float& element : shared.arr) element = value(random);
+    Vector3SoA points, directions;
+    for (size_t i = 0; i < count; i++) {
+        points.push_back(Vector3(value(random), value(random), value(random)));
+        directions.push_back(i % 97 == 0 ? Vector3() : Vector3(value(random), value(random), value(random)));
+    }
+    size_t matrixCount = count / 8 + 3;
+    std::vector<Matrix4> left(matrixCount), right(matrixCount);
+    for (size_t i = 0; i < matrixCount; i++) {
+        for (float& element : left[i].arr) element = value(random);
+        for (float& element : right[i].arr) element = value(random);
+    }
+
+    // The scalar loops, timed, are the reference
+    KernelResult results[5] = {{"transformPoints"}, {"multiplyMatrices"}, {"multiplyMatricesSharedLeft"},
+                               {"multiplyMatricesSharedRight"}, {"normalizeVectors"}};
+    Vector3SoA transformed;
+    transformed.resize(count);
+    std::vector<Matrix4> pairwise(matrixCount), sharedLeft(matrixCount), sharedRight(matrixCount);
+    Vector3SoA normalized;
+    normalized.resize(count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) transformed.set(i, shared.vectorTrans(points.get(i)));
+    results[0].scalarLoopMs = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < matrixCount; i++) pairwise[i] = left[i].matrixMult(right[i]);
+    results[1].scalarLoopMs = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < matrixCount; i++) sharedLeft[i] = shared.matrixMult(right[i]);
+    results[2].scalarLoopMs = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < matrixCount; i++) sharedRight[i] = left[i].matrixMult(shared);
+    results[3].scalarLoopMs = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) normalized.set(i, directions.get(i).normalize());
+    results[4].scalarLoopMs = millisecondsSince(start);
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2};
+    SimdLevel widest = Simd::detect();
+    size_t mismatches = 0;
+    for (SimdLevel level : levels) {
+        if (static_cast<int>(level) > static_cast<int>(widest)) continue;
+        Simd::setLevel(level);
+        int l = static_cast<int>(level);
+
+        Vector3SoA batchPoints = transformed;  // Already allocated, so only the kernel is timed
+        start = std::chrono::steady_clock::now();
+        BatchMath::transformPoints(shared, points, batchPoints);
+        results[0].ms[l] = millisecondsSince(start);
+        results[0].mismatches[l] = countMismatches(batchPoints.x.data(), transformed.x.data(), count) +
+                                   countMismatches(batchPoints.y.data(), transformed.y.data(), count) +
+                                   countMismatches(batchPoints.z.data(), transformed.z.data(), count);
+
+        std::vector<Matrix4> batchMatrices(matrixCount);
+        const std::vector<Matrix4>* expected[] = {&pairwise, &sharedLeft, &sharedRight};
+        for (int variant = 0; variant < 3; variant++) {
+            start = std::chrono::steady_clock::now();
+            if (variant == 0) BatchMath::multiplyMatrices(left.data(), right.data(), batchMatrices.data(), matrixCount);
+            if (variant == 1) BatchMath::multiplyMatrices(shared, right.data(), batchMatrices.data(), matrixCount);
+            if (variant == 2) BatchMath::multiplyMatrices(left.data(), shared, batchMatrices.data(), matrixCount);
+            results[1 + variant].ms[l] = millisecondsSince(start);
+            results[1 + variant].mismatches[l] =
+                countMismatches(batchMatrices[0].arr, (*expected[variant])[0].arr, matrixCount * 16);
+        }
+
+        Vector3SoA batchDirections = directions;
+        start = std::chrono::steady_clock::now();
+        BatchMath::normalizeVectors(batchDirections);
+        results[4].ms[l] = millisecondsSince(start);
+        results[4].mismatches[l] = countMismatches(batchDirections.x.data(), normalized.x.data(), count) +
+                                   countMismatches(batchDirections.y.data(), normalized.y.data(), count) +
+                                   countMismatches(batchDirections.z.data(), normalized.z.data(), count);
+
+        for (const KernelResult& result : results) mismatches += result.mismatches[l];
+    }
+    Simd::setLevel(widest);
+
+    for (const KernelResult& result : results) {
+        std::printf("bench_batchmath: %-27s scalar loop %7.2f ms", result.name, result.scalarLoopMs);
+        for (SimdLevel level : levels) {
+            int l = static_cast<int>(level);
+            if (l > static_cast<int>(widest)) continue;
+            std::printf(", %s %7.2f ms (%zu mismatches)", Simd::name(level), result.ms[l], result.mismatches[l]);
+        }
+        std::printf("\n");
+    }
+    std::printf("bench_batchmath: %zu points, %zu matrices, %s\n", count, matrixCount,
+                mismatches == 0 ? "all levels match the scalar methods" : "MISMATCH");
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"batchmath\",\n");
+    std::fprintf(out, "  \"simd\": \"%s\",\n", Simd::name(widest));
+    std::fprintf(out, "  \"points\": %zu,\n  \"matrices\": %zu,\n", count, matrixCount);
+    std::fprintf(out, "  \"kernels\": [\n");
+    for (int k = 0; k < 5; k++) {
+        const KernelResult& result = results[k];
+        std::fprintf(out, "    {\"name\": \"%s\", \"scalarLoopMs\": %.3f", result.name, result.scalarLoopMs);
+        for (SimdLevel level : levels) {
+            int l = static_cast<int>(level);
+            if (l > static_cast<int>(widest)) continue;
+            std::fprintf(out, ", \"%sMs\": %.3f", Simd::name(level), result.ms[l]);
+        }
+        std::fprintf(out, "}%s\n", k + 1 < 5 ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"mismatches\": %zu\n", mismatches);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return mismatches == 0 ? 0 : -1;
+}
@@ -0,0 +1,363 @@
+// Per-frame systems of a grass field stored three ways: a vector of
+// GameObjects that carry every field any object might need (the layout a
+// scene grows into when each new feature adds a member), and an EntityWorld
+// walked with each() and with parallelEach().
+//
+// The field holds swaying grass blades, static rocks and leaves blown across
+// it. Every frame the leaves drift, and those leaving the field are destroyed
+// and respawned at the opposite edge (through an EntityCommandBuffer filled
+// from the drift system), the model matrices of everything that moved are
+// rebuilt, the objects are culled against an orbiting camera and the visible
+// InstanceData gathered for upload. All three must gather the same instances.
+//
+//   bench_ecs [--blades N] [--frames N] [--output file.json]
+#include "../Engine/EntityWorld.h"
+#include "../Engine/InstanceBuffer.h"
+#include "../Engine/Culling.h"
+#include "../Engine/Camera.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const float TIME_STEP = 1.0f / 60.0f;
+
+struct Placement {
+    float x, y, z;
+    float rotation;  // Radians around y
+    float tilt;      // Radians around x at rest
+    float height;
+};
+
+struct Sway {
+    float phase;
+};
+
+struct Drift {
+    float vx, vz;
+};
+
+struct CullRadius {
+    float radius;
+};
+
+struct Visible {
+    uint8_t value;
+};
+
+enum ObjectKind { GRASS, ROCK, LEAF };
+
+// Everything in one struct, most of it cold for any given system
+struct GameObject {
+    char name[32];
+    ObjectKind kind;
+    Placement placement;
+    Sway sway;
+    Drift drift;
+    float radius;
+    bool visible;
+    float health;
+    int material;
+    Vector3 boundsMin, boundsMax;
+    InstanceData instance;
+};
+
+// T(x, y, z) * Ry(rotation) * Rx(tilt + sway) * S(1, height, 1), column-major
+static void buildInstance(const Placement& p, float sway, InstanceData& instance) {
+    float cy = std::cos(p.rotation);
+    float sy = std::sin(p.rotation);
+    float cx = std::cos(p.tilt + sway);
+    float sx = std::sin(p.tilt + sway);
+    float h = p.height;
+    float* m = instance.transform;
+    m[0] = cy;       m[1] = 0.0f;     m[2] = -sy;      m[3] = 0.0f;
+    m[4] = sy * sx * h;  m[5] = cx * h;  m[6] = cy * sx * h;  m[7] = 0.0f;
+    m[8] = sy * cx;  m[9] = -sx;      m[10] = cy * cx; m[11] = 0.0f;
+    m[12] = p.x;     m[13] = p.y;     m[14] = p.z;     m[15] = 1.0f;
+    instance.height = h;
+    instance.intensity = 1.0f - std::fabs(sway);
+}
+
+static float swayAt(const Sway& sway, float time) {
+    return std::sin(time * 1.7f + sway.phase) * 0.25f;
+}
+
+// Moves the leaf; false once it has left the field
+static bool drift(Placement& p, const Drift& d, float halfSide) {
+    p.x += d.vx * TIME_STEP;
+    p.z += d.vz * TIME_STEP;
+    return std::fabs(p.x) <= halfSide && std::fabs(p.z) <= halfSide;
+}
+
+// Where a leaf that left the field comes back
+static Placement respawned(Placement p, float halfSide) {
+    if (p.x > halfSide) p.x -= 2.0f * halfSide;
+    if (p.x < -halfSide) p.x += 2.0f * halfSide;
+    if (p.z > halfSide) p.z -= 2.0f * halfSide;
+    if (p.z < -halfSide) p.z += 2.0f * halfSide;
+    return p;
+}
+
+static bool inFrustum(const Frustum& frustum, const Placement& p, float radius) {
+    return frustum.containsSphere(Vector3(p.x, p.y + p.height * 0.5f, p.z), radius);
+}
+
+static Frustum frameFrustum(int frame, float halfSide) {
+    Camera camera;
+    camera.farPlane = halfSide;
+    float angle = frame * 0.01f;
+    camera.position = Vector3(std::cos(angle) * halfSide * 0.5f, 3.0f, std::sin(angle) * halfSide * 0.5f);
+    camera.rotate(angle * 57.29578f + 180.0f, -10.0f);
+    return Frustum::fromCamera(camera, 16.0f / 9.0f);
+}
+
+// Independent of the order the instances were gathered in
+static uint64_t hashInstances(const std::vector<InstanceData>& instances) {
+    uint64_t sum = 0;
+    for (const InstanceData& instance : instances) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&instance);
+        uint64_t hash = 1469598103934665603ull;
+        for (size_t i = 0; i < sizeof(InstanceData); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        sum += hash;
+    }
+    return sum;
+}
+
+struct Layout {
+    const char* name;
+    double msPerFrame = 0.0;
+    double driftMs = 0.0, windMs = 0.0, cullMs = 0.0, gatherMs = 0.0;
+    size_t visible = 0;
+    uint64_t hash = 0;
+};
+
+static double since(std::chrono::steady_clock::time_point& start) {
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+template <typename Function>
+static void runFrames(Layout& layout, int frames, Function&& frame) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) frame(i);
+    layout.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / frames;
+    layout.driftMs /= frames;
+    layout.windMs /= frames;
+    layout.cullMs /= frames;
+    layout.gatherMs /= frames;
+}
+
+int main(int argc, char** argv) {
+    size_t bladeCount = 262144;
+    int frames = 120;
+    const char* outputPath = "bench_ecs.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--blades") == 0 && hasValue) {
+            bladeCount = std::max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--blades N] [--frames N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    // One rock per 64 blades, one leaf per 16
+    size_t rockCount = std::max<size_t>(1, bladeCount / 64);
+    size_t leafCount = std::max<size_t>(1, bladeCount / 16);
+    float halfSide = std::sqrt(static_cast<float>(bladeCount)) * 0.125f;
+
+    std::vector<GameObject> objects;
+    EntityWorld serialWorld, parallelWorld;
+    std::mt19937 random(1);
+    auto unit = [&] { return (random() & 0xffffff) / 16777216.0f; };
+    auto place = [&](float tiltRange, float height) {
+        Placement p;
+        p.x = (unit() - 0.5f) * 2.0f * halfSide;
+        p.z = (unit() - 0.5f) * 2.0f * halfSide;
+        p.y = std::sin(p.x * 0.1f) * std::cos(p.z * 0.1f);
+        p.rotation = unit() * 6.2831853f;
+        p.tilt = (unit() - 0.5f) * tiltRange;
+        p.height = height * (0.8f + unit() * 0.4f);
+        return p;
+    };
+    for (size_t i = 0; i < bladeCount + rockCount + leafCount; i++) {
+        GameObject object = {};
+        std::snprintf(object.name, sizeof(object.name), "object%zu", i);
+        object.kind = i < bladeCount ? GRASS : i < bladeCount + rockCount ? ROCK : LEAF;
+        object.placement = object.kind == ROCK ? place(0.2f, 0.5f) : object.kind == LEAF ? place(3.0f, 0.1f) : place(0.35f, 1.0f);
+        object.sway.phase = unit() * 6.2831853f;
+        object.drift = {(unit() - 0.5f) * 4.0f, (unit() - 0.5f) * 4.0f};
+        object.radius = object.placement.height;
+        object.health = 100.0f;
+        object.instance.color = Vector3(1.0f, 1.0f, 1.0f);
+        buildInstance(object.placement, 0.0f, object.instance);
+        objects.push_back(object);
+
+        for (EntityWorld* world : {&serialWorld, &parallelWorld}) {
+            CullRadius radius = {object.radius};
+            Visible visible = {0};
+            if (object.kind == GRASS) {
+                world->create(object.placement, object.sway, radius, visible, object.instance);
+            } else if (object.kind == ROCK) {
+                world->create(object.placement, radius, visible, object.instance);
+            } else {
+                world->create(object.placement, object.drift, radius, visible, object.instance);
+            }
+        }
+    }
+    std::printf("bench_ecs: %zu objects (%zu bytes each as GameObject), %zu archetypes in %zu chunks of %zu KB\n",
+                objects.size(), sizeof(GameObject), serialWorld.getArchetypeCount(), serialWorld.getChunkCount(),
+                EntityChunk::SIZE / 1024);
+
+    std::vector<InstanceData> gathered;
+    gathered.reserve(objects.size());
+    size_t respawns = 0;
+
+    // Every system walks all objects and skips the kinds it does not handle
+    Layout gameObjects = {"gameObjects"};
+    runFrames(gameObjects, frames, [&](int frame) {
+        float time = frame * TIME_STEP;
+        Frustum frustum = frameFrustum(frame, halfSide);
+        auto start = std::chrono::steady_clock::now();
+        for (GameObject& object : objects) {
+            if (object.kind == LEAF && !drift(object.placement, object.drift, halfSide)) {
+                object.placement = respawned(object.placement, halfSide);
+                respawns++;
+            }
+        }
+        gameObjects.driftMs += since(start);
+        for (GameObject& object : objects) {
+            if (object.kind == GRASS) buildInstance(object.placement, swayAt(object.sway, time), object.instance);
+            if (object.kind == LEAF) buildInstance(object.placement, 0.0f, object.instance);
+        }
+        gameObjects.windMs += since(start);
+        for (GameObject& object : objects) object.visible = inFrustum(frustum, object.placement, object.radius);
+        gameObjects.cullMs += since(start);
+        gathered.clear();
+        for (const GameObject& object : objects) {
+            if (object.visible) gathered.push_back(object.instance);
+        }
+        gameObjects.gatherMs += since(start);
+    });
+    gameObjects.visible = gathered.size();
+    gameObjects.hash = hashInstances(gathered);
+
+    // The queries only reach the archetypes that have the components, and
+    // each walks just the arrays it names
+    EntityCommandBuffer commands;
+    std::atomic<size_t> worldRespawns(0);
+    auto runWorld = [&](EntityWorld& world, Layout& layout, bool parallel) {
+        runFrames(layout, frames, [&](int frame) {
+            float time = frame * TIME_STEP;
+            Frustum frustum = frameFrustum(frame, halfSide);
+            auto driftSystem = [&](Entity entity, Placement& p, Drift& d, CullRadius& r, InstanceData& instance) {
+                if (drift(p, d, halfSide)) return;
+                worldRespawns++;
+                commands.destroy(entity);
+                commands.create(respawned(p, halfSide), d, r, Visible{0}, instance);
+            };
+            auto windSystem = [&](Entity, const Placement& p, const Sway& s, InstanceData& instance) {
+                buildInstance(p, swayAt(s, time), instance);
+            };
+            auto leafSystem = [&](Entity, const Placement& p, const Drift&, InstanceData& instance) {
+                buildInstance(p, 0.0f, instance);
+            };
+            auto cullSystem = [&](Entity, const Placement& p, const CullRadius& r, Visible& visible) {
+                visible.value = inFrustum(frustum, p, r.radius);
+            };
+
+            auto start = std::chrono::steady_clock::now();
+            if (parallel) {
+                world.parallelEach<Placement, Drift, CullRadius, InstanceData>(driftSystem);
+            } else {
+                world.each<Placement, Drift, CullRadius, InstanceData>(driftSystem);
+            }
+            commands.playback(world);
+            layout.driftMs += since(start);
+            if (parallel) {
+                world.parallelEach<Placement, Sway, InstanceData>(windSystem);
+                world.parallelEach<Placement, Drift, InstanceData>(leafSystem);
+            } else {
+                world.each<Placement, Sway, InstanceData>(windSystem);
+                world.each<Placement, Drift, InstanceData>(leafSystem);
+            }
+            layout.windMs += since(start);
+            if (parallel) {
+                world.parallelEach<Placement, CullRadius, Visible>(cullSystem);
+            } else {
+                world.each<Placement, CullRadius, Visible>(cullSystem);
+            }
+            layout.cullMs += since(start);
+            gathered.clear();
+            world.eachChunk<InstanceData, Visible>(
+                [&](const Entity*, const InstanceData* instances, const Visible* visible, size_t count) {
+                    for (size_t i = 0; i < count; i++) {
+                        if (visible[i].value) gathered.push_back(instances[i]);
+                    }
+                });
+            layout.gatherMs += since(start);
+        });
+        layout.visible = gathered.size();
+        layout.hash = hashInstances(gathered);
+    };
+
+    Layout serial = {"ecsEach"};
+    runWorld(serialWorld, serial, false);
+    size_t serialRespawns = worldRespawns.exchange(0);
+    JobSystem::init(static_cast<int>(std::thread::hardware_concurrency()));
+    Layout parallel = {"ecsParallelEach"};
+    runWorld(parallelWorld, parallel, true);
+    JobSystem::shutdown();
+
+    bool matches = serial.visible == gameObjects.visible && serial.hash == gameObjects.hash &&
+                   parallel.visible == gameObjects.visible && parallel.hash == gameObjects.hash &&
+                   serialRespawns == respawns && worldRespawns == respawns &&
+                   serialWorld.size() == objects.size() && parallelWorld.size() == objects.size() &&
+                   serialWorld.count<Drift>() == leafCount;
+
+    Layout* layouts[] = {&gameObjects, &serial, &parallel};
+    for (Layout* layout : layouts) {
+        std::printf("bench_ecs: %-15s %8.3f ms/frame (drift %.3f, wind %.3f, cull %.3f, gather %.3f), %zu visible\n",
+                    layout->name, layout->msPerFrame, layout->driftMs, layout->windMs, layout->cullMs,
+                    layout->gatherMs, layout->visible);
+    }
+    std::printf("bench_ecs: %zu leaves respawned through the command buffer, %s\n", respawns,
+                matches ? "all layouts gather the same instances" : "LAYOUTS DIFFER");
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"ecs\",\n");
+    std::fprintf(out, "  \"objects\": %zu,\n  \"frames\": %d,\n", objects.size(), frames);
+    std::fprintf(out, "  \"gameObjectBytes\": %zu,\n  \"archetypes\": %zu,\n  \"chunks\": %zu,\n", sizeof(GameObject),
+                 serialWorld.getArchetypeCount(), serialWorld.getChunkCount());
+    std::fprintf(out, "  \"respawns\": %zu,\n  \"matches\": %s,\n", respawns, matches ? "true" : "false");
+    std::fprintf(out, "  \"layouts\": [\n");
+    for (size_t i = 0; i < 3; i++) {
+        const Layout& layout = *layouts[i];
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"msPerFrame\": %.4f, \"driftMs\": %.4f, \"windMs\": %.4f, "
+                     "\"cullMs\": %.4f, \"gatherMs\": %.4f, \"visible\": %zu}%s\n",
+                     layout.name, layout.msPerFrame, layout.driftMs, layout.windMs, layout.cullMs, layout.gatherMs,
+                     layout.visible, i + 1 < 3 ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return matches ? 0 : -1;
+}
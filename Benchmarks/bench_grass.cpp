@@ -0,0 +1,258 @@
+// Frame time of the grass scene along a scripted camera path, rendered
+// offscreen so it runs on machines without a display or GPU. The seed, the
+// path and the simulated clock are fixed, so two runs draw the same frames
+// and differences in the report come from the code (or the machine) only.
+//
+//   bench_grass [--frames N] [--seed N] [--output file.json] [--shaders dir]
+//               [--shader-cache dir] [--no-multi-draw] [--lod-pixel-error N]
+//               [--procedural-grass N] [--occlusion-width N]
+//
+// --procedural-grass draws N blades generated in the vertex shader instead
+// of the placed instances (see ProceduralGrass). --occlusion-width sets the
+// columns of the CPU depth buffer foliage is occlusion culled against (off
+// by default, as in GrassSceneSettings); the report counts the foliage
+// instances culled each way per frame.
+//
+// Startup is measured twice: cold with the shader cache emptied first, then
+// warm from the binaries the cold start stored. Drivers with their own cache
+// (Mesa's, unless MESA_SHADER_CACHE_DISABLE=true) make the cold start
+// warmer than a true first launch.
+//
+// The report is written as JSON to the output file (bench_grass.json by
+// default), with a one-line summary on stdout.
+#include "../Engine/Rendering/HeadlessContext.h"
+#include "../Engine/Rendering/ShaderCache.h"
+#include "../Engine/Camera.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/JobSystem.h"
+#include "../Scenes/GrassScene.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "Engine/Rendering/Shaders"
+#endif
+
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const float TIME_STEP = 1.0f / 60.0f;
+
+// One lap around the field that sweeps in over the grass and back out over
+// the streamed terrain, always looking at the center
+static void placeCamera(Camera& camera, const GrassScene& scene, float lap) {
+    float angle = lap * 2.0f * static_cast<float>(M_PI);
+    float radius = 35.0f + 25.0f * std::cos(angle * 3.0f);
+    float x = radius * std::cos(angle);
+    float z = radius * std::sin(angle);
+
+    camera.position = Vector3(x, scene.getGroundHeight(x, z) + 6.0f + 4.0f * std::sin(angle * 2.0f), z);
+    camera.rotate(angle * 180.0f / static_cast<float>(M_PI) + 180.0f, -15.0f);
+}
+
+struct StartupStats {
+    double ms = 0.0;
+    ShaderCacheStats shaderCache;
+};
+
+// Construct and initialize the scene, timing everything up to the first frame
+static std::unique_ptr<GrassScene> startScene(const GrassSceneSettings& settings, const std::string& shaderDirectory,
+                                              StartupStats& startup) {
+    ShaderCache::resetStats();
+    auto start = std::chrono::steady_clock::now();
+    auto scene = std::make_unique<GrassScene>(settings);
+    if (!scene->init(shaderDirectory)) return nullptr;
+    startup.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    startup.shaderCache = ShaderCache::getStats();
+    return scene;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    // Nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    unsigned int seed = 1;
+    const char* outputPath = "bench_grass.json";
+    std::string shaderDirectory = ENGINE_SHADER_DIR;
+    std::string shaderCacheDirectory = "bench_shader_cache";
+    bool multiDraw = true;
+    float lodPixelError = 1.0f;
+    size_t proceduralGrass = 0;
+    int occlusionWidth = GrassSceneSettings().occlusionWidth;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--shaders") == 0 && hasValue) {
+            shaderDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--shader-cache") == 0 && hasValue) {
+            shaderCacheDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--no-multi-draw") == 0) {
+            multiDraw = false;
+        } else if (strcmp(argv[i], "--lod-pixel-error") == 0 && hasValue) {
+            lodPixelError = std::max(0.0f, static_cast<float>(atof(argv[++i])));
+        } else if (strcmp(argv[i], "--procedural-grass") == 0 && hasValue) {
+            proceduralGrass = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--occlusion-width") == 0 && hasValue) {
+            occlusionWidth = std::max(0, atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "Usage: %s [--frames N] [--seed N] [--output file.json] [--shaders dir] "
+                                 "[--shader-cache dir] [--no-multi-draw] [--lod-pixel-error N] "
+                                 "[--procedural-grass N] [--occlusion-width N]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    HeadlessContext context(WIDTH, HEIGHT);
+    if (!context.init()) {
+        std::fprintf(stderr, "Failed to create headless context\n");
+        return -1;
+    }
+
+    JobSystem::init();
+
+    // Keep every chunk the path touches resident, so the timed lap never
+    // waits on terrain generation and all runs stream the same way
+    GrassSceneSettings settings;
+    settings.seed = seed;
+    settings.terrainCacheCapacity = 1024;
+    settings.multiDraw = multiDraw;
+    settings.lodPixelError = lodPixelError;
+    settings.proceduralGrass = proceduralGrass;
+    settings.occlusionWidth = occlusionWidth;
+
+    ShaderCache::setDirectory(shaderCacheDirectory);
+    ShaderCache::clear();
+    StartupStats cold, warm;
+    if (!startScene(settings, shaderDirectory, cold)) {
+        return -1;
+    }
+    std::unique_ptr<GrassScene> scenePointer = startScene(settings, shaderDirectory, warm);
+    if (!scenePointer) {
+        return -1;
+    }
+    GrassScene& scene = *scenePointer;
+
+    const float aspect = static_cast<float>(WIDTH) / HEIGHT;
+    Camera camera;
+
+    // Untimed lap: loads the terrain along the path, warms up the driver and
+    // counts the work per frame
+    Profiler::setHistorySize(frames);
+    Profiler::setEnabled(true);
+    double grassBlades = 0.0;
+    FoliageStats foliage;
+    double occlusionMs = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        Profiler::beginFrame();
+        placeCamera(camera, scene, static_cast<float>(frame) / frames);
+        scene.getTerrain().waitUntilLoaded(camera.position);
+        scene.update(camera, frame * TIME_STEP);
+        context.clear();
+        scene.render(camera, aspect);
+        grassBlades += scene.getProceduralGrass().getStats().drawnBlades;
+        const FoliageStats& frameFoliage = scene.getFoliageStats();
+        foliage.instances += frameFoliage.instances;
+        foliage.frustumCulled += frameFoliage.frustumCulled;
+        foliage.occluded += frameFoliage.occluded;
+        foliage.drawn += frameFoliage.drawn;
+        occlusionMs += scene.getOcclusion().getStats().renderMs;
+        Profiler::endFrame();
+    }
+    context.finish();
+
+    double drawCalls = 0.0;
+    double triangles = 0.0;
+    double streamBytes = 0.0;
+    for (const FrameStats& stats : Profiler::getHistory()) {
+        drawCalls += stats.counters.drawCalls;
+        triangles += stats.counters.triangles;
+        streamBytes += static_cast<double>(stats.counters.streamBytes);
+    }
+    drawCalls /= frames;
+    triangles /= frames;
+    streamBytes /= frames;
+    Profiler::setEnabled(false);
+
+    // Timed lap. Each frame ends with glFinish so its GPU work is included
+    std::vector<double> frameMs(frames);
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        placeCamera(camera, scene, static_cast<float>(frame) / frames);
+        scene.update(camera, frame * TIME_STEP);
+        context.clear();
+        scene.render(camera, aspect);
+        context.finish();
+        auto end = std::chrono::steady_clock::now();
+        frameMs[frame] = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    double total = 0.0;
+    for (double ms : frameMs) total += ms;
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+
+    std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    renderer.erase(std::remove(renderer.begin(), renderer.end(), '"'), renderer.end());
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"grass\",\n");
+    std::fprintf(out, "  \"renderer\": \"%s\",\n", renderer.c_str());
+    std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", WIDTH, HEIGHT);
+    std::fprintf(out, "  \"seed\": %u,\n  \"frames\": %d,\n", seed, frames);
+    std::fprintf(out, "  \"multiDraw\": %s,\n", scene.getRenderQueue().isMultiDraw() ? "true" : "false");
+    std::fprintf(out, "  \"lodPixelError\": %.2f,\n", lodPixelError);
+    std::fprintf(out, "  \"proceduralGrass\": {\"blades\": %zu, \"drawnBladesPerFrame\": %.0f},\n",
+                 scene.getProceduralGrass().getBladeCount(), grassBlades / frames);
+    std::fprintf(out, "  \"frameMs\": {\"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+                 total / frames, percentile(sorted, 50.0), percentile(sorted, 95.0), percentile(sorted, 99.0),
+                 sorted.back());
+    std::fprintf(out, "  \"startupMs\": {\"cold\": %.3f, \"warm\": %.3f},\n", cold.ms, warm.ms);
+    std::fprintf(out, "  \"shaderCache\": {\"cold\": {\"hits\": %u, \"misses\": %u, \"stored\": %u}, "
+                      "\"warm\": {\"hits\": %u, \"misses\": %u, \"rejected\": %u}},\n",
+                 cold.shaderCache.hits, cold.shaderCache.misses, cold.shaderCache.stored,
+                 warm.shaderCache.hits, warm.shaderCache.misses, warm.shaderCache.rejected);
+    std::fprintf(out, "  \"foliagePerFrame\": {\"instances\": %.0f, \"frustumCulled\": %.1f, \"occluded\": %.1f, "
+                      "\"drawn\": %.1f},\n",
+                 static_cast<double>(foliage.instances) / frames, static_cast<double>(foliage.frustumCulled) / frames,
+                 static_cast<double>(foliage.occluded) / frames, static_cast<double>(foliage.drawn) / frames);
+    std::fprintf(out, "  \"occlusion\": {\"width\": %d, \"renderMs\": %.3f},\n", occlusionWidth,
+                 occlusionMs / frames);
+    std::fprintf(out, "  \"drawCallsPerFrame\": %.1f,\n", drawCalls);
+    std::fprintf(out, "  \"trianglesPerFrame\": %.0f,\n", triangles);
+    const StreamBufferStats& stream = scene.getRenderQueue().getStreamStats();
+    std::fprintf(out, "  \"stream\": {\"persistent\": %s, \"bytesPerFrame\": %.0f, \"stalls\": %llu, "
+                      "\"stallMs\": %.3f, \"grows\": %llu}\n",
+                 scene.getRenderQueue().isStreamPersistent() ? "true" : "false", streamBytes,
+                 static_cast<unsigned long long>(stream.stalls), stream.stallMs,
+                 static_cast<unsigned long long>(stream.grows));
+    std::fprintf(out, "}\n");
+
+    std::fclose(out);
+
+    std::printf("bench_grass: startup cold %.1f ms, warm %.1f ms; %d frames, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms -> %s\n",
+                cold.ms, warm.ms, frames, percentile(sorted, 50.0), percentile(sorted, 95.0), percentile(sorted, 99.0),
+                outputPath);
+    return 0;
+}
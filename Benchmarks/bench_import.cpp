@@ -0,0 +1,368 @@
+// OBJ import throughput of ModelImporter against a naive parser (getline,
+// a stringstream per line and a std::map of corners), on a generated
+// vegetation pack: thousands of grass clumps and leafy plants with
+// positions, uvs and normals, the way the artists' exports look. The pack is
+// written once and reused while it has the requested size.
+//
+// The naive parser only reads the first --naive-megabytes of the file (it
+// takes minutes for the whole pack); both report MB/s.
+//
+// The GLB path is checked on a small generated file first: one triangle drawn
+// by an identity node, a node rotated 90 degrees about z and a node mirrored
+// by scale (-1, 1, 1), each with and without a NORMAL attribute. Positions
+// must come out transformed, only the mirrored copies may have their winding
+// reversed, and every normal (transformed or generated) must match the
+// geometric normal of its transformed, rewound triangle.
+#include "../Engine/ModelImporter.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// One plant: a fan of bent blades, each a strip of quads
+static void writePlant(FILE* out, unsigned int& seed, size_t& vertexBase, float x, float z) {
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    const int blades = 12;
+    const int segments = 6;
+    for (int b = 0; b < blades; b++) {
+        float angle = random() * 6.2831853f;
+        float height = 0.4f + random() * 0.6f;
+        float bend = random() * 0.3f;
+        float dx = std::cos(angle), dz = std::sin(angle);
+        for (int s = 0; s <= segments; s++) {
+            float t = static_cast<float>(s) / segments;
+            float width = 0.04f * (1.0f - t);
+            float offset = bend * t * t;
+            float y = height * t;
+            for (int side = 0; side < 2; side++) {
+                float w = side ? width : -width;
+                std::fprintf(out, "v %.6f %.6f %.6f\n", x + dx * offset - dz * w, y, z + dz * offset + dx * w);
+            }
+            std::fprintf(out, "vt 0.000000 %.6f\nvt 1.000000 %.6f\n", t, t);
+            std::fprintf(out, "vn %.6f %.6f %.6f\n", -dx * t, 1.0f - t * 0.5f, -dz * t);
+        }
+        for (int s = 0; s < segments; s++) {
+            size_t v = vertexBase + s * 2 + 1;
+            size_t n = vertexBase / 2 + s + 1;
+            std::fprintf(out, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", v, v, n, v + 1, v + 1, n, v + 3,
+                         v + 3, n + 1, v + 2, v + 2, n + 1);
+        }
+        vertexBase += (segments + 1) * 2;
+    }
+}
+
+static bool writePack(const std::string& path, size_t megabytes) {
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) return false;
+    std::fprintf(out, "# Generated vegetation pack\n");
+    unsigned int seed = 12345;
+    size_t vertexBase = 0;
+    size_t target = megabytes * 1024 * 1024;
+    for (int plant = 0; static_cast<size_t>(std::ftell(out)) < target; plant++) {
+        if (plant % 64 == 0) std::fprintf(out, "o clump_%d\nusemtl grass\ns 1\n", plant / 64);
+        writePlant(out, seed, vertexBase, (plant % 512) * 0.5f, (plant / 512) * 0.5f);
+    }
+    std::fclose(out);
+    return true;
+}
+
+// The parser this replaces: one string per line and per token, a tree map
+// for deduplication
+static bool naiveParse(const std::string& path, size_t byteLimit, ModelData& model, size_t& bytesRead) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    std::vector<Vector3> positions, texCoords, normals;
+    std::map<std::tuple<int, int, int>, unsigned int> corners;
+    std::string line;
+    bytesRead = 0;
+    while (bytesRead < byteLimit && std::getline(file, line)) {
+        bytesRead += line.size() + 1;
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if (keyword == "v") {
+            Vector3 v;
+            stream >> v.x >> v.y >> v.z;
+            positions.push_back(v);
+        } else if (keyword == "vt") {
+            Vector3 v;
+            stream >> v.x >> v.y;
+            texCoords.push_back(v);
+        } else if (keyword == "vn") {
+            Vector3 v;
+            stream >> v.x >> v.y >> v.z;
+            normals.push_back(v);
+        } else if (keyword == "f") {
+            std::vector<unsigned int> face;
+            std::string token;
+            while (stream >> token) {
+                int p = 0, t = 0, n = 0;
+                std::sscanf(token.c_str(), "%d/%d/%d", &p, &t, &n);
+                auto key = std::make_tuple(p, t, n);
+                auto found = corners.find(key);
+                if (found == corners.end()) {
+                    Vertex vertex;
+                    vertex.position = positions[p - 1];
+                    vertex.texCoords = texCoords[t - 1];
+                    vertex.normal = normals[n - 1];
+                    vertex.color = Vector3(1.0f, 1.0f, 1.0f);
+                    found = corners.emplace(key, static_cast<unsigned int>(model.vertices.size())).first;
+                    model.vertices.push_back(vertex);
+                }
+                face.push_back(found->second);
+            }
+            for (size_t i = 2; i < face.size(); i++) {
+                model.indices.push_back(face[0]);
+                model.indices.push_back(face[i - 1]);
+                model.indices.push_back(face[i]);
+            }
+        }
+    }
+    return true;
+}
+
+// One triangle facing +y, in two meshes: with and without NORMAL
+static const float GLB_POSITIONS[9] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f};
+static const float GLB_NORMALS[9] = {0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+static const uint16_t GLB_INDICES[3] = {0, 1, 2};
+
+struct GlbNode {
+    const char* transform;  // JSON members
+    float matrix[9];        // The same as a row-major 3x3
+    bool mirrored;
+};
+
+static const GlbNode GLB_NODES[3] = {
+    {"", {1, 0, 0, 0, 1, 0, 0, 0, 1}, false},
+    {"\"rotation\": [0, 0, 0.70710678, 0.70710678]", {0, -1, 0, 1, 0, 0, 0, 0, 1}, false},
+    {"\"scale\": [-1, 1, 1]", {-1, 0, 0, 0, 1, 0, 0, 0, 1}, true},
+};
+
+static std::vector<uint8_t> makeGlb() {
+    std::string json = "{\"asset\": {\"version\": \"2.0\"}, \"scene\": 0, \"scenes\": [{\"nodes\": [0, 1, 2, 3, 4, 5]}], "
+                       "\"nodes\": [";
+    for (int i = 0; i < 6; i++) {
+        const char* transform = GLB_NODES[i / 2].transform;
+        json += std::string(i ? ", " : "") + "{\"mesh\": " + std::to_string(i % 2) + (*transform ? ", " : "") +
+                transform + "}";
+    }
+    json += "], \"meshes\": ["
+            "{\"primitives\": [{\"attributes\": {\"POSITION\": 0, \"NORMAL\": 1}, \"indices\": 2}]}, "
+            "{\"primitives\": [{\"attributes\": {\"POSITION\": 0}, \"indices\": 2}]}], "
+            "\"accessors\": ["
+            "{\"bufferView\": 0, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"}, "
+            "{\"bufferView\": 1, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"}, "
+            "{\"bufferView\": 2, \"componentType\": 5123, \"count\": 3, \"type\": \"SCALAR\"}], "
+            "\"bufferViews\": [{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": 36}, "
+            "{\"buffer\": 0, \"byteOffset\": 36, \"byteLength\": 36}, "
+            "{\"buffer\": 0, \"byteOffset\": 72, \"byteLength\": 6}], "
+            "\"buffers\": [{\"byteLength\": 78}]}";
+    while (json.size() % 4) json += ' ';
+
+    std::vector<uint8_t> binary(80, 0);
+    std::memcpy(binary.data(), GLB_POSITIONS, 36);
+    std::memcpy(binary.data() + 36, GLB_NORMALS, 36);
+    std::memcpy(binary.data() + 72, GLB_INDICES, 6);
+
+    uint32_t header[5] = {0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binary.size()),
+                          static_cast<uint32_t>(json.size()), 0x4E4F534A};
+    uint32_t binaryHeader[2] = {static_cast<uint32_t>(binary.size()), 0x004E4942};
+    std::vector<uint8_t> glb(reinterpret_cast<uint8_t*>(header), reinterpret_cast<uint8_t*>(header) + 20);
+    glb.insert(glb.end(), json.begin(), json.end());
+    glb.insert(glb.end(), reinterpret_cast<uint8_t*>(binaryHeader), reinterpret_cast<uint8_t*>(binaryHeader) + 8);
+    glb.insert(glb.end(), binary.begin(), binary.end());
+    return glb;
+}
+
+// Number of failed checks, each printed
+static int checkGlb() {
+    std::vector<uint8_t> glb = makeGlb();
+    ModelData model;
+    if (!ModelImporter::parseGlb(glb.data(), glb.size(), model)) {
+        std::printf("bench_import: GLB check: the generated file did not load\n");
+        return 1;
+    }
+    if (model.vertices.size() != 18 || model.indices.size() != 18) {
+        std::printf("bench_import: GLB check: %zu vertices and %zu indices, expected 18 and 18\n",
+                    model.vertices.size(), model.indices.size());
+        return 1;
+    }
+
+    const float tolerance = 1e-5f;
+    auto near = [&](const Vector3& a, const Vector3& b) {
+        return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance &&
+               std::fabs(a.z - b.z) <= tolerance;
+    };
+    int failures = 0;
+    for (int draw = 0; draw < 6; draw++) {
+        const GlbNode& node = GLB_NODES[draw / 2];
+        const char* name[] = {"identity", "rotated", "mirrored"};
+        const char* normals = draw % 2 == 0 ? "with NORMAL" : "without NORMAL";
+        unsigned int base = static_cast<unsigned int>(draw * 3);
+        const float* m = node.matrix;
+        for (int i = 0; i < 3; i++) {
+            const float* p = GLB_POSITIONS + i * 3;
+            Vector3 expected(m[0] * p[0] + m[1] * p[1] + m[2] * p[2], m[3] * p[0] + m[4] * p[1] + m[5] * p[2],
+                             m[6] * p[0] + m[7] * p[1] + m[8] * p[2]);
+            if (!near(model.vertices[base + i].position, expected)) {
+                std::printf("bench_import: GLB check: %s node %s, vertex %d is not transformed\n", name[draw / 2],
+                            normals, i);
+                failures++;
+            }
+        }
+
+        const unsigned int* triangle = model.indices.data() + draw * 3;
+        bool reversed = triangle[0] == base && triangle[1] == base + 2 && triangle[2] == base + 1;
+        bool kept = triangle[0] == base && triangle[1] == base + 1 && triangle[2] == base + 2;
+        if (!(node.mirrored ? reversed : kept)) {
+            std::printf("bench_import: GLB check: %s node %s, winding %s\n", name[draw / 2], normals,
+                        node.mirrored ? "not reversed" : "changed");
+            failures++;
+        }
+
+        Vector3 a = model.vertices[triangle[0]].position;
+        Vector3 geometric = (model.vertices[triangle[1]].position - a)
+                                .crossProduct(model.vertices[triangle[2]].position - a)
+                                .normalize();
+        for (int i = 0; i < 3; i++) {
+            if (!near(model.vertices[base + i].normal, geometric)) {
+                std::printf("bench_import: GLB check: %s node %s, normal of vertex %d is (%.2f, %.2f, %.2f), "
+                            "the triangle faces (%.2f, %.2f, %.2f)\n",
+                            name[draw / 2], normals, i, model.vertices[base + i].normal.x,
+                            model.vertices[base + i].normal.y, model.vertices[base + i].normal.z, geometric.x,
+                            geometric.y, geometric.z);
+                failures++;
+            }
+        }
+    }
+    std::printf("bench_import: GLB check: identity, rotated and mirrored nodes with and without normals, %s\n",
+                failures == 0 ? "all correct" : "FAILED");
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = "bench_import.json";
+    std::string packPath = "bench_import_pack.obj";
+    size_t megabytes = 256;
+    size_t naiveMegabytes = 16;
+    int repeat = 3;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--megabytes") == 0 && hasValue) {
+            megabytes = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--naive-megabytes") == 0 && hasValue) {
+            naiveMegabytes = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--file") == 0 && hasValue) {
+            packPath = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--megabytes N] [--naive-megabytes N] [--file pack.obj] [--repeat N]"
+                         " [--threads N] [--output file.json]\n",
+                         argv[0]);
+            return -1;
+        }
+    }
+
+    std::error_code error;
+    size_t existing = std::filesystem::file_size(packPath, error);
+    if (error || existing < megabytes * 1024 * 1024 || existing > (megabytes + 1) * 1024 * 1024) {
+        std::printf("bench_import: writing a %zu MB vegetation pack to %s\n", megabytes, packPath.c_str());
+        if (!writePack(packPath, megabytes)) {
+            std::fprintf(stderr, "Failed to write %s\n", packPath.c_str());
+            return -1;
+        }
+    }
+    JobSystem::init(threads);
+    int glbFailures = checkGlb();
+
+    // The file is mapped once, so every run parses from memory
+    MappedFile file;
+    if (!file.open(packPath)) return -1;
+    double fileMb = file.getSize() / (1024.0 * 1024.0);
+
+    ModelImportStats best;
+    ModelData model;
+    for (int run = 0; run < repeat; run++) {
+        ModelData imported;
+        ModelImportStats stats;
+        if (!ModelImporter::parseObj(reinterpret_cast<const char*>(file.getData()), file.getSize(), imported,
+                                     &stats)) {
+            return -1;
+        }
+        if (run == 0 || stats.totalMs < best.totalMs) best = stats;
+        if (run == 0) model = std::move(imported);
+    }
+    double importerMbs = fileMb * 1000.0 / best.totalMs;
+    std::printf("bench_import: importer %.1f MB in %.1f ms (parse %.1f, dedupe %.1f) = %.1f MB/s on %d threads, "
+                "%zu chunks, %zu vertices, %zu triangles\n",
+                fileMb, best.totalMs, best.parseMs, best.dedupeMs, importerMbs, JobSystem::getThreadCount(),
+                best.chunks, model.vertices.size(), model.indices.size() / 3);
+
+    double naiveMbs = 0.0;
+    double naiveMs = 0.0;
+    size_t naiveBytes = 0;
+    bool matches = false;
+    if (naiveMegabytes > 0) {
+        ModelData naive;
+        auto start = std::chrono::steady_clock::now();
+        naiveParse(packPath, naiveMegabytes * 1024 * 1024, naive, naiveBytes);
+        naiveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        naiveMbs = naiveBytes / (1024.0 * 1024.0) * 1000.0 / naiveMs;
+
+        // Same geometry for the part both parsed: every naive triangle is in
+        // the import, corner by corner
+        matches = naive.indices.size() <= model.indices.size();
+        for (size_t i = 0; matches && i < naive.indices.size(); i++) {
+            const Vertex& a = naive.vertices[naive.indices[i]];
+            const Vertex& b = model.vertices[model.indices[i]];
+            matches = a.position == b.position && a.normal == b.normal && a.texCoords.x == b.texCoords.x &&
+                      a.texCoords.y == b.texCoords.y;
+        }
+        std::printf("bench_import: naive    %.1f MB in %.1f ms = %.1f MB/s, importer is %.1fx faster, %s\n",
+                    naiveBytes / (1024.0 * 1024.0), naiveMs, naiveMbs, importerMbs / naiveMbs,
+                    matches ? "same triangles" : "TRIANGLES DIFFER");
+    }
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"import\",\n");
+    std::fprintf(out, "  \"fileMegabytes\": %.1f,\n  \"threads\": %d,\n  \"repeat\": %d,\n", fileMb,
+                 JobSystem::getThreadCount(), repeat);
+    std::fprintf(out, "  \"vertices\": %zu,\n  \"triangles\": %zu,\n  \"chunks\": %zu,\n", model.vertices.size(),
+                 model.indices.size() / 3, best.chunks);
+    std::fprintf(out, "  \"importer\": {\"ms\": %.2f, \"parseMs\": %.2f, \"dedupeMs\": %.2f, \"megabytesPerSecond\": %.1f},\n",
+                 best.totalMs, best.parseMs, best.dedupeMs, importerMbs);
+    std::fprintf(out, "  \"naive\": {\"megabytes\": %.1f, \"ms\": %.2f, \"megabytesPerSecond\": %.1f, \"matches\": %s},\n",
+                 naiveBytes / (1024.0 * 1024.0), naiveMs, naiveMbs, matches ? "true" : "false");
+    std::fprintf(out, "  \"glbCheckFailures\": %d\n", glbFailures);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    JobSystem::shutdown();
+    return glbFailures == 0 ? 0 : -1;
+}
@@ -0,0 +1,169 @@
+// Scaling of the job system on a CPU-side grass instance update: every frame
+// each blade's model matrix is rebuilt from its placement and the wind, the
+// work a scene does when the sway is animated on the CPU instead of in
+// basic.vert. The same frames run with 1, 2, 4... threads up to the hardware
+// thread count, and every run must produce the same bytes as the serial one.
+//
+//   bench_jobs [--blades N] [--frames N] [--max-threads N] [--output file.json]
+//
+// The report is written as JSON to the output file (bench_jobs.json by
+// default), with one line per thread count on stdout.
+#include "../Engine/JobSystem.h"
+#include "../Engine/InstanceBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const float TIME_STEP = 1.0f / 60.0f;
+static const size_t GRAIN = 4096;
+
+// Placement of the blades, structure of arrays as the update streams it
+struct GrassBlades {
+    std::vector<float> x, y, z;
+    std::vector<float> rotation;  // Radians around y
+    std::vector<float> tilt;      // Radians around x at rest
+    std::vector<float> height;
+    std::vector<float> phase;     // Offsets the gusts so neighbours differ
+
+    void place(size_t count, unsigned int seed) {
+        std::mt19937 random(seed);
+        auto unit = [&] { return (random() & 0xffffff) / 16777216.0f; };
+        float side = std::sqrt(static_cast<float>(count)) * 0.25f;
+        for (size_t i = 0; i < count; i++) {
+            x.push_back((unit() - 0.5f) * side);
+            z.push_back((unit() - 0.5f) * side);
+            y.push_back(std::sin(x.back() * 0.1f) * std::cos(z.back() * 0.1f));
+            rotation.push_back(unit() * 6.2831853f);
+            tilt.push_back((unit() - 0.5f) * 0.35f);
+            height.push_back(0.8f + unit() * 0.4f);
+            phase.push_back(unit() * 6.2831853f);
+        }
+    }
+};
+
+// out = T(x, y, z) * Ry(rotation) * Rx(tilt + sway) * S(1, height, 1), column-major
+static void updateBlades(const GrassBlades& blades, float time, size_t begin, size_t end, InstanceData* out) {
+    for (size_t i = begin; i < end; i++) {
+        float sway = std::sin(time * 1.7f + blades.phase[i]) * 0.25f;
+        float cy = std::cos(blades.rotation[i]);
+        float sy = std::sin(blades.rotation[i]);
+        float cx = std::cos(blades.tilt[i] + sway);
+        float sx = std::sin(blades.tilt[i] + sway);
+        float h = blades.height[i];
+
+        InstanceData& instance = out[i];
+        float* m = instance.transform;
+        m[0] = cy;       m[1] = 0.0f;     m[2] = -sy;      m[3] = 0.0f;
+        m[4] = sy * sx * h;  m[5] = cx * h;  m[6] = cy * sx * h;  m[7] = 0.0f;
+        m[8] = sy * cx;  m[9] = -sx;      m[10] = cy * cx; m[11] = 0.0f;
+        m[12] = blades.x[i];  m[13] = blades.y[i];  m[14] = blades.z[i];  m[15] = 1.0f;
+        instance.height = h;
+        instance.intensity = 1.0f - std::fabs(sway);
+        instance.color = Vector3(1.0f, 1.0f, 1.0f);
+        instance.colorMix = 0.0f;
+    }
+}
+
+struct ScalingResult {
+    int threads;
+    double msPerFrame;
+    bool identical;
+};
+
+int main(int argc, char** argv) {
+    size_t bladeCount = 262144;
+    int frames = 120;
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    const char* outputPath = "bench_jobs.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--blades") == 0 && hasValue) {
+            bladeCount = std::max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--max-threads") == 0 && hasValue) {
+            maxThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--blades N] [--frames N] [--max-threads N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+    maxThreads = std::max(1, maxThreads);
+
+    GrassBlades blades;
+    blades.place(bladeCount, 1);
+
+    // Serial reference of the last frame
+    std::vector<InstanceData> reference(bladeCount);
+    updateBlades(blades, (frames - 1) * TIME_STEP, 0, bladeCount, reference.data());
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::vector<InstanceData> instances(bladeCount);
+    std::vector<ScalingResult> results;
+    for (int threads : threadCounts) {
+        JobSystem::init(threads);
+
+        // One untimed frame to wake the workers and fault the pages in
+        JobSystem::parallelFor(bladeCount, GRAIN, [&](size_t begin, size_t end) {
+            updateBlades(blades, 0.0f, begin, end, instances.data());
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            float time = frame * TIME_STEP;
+            JobSystem::parallelFor(bladeCount, GRAIN, [&](size_t begin, size_t end) {
+                updateBlades(blades, time, begin, end, instances.data());
+            });
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        ScalingResult result;
+        result.threads = threads;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+        result.identical = std::memcmp(instances.data(), reference.data(), bladeCount * sizeof(InstanceData)) == 0;
+        results.push_back(result);
+
+        double speedup = results.front().msPerFrame / result.msPerFrame;
+        std::printf("bench_jobs: %2d threads, %.3f ms/frame, speedup %.2fx, efficiency %.0f%%%s\n", threads,
+                    result.msPerFrame, speedup, 100.0 * speedup / threads, result.identical ? "" : ", MISMATCH");
+    }
+    JobSystem::shutdown();
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+
+    bool allIdentical = true;
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"jobs\",\n");
+    std::fprintf(out, "  \"hardwareThreads\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(out, "  \"blades\": %zu,\n  \"frames\": %d,\n", bladeCount, frames);
+    std::fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const ScalingResult& result = results[i];
+        double speedup = results.front().msPerFrame / result.msPerFrame;
+        allIdentical = allIdentical && result.identical;
+        std::fprintf(out, "    {\"threads\": %d, \"msPerFrame\": %.3f, \"speedup\": %.3f, \"efficiency\": %.3f, \"identical\": %s}%s\n",
+                     result.threads, result.msPerFrame, speedup, speedup / result.threads,
+                     result.identical ? "true" : "false", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+
+    return allIdentical ? 0 : -1;
+}
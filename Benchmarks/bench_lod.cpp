@@ -0,0 +1,167 @@
+// Detail chains from MeshSimplifier and what LodSelector draws of them with
+// distance. For every mesh the chain is built with the default settings
+// and each level's triangles and error are reported; then one instance is
+// moved away from a 1080p camera with a 45 degree fov and the triangles of
+// the selected level are recorded at every distance. Runs on the CPU only.
+//
+//   bench_lod [--pixel-error N] [--output file.json]
+//
+// The report is written as JSON to the output file (bench_lod.json by
+// default), with a summary on stdout.
+#include "../Engine/MeshSimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const float VIEWPORT_HEIGHT = 1080.0f;
+
+struct TestMesh {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Same layout as Mesh::createSphere
+static TestMesh makeSphere(int sectors, int stacks) {
+    TestMesh mesh;
+    mesh.name = "sphere_" + std::to_string(sectors) + "x" + std::to_string(stacks);
+    const float PI = 3.14159265359f;
+    for (int i = 0; i <= stacks; ++i) {
+        float stackAngle = PI / 2 - i * PI / stacks;
+        for (int j = 0; j <= sectors; ++j) {
+            float sectorAngle = j * 2 * PI / sectors;
+            Vector3 position(std::cos(stackAngle) * std::cos(sectorAngle), std::sin(stackAngle),
+                             std::cos(stackAngle) * std::sin(sectorAngle));
+            Vector3 color((position.x + 1.0f) * 0.5f, (position.y + 1.0f) * 0.5f, (position.z + 1.0f) * 0.5f);
+            Vector3 texCoords((float)j / sectors, (float)i / stacks, 0.0f);
+            mesh.vertices.push_back({position, color, position, texCoords});
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        unsigned int k1 = i * (sectors + 1);
+        unsigned int k2 = k1 + sectors + 1;
+        for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if (i != 0) mesh.indices.insert(mesh.indices.end(), {k1, k2, k1 + 1});
+            if (i != stacks - 1) mesh.indices.insert(mesh.indices.end(), {k1 + 1, k2, k2 + 1});
+        }
+    }
+    return mesh;
+}
+
+// Rolling hills on an open grid, a terrain-like surface with a border
+static TestMesh makeHills(int n) {
+    TestMesh mesh;
+    mesh.name = "hills_" + std::to_string(n) + "x" + std::to_string(n);
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            float fx = static_cast<float>(x) / (n - 1) * 2.0f - 1.0f;
+            float fz = static_cast<float>(z) / (n - 1) * 2.0f - 1.0f;
+            float h = 0.15f * std::sin(fx * 3.0f) * std::cos(fz * 2.0f);
+            Vector3 texCoords((fx + 1.0f) * 0.5f, (fz + 1.0f) * 0.5f, 0.0f);
+            mesh.vertices.push_back({{fx, h, fz}, Vector3(0.2f, 0.6f, 0.2f), Vector3(0.0f, 1.0f, 0.0f), texCoords});
+        }
+    }
+    for (int z = 0; z + 1 < n; z++) {
+        for (int x = 0; x + 1 < n; x++) {
+            unsigned int topLeft = z * n + x;
+            unsigned int bottomLeft = topLeft + n;
+            mesh.indices.insert(mesh.indices.end(), {topLeft, bottomLeft, topLeft + 1});
+            mesh.indices.insert(mesh.indices.end(), {topLeft + 1, bottomLeft, bottomLeft + 1});
+        }
+    }
+    return mesh;
+}
+
+struct ChainResult {
+    std::string name;
+    float radius;
+    std::vector<MeshLod> lods;
+    double buildMs;
+};
+
+int main(int argc, char** argv) {
+    float pixelError = 1.0f;
+    const char* outputPath = "bench_lod.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--pixel-error") == 0 && hasValue) {
+            pixelError = std::max(0.01f, static_cast<float>(atof(argv[++i])));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--pixel-error N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    std::vector<TestMesh> meshes;
+    meshes.push_back(makeSphere(20, 20));
+    meshes.push_back(makeSphere(128, 64));
+    meshes.push_back(makeHills(65));
+
+    std::vector<ChainResult> results;
+    for (TestMesh& mesh : meshes) {
+        ChainResult result;
+        result.name = mesh.name;
+        result.radius = 1.0f;
+        auto start = std::chrono::steady_clock::now();
+        result.lods = MeshSimplifier::buildLodChain(mesh.vertices, mesh.indices);
+        auto end = std::chrono::steady_clock::now();
+        result.buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+        results.push_back(result);
+
+        std::printf("bench_lod: %-14s %.1f ms,", result.name.c_str(), result.buildMs);
+        for (const MeshLod& lod : result.lods) std::printf(" %u (%.4f)", lod.indexCount / 3, lod.error);
+        std::printf("\n");
+    }
+
+    Camera camera;
+    LodSelector selector = LodSelector::fromCamera(camera, VIEWPORT_HEIGHT, pixelError);
+    std::vector<float> distances;
+    for (float distance = 1.0f; distance <= 1024.0f; distance *= 2.0f) distances.push_back(distance);
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"lod\",\n");
+    std::fprintf(out, "  \"viewportHeight\": %.0f,\n  \"fov\": %.1f,\n  \"pixelError\": %.3f,\n", VIEWPORT_HEIGHT,
+                 camera.fov, pixelError);
+    std::fprintf(out, "  \"meshes\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const ChainResult& result = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"buildMs\": %.3f,\n", result.name.c_str(), result.buildMs);
+        std::fprintf(out, "     \"levels\": [");
+        for (size_t level = 0; level < result.lods.size(); level++) {
+            std::fprintf(out, "%s{\"triangles\": %u, \"error\": %.5f}", level ? ", " : "",
+                         result.lods[level].indexCount / 3, result.lods[level].error);
+        }
+        std::fprintf(out, "],\n     \"byDistance\": [");
+
+        // Distance to the nearest point of the unit bounds
+        std::printf("bench_lod: %-14s triangles by distance:", result.name.c_str());
+        for (size_t d = 0; d < distances.size(); d++) {
+            size_t level = selector.select(result.lods, distances[d]);
+            unsigned int triangles = result.lods[level].indexCount / 3;
+            std::fprintf(out, "%s{\"distance\": %.0f, \"level\": %zu, \"triangles\": %u}", d ? ", " : "",
+                         distances[d], level, triangles);
+            std::printf(" %.0f:%u", distances[d], triangles);
+        }
+        std::printf("\n");
+        std::fprintf(out, "]}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+
+    return 0;
+}
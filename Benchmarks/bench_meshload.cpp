@@ -0,0 +1,212 @@
+// Load time of a set of MeshFile assets from a cold page cache, three ways:
+//   read    read() every file into memory, the I/O floor
+//   copy    read() into a heap buffer, then upload from it
+//   mapped  MeshFile::open (mmap) and createMesh, uploading from the mapping
+// The set is one packed sphere converted once and copied until it reaches
+// --megabytes. Cached pages are dropped before every pass (posix_fadvise),
+// so each pass reads from the device. Wall and process CPU time are reported;
+// a load that is bound by I/O spends most of its wall time off the CPU.
+#include "../Engine/Rendering/HeadlessContext.h"
+#include "../Engine/Mesh.h"
+#include "../Engine/MeshFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct LoadResult {
+    std::string name;
+    double wallMs = 0.0;
+    double cpuMs = 0.0;
+    size_t meshes = 0;
+};
+
+static double cpuNow() {
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+}
+
+static void dropCachedPages(const std::vector<std::string>& paths) {
+    for (const std::string& path : paths) {
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) continue;
+        fdatasync(descriptor);
+        posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+        close(descriptor);
+    }
+}
+
+static bool readWhole(const std::string& path, std::vector<uint8_t>& buffer) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    posix_fadvise(descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+    off_t size = lseek(descriptor, 0, SEEK_END);
+    buffer.resize(static_cast<size_t>(size));
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t bytes = pread(descriptor, buffer.data() + done, buffer.size() - done, static_cast<off_t>(done));
+        if (bytes <= 0) break;
+        done += static_cast<size_t>(bytes);
+    }
+    close(descriptor);
+    return done == buffer.size();
+}
+
+// Arena sized for the whole set, so no pass pays for regrowing it
+static std::shared_ptr<MeshArena> makeArena(const MeshFileHeader& header, size_t count) {
+    size_t indexUnits = (static_cast<size_t>(header.indexCount) * header.indexSize + 3) / 4 + 1;
+    return std::make_shared<MeshArena>(PackedVertexLayout::format(), header.vertexCount * count,
+                                       indexUnits * count);
+}
+
+static LoadResult measure(const char* name, const std::vector<std::string>& paths, const MeshFileHeader& header,
+                          int mode) {
+    dropCachedPages(paths);
+    std::shared_ptr<MeshArena> arena = mode == 0 ? nullptr : makeArena(header, paths.size());
+    std::vector<Mesh> meshes;
+    meshes.reserve(paths.size());
+    std::vector<uint8_t> buffer;
+    size_t filesRead = 0;
+
+    double cpuStart = cpuNow();
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        if (mode == 0) {
+            if (readWhole(path, buffer)) filesRead++;
+        } else if (mode == 1) {
+            if (!readWhole(path, buffer)) continue;
+            const MeshFileHeader* fileHeader = reinterpret_cast<const MeshFileHeader*>(buffer.data());
+            MeshAllocation allocation =
+                arena->allocatePacked(buffer.data() + fileHeader->vertexOffset, fileHeader->vertexCount,
+                                      buffer.data() + fileHeader->indexOffset, fileHeader->indexCount,
+                                      fileHeader->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+            const MeshLod* lods = reinterpret_cast<const MeshLod*>(buffer.data() + fileHeader->lodOffset);
+            meshes.emplace_back(arena, allocation, Bounds(),
+                                std::vector<MeshLod>(lods, lods + fileHeader->lodCount));
+        } else {
+            MeshFile file;
+            if (file.open(path)) meshes.push_back(file.createMesh(arena));
+        }
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+
+    LoadResult result;
+    result.name = name;
+    result.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+    result.cpuMs = cpuNow() - cpuStart;
+    result.meshes = mode == 0 ? filesRead : meshes.size();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = "bench_meshload.json";
+    std::string directory = "bench_meshload_data";  // Not the executable's own name in the build directory
+    size_t megabytes = 256;
+    int repeat = 3;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--megabytes") == 0 && hasValue) {
+            megabytes = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--directory") == 0 && hasValue) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--megabytes N] [--directory dir] [--repeat N] [--output file.json]\n",
+                         argv[0]);
+            return -1;
+        }
+    }
+
+    HeadlessContext context(16, 16);
+    if (!context.init()) return -1;
+
+    // One converted sphere, copied to fill the set
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::fprintf(stderr, "Failed to create %s: %s\n", directory.c_str(), error.message().c_str());
+        return -1;
+    }
+    std::string source = directory + "/sphere.emesh";
+    {
+        Mesh sphere = Mesh::createSphere(1.0f, 256, 128);
+        if (!MeshFile::write(source, sphere, PackedVertexLayout::format())) return -1;
+    }
+    MeshFile sourceFile;
+    if (!sourceFile.open(source)) return -1;
+    MeshFileHeader header = sourceFile.getHeader();
+    size_t fileSize = sourceFile.getFileSize();
+    sourceFile.close();
+
+    size_t count = std::max<size_t>(1, megabytes * 1024 * 1024 / fileSize);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; i++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/mesh%04zu.emesh", i);
+        paths.push_back(directory + name);
+        std::filesystem::copy_file(source, paths.back(), std::filesystem::copy_options::overwrite_existing, error);
+        if (error) {
+            std::fprintf(stderr, "Failed to copy %s to %s: %s\n", source.c_str(), paths.back().c_str(),
+                         error.message().c_str());
+            return -1;
+        }
+    }
+    double totalMb = static_cast<double>(count * fileSize) / (1024.0 * 1024.0);
+    std::printf("bench_meshload: %zu files of %zu bytes (%u vertices, %u levels, %u meshlets), %.1f MB\n", count,
+                fileSize, header.vertexCount, header.lodCount, header.meshletCount, totalMb);
+
+    const char* names[3] = {"read", "copy", "mapped"};
+    LoadResult best[3];
+    for (int run = 0; run < repeat; run++) {
+        for (int mode = 0; mode < 3; mode++) {
+            LoadResult result = measure(names[mode], paths, header, mode);
+            if (run == 0 || result.wallMs < best[mode].wallMs) best[mode] = result;
+        }
+    }
+
+    for (const LoadResult& result : best) {
+        std::printf("bench_meshload: %-6s %8.1f ms wall, %8.1f ms CPU, %7.1f MB/s, %zu meshes\n",
+                    result.name.c_str(), result.wallMs, result.cpuMs, totalMb * 1000.0 / result.wallMs,
+                    result.meshes);
+    }
+    std::printf("bench_meshload: mapped load takes %.2fx the time of reading the files\n",
+                best[2].wallMs / best[0].wallMs);
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"meshload\",\n");
+    std::fprintf(out, "  \"files\": %zu,\n  \"fileBytes\": %zu,\n  \"totalMegabytes\": %.1f,\n", count, fileSize,
+                 totalMb);
+    std::fprintf(out, "  \"vertices\": %u,\n  \"lods\": %u,\n  \"meshlets\": %u,\n", header.vertexCount,
+                 header.lodCount, header.meshletCount);
+    std::fprintf(out, "  \"repeat\": %d,\n", repeat);
+    std::fprintf(out, "  \"paths\": [\n");
+    for (int mode = 0; mode < 3; mode++) {
+        const LoadResult& result = best[mode];
+        std::fprintf(out, "    {\"name\": \"%s\", \"wallMs\": %.2f, \"cpuMs\": %.2f, \"megabytesPerSecond\": %.1f}%s\n",
+                     result.name.c_str(), result.wallMs, result.cpuMs, totalMb * 1000.0 / result.wallMs,
+                     mode < 2 ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"mappedOverRead\": %.3f\n", best[2].wallMs / best[0].wallMs);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return 0;
+}
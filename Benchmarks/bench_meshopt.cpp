@@ -0,0 +1,171 @@
+// Post-transform cache efficiency of the engine's meshes before and after
+// MeshOptimizer: the UV sphere of Mesh::createSphere, a terrain chunk grid
+// in the row-major order TerrainStreamer generates, and the same sphere with
+// its triangles shuffled the way exported or imported files often arrive.
+// Runs on the CPU only, no context needed.
+//
+//   bench_meshopt [--repeat N] [--output file.json]
+//
+// The report is written as JSON to the output file (bench_meshopt.json by
+// default), with one line per mesh on stdout. The optimizer time is the
+// median of N runs.
+#include "../Engine/MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct TestMesh {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Same layout as Mesh::createSphere
+static TestMesh makeSphere(int sectors, int stacks) {
+    TestMesh mesh;
+    mesh.name = "sphere_" + std::to_string(sectors) + "x" + std::to_string(stacks);
+    const float PI = 3.14159265359f;
+    for (int i = 0; i <= stacks; ++i) {
+        float stackAngle = PI / 2 - i * PI / stacks;
+        for (int j = 0; j <= sectors; ++j) {
+            float sectorAngle = j * 2 * PI / sectors;
+            Vector3 position(std::cos(stackAngle) * std::cos(sectorAngle), std::sin(stackAngle),
+                             std::cos(stackAngle) * std::sin(sectorAngle));
+            Vector3 texCoords((float)j / sectors, (float)i / stacks, 0.0f);
+            mesh.vertices.push_back({position, Vector3(1.0f, 1.0f, 1.0f), position, texCoords});
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        unsigned int k1 = i * (sectors + 1);
+        unsigned int k2 = k1 + sectors + 1;
+        for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if (i != 0) mesh.indices.insert(mesh.indices.end(), {k1, k2, k1 + 1});
+            if (i != stacks - 1) mesh.indices.insert(mesh.indices.end(), {k1 + 1, k2, k2 + 1});
+        }
+    }
+    return mesh;
+}
+
+// Full-detail level of a terrain chunk, without the skirts
+static TestMesh makeGrid(int n) {
+    TestMesh mesh;
+    mesh.name = "terrain_" + std::to_string(n) + "x" + std::to_string(n);
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            float h = std::sin(x * 0.3f) * std::cos(z * 0.2f);
+            Vector3 texCoords(static_cast<float>(x) / (n - 1), static_cast<float>(z) / (n - 1), 0.0f);
+            mesh.vertices.push_back({{static_cast<float>(x), h, static_cast<float>(z)}, Vector3(0.2f, 0.6f, 0.2f),
+                                     Vector3(0.0f, 1.0f, 0.0f), texCoords});
+        }
+    }
+    for (int z = 0; z + 1 < n; z++) {
+        for (int x = 0; x + 1 < n; x++) {
+            unsigned int topLeft = z * n + x;
+            unsigned int bottomLeft = topLeft + n;
+            mesh.indices.insert(mesh.indices.end(), {topLeft, bottomLeft, topLeft + 1});
+            mesh.indices.insert(mesh.indices.end(), {topLeft + 1, bottomLeft, bottomLeft + 1});
+        }
+    }
+    return mesh;
+}
+
+static TestMesh shuffleTriangles(TestMesh mesh, unsigned int seed) {
+    mesh.name += "_shuffled";
+    size_t triangleCount = mesh.indices.size() / 3;
+    std::mt19937 random(seed);
+    for (size_t t = triangleCount - 1; t > 0; t--) {
+        size_t other = random() % (t + 1);
+        std::swap_ranges(mesh.indices.begin() + t * 3, mesh.indices.begin() + t * 3 + 3,
+                         mesh.indices.begin() + other * 3);
+    }
+    return mesh;
+}
+
+struct MeshResult {
+    std::string name;
+    size_t vertices;
+    size_t triangles;
+    MeshOptimizeStats stats;
+    double optimizeMs;
+};
+
+int main(int argc, char** argv) {
+    int repeat = 9;
+    const char* outputPath = "bench_meshopt.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--repeat N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    std::vector<TestMesh> meshes;
+    meshes.push_back(makeSphere(20, 20));
+    meshes.push_back(makeSphere(128, 64));
+    meshes.push_back(makeGrid(33));
+    meshes.push_back(makeGrid(129));
+    meshes.push_back(shuffleTriangles(makeSphere(128, 64), 1));
+
+    std::vector<MeshResult> results;
+    for (const TestMesh& mesh : meshes) {
+        MeshResult result;
+        result.name = mesh.name;
+        result.vertices = mesh.vertices.size();
+        result.triangles = mesh.indices.size() / 3;
+
+        std::vector<double> times;
+        for (int run = 0; run < repeat; run++) {
+            std::vector<Vertex> vertices = mesh.vertices;
+            std::vector<unsigned int> indices = mesh.indices;
+            auto start = std::chrono::steady_clock::now();
+            result.stats = MeshOptimizer::optimize(vertices, indices);
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        result.optimizeMs = times[times.size() / 2];
+        results.push_back(result);
+
+        std::printf("bench_meshopt: %-22s %6zu tris, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.3f ms\n",
+                    result.name.c_str(), result.triangles, result.stats.before.acmr, result.stats.after.acmr,
+                    result.stats.before.atvr, result.stats.after.atvr, result.optimizeMs);
+    }
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"meshopt\",\n");
+    std::fprintf(out, "  \"cacheSize\": %u,\n", MeshOptimizer::CACHE_SIZE);
+    std::fprintf(out, "  \"meshes\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const MeshResult& result = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"vertices\": %zu, \"triangles\": %zu, ", result.name.c_str(),
+                     result.vertices, result.triangles);
+        std::fprintf(out, "\"acmr\": {\"before\": %.4f, \"after\": %.4f}, ", result.stats.before.acmr,
+                     result.stats.after.acmr);
+        std::fprintf(out, "\"atvr\": {\"before\": %.4f, \"after\": %.4f}, ", result.stats.before.atvr,
+                     result.stats.after.atvr);
+        std::fprintf(out, "\"optimizeMs\": %.3f}%s\n", result.optimizeMs, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+
+    return 0;
+}
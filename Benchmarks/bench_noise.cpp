@@ -0,0 +1,131 @@
+// The terrain noise kernel against the scalar reference it replaced.
+// Noise::heights runs at every SIMD level the CPU supports over random
+// points (negative coordinates included, where the lattice truncates toward
+// zero) and is compared with Noise::height. A HeightField like the demo's is
+// then generated and read back with getHeight at its sample points, which
+// must give the same heights as Noise::height there.
+//
+// Each level is timed next to the scalar loop. Any height further than
+// TOLERANCE from the reference fails the run.
+//
+//   bench_noise [--count N] [--output file.json]
+#include "../Engine/Noise.h"
+#include "../Engine/HeightField.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// How far the SIMD kernels' polynomial cosine may move a height, the
+// "about 1e-6" Noise::heights documents: two float steps at 5 m, the
+// default amplitude
+static const float TOLERANCE = 1e-6f;
+
+// The demo's field: 513 x 513 samples every 0.25 m around the origin
+static const int FIELD_SAMPLES = 513;
+static const float FIELD_SPACING = 0.25f;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t count = 1 << 20;
+    const char* outputPath = "bench_noise.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--count") == 0 && hasValue) {
+            count = std::max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--count N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    NoiseParams params;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> coordinate(-1000.0f, 1000.0f);
+    std::vector<float> xs(count), zs(count), reference(count), batch(count);
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = coordinate(random);
+        zs[i] = coordinate(random);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) reference[i] = Noise::height(params, xs[i], zs[i]);
+    double scalarLoopMs = millisecondsSince(start);
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2};
+    SimdLevel widest = Simd::detect();
+    double ms[3] = {};
+    float maxError[3] = {};
+    size_t failures = 0;
+    for (SimdLevel level : levels) {
+        int l = static_cast<int>(level);
+        if (l > static_cast<int>(widest)) continue;
+        Simd::setLevel(level);
+        start = std::chrono::steady_clock::now();
+        Noise::heights(params, xs.data(), zs.data(), batch.data(), count);
+        ms[l] = millisecondsSince(start);
+        for (size_t i = 0; i < count; i++) {
+            float error = std::fabs(batch[i] - reference[i]);
+            maxError[l] = std::max(maxError[l], error);
+            if (!(error <= TOLERANCE)) failures++;
+        }
+        std::printf("bench_noise: %-6s %8.2f ms (scalar loop %.2f ms), max error %.2g\n", Simd::name(level), ms[l],
+                    scalarLoopMs, maxError[l]);
+    }
+    Simd::setLevel(widest);
+
+    // The field's own sample points land exactly on its grid, so getHeight
+    // returns the sample the kernel wrote there
+    HeightField field;
+    float origin = -(FIELD_SAMPLES - 1) * FIELD_SPACING * 0.5f;
+    field.generate(params, origin, origin, FIELD_SPACING, FIELD_SAMPLES, FIELD_SAMPLES);
+    JobSystem::shutdown();
+    float fieldError = 0.0f;
+    size_t fieldFailures = 0;
+    for (int z = 0; z < FIELD_SAMPLES; z++) {
+        for (int x = 0; x < FIELD_SAMPLES; x++) {
+            float px = origin + x * FIELD_SPACING, pz = origin + z * FIELD_SPACING;
+            float error = std::fabs(field.getHeight(px, pz) - Noise::height(params, px, pz));
+            fieldError = std::max(fieldError, error);
+            if (!(error <= TOLERANCE)) fieldFailures++;
+        }
+    }
+    failures += fieldFailures;
+    std::printf("bench_noise: %d x %d height field at %s, max error %.2g at the samples; %zu heights off by "
+                "more than %.1g\n",
+                FIELD_SAMPLES, FIELD_SAMPLES, Simd::name(widest), fieldError, failures, TOLERANCE);
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"noise\",\n");
+    std::fprintf(out, "  \"count\": %zu,\n  \"tolerance\": %g,\n", count, TOLERANCE);
+    std::fprintf(out, "  \"scalarLoopMs\": %.3f,\n", scalarLoopMs);
+    std::fprintf(out, "  \"levels\": [\n");
+    for (SimdLevel level : levels) {
+        int l = static_cast<int>(level);
+        if (l > static_cast<int>(widest)) continue;
+        std::fprintf(out, "    {\"simd\": \"%s\", \"ms\": %.3f, \"maxError\": %g}%s\n", Simd::name(level), ms[l],
+                     maxError[l], l < static_cast<int>(widest) ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"fieldMaxError\": %g,\n", fieldError);
+    std::fprintf(out, "  \"failures\": %zu\n", failures);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return failures == 0 ? 0 : -1;
+}
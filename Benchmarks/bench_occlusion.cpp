@@ -0,0 +1,387 @@
+// Software occlusion culling of a grass field on hills, all on the CPU. The
+// hills are about 30 m from valley floor to crest, and the views stand in the
+// valleys, so much of the field in front of them is behind a hill. The
+// terrain is a HeightField cut into 32 m chunks; each chunk becomes an
+// occluder the way TerrainStreamer builds them (a coarser grid lowered below
+// the full-detail one, with skirts). Grass blades are scattered over the
+// field and bucketed in a CullingGrid.
+//
+// From each view, the occluders in the frustum are rasterized by
+// OcclusionCuller and the grid is culled against the frustum alone and
+// against the frustum plus the depth pyramid, reporting how many blades each
+// draws. Rasterization is timed with SSE and scalar code on one
+// thread and on the job system; all four must produce the same depth
+// buffers. Blades reported hidden are checked by casting rays from the eye
+// to points on them that are on screen, through a MeshBvh of the full-detail
+// terrain.
+//
+//   bench_occlusion [--size N] [--views N] [--width N] [--occluder-stride N]
+//                   [--output file.json]
+#include "../Engine/OcclusionCuller.h"
+#include "../Engine/Culling.h"
+#include "../Engine/Camera.h"
+#include "../Engine/Bvh.h"
+#include "../Engine/HeightField.h"
+#include "../Engine/Scatter.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int CHUNK = 32;  // Samples per chunk side, 1 m apart
+static const float SKIRT_DEPTH = 2.0f;
+static const float BLADE_HEIGHT = 1.0f;
+static const float BLADE_RADIUS = 0.6f;  // Bounding sphere around the middle of the blade
+static const float EYE_HEIGHT = 1.7f;
+static const float HILL_FREQUENCY = 0.03f;
+static const float HILL_AMPLITUDE = 40.0f;
+static const int VALLEY_CANDIDATES = 16;  // Random spots tried per view, the lowest is kept
+static const float ASPECT = 16.0f / 9.0f;
+static const size_t CHECKED_PER_VIEW = 512;
+
+struct ChunkOccluder {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    Vector3 min, max;
+};
+
+// Height of the grid with the given stride at sample (x, z) of the chunk
+// starting at (x0, z0), on the cell diagonals TerrainStreamer uses
+static float gridHeight(const HeightField& field, int x0, int z0, int stride, int x, int z) {
+    int qx = std::min(x / stride * stride, CHUNK - stride);
+    int qz = std::min(z / stride * stride, CHUNK - stride);
+    float fx = static_cast<float>(x - qx) / stride, fz = static_cast<float>(z - qz) / stride;
+    float topLeft = field.getSample(x0 + qx, z0 + qz), topRight = field.getSample(x0 + qx + stride, z0 + qz);
+    float bottomLeft = field.getSample(x0 + qx, z0 + qz + stride);
+    float bottomRight = field.getSample(x0 + qx + stride, z0 + qz + stride);
+    if (fx + fz <= 1.0f) return topLeft + (topRight - topLeft) * fx + (bottomLeft - topLeft) * fz;
+    return bottomRight + (bottomLeft - bottomRight) * (1.0f - fx) + (topRight - bottomRight) * (1.0f - fz);
+}
+
+static std::vector<ChunkOccluder> makeOccluders(const HeightField& field, int stride) {
+    std::vector<ChunkOccluder> chunks;
+    int side = CHUNK / stride + 1;
+    for (int z0 = 0; z0 + CHUNK < field.getDepth(); z0 += CHUNK) {
+        for (int x0 = 0; x0 + CHUNK < field.getWidth(); x0 += CHUNK) {
+            ChunkOccluder chunk;
+
+            // Each vertex sinks by the largest gap between the coarse and the
+            // full-detail surface in the quads around it
+            std::vector<float> quadSink((side - 1) * (side - 1), 0.0f);
+            float low = 1e30f, high = -1e30f;
+            for (int z = 0; z <= CHUNK; z++) {
+                for (int x = 0; x <= CHUNK; x++) {
+                    float h = field.getSample(x0 + x, z0 + z);
+                    float gap = gridHeight(field, x0, z0, stride, x, z) - h;
+                    low = std::min(low, h);
+                    high = std::max(high, h);
+                    for (int qz = std::max(0, (z - 1) / stride); qz <= std::min(z / stride, side - 2); qz++) {
+                        for (int qx = std::max(0, (x - 1) / stride); qx <= std::min(x / stride, side - 2); qx++) {
+                            float& sink = quadSink[qz * (side - 1) + qx];
+                            sink = std::max(sink, gap);
+                        }
+                    }
+                }
+            }
+            float originX = field.getOriginX() + x0 * field.getSpacing();
+            float originZ = field.getOriginZ() + z0 * field.getSpacing();
+            float deepest = 0.0f;
+            for (int z = 0; z < side; z++) {
+                for (int x = 0; x < side; x++) {
+                    float sink = 0.0f;
+                    for (int qz = std::max(0, z - 1); qz <= std::min(z, side - 2); qz++) {
+                        for (int qx = std::max(0, x - 1); qx <= std::min(x, side - 2); qx++) {
+                            sink = std::max(sink, quadSink[qz * (side - 1) + qx]);
+                        }
+                    }
+                    deepest = std::max(deepest, sink);
+                    chunk.positions.insert(chunk.positions.end(), {originX + x * stride * field.getSpacing(),
+                                                                   field.getSample(x0 + x * stride, z0 + z * stride) - sink,
+                                                                   originZ + z * stride * field.getSpacing()});
+                }
+            }
+            for (int z = 0; z + 1 < side; z++) {
+                for (int x = 0; x + 1 < side; x++) {
+                    uint32_t a = z * side + x, c = a + side;
+                    chunk.indices.insert(chunk.indices.end(), {a, c, a + 1, a + 1, c, c + 1});
+                }
+            }
+            auto edge = [&](int s, int i) -> uint32_t {
+                switch (s) {
+                    case 0: return i;
+                    case 1: return i * side + side - 1;
+                    case 2: return (side - 1) * side + i;
+                    default: return i * side;
+                }
+            };
+            uint32_t skirtBase = static_cast<uint32_t>(chunk.positions.size() / 3);
+            for (int s = 0; s < 4; s++) {
+                for (int i = 0; i < side; i++) {
+                    const float* top = &chunk.positions[edge(s, i) * 3];
+                    float skirt[3] = {top[0], top[1] - SKIRT_DEPTH, top[2]};
+                    chunk.positions.insert(chunk.positions.end(), skirt, skirt + 3);
+                }
+            }
+            for (int s = 0; s < 4; s++) {
+                for (int i = 0; i + 1 < side; i++) {
+                    uint32_t a = edge(s, i), b = edge(s, i + 1), skirtA = skirtBase + s * side + i;
+                    chunk.indices.insert(chunk.indices.end(), {a, skirtA, b, b, skirtA, skirtA + 1});
+                }
+            }
+            chunk.min = Vector3(originX, low - deepest - SKIRT_DEPTH, originZ);
+            chunk.max = Vector3(originX + CHUNK * field.getSpacing(), high, originZ + CHUNK * field.getSpacing());
+            chunks.push_back(std::move(chunk));
+        }
+    }
+    return chunks;
+}
+
+static void renderView(OcclusionCuller& culler, const std::vector<ChunkOccluder>& chunks, const Camera& camera) {
+    Frustum frustum = Frustum::fromCamera(camera, ASPECT);
+    culler.begin(camera.getViewProjectionMatrix(ASPECT));
+    for (const ChunkOccluder& chunk : chunks) {
+        if (frustum.classifyBox(chunk.min, chunk.max) == CullResult::Outside) continue;
+        culler.addOccluder(chunk.positions.data(), chunk.positions.size() / 3, chunk.indices.data(),
+                           chunk.indices.size());
+    }
+    culler.render();
+}
+
+static uint64_t hashDepth(const OcclusionCuller& culler) {
+    uint64_t hash = 1469598103934665603ull;
+    for (int y = 0; y < culler.getHeight(); y++) {
+        const unsigned char* row = reinterpret_cast<const unsigned char*>(culler.getDepth() + y * culler.getStride());
+        for (size_t i = 0; i < culler.getWidth() * sizeof(float); i++) hash = (hash ^ row[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+struct RasterConfig {
+    const char* name;
+    SimdLevel level;
+    int threads;
+    double ms = 0.0;
+    bool identical = true;
+};
+
+int main(int argc, char** argv) {
+    int size = 512;
+    int views = 64;
+    int width = 256;
+    int stride = 4;
+    const char* outputPath = "bench_occlusion.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            size = std::max(2 * CHUNK, atoi(argv[++i]) / CHUNK * CHUNK);
+        } else if (strcmp(argv[i], "--views") == 0 && hasValue) {
+            views = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--width") == 0 && hasValue) {
+            width = std::max(16, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--occluder-stride") == 0 && hasValue) {
+            stride = atoi(argv[++i]);
+            if (stride < 1 || CHUNK % stride != 0) stride = 4;
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--size N] [--views N] [--width N] [--occluder-stride N] "
+                                 "[--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+    int height = static_cast<int>(width / ASPECT + 0.5f);
+    int threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+
+    // Hills tall and close enough to hide what lies behind them from the
+    // valleys between; the grass scene's +-2.5 m ground hides next to nothing
+    // from eye height
+    NoiseParams hills;
+    hills.frequency = HILL_FREQUENCY;
+    hills.amplitude = HILL_AMPLITUDE;
+    HeightField ground;
+    ground.generate(hills, -size * 0.5f, -size * 0.5f, 1.0f, size + 1, size + 1);
+    std::vector<ChunkOccluder> chunks = makeOccluders(ground, stride);
+
+    // Grass over the field, spheres around the middle of each blade
+    ScatterSettings scatterSettings;
+    scatterSettings.minX = scatterSettings.minZ = -size * 0.5f;
+    scatterSettings.maxX = scatterSettings.maxZ = size * 0.5f;
+    std::vector<ScatterType> types(1);
+    types[0].radius = 0.4f;
+    std::vector<ScatterInstance> blades;
+    Scatter::scatter(ground, scatterSettings, types, blades);
+    std::vector<Vector3> centers(blades.size());
+    std::vector<float> radii(blades.size(), BLADE_RADIUS);
+    for (size_t i = 0; i < blades.size(); i++) {
+        centers[i] = Vector3(blades[i].x, blades[i].y + BLADE_HEIGHT * 0.5f, blades[i].z);
+    }
+    CullingGrid grid(8.0f);
+    grid.build(centers, radii);
+
+    std::vector<Vertex> terrainVertices;
+    std::vector<unsigned int> terrainIndices;
+    for (int z = 0; z <= size; z++) {
+        for (int x = 0; x <= size; x++) {
+            Vector3 p(ground.getOriginX() + x, ground.getSample(x, z), ground.getOriginZ() + z);
+            terrainVertices.push_back({p, Vector3(), Vector3(0.0f, 1.0f, 0.0f), Vector3()});
+        }
+    }
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            unsigned int a = z * (size + 1) + x, c = a + size + 1;
+            terrainIndices.insert(terrainIndices.end(), {a, c, a + 1, a + 1, c, c + 1});
+        }
+    }
+    MeshBvh terrainBvh;
+    terrainBvh.build(terrainVertices.data(), terrainVertices.size(), terrainIndices.data(), terrainIndices.size());
+
+    // Eye-height views from low ground around the middle of the field
+    std::mt19937 random(11);
+    std::vector<Camera> cameras(views);
+    for (Camera& camera : cameras) {
+        float bestX = 0.0f, bestZ = 0.0f, lowest = 1e30f;
+        for (int i = 0; i < VALLEY_CANDIDATES; i++) {
+            float x = (static_cast<float>(random() % 1000) / 1000.0f - 0.5f) * size * 0.5f;
+            float z = (static_cast<float>(random() % 1000) / 1000.0f - 0.5f) * size * 0.5f;
+            if (ground.getHeight(x, z) < lowest) {
+                lowest = ground.getHeight(x, z);
+                bestX = x;
+                bestZ = z;
+            }
+        }
+        camera.position = Vector3(bestX, lowest + EYE_HEIGHT, bestZ);
+        camera.rotate(static_cast<float>(random() % 360), 0.0f);
+    }
+
+    // Rasterization with each path; the first is the reference
+    OcclusionCuller culler(width, height);
+    SimdLevel simd = Simd::detect() == SimdLevel::Scalar ? SimdLevel::Scalar : SimdLevel::SSE;
+    RasterConfig configs[] = {
+        {"sse, job system", simd, threads},
+        {"sse, 1 thread", simd, 1},
+        {"scalar, job system", SimdLevel::Scalar, threads},
+        {"scalar, 1 thread", SimdLevel::Scalar, 1},
+    };
+    std::vector<uint64_t> reference(views);
+    size_t occluderTriangles = 0, rasterizedTriangles = 0;
+    for (RasterConfig& config : configs) {
+        Simd::setLevel(config.level);
+        JobSystem::init(config.threads);
+        for (int view = 0; view < views; view++) {
+            renderView(culler, chunks, cameras[view]);
+            config.ms += culler.getStats().renderMs;
+            uint64_t hash = hashDepth(culler);
+            if (&config == &configs[0]) {
+                reference[view] = hash;
+                occluderTriangles += culler.getStats().occluderTriangles;
+                rasterizedTriangles += culler.getStats().rasterizedTriangles;
+            } else if (hash != reference[view]) {
+                config.identical = false;
+            }
+        }
+        config.ms /= views;
+        JobSystem::shutdown();
+    }
+    Simd::setLevel(Simd::detect());
+
+    // Culling, and the blades it hides checked with rays
+    double frustumVisible = 0.0, drawn = 0.0, frustumMs = 0.0, occlusionMs = 0.0;
+    size_t checked = 0, visibleHidden = 0;
+    std::vector<uint32_t> inFrustum, afterOcclusion;
+    for (int view = 0; view < views; view++) {
+        const Camera& camera = cameras[view];
+        Frustum frustum = Frustum::fromCamera(camera, ASPECT);
+        auto start = std::chrono::steady_clock::now();
+        grid.cull(frustum, inFrustum);
+        auto middle = std::chrono::steady_clock::now();
+        renderView(culler, chunks, camera);
+        auto rendered = std::chrono::steady_clock::now();
+        size_t occluded = 0;
+        grid.cull(frustum, afterOcclusion, &culler, &occluded);
+        auto end = std::chrono::steady_clock::now();
+        frustumMs += std::chrono::duration<double, std::milli>(middle - start).count();
+        occlusionMs += std::chrono::duration<double, std::milli>(end - rendered).count() + culler.getStats().renderMs;
+        frustumVisible += inFrustum.size();
+        drawn += afterOcclusion.size();
+
+        std::sort(inFrustum.begin(), inFrustum.end());
+        std::sort(afterOcclusion.begin(), afterOcclusion.end());
+        std::vector<uint32_t> hidden;
+        std::set_difference(inFrustum.begin(), inFrustum.end(), afterOcclusion.begin(), afterOcclusion.end(),
+                            std::back_inserter(hidden));
+        Matrix4 viewProjection = camera.getViewProjectionMatrix(ASPECT);
+        const float* m = viewProjection.arr;
+        size_t step = std::max<size_t>(1, hidden.size() / CHECKED_PER_VIEW);
+        for (size_t i = 0; i < hidden.size(); i += step) {
+            const ScatterInstance& blade = blades[hidden[i]];
+            bool seen = false;
+            for (float up : {0.25f, 0.5f, BLADE_HEIGHT}) {
+                // Only points on screen, the depth buffer says nothing of the rest
+                Vector3 point(blade.x, blade.y + up, blade.z);
+                float x = m[0] * point.x + m[1] * point.y + m[2] * point.z + m[3];
+                float y = m[4] * point.x + m[5] * point.y + m[6] * point.z + m[7];
+                float w = m[12] * point.x + m[13] * point.y + m[14] * point.z + m[15];
+                if (w <= 0.0f || std::fabs(x) > w || std::fabs(y) > w) continue;
+                Ray ray;
+                ray.origin = camera.position;
+                ray.direction = point - camera.position;
+                ray.maxDistance = 0.999f;
+                seen = seen || !terrainBvh.occluded(ray);
+            }
+            checked++;
+            if (seen) visibleHidden++;
+        }
+    }
+    JobSystem::shutdown();
+    frustumVisible /= views;
+    drawn /= views;
+    frustumMs /= views;
+    occlusionMs /= views;
+
+    bool identical = true;
+    for (const RasterConfig& config : configs) identical = identical && config.identical;
+    std::printf("bench_occlusion: %dx%d depth buffer, %zu blades, %d views, %.0f occluder triangles per view "
+                "(%.0f rasterized)\n",
+                width, height, blades.size(), views, static_cast<double>(occluderTriangles) / views,
+                static_cast<double>(rasterizedTriangles) / views);
+    for (const RasterConfig& config : configs) {
+        std::printf("bench_occlusion: raster %-18s %.3f ms%s\n", config.name, config.ms,
+                    config.identical ? "" : " DIFFERENT");
+    }
+    std::printf("bench_occlusion: frustum culling draws %.0f blades (%.3f ms), with occlusion %.0f (%.3f ms), "
+                "%.1f%% culled; %zu of %zu hidden blades checked are visible\n",
+                frustumVisible, frustumMs, drawn, occlusionMs, 100.0 * (1.0 - drawn / std::max(frustumVisible, 1.0)),
+                visibleHidden, checked);
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"occlusion\",\n");
+    std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n  \"size\": %d,\n", width, height, size);
+    std::fprintf(out, "  \"views\": %d,\n  \"threads\": %d,\n  \"occluderStride\": %d,\n", views, threads, stride);
+    std::fprintf(out, "  \"blades\": %zu,\n", blades.size());
+    std::fprintf(out, "  \"occluderTrianglesPerView\": %.0f,\n  \"rasterizedTrianglesPerView\": %.0f,\n",
+                 static_cast<double>(occluderTriangles) / views, static_cast<double>(rasterizedTriangles) / views);
+    std::fprintf(out, "  \"rasterMs\": {");
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        std::fprintf(out, "%s\"%s\": %.4f", i ? ", " : "", configs[i].name, configs[i].ms);
+    }
+    std::fprintf(out, "},\n");
+    std::fprintf(out, "  \"identical\": %s,\n", identical ? "true" : "false");
+    std::fprintf(out, "  \"frustumDrawn\": %.0f,\n  \"occlusionDrawn\": %.0f,\n", frustumVisible, drawn);
+    std::fprintf(out, "  \"frustumMs\": %.4f,\n  \"occlusionMs\": %.4f,\n", frustumMs, occlusionMs);
+    std::fprintf(out, "  \"checkedHidden\": %zu,\n  \"visibleHidden\": %zu\n", checked, visibleHidden);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return identical ? 0 : -1;
+}
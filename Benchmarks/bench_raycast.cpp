@@ -0,0 +1,330 @@
+// Ray queries against a terrain-scale mesh and a scene of placed rocks,
+// through MeshBvh and SceneBvh. The terrain is a HeightField grid (two
+// triangles per cell, 2M triangles by default) with a few thousand rock
+// instances on top. Three query kinds are timed:
+//
+//   snap    straight down from above the terrain, as for ground snapping
+//   pick    closest hit along incoherent rays from above, as for picking
+//   sight   whether a segment between two points above the ground is blocked
+//
+// Each kind is timed one ray at a time on one thread (SSE and scalar) and as
+// a batch spread over the job system, in millions of rays per second. Snap
+// results are checked against the height of the triangle under the ray,
+// picks and sight tests against brute force over every triangle.
+//
+//   bench_raycast [--grid N] [--rays N] [--rocks N] [--output file.json]
+#include "../Engine/Bvh.h"
+#include "../Engine/HeightField.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int BRUTE_FORCE_RAYS = 64;
+
+struct TestMesh {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Cell (x, z) is split along the diagonal from (x + 1, z) to (x, z + 1)
+static TestMesh makeTerrain(const HeightField& field) {
+    TestMesh mesh;
+    int w = field.getWidth(), d = field.getDepth();
+    for (int z = 0; z < d; z++) {
+        for (int x = 0; x < w; x++) {
+            Vector3 p(field.getOriginX() + x * field.getSpacing(), field.getSample(x, z),
+                      field.getOriginZ() + z * field.getSpacing());
+            mesh.vertices.push_back({p, Vector3(0.2f, 0.6f, 0.2f), Vector3(0.0f, 1.0f, 0.0f), Vector3()});
+        }
+    }
+    for (int z = 0; z + 1 < d; z++) {
+        for (int x = 0; x + 1 < w; x++) {
+            unsigned int a = z * w + x, b = a + 1, c = a + w, e = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, c, b, b, c, e});
+        }
+    }
+    return mesh;
+}
+
+// Height of the terrain triangle under (x, z), the exact snap answer
+static float triangleHeight(const HeightField& field, float x, float z) {
+    float gx = (x - field.getOriginX()) / field.getSpacing();
+    float gz = (z - field.getOriginZ()) / field.getSpacing();
+    int cx = std::min(static_cast<int>(gx), field.getWidth() - 2);
+    int cz = std::min(static_cast<int>(gz), field.getDepth() - 2);
+    float fx = gx - cx, fz = gz - cz;
+    float ha = field.getSample(cx, cz), hb = field.getSample(cx + 1, cz);
+    float hc = field.getSample(cx, cz + 1), hd = field.getSample(cx + 1, cz + 1);
+    if (fx + fz <= 1.0f) return ha + fx * (hb - ha) + fz * (hc - ha);
+    return hd + (1.0f - fx) * (hc - hd) + (1.0f - fz) * (hb - hd);
+}
+
+// Same layout as Mesh::createSphere, squashed into a boulder by the transform
+static TestMesh makeRock(int sectors, int stacks) {
+    TestMesh mesh;
+    const float PI = 3.14159265359f;
+    for (int i = 0; i <= stacks; ++i) {
+        float stackAngle = PI / 2 - i * PI / stacks;
+        for (int j = 0; j <= sectors; ++j) {
+            float sectorAngle = j * 2 * PI / sectors;
+            Vector3 position(std::cos(stackAngle) * std::cos(sectorAngle), std::sin(stackAngle),
+                             std::cos(stackAngle) * std::sin(sectorAngle));
+            mesh.vertices.push_back({position, Vector3(0.5f, 0.5f, 0.5f), position, Vector3()});
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        unsigned int k1 = i * (sectors + 1);
+        unsigned int k2 = k1 + sectors + 1;
+        for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if (i != 0) mesh.indices.insert(mesh.indices.end(), {k1, k2, k1 + 1});
+            if (i != stacks - 1) mesh.indices.insert(mesh.indices.end(), {k1 + 1, k2, k2 + 1});
+        }
+    }
+    return mesh;
+}
+
+// Plain Möller-Trumbore over every triangle, in double precision
+static float bruteForce(const TestMesh& mesh, const Matrix4& worldToObject, const Ray& worldRay, float tMax) {
+    Vector3 o = worldToObject.vectorTrans(worldRay.origin);
+    Vector3 d = worldToObject.vectorTrans(worldRay.origin + worldRay.direction) - o;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        const Vector3& a = mesh.vertices[mesh.indices[t]].position;
+        Vector3 e1 = mesh.vertices[mesh.indices[t + 1]].position - a;
+        Vector3 e2 = mesh.vertices[mesh.indices[t + 2]].position - a;
+        double px = (double)d.y * e2.z - (double)d.z * e2.y;
+        double py = (double)d.z * e2.x - (double)d.x * e2.z;
+        double pz = (double)d.x * e2.y - (double)d.y * e2.x;
+        double det = e1.x * px + e1.y * py + e1.z * pz;
+        if (det == 0.0) continue;
+        double sx = (double)o.x - a.x, sy = (double)o.y - a.y, sz = (double)o.z - a.z;
+        double u = (sx * px + sy * py + sz * pz) / det;
+        double qx = sy * e1.z - sz * e1.y, qy = sz * e1.x - sx * e1.z, qz = sx * e1.y - sy * e1.x;
+        double v = (d.x * qx + d.y * qy + d.z * qz) / det;
+        double dist = (e2.x * qx + e2.y * qy + e2.z * qz) / det;
+        if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && dist >= 0.0 && dist < tMax) tMax = static_cast<float>(dist);
+    }
+    return tMax;
+}
+
+struct QueryResult {
+    const char* name;
+    double serialMraysSSE = 0.0;
+    double serialMraysScalar = 0.0;
+    double batchMrays = 0.0;
+    size_t hits = 0;
+};
+
+template <typename Function>
+static double mraysPerSecond(size_t count, Function&& function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / seconds / 1e6;
+}
+
+// Closest hits (or occlusion as 0/1 distances) one ray at a time
+static void serialQuery(const SceneBvh& scene, const std::vector<Ray>& rays, bool sight, std::vector<RayHit>& hits) {
+    for (size_t i = 0; i < rays.size(); i++) {
+        if (sight) {
+            hits[i].triangle = scene.occluded(rays[i]) ? 0 : RayHit::NONE;
+        } else {
+            scene.intersect(rays[i], hits[i]);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int grid = 1025;
+    size_t rayCount = 1 << 20;
+    int rockCount = 4096;
+    const char* outputPath = "bench_raycast.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--grid") == 0 && hasValue) {
+            grid = std::max(3, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rays") == 0 && hasValue) {
+            rayCount = std::max<size_t>(BRUTE_FORCE_RAYS, strtoull(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--rocks") == 0 && hasValue) {
+            rockCount = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--grid N] [--rays N] [--rocks N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    HeightField field;
+    NoiseParams noise;
+    float spacing = 0.25f;
+    float half = (grid - 1) * spacing * 0.5f;
+    field.generate(noise, -half, -half, spacing, grid, grid);
+    TestMesh terrain = makeTerrain(field);
+    TestMesh rock = makeRock(16, 12);
+
+    MeshBvh terrainBvh, rockBvh;
+    terrainBvh.build(terrain.vertices.data(), terrain.vertices.size(), terrain.indices.data(), terrain.indices.size());
+    rockBvh.build(rock.vertices.data(), rock.vertices.size(), rock.indices.data(), rock.indices.size());
+    const BvhStats& terrainStats = terrainBvh.getStats();
+    std::printf("bench_raycast: terrain %zu triangles, %zu nodes, %zu leaves, depth %d, built in %.1f ms\n",
+                terrainStats.primitives, terrainStats.nodes, terrainStats.leaves, terrainStats.depth,
+                terrainStats.buildMs);
+
+    // The terrain is an instance too, so every query goes through both levels
+    std::mt19937 random(1);
+    auto unit = [&] { return (random() & 0xffffff) / 16777216.0f; };
+    SceneBvh scene;
+    std::vector<Matrix4> worldToObject;
+    std::vector<const TestMesh*> meshes;
+    scene.addInstance(&terrainBvh, Matrix4());
+    worldToObject.push_back(Matrix4());
+    meshes.push_back(&terrain);
+    for (int i = 0; i < rockCount; i++) {
+        float x = (unit() * 2.0f - 1.0f) * half * 0.95f, z = (unit() * 2.0f - 1.0f) * half * 0.95f;
+        float size = 0.3f + unit() * 1.2f;
+        Vector3 axis(unit() - 0.5f, unit() - 0.5f, unit() - 0.5f);
+        Quaternion rotation = Quaternion::axisRotation(unit() * 6.2831853f, axis.length() > 0.0f ? axis : Vector3(0, 1, 0));
+        Matrix4 world = Matrix4::compose(Vector3(x, triangleHeight(field, x, z), z), rotation,
+                                         Vector3(size, size * 0.6f, size * 0.8f));
+        scene.addInstance(&rockBvh, world);
+        worldToObject.push_back(world.inverse());
+        meshes.push_back(&rock);
+    }
+    scene.build();
+    std::printf("bench_raycast: %zu instances, top level %zu nodes, built in %.2f ms\n", scene.size(),
+                scene.getStats().nodes, scene.getStats().buildMs);
+
+    // Rays over the inner 90% so snaps never leave the grid
+    float top = terrainBvh.getMax().y + 10.0f;
+    std::vector<Ray> snapRays(rayCount), pickRays(rayCount), sightRays(rayCount);
+    for (size_t i = 0; i < rayCount; i++) {
+        float x = (unit() * 2.0f - 1.0f) * half * 0.9f, z = (unit() * 2.0f - 1.0f) * half * 0.9f;
+        snapRays[i].origin = Vector3(x, top, z);
+        snapRays[i].direction = Vector3(0.0f, -1.0f, 0.0f);
+
+        float angle = unit() * 6.2831853f, down = 0.05f + unit() * 0.9f;
+        pickRays[i].origin = Vector3(x, triangleHeight(field, x, z) + 2.0f + unit() * 8.0f, z);
+        pickRays[i].direction = Vector3(std::cos(angle), -down, std::sin(angle)).normalize();
+
+        // Eye height to eye height up to 40 units apart
+        float length = 1.0f + unit() * 39.0f;
+        float tx = std::max(-half * 0.9f, std::min(half * 0.9f, x + std::cos(angle) * length));
+        float tz = std::max(-half * 0.9f, std::min(half * 0.9f, z + std::sin(angle) * length));
+        Vector3 from(x, triangleHeight(field, x, z) + 1.7f, z);
+        Vector3 to(tx, triangleHeight(field, tx, tz) + 1.7f, tz);
+        sightRays[i].origin = from;
+        sightRays[i].direction = to - from;
+        sightRays[i].maxDistance = 1.0f;
+    }
+
+    std::vector<QueryResult> results = {{"snap"}, {"pick"}, {"sight"}};
+    const std::vector<Ray>* raySets[] = {&snapRays, &pickRays, &sightRays};
+    std::vector<RayHit> hits(rayCount), batchHits(rayCount);
+    std::vector<uint8_t> blocked(rayCount);
+    bool matches = true;
+    float snapError = 0.0f;
+    int bruteForceMismatches = 0;
+    for (size_t q = 0; q < results.size(); q++) {
+        QueryResult& result = results[q];
+        const std::vector<Ray>& rays = *raySets[q];
+        bool sight = q == 2;
+
+        JobSystem::shutdown();
+        Simd::setLevel(SimdLevel::Scalar);
+        result.serialMraysScalar = mraysPerSecond(rayCount, [&] { serialQuery(scene, rays, sight, hits); });
+        std::vector<RayHit> scalarHits = hits;
+        Simd::setLevel(Simd::detect());
+        result.serialMraysSSE = mraysPerSecond(rayCount, [&] { serialQuery(scene, rays, sight, hits); });
+
+        JobSystem::init(static_cast<int>(std::thread::hardware_concurrency()));
+        if (sight) {
+            result.batchMrays = mraysPerSecond(rayCount, [&] { scene.occluded(rays.data(), blocked.data(), rayCount); });
+        } else {
+            result.batchMrays = mraysPerSecond(rayCount, [&] { scene.intersect(rays.data(), batchHits.data(), rayCount); });
+        }
+
+        for (size_t i = 0; i < rayCount; i++) {
+            bool hit = hits[i].hit();
+            result.hits += hit;
+            bool batchHit = sight ? blocked[i] != 0 : batchHits[i].hit();
+            if (hit != batchHit || hit != scalarHits[i].hit()) matches = false;
+            if (!sight && hit && (hits[i].distance != batchHits[i].distance ||
+                                  std::fabs(hits[i].distance - scalarHits[i].distance) > 1e-4f)) {
+                matches = false;
+            }
+        }
+
+        // Snaps that hit the terrain (not a rock) land on the triangle below
+        if (q == 0) {
+            for (size_t i = 0; i < rayCount; i++) {
+                if (!hits[i].hit()) {
+                    matches = false;
+                    continue;
+                }
+                if (hits[i].instance != 0) continue;
+                const Vector3& o = rays[i].origin;
+                float expected = o.y - triangleHeight(field, o.x, o.z);
+                snapError = std::max(snapError, std::fabs(hits[i].distance - expected));
+            }
+        }
+
+        // The first rays against every triangle of every instance
+        for (int i = 0; i < BRUTE_FORCE_RAYS; i++) {
+            float nearest = rays[i].maxDistance;
+            for (size_t m = 0; m < meshes.size(); m++) {
+                nearest = std::min(nearest, bruteForce(*meshes[m], worldToObject[m], rays[i], nearest));
+            }
+            bool expectHit = nearest < rays[i].maxDistance;
+            bool mismatch = expectHit != hits[i].hit();
+            if (!sight && expectHit && std::fabs(nearest - hits[i].distance) > 1e-3f * std::max(1.0f, nearest)) {
+                mismatch = true;
+            }
+            bruteForceMismatches += mismatch;
+        }
+
+        std::printf("bench_raycast: %-5s %7.2f Mrays/s one thread (scalar %.2f), %7.2f batched on %d threads, "
+                    "%.1f%% hit\n",
+                    result.name, result.serialMraysSSE, result.serialMraysScalar, result.batchMrays,
+                    JobSystem::getThreadCount(), 100.0 * result.hits / rayCount);
+    }
+    int threads = JobSystem::getThreadCount();
+    JobSystem::shutdown();
+
+    matches = matches && snapError < 1e-3f && bruteForceMismatches == 0;
+    std::printf("bench_raycast: snap error %.2g, %d brute-force mismatches, %s\n", snapError, bruteForceMismatches,
+                matches ? "results match" : "RESULTS DIFFER");
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"raycast\",\n");
+    std::fprintf(out, "  \"simd\": \"%s\",\n  \"threads\": %d,\n", Simd::name(Simd::detect()), threads);
+    std::fprintf(out, "  \"triangles\": %zu,\n  \"nodes\": %zu,\n  \"depth\": %d,\n  \"buildMs\": %.2f,\n",
+                 terrainStats.primitives, terrainStats.nodes, terrainStats.depth, terrainStats.buildMs);
+    std::fprintf(out, "  \"instances\": %zu,\n  \"rays\": %zu,\n", scene.size(), rayCount);
+    std::fprintf(out, "  \"snapError\": %g,\n  \"matches\": %s,\n", snapError, matches ? "true" : "false");
+    std::fprintf(out, "  \"queries\": [\n");
+    for (size_t q = 0; q < results.size(); q++) {
+        const QueryResult& result = results[q];
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"serialMrays\": %.3f, \"serialMraysScalar\": %.3f, "
+                     "\"batchMrays\": %.3f, \"hitRate\": %.4f}%s\n",
+                     result.name, result.serialMraysSSE, result.serialMraysScalar, result.batchMrays,
+                     static_cast<double>(result.hits) / rayCount, q + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return matches ? 0 : -1;
+}
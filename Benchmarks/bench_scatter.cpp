@@ -0,0 +1,199 @@
+// Poisson-disk foliage scattering with Scatter over a large height field:
+// rocks in patches, bushes on the higher ground keeping clear of the rocks,
+// and grass everywhere else, about ten million instances on the default
+// 1000 x 1000 field.
+//
+// The scatter runs once on a single thread and once on the job system with
+// at least four threads; both must produce the same instances. Every
+// instance is then checked for its type's spacing and exclusion distance.
+// For scale, the dart throwing GrassScene used to place plants with (each
+// candidate tested against every accepted instance) is timed on a small
+// field next to Scatter on the same field.
+//
+//   bench_scatter [--size N] [--threads N] [--output file.json]
+#include "../Engine/Scatter.h"
+#include "../Engine/CounterRandom.h"
+#include "../Engine/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const float NAIVE_SIZE = 100.0f;
+static const float NAIVE_RADIUS = 0.5f;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Closest pair closer than `distance` between instances of type a and type b
+// (b == a for the spacing within a type), through a grid of linked lists
+static size_t countViolations(const std::vector<ScatterInstance>& instances, uint32_t a, uint32_t b,
+                              float distance, const ScatterSettings& settings) {
+    int width = static_cast<int>(std::ceil((settings.maxX - settings.minX) / distance)) + 1;
+    int depth = static_cast<int>(std::ceil((settings.maxZ - settings.minZ) / distance)) + 1;
+    std::vector<int> head(static_cast<size_t>(width) * depth, -1);
+    std::vector<int> next(instances.size(), -1);
+    auto cellOf = [&](const ScatterInstance& p, int& cx, int& cz) {
+        cx = static_cast<int>((p.x - settings.minX) / distance);
+        cz = static_cast<int>((p.z - settings.minZ) / distance);
+    };
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (instances[i].type != b) continue;
+        int cx, cz;
+        cellOf(instances[i], cx, cz);
+        next[i] = head[cz * width + cx];
+        head[cz * width + cx] = static_cast<int>(i);
+    }
+    size_t violations = 0;
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (instances[i].type != a) continue;
+        int cx, cz;
+        cellOf(instances[i], cx, cz);
+        for (int nz = std::max(cz - 1, 0); nz <= std::min(cz + 1, depth - 1); nz++) {
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, width - 1); nx++) {
+                for (int j = head[nz * width + nx]; j >= 0; j = next[j]) {
+                    if (static_cast<size_t>(j) == i) continue;
+                    float dx = instances[j].x - instances[i].x, dz = instances[j].z - instances[i].z;
+                    if (dx * dx + dz * dz < distance * distance) violations++;
+                }
+            }
+        }
+    }
+    return violations;
+}
+
+// The old plant placement: random candidates, each compared with all
+// accepted ones
+static size_t dartThrowing(size_t candidates, float size, float radius) {
+    std::vector<float> xs, zs;
+    CounterRandom random(1, 0);
+    for (size_t i = 0; i < candidates; i++) {
+        float x = (random.unit() - 0.5f) * size, z = (random.unit() - 0.5f) * size;
+        bool tooClose = false;
+        for (size_t j = 0; j < xs.size() && !tooClose; j++) {
+            float dx = xs[j] - x, dz = zs[j] - z;
+            tooClose = dx * dx + dz * dz < radius * radius;
+        }
+        if (tooClose) continue;
+        xs.push_back(x);
+        zs.push_back(z);
+    }
+    return xs.size();
+}
+
+int main(int argc, char** argv) {
+    float size = 1000.0f;
+    int threads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+    const char* outputPath = "bench_scatter.json";
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            size = std::max(10.0f, static_cast<float>(atof(argv[++i])));
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(2, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--size N] [--threads N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    HeightField ground;
+    int samples = static_cast<int>(size) + 1;
+    ground.generate(NoiseParams(), -size * 0.5f, -size * 0.5f, 1.0f, samples, samples);
+
+    ScatterSettings settings;
+    settings.minX = settings.minZ = -size * 0.5f;
+    settings.maxX = settings.maxZ = size * 0.5f;
+    settings.seed = 7;
+
+    std::vector<ScatterType> types(3);
+    types[0].radius = 6.0f;
+    types[0].density = [](float x, float z) {
+        return std::max(0.0f, std::sin(x * 0.02f) * std::cos(z * 0.02f));
+    };
+    types[1].radius = 1.5f;
+    types[1].exclusion = 2.0f;
+    types[1].density = [&ground](float x, float z) {
+        return std::min(1.0f, std::max(0.0f, ground.getHeight(x, z) * 0.25f + 0.5f));
+    };
+    types[2].radius = 0.28f;
+    types[2].exclusion = 0.5f;
+
+    const char* typeNames[] = {"rocks", "bushes", "grass"};
+    std::vector<ScatterInstance> serial, parallel;
+    ScatterStats serialStats, parallelStats;
+    JobSystem::init(1);
+    Scatter::scatter(ground, settings, types, serial, &serialStats);
+    JobSystem::init(threads);
+    Scatter::scatter(ground, settings, types, parallel, &parallelStats);
+    JobSystem::shutdown();
+
+    bool identical = serial.size() == parallel.size() &&
+                     std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(ScatterInstance)) == 0;
+    std::printf("bench_scatter: %zu instances (%zu samples before the masks) on %.0f x %.0f, "
+                "%.0f ms on 1 thread, %.0f ms on %d threads, %s\n",
+                serialStats.instances, serialStats.samples, size, size, serialStats.ms, parallelStats.ms, threads,
+                identical ? "identical" : "DIFFERENT");
+
+    size_t counts[3] = {};
+    for (const ScatterInstance& instance : serial) counts[instance.type]++;
+    size_t violations = 0;
+    for (uint32_t type = 0; type < types.size(); type++) {
+        size_t spacing = countViolations(serial, type, type, types[type].radius, settings);
+        size_t excluded = 0;
+        for (uint32_t earlier = 0; earlier < type && types[type].exclusion > 0.0f; earlier++) {
+            excluded += countViolations(serial, type, earlier, types[type].exclusion, settings);
+        }
+        violations += spacing + excluded;
+        std::printf("bench_scatter: %-6s %9zu instances, radius %.2f, %zu spacing and %zu exclusion violations\n",
+                    typeNames[type], counts[type], types[type].radius, spacing, excluded);
+    }
+
+    // Both on the same small field
+    ScatterSettings small;
+    small.minX = small.minZ = -NAIVE_SIZE * 0.5f;
+    small.maxX = small.maxZ = NAIVE_SIZE * 0.5f;
+    std::vector<ScatterType> one(1);
+    one[0].radius = NAIVE_RADIUS;
+    std::vector<ScatterInstance> smallResult;
+    ScatterStats smallStats;
+    Scatter::scatter(ground, small, one, smallResult, &smallStats);
+    JobSystem::shutdown();
+    auto start = std::chrono::steady_clock::now();
+    size_t naiveCount = dartThrowing(smallResult.size() * 4, NAIVE_SIZE, NAIVE_RADIUS);
+    double naiveMs = millisecondsSince(start);
+    std::printf("bench_scatter: %.0f x %.0f field, radius %.1f: dart throwing %zu instances in %.0f ms, "
+                "Scatter %zu in %.1f ms\n",
+                NAIVE_SIZE, NAIVE_SIZE, NAIVE_RADIUS, naiveCount, naiveMs, smallResult.size(), smallStats.ms);
+
+    bool passed = identical && violations == 0;
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"scatter\",\n");
+    std::fprintf(out, "  \"size\": %.0f,\n  \"threads\": %d,\n", size, threads);
+    std::fprintf(out, "  \"instances\": %zu,\n  \"samples\": %zu,\n", serialStats.instances, serialStats.samples);
+    std::fprintf(out, "  \"serialMs\": %.1f,\n  \"parallelMs\": %.1f,\n", serialStats.ms, parallelStats.ms);
+    std::fprintf(out, "  \"identical\": %s,\n  \"violations\": %zu,\n", identical ? "true" : "false", violations);
+    std::fprintf(out, "  \"types\": [\n");
+    for (uint32_t type = 0; type < types.size(); type++) {
+        std::fprintf(out, "    {\"name\": \"%s\", \"radius\": %.2f, \"instances\": %zu}%s\n", typeNames[type],
+                     types[type].radius, counts[type], type + 1 < types.size() ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"dartThrowing\": {\"instances\": %zu, \"ms\": %.1f, \"scatterInstances\": %zu, \"scatterMs\": %.2f}\n",
+                 naiveCount, naiveMs, smallResult.size(), smallStats.ms);
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return passed ? 0 : -1;
+}
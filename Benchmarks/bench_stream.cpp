@@ -0,0 +1,182 @@
+// Per-frame CPU cost of streaming instance data to the GPU, three ways:
+//   subdata     InstanceBuffer::upload, glBufferSubData into a buffer the
+//               previous frames may still be drawing from
+//   orphan      StreamBuffer without persistent mapping: orphan, then upload
+//   persistent  StreamBuffer mapped persistently, written in place
+// Frames are not finished with glFinish, so the CPU may run ahead of the GPU
+// as it does in the render loop. Every mode draws the same instances, and the
+// last frame's pixels are compared between them.
+#include "../Engine/Rendering/HeadlessContext.h"
+#include "../Engine/Rendering/GLCapabilities.h"
+#include "../Engine/Rendering/Shader.h"
+#include "../Engine/Rendering/StreamBuffer.h"
+#include "../Engine/Rendering/UniformBuffer.h"
+#include "../Engine/InstanceBuffer.h"
+#include "../Engine/Mesh.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "Engine/Rendering/Shaders"
+#endif
+
+static const int WIDTH = 256;
+static const int HEIGHT = 256;
+
+struct StreamResult {
+    const char* name;
+    double cpuMs = 0.0;   // Per frame, up to the last draw call
+    double wallMs = 0.0;  // Per frame, until the GPU is done
+    uint64_t stalls = 0;
+    double stallMs = 0.0;
+    uint32_t checksum = 0;
+};
+
+// A grid of small quads drifting on a wave; every frame rewrites all of them
+static void fillInstances(InstanceData* out, size_t count, int frame) {
+    size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    for (size_t i = 0; i < count; i++) {
+        InstanceData& instance = out[i];
+        std::memset(instance.transform, 0, sizeof(instance.transform));
+        float x = (i % side) / static_cast<float>(side) * 2.0f - 1.0f;
+        float y = (i / side) / static_cast<float>(side) * 2.0f - 1.0f;
+        instance.transform[0] = instance.transform[5] = instance.transform[10] = instance.transform[15] = 1.0f;
+        instance.transform[12] = x;
+        instance.transform[13] = y + 0.02f * std::sin(x * 6.0f + frame * 0.1f);
+        instance.height = 0.0f;
+        instance.intensity = 0.0f;
+        instance.color = Vector3(0.5f + 0.5f * x, 0.5f + 0.5f * y, 0.5f);
+        instance.colorMix = 1.0f;
+    }
+}
+
+static uint32_t frameChecksum(const HeadlessContext& context) {
+    std::vector<unsigned char> pixels(WIDTH * HEIGHT * 4);
+    context.readPixels(pixels.data());
+    uint32_t hash = 2166136261u;
+    for (unsigned char value : pixels) hash = (hash ^ value) * 16777619u;
+    return hash;
+}
+
+static StreamResult measure(const char* name, int mode, HeadlessContext& context, const Mesh& mesh, size_t count,
+                            int frames) {
+    StreamResult result;
+    result.name = name;
+    InstanceBuffer instanceBuffer;
+    StreamBuffer stream(count * sizeof(InstanceData), mode == 2);
+    std::vector<InstanceData> instances(count);
+    size_t indexCount = mesh.getLods()[0].indexCount;
+
+    double cpuMs = 0.0;
+    auto wallStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        context.clear();
+        if (mode == 0) {
+            fillInstances(instances.data(), count, frame);
+            instanceBuffer.upload(instances, true);
+            mesh.getArena()->bind();
+            instanceBuffer.bindAttributes();
+        } else {
+            stream.beginFrame();
+            StreamAllocation allocation = stream.allocate(count * sizeof(InstanceData));
+            fillInstances(static_cast<InstanceData*>(allocation.data), count, frame);
+            stream.commit();
+            mesh.getArena()->bind();
+            InstanceBuffer::bindAttributes(allocation.buffer, allocation.offset);
+        }
+        mesh.drawInstancedRange(0, indexCount, count);
+        glFlush();
+        cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    context.finish();
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    InstanceBuffer::unbindAttributes();
+
+    result.cpuMs = cpuMs / frames;
+    result.wallMs = wallMs / frames;
+    result.stalls = stream.getStats().stalls;
+    result.stallMs = stream.getStats().stallMs;
+    result.checksum = frameChecksum(context);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = "bench_stream.json";
+    size_t count = 16384;
+    int frames = 200;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--instances") == 0 && hasValue) {
+            count = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--instances N] [--frames N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    HeadlessContext context(WIDTH, HEIGHT);
+    if (!context.init()) return -1;
+
+    const std::string shaderDirectory = ENGINE_SHADER_DIR;
+    Shader shader;
+    if (!shader.loadFromFiles(shaderDirectory + "/basic.vert", shaderDirectory + "/basic.frag", {"INSTANCED"})) {
+        std::fprintf(stderr, "Failed to load shaders\n");
+        return -1;
+    }
+    FrameData frameData = {};
+    frameData.view[0] = frameData.view[5] = frameData.view[10] = frameData.view[15] = 1.0f;
+    frameData.projection[0] = frameData.projection[5] = frameData.projection[10] = frameData.projection[15] = 1.0f;
+    UniformBuffer frameUniforms(sizeof(FrameData), Shader::FRAME_DATA_BINDING);
+    frameUniforms.update(&frameData);
+    frameUniforms.bind();
+    shader.use();
+
+    Mesh mesh = Mesh::createPlane(0.01f);
+    bool persistent = GLCapabilities::get().bufferStorage;
+    std::vector<StreamResult> results;
+    results.push_back(measure("subdata", 0, context, mesh, count, frames));
+    results.push_back(measure("orphan", 1, context, mesh, count, frames));
+    if (persistent) results.push_back(measure("persistent", 2, context, mesh, count, frames));
+
+    bool identical = true;
+    for (const StreamResult& result : results) {
+        identical = identical && result.checksum == results[0].checksum;
+        std::printf("bench_stream: %-10s %7.3f ms CPU, %7.3f ms wall per frame, %llu stalls (%.1f ms)\n",
+                    result.name, result.cpuMs, result.wallMs, static_cast<unsigned long long>(result.stalls),
+                    result.stallMs);
+    }
+    std::printf("bench_stream: %zu instances (%.1f KB per frame), %d frames, last frames %s\n", count,
+                count * sizeof(InstanceData) / 1024.0, frames, identical ? "identical" : "DIFFER");
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"stream\",\n");
+    std::fprintf(out, "  \"instances\": %zu,\n  \"frames\": %d,\n  \"bufferStorage\": %s,\n", count, frames,
+                 persistent ? "true" : "false");
+    std::fprintf(out, "  \"identical\": %s,\n", identical ? "true" : "false");
+    std::fprintf(out, "  \"modes\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const StreamResult& result = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"cpuMs\": %.4f, \"wallMs\": %.4f, \"stalls\": %llu, \"stallMs\": %.3f}%s\n",
+                     result.name, result.cpuMs, result.wallMs, static_cast<unsigned long long>(result.stalls),
+                     result.stallMs, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return identical ? 0 : -1;
+}
@@ -0,0 +1,195 @@
+// Per-frame cost of TransformHierarchy::update on a scene of mostly static
+// objects: a thousand props of a hundred nodes each (root, 9 parts, 10
+// pieces per part). Each scenario touches a different share of the nodes
+// every frame, from nothing to every root, and reports the time per update
+// and how many world matrices it recomputed.
+//
+// The world matrices are checked against a plain recursive evaluation with
+// Matrix4::compose and matrixMult after every scenario and after reparenting
+// and destroying subtrees.
+//
+//   bench_transforms [--objects N] [--frames N] [--output file.json]
+#include "../Engine/TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const int PARTS = 9;
+static const int PIECES = 10;
+
+struct Scenario {
+    const char* name;
+    double ms = 0.0;
+    double updatedNodes = 0.0;
+};
+
+static Quaternion randomRotation(std::mt19937& random) {
+    auto unit = [&] { return (random() & 0xffffff) / 16777216.0f; };
+    Vector3 axis(unit() - 0.5f, unit() - 0.5f, unit() - 0.5f);
+    if (axis.length() == 0.0f) axis = Vector3(0.0f, 1.0f, 0.0f);
+    return Quaternion::axisRotation(unit() * 6.2831853f, axis);
+}
+
+// World matrix straight from the definition, memoized per id
+static const Matrix4& referenceWorld(const TransformHierarchy& hierarchy, TransformId id,
+                                     std::vector<Matrix4>& cache, std::vector<char>& done) {
+    if (!done[id]) {
+        Matrix4 local = Matrix4::compose(hierarchy.getLocalPosition(id), hierarchy.getLocalRotation(id),
+                                         hierarchy.getLocalScale(id));
+        TransformId parent = hierarchy.getParent(id);
+        cache[id] = parent == NO_TRANSFORM ? local : referenceWorld(hierarchy, parent, cache, done).matrixMult(local);
+        done[id] = 1;
+    }
+    return cache[id];
+}
+
+// Largest difference to the reference over every live node, with the
+// inverses checked on the way
+static float verify(const TransformHierarchy& hierarchy, const std::vector<TransformId>& ids, float& inverseError) {
+    std::vector<Matrix4> cache(ids.size());
+    std::vector<char> done(ids.size(), 0);
+    float error = 0.0f;
+    inverseError = 0.0f;
+    for (TransformId id : ids) {
+        if (!hierarchy.isValid(id)) continue;
+        const Matrix4& world = hierarchy.getWorld(id);
+        const Matrix4& reference = referenceWorld(hierarchy, id, cache, done);
+        for (int i = 0; i < 16; i++) error = std::max(error, std::fabs(world.arr[i] - reference.arr[i]));
+
+        // Non-uniform scales under rotated children shear, which only the
+        // general inverse handles; the roots are plain compose() results
+        Matrix4 product = world.matrixMult(world.inverse());
+        if (hierarchy.getParent(id) == NO_TRANSFORM) product = product.matrixMult(world).matrixMult(world.affineInverse());
+        for (int i = 0; i < 16; i++) {
+            float identity = i % 5 == 0 ? 1.0f : 0.0f;
+            inverseError = std::max(inverseError, std::fabs(product.arr[i] - identity));
+        }
+    }
+    return error;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = "bench_transforms.json";
+    int objects = 1000;
+    int frames = 200;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--objects") == 0 && hasValue) {
+            objects = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--objects N] [--frames N] [--output file.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    // Built breadth-first per object, so the first update also re-sorts
+    std::mt19937 random(1);
+    auto unit = [&] { return (random() & 0xffffff) / 16777216.0f; };
+    TransformHierarchy hierarchy;
+    std::vector<TransformId> ids, roots, leaves;
+    for (int object = 0; object < objects; object++) {
+        TransformId root = hierarchy.create();
+        hierarchy.setLocal(root, Vector3((object % 32) * 4.0f, 0.0f, (object / 32) * 4.0f), randomRotation(random),
+                           Vector3(1.0f, 1.0f, 1.0f));
+        roots.push_back(root);
+        ids.push_back(root);
+        std::vector<TransformId> parts;
+        for (int p = 0; p < PARTS; p++) {
+            TransformId part = hierarchy.create(root);
+            hierarchy.setLocal(part, Vector3(unit(), unit() + 1.0f, unit()), randomRotation(random),
+                               Vector3(0.8f, 0.8f + unit() * 0.4f, 0.8f));
+            parts.push_back(part);
+            ids.push_back(part);
+        }
+        for (TransformId part : parts) {
+            for (int p = 0; p < PIECES; p++) {
+                TransformId piece = hierarchy.create(part);
+                hierarchy.setLocal(piece, Vector3(unit() * 0.5f, unit() * 0.5f, unit() * 0.5f), randomRotation(random),
+                                   Vector3(0.5f, 0.5f, 0.5f));
+                leaves.push_back(piece);
+                ids.push_back(piece);
+            }
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    hierarchy.update();
+    double firstMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("bench_transforms: %zu nodes, first update (with re-sort) %.3f ms\n", hierarchy.size(), firstMs);
+
+    // Touched per frame: nothing, 1% of the leaves, ten whole objects, every object
+    size_t touchedLeaves[] = {0, leaves.size() / 100, 0, 0};
+    size_t touchedRoots[] = {0, 0, std::min<size_t>(10, roots.size()), roots.size()};
+    std::vector<Scenario> scenarios = {{"static"}, {"leaves1%"}, {"roots10"}, {"allRoots"}};
+    float maxError = 0.0f, maxInverseError = 0.0f;
+    for (size_t s = 0; s < scenarios.size(); s++) {
+        Scenario& scenario = scenarios[s];
+        double total = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            for (size_t i = 0; i < touchedLeaves[s]; i++) {
+                hierarchy.setLocalRotation(leaves[random() % leaves.size()], randomRotation(random));
+            }
+            for (size_t i = 0; i < touchedRoots[s]; i++) {
+                TransformId root = touchedRoots[s] == roots.size() ? roots[i] : roots[random() % roots.size()];
+                hierarchy.setLocalRotation(root, randomRotation(random));
+            }
+            start = std::chrono::steady_clock::now();
+            hierarchy.update();
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            scenario.updatedNodes += hierarchy.getStats().updatedNodes;
+        }
+        scenario.ms = total / frames;
+        scenario.updatedNodes /= frames;
+
+        float inverseError = 0.0f;
+        maxError = std::max(maxError, verify(hierarchy, ids, inverseError));
+        maxInverseError = std::max(maxInverseError, inverseError);
+        std::printf("bench_transforms: %-9s %8.4f ms per update, %8.0f nodes recomputed\n", scenario.name, scenario.ms,
+                    scenario.updatedNodes);
+    }
+
+    // Structural changes: move every tenth part to another object, drop
+    // every tenth object
+    for (size_t i = 0; i < roots.size(); i += 10) {
+        TransformId part = ids[i * (1 + PARTS + PARTS * PIECES) + 1];
+        hierarchy.setParent(part, roots[(i + 5) % roots.size()]);
+    }
+    for (size_t i = 3; i < roots.size(); i += 10) hierarchy.destroy(roots[i]);
+    hierarchy.update();
+    float inverseError = 0.0f;
+    maxError = std::max(maxError, verify(hierarchy, ids, inverseError));
+    maxInverseError = std::max(maxInverseError, inverseError);
+    bool matches = maxError < 1e-3f && maxInverseError < 1e-3f;
+    std::printf("bench_transforms: after reparenting and destroying, %zu nodes, %zu re-sorts; largest error %.2g, "
+                "inverse error %.2g, %s\n",
+                hierarchy.size(), hierarchy.getStats().reorders, maxError, maxInverseError,
+                matches ? "matches the reference" : "DIFFERS FROM THE REFERENCE");
+
+    FILE* out = std::fopen(outputPath, "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", outputPath);
+        return -1;
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"transforms\",\n");
+    std::fprintf(out, "  \"nodes\": %zu,\n  \"frames\": %d,\n  \"firstUpdateMs\": %.4f,\n", ids.size(), frames, firstMs);
+    std::fprintf(out, "  \"maxError\": %g,\n  \"matches\": %s,\n", maxError, matches ? "true" : "false");
+    std::fprintf(out, "  \"scenarios\": [\n");
+    for (size_t s = 0; s < scenarios.size(); s++) {
+        std::fprintf(out, "    {\"name\": \"%s\", \"ms\": %.5f, \"updatedNodes\": %.0f}%s\n", scenarios[s].name,
+                     scenarios[s].ms, scenarios[s].updatedNodes, s + 1 < scenarios.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n");
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return matches ? 0 : -1;
+}
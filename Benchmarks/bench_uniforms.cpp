@@ -0,0 +1,123 @@
+// Per-draw CPU cost of the three ways of feeding uniforms to basic.vert:
+// a driver lookup per set (the old Shader behavior), a cached lookup by name,
+// and pre-resolved handles with the shared data in the FrameData block.
+// Runs headless where EGL is available (ENGINE_HEADLESS), in a window otherwise.
+#ifdef ENGINE_HEADLESS
+#include "../Engine/Rendering/HeadlessContext.h"
+#else
+#include "../Engine/Rendering/Window.h"
+#endif
+#include "../Engine/Rendering/Shader.h"
+#include "../Engine/Rendering/UniformBuffer.h"
+#include "../Engine/Mesh.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "Engine/Rendering/Shaders"
+#endif
+
+static const int DRAWS_PER_FRAME = 10000;
+static const int FRAMES = 20;
+
+typedef void (*SubmitFunction)(const Shader& shader, const Mesh& mesh, const float* matrices);
+
+// Old path: every set resolves its location through the driver
+static void submitWithLookup(const Shader& shader, const Mesh& mesh, const float* matrices) {
+    GLuint program = shader.getProgram();
+    for (int i = 0; i < DRAWS_PER_FRAME; i++) {
+        const float* m = matrices + (i % 64) * 16;
+        glUniformMatrix4fv(glGetUniformLocation(program, std::string("model").c_str()), 1, GL_FALSE, m);
+        glUniformMatrix4fv(glGetUniformLocation(program, std::string("transform").c_str()), 1, GL_FALSE, m);
+        glUniform3f(glGetUniformLocation(program, std::string("windDirection").c_str()), 1.0f, 0.0f, 0.0f);
+        glUniform1f(glGetUniformLocation(program, std::string("windStrength").c_str()), 0.3f);
+        mesh.draw();
+    }
+}
+
+// Name setters, resolved from the cache filled after linking
+static void submitWithCache(const Shader& shader, const Mesh& mesh, const float* matrices) {
+    for (int i = 0; i < DRAWS_PER_FRAME; i++) {
+        const float* m = matrices + (i % 64) * 16;
+        shader.setMat4("model", m);
+        shader.setMat4("transform", m);
+        mesh.draw();
+    }
+}
+
+// Handles resolved once, shared data comes from the uniform buffer
+static void submitWithHandles(const Shader& shader, const Mesh& mesh, const float* matrices) {
+    static UniformMat4 model = shader.getMat4Uniform("model");
+    static UniformMat4 transform = shader.getMat4Uniform("transform");
+    for (int i = 0; i < DRAWS_PER_FRAME; i++) {
+        const float* m = matrices + (i % 64) * 16;
+        model.set(m);
+        transform.set(m);
+        mesh.draw();
+    }
+}
+
+static double measure(const Shader& shader, const Mesh& mesh, const float* matrices, SubmitFunction submit) {
+    // One warm-up frame, then the average CPU submission time per draw
+    submit(shader, mesh, matrices);
+    glFinish();
+
+    double totalNs = 0.0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        submit(shader, mesh, matrices);
+        auto end = std::chrono::steady_clock::now();
+        totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+        glFinish();
+    }
+    return totalNs / (FRAMES * DRAWS_PER_FRAME);
+}
+
+int main() {
+#ifdef ENGINE_HEADLESS
+    HeadlessContext window(320, 240);
+#else
+    Window window(320, 240, "Uniform benchmark");
+#endif
+    if (!window.init()) {
+        std::fprintf(stderr, "Failed to initialize window\n");
+        return -1;
+    }
+
+    const std::string shaderDirectory = ENGINE_SHADER_DIR;
+    Shader shader;
+    if (!shader.loadFromFiles(shaderDirectory + "/basic.vert", shaderDirectory + "/basic.frag")) {
+        std::fprintf(stderr, "Failed to load shaders\n");
+        return -1;
+    }
+
+    Mesh mesh = Mesh::createPlane(0.01f);
+    float matrices[64 * 16];
+    for (int i = 0; i < 64; i++) {
+        float* m = matrices + i * 16;
+        std::memset(m, 0, 16 * sizeof(float));
+        m[0] = m[5] = m[10] = m[15] = 1.0f;
+        m[12] = (i % 8) * 0.1f - 0.4f;
+        m[13] = (i / 8) * 0.1f - 0.4f;
+    }
+
+    FrameData frameData = {};
+    frameData.view[0] = frameData.view[5] = frameData.view[10] = frameData.view[15] = 1.0f;
+    frameData.projection[0] = frameData.projection[5] = frameData.projection[10] = frameData.projection[15] = 1.0f;
+    UniformBuffer frameUniforms(sizeof(FrameData), Shader::FRAME_DATA_BINDING);
+    frameUniforms.update(&frameData);
+    frameUniforms.bind();
+
+    shader.use();
+    double lookupNs = measure(shader, mesh, matrices, submitWithLookup);
+    double cachedNs = measure(shader, mesh, matrices, submitWithCache);
+    double handleNs = measure(shader, mesh, matrices, submitWithHandles);
+
+    std::printf("draws per frame: %d\n", DRAWS_PER_FRAME);
+    std::printf("driver lookup per set : %8.1f ns/draw\n", lookupNs);
+    std::printf("cached name lookup    : %8.1f ns/draw\n", cachedNs);
+    std::printf("handles + FrameData   : %8.1f ns/draw (%.1fx faster than lookup)\n", handleNs, lookupNs / handleNs);
+    return 0;
+}
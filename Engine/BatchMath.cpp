@@ -0,0 +1,243 @@
+#include "BatchMath.h"
+#include <cmath>
+
+// Scalar kernels, also used for the tails the SIMD loops leave behind
+
+static void transformPointsScalar(const Matrix4& m,
+                                  const float* inX, const float* inY, const float* inZ,
+                                  float* outX, float* outY, float* outZ,
+                                  size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        Vector3 p = m.vectorTrans(Vector3(inX[i], inY[i], inZ[i]));
+        outX[i] = p.x;
+        outY[i] = p.y;
+        outZ[i] = p.z;
+    }
+}
+
+static void multiplyScalar(const Matrix4* a, size_t aStep, const Matrix4* b, size_t bStep,
+                           Matrix4* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i * aStep].matrixMult(b[i * bStep]);
+    }
+}
+
+static void normalizeScalar(float* x, float* y, float* z, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        Vector3 v = Vector3(x[i], y[i], z[i]).normalize();
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+}
+
+#if ENGINE_SIMD_X86
+
+// SSE: 4 points per iteration, one 4-wide row per matrix row
+
+static void transformPointsSSE(const Matrix4& m,
+                               const float* inX, const float* inY, const float* inZ,
+                               float* outX, float* outY, float* outZ, size_t count) {
+    const float* a = m.arr;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(inX + i);
+        __m128 y = _mm_loadu_ps(inY + i);
+        __m128 z = _mm_loadu_ps(inZ + i);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), x),
+                   _mm_mul_ps(_mm_set1_ps(a[1]), y)), _mm_mul_ps(_mm_set1_ps(a[2]), z)), _mm_set1_ps(a[3]));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[4]), x),
+                   _mm_mul_ps(_mm_set1_ps(a[5]), y)), _mm_mul_ps(_mm_set1_ps(a[6]), z)), _mm_set1_ps(a[7]));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[8]), x),
+                   _mm_mul_ps(_mm_set1_ps(a[9]), y)), _mm_mul_ps(_mm_set1_ps(a[10]), z)), _mm_set1_ps(a[11]));
+
+        _mm_storeu_ps(outX + i, rx);
+        _mm_storeu_ps(outY + i, ry);
+        _mm_storeu_ps(outZ + i, rz);
+    }
+    transformPointsScalar(m, inX, inY, inZ, outX, outY, outZ, i, count);
+}
+
+static void multiplySSE(const Matrix4* a, size_t aStep, const Matrix4* b, size_t bStep,
+                        Matrix4* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const float* pa = a[i * aStep].arr;
+        const float* pb = b[i * bStep].arr;
+        __m128 b0 = _mm_loadu_ps(pb);
+        __m128 b1 = _mm_loadu_ps(pb + 4);
+        __m128 b2 = _mm_loadu_ps(pb + 8);
+        __m128 b3 = _mm_loadu_ps(pb + 12);
+
+        // All four rows are computed before storing so out may alias a or b
+        __m128 rows[4];
+        for (int r = 0; r < 4; r++) {
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(pa[r * 4]), b0);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pa[r * 4 + 1]), b1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pa[r * 4 + 2]), b2));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pa[r * 4 + 3]), b3));
+            rows[r] = sum;
+        }
+
+        float* po = out[i].arr;
+        _mm_storeu_ps(po, rows[0]);
+        _mm_storeu_ps(po + 4, rows[1]);
+        _mm_storeu_ps(po + 8, rows[2]);
+        _mm_storeu_ps(po + 12, rows[3]);
+    }
+}
+
+static void normalizeSSE(float* x, float* y, float* z, size_t count) {
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+        __m128 valid = _mm_cmpgt_ps(len, zero);
+
+        _mm_storeu_ps(x + i, _mm_and_ps(valid, _mm_div_ps(vx, len)));
+        _mm_storeu_ps(y + i, _mm_and_ps(valid, _mm_div_ps(vy, len)));
+        _mm_storeu_ps(z + i, _mm_and_ps(valid, _mm_div_ps(vz, len)));
+    }
+    normalizeScalar(x, y, z, i, count);
+}
+
+// AVX2: 8 points per iteration, two matrix rows per 256-bit register
+
+ENGINE_TARGET_AVX2
+static void transformPointsAVX2(const Matrix4& m,
+                                const float* inX, const float* inY, const float* inZ,
+                                float* outX, float* outY, float* outZ, size_t count) {
+    const float* a = m.arr;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(inX + i);
+        __m256 y = _mm256_loadu_ps(inY + i);
+        __m256 z = _mm256_loadu_ps(inZ + i);
+
+        __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a[0]), x),
+                    _mm256_mul_ps(_mm256_set1_ps(a[1]), y)), _mm256_mul_ps(_mm256_set1_ps(a[2]), z)), _mm256_set1_ps(a[3]));
+        __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a[4]), x),
+                    _mm256_mul_ps(_mm256_set1_ps(a[5]), y)), _mm256_mul_ps(_mm256_set1_ps(a[6]), z)), _mm256_set1_ps(a[7]));
+        __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a[8]), x),
+                    _mm256_mul_ps(_mm256_set1_ps(a[9]), y)), _mm256_mul_ps(_mm256_set1_ps(a[10]), z)), _mm256_set1_ps(a[11]));
+
+        _mm256_storeu_ps(outX + i, rx);
+        _mm256_storeu_ps(outY + i, ry);
+        _mm256_storeu_ps(outZ + i, rz);
+    }
+    transformPointsScalar(m, inX, inY, inZ, outX, outY, outZ, i, count);
+}
+
+// Rows r and r+1 of a live in the two 128-bit lanes of ar; the in-lane shuffle
+// broadcasts column k of each row against row k of b duplicated in both lanes
+ENGINE_TARGET_AVX2
+static inline __m256 multiplyRowPairAVX2(__m256 ar, __m256 b0, __m256 b1, __m256 b2, __m256 b3) {
+    __m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(ar, ar, 0x00), b0);
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(ar, ar, 0x55), b1));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(ar, ar, 0xAA), b2));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(ar, ar, 0xFF), b3));
+    return sum;
+}
+
+ENGINE_TARGET_AVX2
+static void multiplyAVX2(const Matrix4* a, size_t aStep, const Matrix4* b, size_t bStep,
+                         Matrix4* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const float* pa = a[i * aStep].arr;
+        const float* pb = b[i * bStep].arr;
+        __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pb));
+        __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pb + 4));
+        __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pb + 8));
+        __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pb + 12));
+
+        __m256 r01 = multiplyRowPairAVX2(_mm256_loadu_ps(pa), b0, b1, b2, b3);
+        __m256 r23 = multiplyRowPairAVX2(_mm256_loadu_ps(pa + 8), b0, b1, b2, b3);
+
+        _mm256_storeu_ps(out[i].arr, r01);
+        _mm256_storeu_ps(out[i].arr + 8, r23);
+    }
+}
+
+ENGINE_TARGET_AVX2
+static void normalizeAVX2(float* x, float* y, float* z, size_t count) {
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+                                                  _mm256_mul_ps(vz, vz)));
+        __m256 valid = _mm256_cmp_ps(len, zero, _CMP_GT_OQ);
+
+        _mm256_storeu_ps(x + i, _mm256_and_ps(valid, _mm256_div_ps(vx, len)));
+        _mm256_storeu_ps(y + i, _mm256_and_ps(valid, _mm256_div_ps(vy, len)));
+        _mm256_storeu_ps(z + i, _mm256_and_ps(valid, _mm256_div_ps(vz, len)));
+    }
+    normalizeScalar(x, y, z, i, count);
+}
+
+#endif
+
+static void multiply(const Matrix4* a, size_t aStep, const Matrix4* b, size_t bStep,
+                     Matrix4* out, size_t count) {
+#if ENGINE_SIMD_X86
+    switch (Simd::level()) {
+        case SimdLevel::AVX2: multiplyAVX2(a, aStep, b, bStep, out, count); return;
+        case SimdLevel::SSE: multiplySSE(a, aStep, b, bStep, out, count); return;
+        default: break;
+    }
+#endif
+    multiplyScalar(a, aStep, b, bStep, out, count);
+}
+
+void BatchMath::transformPoints(const Matrix4& m,
+                                const float* inX, const float* inY, const float* inZ,
+                                float* outX, float* outY, float* outZ, size_t count) {
+#if ENGINE_SIMD_X86
+    switch (Simd::level()) {
+        case SimdLevel::AVX2: transformPointsAVX2(m, inX, inY, inZ, outX, outY, outZ, count); return;
+        case SimdLevel::SSE: transformPointsSSE(m, inX, inY, inZ, outX, outY, outZ, count); return;
+        default: break;
+    }
+#endif
+    transformPointsScalar(m, inX, inY, inZ, outX, outY, outZ, 0, count);
+}
+
+void BatchMath::transformPoints(const Matrix4& m, const Vector3SoA& in, Vector3SoA& out) {
+    out.resize(in.size());
+    transformPoints(m, in.x.data(), in.y.data(), in.z.data(),
+                    out.x.data(), out.y.data(), out.z.data(), in.size());
+}
+
+void BatchMath::multiplyMatrices(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+    multiply(a, 1, b, 1, out, count);
+}
+
+void BatchMath::multiplyMatrices(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+    multiply(&a, 0, b, 1, out, count);
+}
+
+void BatchMath::multiplyMatrices(const Matrix4* a, const Matrix4& b, Matrix4* out, size_t count) {
+    multiply(a, 1, &b, 0, out, count);
+}
+
+void BatchMath::normalizeVectors(float* x, float* y, float* z, size_t count) {
+#if ENGINE_SIMD_X86
+    switch (Simd::level()) {
+        case SimdLevel::AVX2: normalizeAVX2(x, y, z, count); return;
+        case SimdLevel::SSE: normalizeSSE(x, y, z, count); return;
+        default: break;
+    }
+#endif
+    normalizeScalar(x, y, z, 0, count);
+}
+
+void BatchMath::normalizeVectors(Vector3SoA& v) {
+    normalizeVectors(v.x.data(), v.y.data(), v.z.data(), v.size());
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4.h"
+#include "Simd.h"
+
+// Structure-of-arrays storage for many points or directions, the layout the
+// batch kernels stream over
+struct Vector3SoA {
+    std::vector<float> x, y, z;
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+    }
+
+    void push_back(const Vector3& v) {
+        x.push_back(v.x);
+        y.push_back(v.y);
+        z.push_back(v.z);
+    }
+
+    Vector3 get(size_t i) const { return Vector3(x[i], y[i], z[i]); }
+
+    void set(size_t i, const Vector3& v) {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+};
+
+// Batch versions of the Matrix4 / Vector3 operations. Every kernel gives the
+// same result as calling the scalar method in a loop (same operation order, no
+// fused multiply-add), the SIMD paths just process 4 or 8 elements at a time.
+// The path is chosen from Simd::level() on every call.
+class BatchMath {
+public:
+    // out[i] = m.vectorTrans(in[i])
+    static void transformPoints(const Matrix4& m,
+                                const float* inX, const float* inY, const float* inZ,
+                                float* outX, float* outY, float* outZ, size_t count);
+    static void transformPoints(const Matrix4& m, const Vector3SoA& in, Vector3SoA& out);
+
+    // out[i] = a[i].matrixMult(b[i])
+    static void multiplyMatrices(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count);
+    // out[i] = a.matrixMult(b[i])
+    static void multiplyMatrices(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count);
+    // out[i] = a[i].matrixMult(b)
+    static void multiplyMatrices(const Matrix4* a, const Matrix4& b, Matrix4* out, size_t count);
+
+    // v[i] = v[i].normalize(), zero-length vectors stay zero
+    static void normalizeVectors(float* x, float* y, float* z, size_t count);
+    static void normalizeVectors(Vector3SoA& v);
+};
@@ -0,0 +1,715 @@
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+static const int BINS = 16;
+static const uint32_t MESH_LEAF = 4;  // Triangles, one SIMD test
+static const int MAX_BINARY_DEPTH = 64;  // Deeper splits fall back to the median
+
+// Each level pushes at most three more entries than it pops; median splits
+// past the depth limit add at most 32 levels
+static const int STACK_SIZE = 3 * (MAX_BINARY_DEPTH + 32) + 1;
+static const size_t RAY_GRAIN = 256;
+
+struct BuildBox {
+    float min[3] = {1e30f, 1e30f, 1e30f};
+    float max[3] = {-1e30f, -1e30f, -1e30f};
+
+    void grow(const BuildBox& other) {
+        for (int a = 0; a < 3; a++) {
+            min[a] = std::min(min[a], other.min[a]);
+            max[a] = std::max(max[a], other.max[a]);
+        }
+    }
+
+    void grow(const float* point) {
+        for (int a = 0; a < 3; a++) {
+            min[a] = std::min(min[a], point[a]);
+            max[a] = std::max(max[a], point[a]);
+        }
+    }
+
+    // Half the surface area, all the heuristic needs
+    float area() const {
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        if (dx < 0.0f) return 0.0f;
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    float center(int axis) const { return (min[axis] + max[axis]) * 0.5f; }
+};
+
+// Intermediate two-wide tree, leaf if count > 0
+struct BinaryNode {
+    BuildBox box;
+    uint32_t left = 0, right = 0;
+    uint32_t first = 0, count = 0;
+};
+
+// Binned SAH over the primitives' boxes, at most maxLeaf per leaf. order
+// ends up holding the primitive indices so every leaf is a contiguous range
+// of it. Leaves are tested maxLeaf primitives at a time, so the heuristic
+// counts primitives in groups of maxLeaf.
+static void buildBinary(const std::vector<BuildBox>& boxes, uint32_t maxLeaf, std::vector<uint32_t>& order,
+                        std::vector<BinaryNode>& tree) {
+    auto leafTests = [maxLeaf](uint32_t count) { return (count + maxLeaf - 1) / maxLeaf; };
+    order.resize(boxes.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    tree.clear();
+    tree.reserve(boxes.size() / 2 + 1);
+    tree.emplace_back();
+    tree[0].count = static_cast<uint32_t>(boxes.size());
+
+    struct Task {
+        uint32_t node;
+        int depth;
+    };
+    std::vector<Task> tasks = {{0, 0}};
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        uint32_t first = tree[task.node].first;
+        uint32_t count = tree[task.node].count;
+
+        BuildBox box, centroids;
+        for (uint32_t i = first; i < first + count; i++) {
+            const BuildBox& b = boxes[order[i]];
+            box.grow(b);
+            float c[3] = {b.center(0), b.center(1), b.center(2)};
+            centroids.grow(c);
+        }
+        tree[task.node].box = box;
+        if (count <= 1) continue;
+
+        // Cheapest bin boundary over the three axes
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = 1e30f;
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centroids.max[axis] - centroids.min[axis];
+            if (extent <= 0.0f) continue;
+            float scale = BINS / extent;
+            BuildBox binBoxes[BINS];
+            uint32_t binCounts[BINS] = {};
+            for (uint32_t i = first; i < first + count; i++) {
+                const BuildBox& b = boxes[order[i]];
+                int bin = std::min(BINS - 1, static_cast<int>((b.center(axis) - centroids.min[axis]) * scale));
+                binBoxes[bin].grow(b);
+                binCounts[bin]++;
+            }
+            float rightArea[BINS];
+            uint32_t rightCount[BINS];
+            BuildBox right;
+            uint32_t rightTotal = 0;
+            for (int bin = BINS - 1; bin > 0; bin--) {
+                right.grow(binBoxes[bin]);
+                rightTotal += binCounts[bin];
+                rightArea[bin] = right.area();
+                rightCount[bin] = rightTotal;
+            }
+            BuildBox left;
+            uint32_t leftTotal = 0;
+            for (int split = 1; split < BINS; split++) {
+                left.grow(binBoxes[split - 1]);
+                leftTotal += binCounts[split - 1];
+                if (leftTotal == 0 || rightCount[split] == 0) continue;
+                float cost = left.area() * leafTests(leftTotal) + rightArea[split] * leafTests(rightCount[split]);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        // A full leaf is one test, cheaper than any split
+        if (count <= maxLeaf) continue;
+
+        uint32_t middle;
+        if (bestAxis >= 0 && task.depth < MAX_BINARY_DEPTH) {
+            float scale = BINS / (centroids.max[bestAxis] - centroids.min[bestAxis]);
+            auto split = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t i) {
+                int bin = std::min(BINS - 1, static_cast<int>((boxes[i].center(bestAxis) - centroids.min[bestAxis]) * scale));
+                return bin < bestSplit;
+            });
+            middle = static_cast<uint32_t>(split - order.begin());
+        } else {
+            // Identical centroids, or too deep: halve along the longest axis
+            int axis = 0;
+            for (int a = 1; a < 3; a++) {
+                if (box.max[a] - box.min[a] > box.max[axis] - box.min[axis]) axis = a;
+            }
+            middle = first + count / 2;
+            std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+                             [&](uint32_t a, uint32_t b) { return boxes[a].center(axis) < boxes[b].center(axis); });
+        }
+
+        uint32_t left = static_cast<uint32_t>(tree.size());
+        tree.emplace_back();
+        tree.emplace_back();
+        tree[left].first = first;
+        tree[left].count = middle - first;
+        tree[left + 1].first = middle;
+        tree[left + 1].count = first + count - middle;
+        tree[task.node].left = left;
+        tree[task.node].right = left + 1;
+        tree[task.node].count = 0;
+        tasks.push_back({left, task.depth + 1});
+        tasks.push_back({left + 1, task.depth + 1});
+    }
+}
+
+// Pull grandchildren up until a node has four children, widest boxes first.
+// makeLeaf(first, count) returns the payload of a leaf child.
+template <typename MakeLeaf>
+static uint32_t collapse(const std::vector<BinaryNode>& tree, uint32_t binary, std::vector<BvhNode>& nodes,
+                         BvhStats& stats, int depth, MakeLeaf& makeLeaf) {
+    uint32_t children[4];
+    uint32_t childCount = 0;
+    if (tree[binary].count > 0) {
+        children[childCount++] = binary;
+    } else {
+        children[childCount++] = tree[binary].left;
+        children[childCount++] = tree[binary].right;
+        while (childCount < 4) {
+            int widest = -1;
+            for (uint32_t c = 0; c < childCount; c++) {
+                if (tree[children[c]].count > 0) continue;
+                if (widest < 0 || tree[children[c]].box.area() > tree[children[widest]].box.area()) widest = c;
+            }
+            if (widest < 0) break;
+            uint32_t split = children[widest];
+            children[widest] = tree[split].left;
+            children[childCount++] = tree[split].right;
+        }
+    }
+
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    stats.depth = std::max(stats.depth, depth + 1);
+    BvhNode node = {};
+    node.childCount = childCount;
+    for (uint32_t c = 0; c < 4; c++) {
+        // Unused slots get an empty box and are masked out by childCount
+        const BuildBox box = c < childCount ? tree[children[c]].box : BuildBox();
+        node.minX[c] = box.min[0];
+        node.minY[c] = box.min[1];
+        node.minZ[c] = box.min[2];
+        node.maxX[c] = box.max[0];
+        node.maxY[c] = box.max[1];
+        node.maxZ[c] = box.max[2];
+        if (c >= childCount) continue;
+        const BinaryNode& child = tree[children[c]];
+        if (child.count > 0) {
+            node.child[c] = BvhNode::LEAF | makeLeaf(child.first, child.count);
+            stats.leaves++;
+        } else {
+            node.child[c] = collapse(tree, children[c], nodes, stats, depth + 1, makeLeaf);
+        }
+    }
+    nodes[index] = node;
+    return index;
+}
+
+// Ray with the reciprocal direction for the slab test. Zero components get
+// a huge but finite reciprocal so no 0 * inf appears.
+struct PreparedRay {
+    float ox, oy, oz;
+    float dx, dy, dz;
+    float ix, iy, iz;
+};
+
+static float safeReciprocal(float d) {
+    if (std::fabs(d) < 1e-20f) d = d < 0.0f ? -1e-20f : 1e-20f;
+    return 1.0f / d;
+}
+
+static PreparedRay prepare(const Ray& ray) {
+    PreparedRay r;
+    r.ox = ray.origin.x;
+    r.oy = ray.origin.y;
+    r.oz = ray.origin.z;
+    r.dx = ray.direction.x;
+    r.dy = ray.direction.y;
+    r.dz = ray.direction.z;
+    r.ix = safeReciprocal(r.dx);
+    r.iy = safeReciprocal(r.dy);
+    r.iz = safeReciprocal(r.dz);
+    return r;
+}
+
+// Bit c set if child c's box is entered before tMax; entry distances in tNear
+
+static int intersectNodeScalar(const BvhNode& node, const PreparedRay& r, float tMax, float* tNear) {
+    int mask = 0;
+    for (uint32_t c = 0; c < node.childCount; c++) {
+        float x1 = (node.minX[c] - r.ox) * r.ix, x2 = (node.maxX[c] - r.ox) * r.ix;
+        float y1 = (node.minY[c] - r.oy) * r.iy, y2 = (node.maxY[c] - r.oy) * r.iy;
+        float z1 = (node.minZ[c] - r.oz) * r.iz, z2 = (node.maxZ[c] - r.oz) * r.iz;
+        float enter = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+        float exit = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), tMax));
+        tNear[c] = enter;
+        if (enter <= exit) mask |= 1 << c;
+    }
+    return mask;
+}
+
+// Closest of the leaf's triangles nearer than tMax. Möller-Trumbore.
+static bool intersectTrianglesScalar(const BvhTriangles& tri, const PreparedRay& r, float& tMax, float& u,
+                                     float& v, uint32_t& id) {
+    bool found = false;
+    for (int lane = 0; lane < 4; lane++) {
+        float px = r.dy * tri.e2z[lane] - r.dz * tri.e2y[lane];
+        float py = r.dz * tri.e2x[lane] - r.dx * tri.e2z[lane];
+        float pz = r.dx * tri.e2y[lane] - r.dy * tri.e2x[lane];
+        float det = tri.e1x[lane] * px + tri.e1y[lane] * py + tri.e1z[lane] * pz;
+        if (det == 0.0f) continue;
+        float inv = 1.0f / det;
+        float sx = r.ox - tri.v0x[lane], sy = r.oy - tri.v0y[lane], sz = r.oz - tri.v0z[lane];
+        float lu = (sx * px + sy * py + sz * pz) * inv;
+        float qx = sy * tri.e1z[lane] - sz * tri.e1y[lane];
+        float qy = sz * tri.e1x[lane] - sx * tri.e1z[lane];
+        float qz = sx * tri.e1y[lane] - sy * tri.e1x[lane];
+        float lv = (r.dx * qx + r.dy * qy + r.dz * qz) * inv;
+        float t = (tri.e2x[lane] * qx + tri.e2y[lane] * qy + tri.e2z[lane] * qz) * inv;
+        if (lu >= 0.0f && lv >= 0.0f && lu + lv <= 1.0f && t >= 0.0f && t < tMax) {
+            tMax = t;
+            u = lu;
+            v = lv;
+            id = tri.id[lane];
+            found = true;
+        }
+    }
+    return found;
+}
+
+#if ENGINE_SIMD_X86
+
+static int intersectNodeSSE(const BvhNode& node, const PreparedRay& r, float tMax, float* tNear) {
+    __m128 ox = _mm_set1_ps(r.ox), oy = _mm_set1_ps(r.oy), oz = _mm_set1_ps(r.oz);
+    __m128 ix = _mm_set1_ps(r.ix), iy = _mm_set1_ps(r.iy), iz = _mm_set1_ps(r.iz);
+    __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+    __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+    __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+    __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+    __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+    __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+    __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)),
+                              _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+    __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)),
+                             _mm_min_ps(_mm_max_ps(z1, z2), _mm_set1_ps(tMax)));
+    _mm_storeu_ps(tNear, enter);
+    return _mm_movemask_ps(_mm_cmple_ps(enter, exit)) & ((1 << node.childCount) - 1);
+}
+
+static bool intersectTrianglesSSE(const BvhTriangles& tri, const PreparedRay& r, float& tMax, float& u, float& v,
+                                  uint32_t& id) {
+    __m128 dx = _mm_set1_ps(r.dx), dy = _mm_set1_ps(r.dy), dz = _mm_set1_ps(r.dz);
+    __m128 e1x = _mm_load_ps(tri.e1x), e1y = _mm_load_ps(tri.e1y), e1z = _mm_load_ps(tri.e1z);
+    __m128 e2x = _mm_load_ps(tri.e2x), e2y = _mm_load_ps(tri.e2y), e2z = _mm_load_ps(tri.e2z);
+
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(r.ox), _mm_load_ps(tri.v0x));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(r.oy), _mm_load_ps(tri.v0y));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(r.oz), _mm_load_ps(tri.v0z));
+    __m128 lu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv);
+
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 lv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+
+    // Degenerate and padding lanes have det == 0, so their NaNs are masked too
+    __m128 zero = _mm_setzero_ps();
+    __m128 valid = _mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_cmpge_ps(lu, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(lv, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(lu, lv), _mm_set1_ps(1.0f)));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+    int mask = _mm_movemask_ps(valid);
+    if (!mask) return false;
+
+    alignas(16) float ts[4], us[4], vs[4];
+    _mm_store_ps(ts, t);
+    _mm_store_ps(us, lu);
+    _mm_store_ps(vs, lv);
+    for (int lane = 0; lane < 4; lane++) {
+        if ((mask & (1 << lane)) && ts[lane] < tMax) {
+            tMax = ts[lane];
+            u = us[lane];
+            v = vs[lane];
+            id = tri.id[lane];
+        }
+    }
+    return true;
+}
+
+#endif
+
+static int intersectNode(bool simd, const BvhNode& node, const PreparedRay& r, float tMax, float* tNear) {
+#if ENGINE_SIMD_X86
+    if (simd) return intersectNodeSSE(node, r, tMax, tNear);
+#endif
+    return intersectNodeScalar(node, r, tMax, tNear);
+}
+
+static bool intersectTriangles(bool simd, const BvhTriangles& tri, const PreparedRay& r, float& tMax, float& u,
+                               float& v, uint32_t& id) {
+#if ENGINE_SIMD_X86
+    if (simd) return intersectTrianglesSSE(tri, r, tMax, u, v, id);
+#endif
+    return intersectTrianglesScalar(tri, r, tMax, u, v, id);
+}
+
+// Front-to-back walk shared by both levels. visitLeaf(payload, tMax) tests
+// a leaf, shrinking tMax on a hit, and returns whether it hit.
+template <typename VisitLeaf>
+static bool traverse(const std::vector<BvhNode>& nodes, const PreparedRay& r, float& tMax, bool anyHit,
+                     VisitLeaf&& visitLeaf) {
+    bool simd = Simd::level() != SimdLevel::Scalar;
+    uint32_t stack[STACK_SIZE];
+    float stackNear[STACK_SIZE];
+    int size = 0;
+    stack[size] = 0;
+    stackNear[size++] = 0.0f;
+    bool found = false;
+    while (size > 0) {
+        size--;
+        if (stackNear[size] > tMax) continue;
+        uint32_t item = stack[size];
+        if (item & BvhNode::LEAF) {
+            if (visitLeaf(item & ~BvhNode::LEAF, tMax)) {
+                found = true;
+                if (anyHit) return true;
+            }
+            continue;
+        }
+
+        const BvhNode& node = nodes[item];
+        float tNear[4];
+        int mask = intersectNode(simd, node, r, tMax, tNear);
+
+        // Farthest pushed first so the nearest is popped next
+        uint32_t hitChild[4];
+        float hitNear[4];
+        int hits = 0;
+        for (int c = 0; c < 4; c++) {
+            if (!(mask & (1 << c))) continue;
+            int slot = hits++;
+            while (slot > 0 && hitNear[slot - 1] < tNear[c]) {
+                hitChild[slot] = hitChild[slot - 1];
+                hitNear[slot] = hitNear[slot - 1];
+                slot--;
+            }
+            hitChild[slot] = node.child[c];
+            hitNear[slot] = tNear[c];
+        }
+        for (int h = 0; h < hits; h++) {
+            stack[size] = hitChild[h];
+            stackNear[size++] = hitNear[h];
+        }
+    }
+    return found;
+}
+
+// 10 bits of each coordinate interleaved, z highest
+static uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+    auto spread = [](uint32_t v) {
+        v = (v | (v << 16)) & 0x030000FFu;
+        v = (v | (v << 8)) & 0x0300F00Fu;
+        v = (v | (v << 4)) & 0x030C30C3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
+
+// Rays sorted by the Morton code of their origins (radix sort), so rays
+// traced one after another walk the same nodes while they are in cache.
+// Random ray order over a large hierarchy misses the cache at almost every
+// node below the top levels. Occlusion rays stop at the first hit and
+// mostly cost less than fetching them out of order, so only closest-hit
+// batches are sorted.
+static void coherentOrder(const Ray* rays, size_t count, const Vector3& min, const Vector3& max,
+                          std::vector<uint32_t>& order) {
+    float scale[3] = {1023.0f / std::max(max.x - min.x, 1e-20f), 1023.0f / std::max(max.y - min.y, 1e-20f),
+                      1023.0f / std::max(max.z - min.z, 1e-20f)};
+    auto quantize = [](float value, float scale) {
+        return static_cast<uint32_t>(std::min(1023.0f, std::max(0.0f, value * scale)));
+    };
+    std::vector<uint32_t> keys(count), sortedKeys(count), sorted(count);
+    order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const Vector3& o = rays[i].origin;
+        keys[i] = mortonCode(quantize(o.x - min.x, scale[0]), quantize(o.y - min.y, scale[1]),
+                             quantize(o.z - min.z, scale[2]));
+        order[i] = static_cast<uint32_t>(i);
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t offsets[257] = {};
+        for (size_t i = 0; i < count; i++) offsets[((keys[i] >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++) offsets[b + 1] += offsets[b];
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = offsets[(keys[i] >> shift) & 0xFF]++;
+            sortedKeys[slot] = keys[i];
+            sorted[slot] = order[i];
+        }
+        keys.swap(sortedKeys);
+        order.swap(sorted);
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool MeshBvh::build(const Mesh& mesh) {
+    if (mesh.getIndices().empty() || mesh.getVertices().empty()) {
+        std::cerr << "MeshBvh needs the mesh's CPU data (keepData = true)" << std::endl;
+        return false;
+    }
+    build(mesh.getVertices().data(), mesh.getVertices().size(), mesh.getIndices().data(), mesh.getIndices().size());
+    return true;
+}
+
+void MeshBvh::build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    auto start = std::chrono::steady_clock::now();
+    nodes.clear();
+    triangles.clear();
+    stats = BvhStats();
+
+    size_t triangleCount = vertexCount > 0 ? indexCount / 3 : 0;
+
+    // Out-of-range indices are pointed at vertex 0 once, here, so the boxes
+    // and the leaves below both read valid vertices
+    std::vector<unsigned int> clampedIndices;
+    size_t badIndices = 0;
+    for (size_t i = 0; i < triangleCount * 3; i++) badIndices += indices[i] >= vertexCount;
+    if (badIndices > 0) {
+        std::cerr << "MeshBvh: " << badIndices << " indices past the " << vertexCount
+                  << " vertices, using vertex 0 for them" << std::endl;
+        clampedIndices.assign(indices, indices + triangleCount * 3);
+        for (unsigned int& index : clampedIndices) index = index < vertexCount ? index : 0;
+        indices = clampedIndices.data();
+    }
+
+    std::vector<BuildBox> boxes(triangleCount);
+    BuildBox all;
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            const Vector3& p = vertices[indices[t * 3 + k]].position;
+            float point[3] = {p.x, p.y, p.z};
+            boxes[t].grow(point);
+        }
+        all.grow(boxes[t]);
+    }
+    stats.primitives = triangleCount;
+    if (triangleCount == 0) return;
+    boundsMin = Vector3(all.min[0], all.min[1], all.min[2]);
+    boundsMax = Vector3(all.max[0], all.max[1], all.max[2]);
+
+    std::vector<uint32_t> order;
+    std::vector<BinaryNode> tree;
+    buildBinary(boxes, MESH_LEAF, order, tree);
+
+    triangles.reserve(triangleCount / 2);
+    auto makeLeaf = [&](uint32_t first, uint32_t count) {
+        BvhTriangles block = {};
+        for (uint32_t lane = 0; lane < count; lane++) {
+            uint32_t t = order[first + lane];
+            const Vector3& a = vertices[indices[t * 3]].position;
+            Vector3 e1 = vertices[indices[t * 3 + 1]].position - a;
+            Vector3 e2 = vertices[indices[t * 3 + 2]].position - a;
+            block.v0x[lane] = a.x;
+            block.v0y[lane] = a.y;
+            block.v0z[lane] = a.z;
+            block.e1x[lane] = e1.x;
+            block.e1y[lane] = e1.y;
+            block.e1z[lane] = e1.z;
+            block.e2x[lane] = e2.x;
+            block.e2y[lane] = e2.y;
+            block.e2z[lane] = e2.z;
+            block.id[lane] = t;
+        }
+        for (uint32_t lane = count; lane < 4; lane++) block.id[lane] = RayHit::NONE;
+        triangles.push_back(block);
+        return static_cast<uint32_t>(triangles.size() - 1);
+    };
+    nodes.reserve(tree.size() / 3 + 1);
+    collapse(tree, 0, nodes, stats, 0, makeLeaf);
+    stats.nodes = nodes.size();
+    stats.buildMs = millisecondsSince(start);
+}
+
+bool MeshBvh::trace(const Ray& ray, bool anyHit, RayHit& hit) const {
+    if (nodes.empty()) return false;
+    PreparedRay r = prepare(ray);
+    bool simd = Simd::level() != SimdLevel::Scalar;
+    float tMax = ray.maxDistance;
+    float u = 0.0f, v = 0.0f;
+    uint32_t id = RayHit::NONE;
+    bool found = traverse(nodes, r, tMax, anyHit, [&](uint32_t leaf, float& leafMax) {
+        return intersectTriangles(simd, triangles[leaf], r, leafMax, u, v, id);
+    });
+    if (found) {
+        hit.distance = tMax;
+        hit.u = u;
+        hit.v = v;
+        hit.triangle = id;
+    }
+    return found;
+}
+
+bool MeshBvh::intersect(const Ray& ray, RayHit& hit) const {
+    hit = RayHit();
+    return trace(ray, false, hit);
+}
+
+bool MeshBvh::occluded(const Ray& ray) const {
+    RayHit hit;
+    return trace(ray, true, hit);
+}
+
+void MeshBvh::intersect(const Ray* rays, RayHit* hits, size_t count) const {
+    std::vector<uint32_t> order;
+    coherentOrder(rays, count, boundsMin, boundsMax, order);
+    JobSystem::parallelFor(count, RAY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) intersect(rays[order[i]], hits[order[i]]);
+    });
+}
+
+void MeshBvh::occluded(const Ray* rays, uint8_t* results, size_t count) const {
+    JobSystem::parallelFor(count, RAY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) results[i] = occluded(rays[i]) ? 1 : 0;
+    });
+}
+
+// Rotation and scale only, for directions
+static Vector3 transformDirection(const Matrix4& m, const Vector3& d) {
+    return Vector3(m.arr[0] * d.x + m.arr[1] * d.y + m.arr[2] * d.z,
+                   m.arr[4] * d.x + m.arr[5] * d.y + m.arr[6] * d.z,
+                   m.arr[8] * d.x + m.arr[9] * d.y + m.arr[10] * d.z);
+}
+
+uint32_t SceneBvh::addInstance(const MeshBvh* mesh, const Matrix4& world) {
+    instances.push_back({mesh, world, world.inverse()});
+    return static_cast<uint32_t>(instances.size() - 1);
+}
+
+void SceneBvh::setTransform(uint32_t instance, const Matrix4& world) {
+    instances[instance].world = world;
+    instances[instance].worldToObject = world.inverse();
+}
+
+void SceneBvh::clear() {
+    instances.clear();
+    order.clear();
+    nodes.clear();
+    stats = BvhStats();
+}
+
+void SceneBvh::build() {
+    auto start = std::chrono::steady_clock::now();
+    nodes.clear();
+    order.clear();
+    stats = BvhStats();
+
+    // World box of each placed mesh box, empty meshes left out
+    std::vector<BuildBox> boxes;
+    std::vector<uint32_t> placed;
+    BuildBox all;
+    for (uint32_t i = 0; i < instances.size(); i++) {
+        const Instance& instance = instances[i];
+        if (!instance.mesh || instance.mesh->empty()) continue;
+        const Vector3& lo = instance.mesh->getMin();
+        const Vector3& hi = instance.mesh->getMax();
+        BuildBox box;
+        for (int corner = 0; corner < 8; corner++) {
+            Vector3 p = instance.world.vectorTrans(
+                Vector3(corner & 1 ? hi.x : lo.x, corner & 2 ? hi.y : lo.y, corner & 4 ? hi.z : lo.z));
+            float point[3] = {p.x, p.y, p.z};
+            box.grow(point);
+        }
+        boxes.push_back(box);
+        placed.push_back(i);
+        all.grow(box);
+    }
+    stats.primitives = placed.size();
+    if (placed.empty()) return;
+    boundsMin = Vector3(all.min[0], all.min[1], all.min[2]);
+    boundsMax = Vector3(all.max[0], all.max[1], all.max[2]);
+
+    std::vector<uint32_t> buildOrder;
+    std::vector<BinaryNode> tree;
+    // One instance per leaf: each costs a ray transform and a traversal, so
+    // they are worth telling apart by their own boxes
+    buildBinary(boxes, 1, buildOrder, tree);
+    order.resize(buildOrder.size());
+    for (size_t i = 0; i < buildOrder.size(); i++) order[i] = placed[buildOrder[i]];
+
+    // Leaf payload: index into order
+    auto makeLeaf = [](uint32_t first, uint32_t) { return first; };
+    collapse(tree, 0, nodes, stats, 0, makeLeaf);
+    stats.nodes = nodes.size();
+    stats.buildMs = millisecondsSince(start);
+}
+
+bool SceneBvh::trace(const Ray& ray, bool anyHit, RayHit& hit) const {
+    if (nodes.empty()) return false;
+    PreparedRay r = prepare(ray);
+    bool found = traverse(nodes, r, hit.distance, anyHit, [&](uint32_t leaf, float& tMax) {
+        const Instance& instance = instances[order[leaf]];
+
+        // Affine maps keep t, so the object-space hit distance is the world one
+        Ray local;
+        local.origin = instance.worldToObject.vectorTrans(ray.origin);
+        local.direction = transformDirection(instance.worldToObject, ray.direction);
+        local.maxDistance = tMax;
+        RayHit localHit;
+        if (!instance.mesh->trace(local, anyHit, localHit)) return false;
+        tMax = localHit.distance;
+        hit.u = localHit.u;
+        hit.v = localHit.v;
+        hit.triangle = localHit.triangle;
+        hit.instance = order[leaf];
+        return true;
+    });
+    return found;
+}
+
+bool SceneBvh::intersect(const Ray& ray, RayHit& hit) const {
+    hit = RayHit();
+    hit.distance = ray.maxDistance;
+    bool found = trace(ray, false, hit);
+    if (!found) hit = RayHit();
+    return found;
+}
+
+bool SceneBvh::occluded(const Ray& ray) const {
+    RayHit hit;
+    hit.distance = ray.maxDistance;
+    return trace(ray, true, hit);
+}
+
+void SceneBvh::intersect(const Ray* rays, RayHit* hits, size_t count) const {
+    std::vector<uint32_t> order;
+    coherentOrder(rays, count, boundsMin, boundsMax, order);
+    JobSystem::parallelFor(count, RAY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) intersect(rays[order[i]], hits[order[i]]);
+    });
+}
+
+void SceneBvh::occluded(const Ray* rays, uint8_t* results, size_t count) const {
+    JobSystem::parallelFor(count, RAY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) results[i] = occluded(rays[i]) ? 1 : 0;
+    });
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4.h"
+#include "Mesh.h"
+
+// origin + direction * t for 0 <= t <= maxDistance. The direction need not
+// be normalized; distances are then in units of its length.
+struct Ray {
+    Vector3 origin;
+    Vector3 direction;
+    float maxDistance = 1e30f;
+};
+
+struct RayHit {
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    float distance = 1e30f;   // t along the ray
+    float u = 0.0f, v = 0.0f;  // Barycentrics of vertices 1 and 2
+    uint32_t triangle = NONE;  // Index into the mesh's triangles (indices / 3)
+    uint32_t instance = NONE;  // SceneBvh instance, NONE for a MeshBvh query
+
+    bool hit() const { return triangle != NONE; }
+};
+
+struct BvhStats {
+    size_t primitives = 0;
+    size_t nodes = 0;
+    size_t leaves = 0;
+    int depth = 0;
+    double buildMs = 0.0;
+};
+
+// Four children per node, their boxes stored axis by axis so one SSE
+// compare tests all four against a ray. Children are packed to the front;
+// leaf children carry LEAF and their payload in the low bits.
+struct alignas(16) BvhNode {
+    static constexpr uint32_t LEAF = 0x80000000u;
+
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    uint32_t child[4];
+    uint32_t childCount;
+};
+
+// Up to four triangles of a leaf in SIMD-friendly layout: first vertex and
+// the two edges from it, lane by lane. Unused lanes have zero edges.
+struct alignas(16) BvhTriangles {
+    float v0x[4], v0y[4], v0z[4];
+    float e1x[4], e1y[4], e1z[4];
+    float e2x[4], e2y[4], e2z[4];
+    uint32_t id[4];
+};
+
+// Bounding volume hierarchy over a mesh's triangles, built top-down with the
+// binned surface area heuristic and collapsed into 4-wide nodes whose leaves
+// hold at most four triangles. Rays test a node's four boxes and a leaf's
+// four triangles at once (SSE, or one lane at a time when Simd::level() is
+// Scalar). Triangles count from both sides. The mesh is copied; later
+// changes to it need a rebuild.
+//
+// Queries are read-only and may run from any number of threads.
+class MeshBvh {
+public:
+    bool build(const Mesh& mesh);
+    void build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+    // Closest hit within the ray's range, false if none
+    bool intersect(const Ray& ray, RayHit& hit) const;
+
+    // Whether anything lies within the ray's range (line of sight), stopping
+    // at the first hit found
+    bool occluded(const Ray& ray) const;
+
+    // Batches spread over the job system, results in the given order.
+    // Closest-hit rays (picking, ground snapping) are traced in the Morton
+    // order of their origins, nearby rays one after another.
+    void intersect(const Ray* rays, RayHit* hits, size_t count) const;
+    void occluded(const Ray* rays, uint8_t* results, size_t count) const;
+
+    bool empty() const { return nodes.empty(); }
+    const Vector3& getMin() const { return boundsMin; }
+    const Vector3& getMax() const { return boundsMax; }
+    const BvhStats& getStats() const { return stats; }
+
+private:
+    std::vector<BvhNode> nodes;  // Root first
+    std::vector<BvhTriangles> triangles;
+    Vector3 boundsMin, boundsMax;
+    BvhStats stats;
+
+    friend class SceneBvh;
+    bool trace(const Ray& ray, bool anyHit, RayHit& hit) const;
+};
+
+// Top-level hierarchy over placed MeshBvh instances, rebuilt from their
+// world boxes whenever they move. A ray is taken into each instance's
+// object space, so one MeshBvh serves any number of placements.
+class SceneBvh {
+public:
+    // world is row-major like Matrix4 (e.g. TransformHierarchy::getWorld).
+    // Returns the instance index reported in RayHit::instance.
+    uint32_t addInstance(const MeshBvh* mesh, const Matrix4& world);
+    void setTransform(uint32_t instance, const Matrix4& world);
+    void clear();
+
+    // After adding instances or changing transforms, before any query
+    void build();
+
+    // As for MeshBvh, over all instances
+    bool intersect(const Ray& ray, RayHit& hit) const;
+    bool occluded(const Ray& ray) const;
+    void intersect(const Ray* rays, RayHit* hits, size_t count) const;
+    void occluded(const Ray* rays, uint8_t* results, size_t count) const;
+
+    size_t size() const { return instances.size(); }
+    const BvhStats& getStats() const { return stats; }
+
+private:
+    struct Instance {
+        const MeshBvh* mesh;
+        Matrix4 world;
+        Matrix4 worldToObject;
+    };
+
+    std::vector<Instance> instances;
+    std::vector<uint32_t> order;  // Instance indices in leaf order
+    std::vector<BvhNode> nodes;
+    Vector3 boundsMin, boundsMax;
+    BvhStats stats;
+
+    bool trace(const Ray& ray, bool anyHit, RayHit& hit) const;
+};
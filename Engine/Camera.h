@@ -1,6 +1,7 @@
 #include <cmath>
 #include <vector>
 #include "Vector3.h"
+#include "Matrix4.h"
 
 using namespace std;
 
@@ -68,6 +69,43 @@ public: Vector3 position, direction, up, right;
             up = up.normalize();
         }
 
+        // World to view space, row-major like the rest of Matrix4 (transpose
+        // before handing it to GL as a column-major matrix)
+        Matrix4 getViewMatrix() const {
+            Matrix4 result;
+            result.arr[0] = right.x;
+            result.arr[1] = right.y;
+            result.arr[2] = right.z;
+            result.arr[3] = -right.dotProduct(position);
+            result.arr[4] = up.x;
+            result.arr[5] = up.y;
+            result.arr[6] = up.z;
+            result.arr[7] = -up.dotProduct(position);
+            result.arr[8] = -direction.x;
+            result.arr[9] = -direction.y;
+            result.arr[10] = -direction.z;
+            result.arr[11] = direction.dotProduct(position);
+            return result;
+        }
+
+        // OpenGL clip space projection (z in [-w, w]), row-major
+        Matrix4 getProjectionMatrix(float aspect) const {
+            Matrix4 result;
+            float tanHalfFov = tan(fov * (M_PI / 180) / 2.0f);
+
+            result.arr[0] = 1.0f / (aspect * tanHalfFov);
+            result.arr[5] = 1.0f / tanHalfFov;
+            result.arr[10] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+            result.arr[11] = -(2.0f * farPlane * nearPlane) / (farPlane - nearPlane);
+            result.arr[14] = -1.0f;
+            result.arr[15] = 0.0f;
+            return result;
+        }
+
+        Matrix4 getViewProjectionMatrix(float aspect) const {
+            return getProjectionMatrix(aspect).matrixMult(getViewMatrix());
+        }
+
 private:
 
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based random numbers: draw i of a stream is a hash of the stream's
+// key and i, with no state carried from one draw to the next. A job that
+// knows its stream and draw index gets the same numbers however the work is
+// split over threads, and any draw can be recomputed on its own. The hash is
+// the lowbias32 one basic.vert uses for procedural grass.
+class CounterRandom {
+public:
+    static uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Draw `index` of the stream (seed, stream) without creating one
+    static uint32_t at(uint32_t seed, uint32_t stream, uint32_t index) {
+        return hash(hash(stream ^ seed) + index);
+    }
+
+    static float unitAt(uint32_t seed, uint32_t stream, uint32_t index) {
+        return (at(seed, stream, index) >> 8) / 16777216.0f;
+    }
+
+    CounterRandom(uint32_t seed, uint32_t stream) : key(hash(stream ^ seed)) {}
+
+    uint32_t next() { return hash(key + counter++); }
+
+    // Uniform in [0, 1)
+    float unit() { return (next() >> 8) / 16777216.0f; }
+
+    // Uniform in [0, n)
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>((static_cast<uint64_t>(next()) * n) >> 32); }
+
+private:
+    uint32_t key;
+    uint32_t counter = 0;
+};
@@ -0,0 +1,270 @@
+#include "Culling.h"
+#include "OcclusionCuller.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+Frustum Frustum::fromMatrix(const Matrix4& viewProjection) {
+    const float* m = viewProjection.arr;
+    Frustum frustum;
+
+    // Clip space -w <= x, y, z <= w, so every plane is row 3 plus or minus row 0-2
+    for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            Plane& plane = frustum.planes[i * 2 + side];
+            plane.normal = Vector3(m[12] + sign * m[i * 4], m[13] + sign * m[i * 4 + 1], m[14] + sign * m[i * 4 + 2]);
+            plane.d = m[15] + sign * m[i * 4 + 3];
+
+            float length = plane.normal.length();
+            if (length > 0) {
+                plane.normal = plane.normal * (1.0f / length);
+                plane.d /= length;
+            }
+        }
+    }
+    return frustum;
+}
+
+Frustum Frustum::fromCamera(const Camera& camera, float aspect) {
+    return fromMatrix(camera.getViewProjectionMatrix(aspect));
+}
+
+bool Frustum::containsSphere(const Vector3& center, float radius) const {
+    for (const auto& plane : planes) {
+        if (plane.distance(center) < -radius) return false;
+    }
+    return true;
+}
+
+CullResult Frustum::classifyBox(const Vector3& min, const Vector3& max) const {
+    CullResult result = CullResult::Inside;
+    for (const auto& plane : planes) {
+        // Corners farthest along and against the plane normal
+        Vector3 positive(plane.normal.x >= 0 ? max.x : min.x,
+                         plane.normal.y >= 0 ? max.y : min.y,
+                         plane.normal.z >= 0 ? max.z : min.z);
+        Vector3 negative(plane.normal.x >= 0 ? min.x : max.x,
+                         plane.normal.y >= 0 ? min.y : max.y,
+                         plane.normal.z >= 0 ? min.z : max.z);
+
+        if (plane.distance(positive) < 0) return CullResult::Outside;
+        if (plane.distance(negative) < 0) result = CullResult::Intersecting;
+    }
+    return result;
+}
+
+void transformBounds(const Bounds& bounds, const float* m, Vector3& center, float& radius) {
+    const Vector3& c = bounds.center;
+    center = Vector3(m[0] * c.x + m[4] * c.y + m[8] * c.z + m[12],
+                     m[1] * c.x + m[5] * c.y + m[9] * c.z + m[13],
+                     m[2] * c.x + m[6] * c.y + m[10] * c.z + m[14]);
+
+    float scaleX = Vector3(m[0], m[1], m[2]).length();
+    float scaleY = Vector3(m[4], m[5], m[6]).length();
+    float scaleZ = Vector3(m[8], m[9], m[10]).length();
+    radius = bounds.radius * std::max(scaleX, std::max(scaleY, scaleZ));
+}
+
+CullingGrid::CullingGrid(float cellSize) : cellSize(cellSize) {
+}
+
+void CullingGrid::build(const std::vector<Vector3>& centers, const std::vector<float>& radii) {
+    cells.clear();
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    ids.clear();
+    slots.clear();
+
+    // Bucket instances by grid cell, then lay them out cell after cell
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    std::vector<uint64_t> order;
+    for (size_t i = 0; i < centers.size(); i++) {
+        int64_t cx = static_cast<int64_t>(std::floor(centers[i].x / cellSize));
+        int64_t cz = static_cast<int64_t>(std::floor(centers[i].z / cellSize));
+        uint64_t key = (static_cast<uint64_t>(cx) << 32) ^ (static_cast<uint64_t>(cz) & 0xffffffff);
+        auto& bucket = buckets[key];
+        if (bucket.empty()) order.push_back(key);
+        bucket.push_back(static_cast<uint32_t>(i));
+    }
+
+    // Sorted keys keep neighbouring cells close together in memory
+    std::sort(order.begin(), order.end());
+
+    size_t count = centers.size();
+    centerX.reserve(count);
+    centerY.reserve(count);
+    centerZ.reserve(count);
+    radius.reserve(count);
+    ids.reserve(count);
+
+    for (uint64_t key : order) {
+        const auto& bucket = buckets[key];
+        Cell cell;
+        cell.first = static_cast<uint32_t>(ids.size());
+        cell.count = static_cast<uint32_t>(bucket.size());
+
+        const Vector3& c0 = centers[bucket[0]];
+        cell.min = c0;
+        cell.max = c0;
+        for (uint32_t id : bucket) {
+            const Vector3& c = centers[id];
+            float r = radii[id];
+            cell.min = Vector3(std::min(cell.min.x, c.x - r), std::min(cell.min.y, c.y - r), std::min(cell.min.z, c.z - r));
+            cell.max = Vector3(std::max(cell.max.x, c.x + r), std::max(cell.max.y, c.y + r), std::max(cell.max.z, c.z + r));
+
+            centerX.push_back(c.x);
+            centerY.push_back(c.y);
+            centerZ.push_back(c.z);
+            radius.push_back(r);
+            ids.push_back(id);
+        }
+        cells.push_back(cell);
+    }
+
+    slots.resize(count);
+    for (size_t slot = 0; slot < ids.size(); slot++) slots[ids[slot]] = static_cast<uint32_t>(slot);
+}
+
+static void testSpheresScalar(const Frustum& frustum, const float* x, const float* y, const float* z,
+                              const float* r, const uint32_t* ids, size_t begin, size_t end,
+                              std::vector<uint32_t>& visible) {
+    for (size_t i = begin; i < end; i++) {
+        bool inside = true;
+        for (const auto& plane : frustum.planes) {
+            float distance = plane.normal.x * x[i] + plane.normal.y * y[i] + plane.normal.z * z[i] + plane.d;
+            if (distance < -r[i]) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) visible.push_back(ids[i]);
+    }
+}
+
+#if ENGINE_SIMD_X86
+
+static void testSpheresSSE(const Frustum& frustum, const float* x, const float* y, const float* z,
+                           const float* r, const uint32_t* ids, size_t count,
+                           std::vector<uint32_t>& visible) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(plane.normal.x), vx),
+                _mm_mul_ps(_mm_set1_ps(plane.normal.y), vy)),
+                _mm_mul_ps(_mm_set1_ps(plane.normal.z), vz)),
+                _mm_set1_ps(plane.d));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negR));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            visible.push_back(ids[i + lane]);
+            mask &= mask - 1;
+        }
+    }
+    testSpheresScalar(frustum, x, y, z, r, ids, i, count, visible);
+}
+
+ENGINE_TARGET_AVX2
+static void testSpheresAVX2(const Frustum& frustum, const float* x, const float* y, const float* z,
+                            const float* r, const uint32_t* ids, size_t count,
+                            std::vector<uint32_t>& visible) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_set1_ps(plane.normal.x), vx),
+                _mm256_mul_ps(_mm256_set1_ps(plane.normal.y), vy)),
+                _mm256_mul_ps(_mm256_set1_ps(plane.normal.z), vz)),
+                _mm256_set1_ps(plane.d));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negR, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            visible.push_back(ids[i + lane]);
+            mask &= mask - 1;
+        }
+    }
+    testSpheresScalar(frustum, x, y, z, r, ids, i, count, visible);
+}
+
+#endif
+
+size_t CullingGrid::testSpheres(const Frustum& frustum, uint32_t first, uint32_t count,
+                                std::vector<uint32_t>& visible) const {
+    size_t before = visible.size();
+    const float* x = centerX.data() + first;
+    const float* y = centerY.data() + first;
+    const float* z = centerZ.data() + first;
+    const float* r = radius.data() + first;
+    const uint32_t* cellIds = ids.data() + first;
+
+#if ENGINE_SIMD_X86
+    switch (Simd::level()) {
+        case SimdLevel::AVX2: testSpheresAVX2(frustum, x, y, z, r, cellIds, count, visible); return visible.size() - before;
+        case SimdLevel::SSE: testSpheresSSE(frustum, x, y, z, r, cellIds, count, visible); return visible.size() - before;
+        default: break;
+    }
+#endif
+    testSpheresScalar(frustum, x, y, z, r, cellIds, 0, count, visible);
+    return visible.size() - before;
+}
+
+size_t CullingGrid::cull(const Frustum& frustum, std::vector<uint32_t>& visible, const OcclusionCuller* occlusion,
+                         size_t* occluded) const {
+    visible.clear();
+    visible.reserve(ids.size());
+
+    for (const auto& cell : cells) {
+        CullResult result = frustum.classifyBox(cell.min, cell.max);
+        if (result != CullResult::Outside && occlusion && occlusion->isOccluded(cell.min, cell.max)) {
+            if (occluded) *occluded += cell.count;
+            continue;
+        }
+        size_t before = visible.size();
+        switch (result) {
+            case CullResult::Outside:
+                break;
+            case CullResult::Inside:
+                visible.insert(visible.end(), ids.begin() + cell.first, ids.begin() + cell.first + cell.count);
+                break;
+            case CullResult::Intersecting:
+                testSpheres(frustum, cell.first, cell.count, visible);
+                break;
+        }
+
+        // Cells reaching over a hill often have instances behind it
+        if (occlusion && visible.size() > before) {
+            size_t kept = before;
+            for (size_t i = before; i < visible.size(); i++) {
+                uint32_t slot = slots[visible[i]];
+                Vector3 center(centerX[slot], centerY[slot], centerZ[slot]);
+                if (occlusion->isSphereOccluded(center, radius[slot])) continue;
+                visible[kept++] = visible[i];
+            }
+            if (occluded) *occluded += visible.size() - kept;
+            visible.resize(kept);
+        }
+    }
+    return visible.size();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4.h"
+#include "Camera.h"
+#include "Mesh.h"
+
+class OcclusionCuller;
+
+// dot(normal, p) + d >= 0 for points on the inner side
+struct Plane {
+    Vector3 normal;
+    float d = 0.0f;
+
+    float distance(const Vector3& p) const { return normal.dotProduct(p) + d; }
+};
+
+enum class CullResult {
+    Outside,
+    Intersecting,
+    Inside
+};
+
+class Frustum {
+public:
+    // Left, right, bottom, top, near, far
+    Plane planes[6];
+
+    // Gribb-Hartmann extraction from a row-major view-projection matrix
+    static Frustum fromMatrix(const Matrix4& viewProjection);
+    static Frustum fromCamera(const Camera& camera, float aspect);
+
+    bool containsSphere(const Vector3& center, float radius) const;
+    CullResult classifyBox(const Vector3& min, const Vector3& max) const;
+};
+
+// World-space sphere of a mesh placed with a column-major model matrix (the
+// InstanceData layout). The radius grows by the largest axis scale.
+void transformBounds(const Bounds& bounds, const float* columnMajorModel, Vector3& center, float& radius);
+
+// Instances bucketed into a uniform grid on the XZ plane. Each cell keeps the
+// box around its spheres, so whole cells are rejected or accepted with one
+// test and only cells crossing a frustum plane test their instances, in SIMD
+// batches over structure-of-arrays sphere data.
+class CullingGrid {
+private:
+    struct Cell {
+        Vector3 min;
+        Vector3 max;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    float cellSize;
+    std::vector<Cell> cells;
+
+    // Sphere data sorted by cell
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> slots;  // Position of each id in the arrays above
+
+    size_t testSpheres(const Frustum& frustum, uint32_t first, uint32_t count, std::vector<uint32_t>& visible) const;
+
+public:
+    explicit CullingGrid(float cellSize = 8.0f);
+
+    // Rebuild from one sphere per instance; ids in cull() index these arrays
+    void build(const std::vector<Vector3>& centers, const std::vector<float>& radii);
+
+    // Append the ids of instances touching the frustum to visible (which is
+    // cleared first) and return how many there are. Ids come out grouped by
+    // cell, which keeps nearby instances together in the gathered buffers.
+    // With an occlusion culler, cells whose box it finds hidden are skipped
+    // as a whole, then the instances left in the others are tested one by
+    // one; the number dropped is added to *occluded.
+    size_t cull(const Frustum& frustum, std::vector<uint32_t>& visible, const OcclusionCuller* occlusion = nullptr,
+                size_t* occluded = nullptr) const;
+
+    size_t size() const { return ids.size(); }
+    size_t getCellCount() const { return cells.size(); }
+};
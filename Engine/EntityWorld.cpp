@@ -0,0 +1,259 @@
+#include "EntityWorld.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+};
+
+// Ids are handed out on first use of a type, in any thread and possibly
+// during static initialization, hence the function-local statics
+static std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<ComponentInfo>& registry() {
+    static std::vector<ComponentInfo> infos;
+    return infos;
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t EntityWorld::registerComponent(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<ComponentInfo>& infos = registry();
+    if (infos.size() == 64) {
+        std::cerr << "EntityWorld supports at most 64 component types" << std::endl;
+        std::abort();
+    }
+    infos.push_back({size, alignment});
+    return static_cast<uint32_t>(infos.size() - 1);
+}
+
+EntityWorld::EntityWorld() {}
+
+EntityWorld::~EntityWorld() {}
+
+// Entity array first, then one array per component, each on its own cache
+// line. Returns the bytes a chunk of `capacity` entities needs.
+static size_t layoutChunk(Archetype& archetype, const std::vector<ComponentInfo>& infos, uint32_t capacity) {
+    size_t offset = capacity * sizeof(Entity);
+    for (uint32_t component : archetype.components) {
+        offset = alignUp(offset, std::max<size_t>(64, infos[component].alignment));
+        archetype.offsets[component] = static_cast<uint16_t>(std::min<size_t>(offset, Archetype::ABSENT - 1));
+        archetype.sizes[component] = static_cast<uint16_t>(std::min<size_t>(infos[component].size, EntityChunk::SIZE));
+        offset += capacity * infos[component].size;
+    }
+    return offset;
+}
+
+Archetype* EntityWorld::findArchetype(ComponentMask mask) {
+    auto found = archetypeByMask.find(mask);
+    if (found != archetypeByMask.end()) return found->second;
+
+    std::vector<ComponentInfo> infos;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        infos = registry();
+    }
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = mask;
+    std::fill(std::begin(archetype->offsets), std::end(archetype->offsets), Archetype::ABSENT);
+    std::fill(std::begin(archetype->sizes), std::end(archetype->sizes), 0);
+    size_t bytesPerEntity = sizeof(Entity);
+    for (uint32_t component = 0; component < 64; component++) {
+        if (mask & (ComponentMask(1) << component)) {
+            archetype->components.push_back(component);
+            bytesPerEntity += infos[component].size;
+        }
+    }
+
+    // As many as fit once the arrays are aligned
+    uint32_t capacity = static_cast<uint32_t>(EntityChunk::SIZE / bytesPerEntity);
+    while (capacity > 0 && layoutChunk(*archetype, infos, capacity) > EntityChunk::SIZE) capacity--;
+    if (capacity == 0) {
+        std::cerr << "Components of archetype " << std::hex << mask << std::dec << " do not fit in a chunk"
+                  << std::endl;
+        std::abort();
+    }
+    archetype->capacity = capacity;
+
+    Archetype* result = archetype.get();
+    archetypes.push_back(std::move(archetype));
+    archetypeByMask[mask] = result;
+    return result;
+}
+
+Entity EntityWorld::create() {
+    return createWithMask(0);
+}
+
+Entity EntityWorld::createWithMask(ComponentMask mask) {
+    Entity entity;
+    if (!freeIndices.empty()) {
+        entity.index = freeIndices.back();
+        freeIndices.pop_back();
+    } else {
+        entity.index = static_cast<uint32_t>(records.size());
+        records.emplace_back();
+    }
+    entity.generation = records[entity.index].generation;
+    pushRow(entity, findArchetype(mask));
+    return entity;
+}
+
+void EntityWorld::destroy(Entity entity) {
+    if (!isAlive(entity)) return;
+    Record& record = records[entity.index];
+    removeRow(record.archetype, record.chunk, record.row);
+    record.archetype = nullptr;
+    record.generation++;
+    freeIndices.push_back(entity.index);
+}
+
+bool EntityWorld::isAlive(Entity entity) const {
+    return entity.index < records.size() && records[entity.index].archetype &&
+           records[entity.index].generation == entity.generation;
+}
+
+// Append to the archetype's last chunk with zeroed components
+void EntityWorld::pushRow(Entity entity, Archetype* archetype) {
+    if (archetype->chunks.empty() || archetype->chunks.back()->count == archetype->capacity) {
+        archetype->chunks.push_back(std::make_unique<EntityChunk>());
+    }
+    EntityChunk& chunk = *archetype->chunks.back();
+    uint32_t row = chunk.count++;
+    entityArray(chunk)[row] = entity;
+    for (uint32_t component : archetype->components) {
+        size_t size = archetype->sizes[component];
+        std::memset(chunk.data + archetype->offsets[component] + row * size, 0, size);
+    }
+    archetype->size++;
+
+    Record& record = records[entity.index];
+    record.archetype = archetype;
+    record.chunk = static_cast<uint32_t>(archetype->chunks.size() - 1);
+    record.row = row;
+}
+
+// Fill the gap with the archetype's last entity, so chunks stay packed
+void EntityWorld::removeRow(Archetype* archetype, uint32_t chunkIndex, uint32_t row) {
+    EntityChunk& last = *archetype->chunks.back();
+    uint32_t lastChunk = static_cast<uint32_t>(archetype->chunks.size() - 1);
+    uint32_t lastRow = last.count - 1;
+    if (chunkIndex != lastChunk || row != lastRow) {
+        EntityChunk& chunk = *archetype->chunks[chunkIndex];
+        Entity moved = entityArray(last)[lastRow];
+        entityArray(chunk)[row] = moved;
+        for (uint32_t component : archetype->components) {
+            size_t size = archetype->sizes[component];
+            uint16_t offset = archetype->offsets[component];
+            std::memcpy(chunk.data + offset + row * size, last.data + offset + lastRow * size, size);
+        }
+        records[moved.index].chunk = chunkIndex;
+        records[moved.index].row = row;
+    }
+    last.count--;
+    archetype->size--;
+    if (last.count == 0) archetype->chunks.pop_back();
+}
+
+// Components both archetypes have are carried over, the others start zeroed
+void EntityWorld::moveEntity(Entity entity, Archetype* target) {
+    Record& record = records[entity.index];
+    Archetype* source = record.archetype;
+    if (source == target) return;
+    uint32_t sourceChunk = record.chunk;
+    uint32_t sourceRow = record.row;
+
+    pushRow(entity, target);
+    EntityChunk& from = *source->chunks[sourceChunk];
+    EntityChunk& to = *target->chunks[record.chunk];
+    for (uint32_t component : target->components) {
+        if (source->offsets[component] == Archetype::ABSENT) continue;
+        size_t size = target->sizes[component];
+        std::memcpy(to.data + target->offsets[component] + record.row * size,
+                    from.data + source->offsets[component] + sourceRow * size, size);
+    }
+    removeRow(source, sourceChunk, sourceRow);
+}
+
+void EntityWorld::addComponent(Entity entity, uint32_t component, const void* data) {
+    if (!isAlive(entity)) return;
+    ComponentMask mask = records[entity.index].archetype->mask | (ComponentMask(1) << component);
+    moveEntity(entity, findArchetype(mask));
+    std::memcpy(componentData(entity, component), data, records[entity.index].archetype->sizes[component]);
+}
+
+void EntityWorld::removeComponent(Entity entity, uint32_t component) {
+    if (!isAlive(entity)) return;
+    ComponentMask mask = records[entity.index].archetype->mask & ~(ComponentMask(1) << component);
+    moveEntity(entity, findArchetype(mask));
+}
+
+void* EntityWorld::componentData(Entity entity, uint32_t component) {
+    const Record& record = records[entity.index];
+    EntityChunk& chunk = *record.archetype->chunks[record.chunk];
+    return chunk.data + record.archetype->offsets[component] + record.row * record.archetype->sizes[component];
+}
+
+void EntityWorld::matchingChunks(ComponentMask mask, std::vector<std::pair<Archetype*, EntityChunk*>>& chunks) {
+    for (const auto& archetype : archetypes) {
+        if ((archetype->mask & mask) != mask) continue;
+        for (const auto& chunk : archetype->chunks) {
+            chunks.emplace_back(archetype.get(), chunk.get());
+        }
+    }
+}
+
+size_t EntityWorld::getChunkCount() const {
+    size_t total = 0;
+    for (const auto& archetype : archetypes) total += archetype->chunks.size();
+    return total;
+}
+
+void EntityCommandBuffer::push(Op op, Entity entity, uint32_t component, const void* bytes, size_t size) {
+    Command command = {op, entity, 0, component, static_cast<uint32_t>(data.size())};
+    commands.push_back(command);
+    if (size > 0) {
+        const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+        data.insert(data.end(), begin, begin + size);
+    }
+}
+
+void EntityCommandBuffer::destroy(Entity entity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    push(Op::Destroy, entity, 0, nullptr, 0);
+}
+
+void EntityCommandBuffer::playback(EntityWorld& world) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entity created;
+    for (const Command& command : commands) {
+        switch (command.op) {
+        case Op::Create:
+            created = world.createWithMask(command.mask);
+            break;
+        case Op::Set:
+            world.addComponent(created, command.component, data.data() + command.dataOffset);
+            break;
+        case Op::Destroy:
+            world.destroy(command.entity);
+            break;
+        case Op::Add:
+            world.addComponent(command.entity, command.component, data.data() + command.dataOffset);
+            break;
+        case Op::Remove:
+            world.removeComponent(command.entity, command.component);
+            break;
+        }
+    }
+    commands.clear();
+    data.clear();
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+
+// Handle of an entity. The generation tells a reused slot from the entity
+// that held it before, so stale handles are detected instead of aliasing.
+struct Entity {
+    uint32_t index = 0xFFFFFFFFu;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// One bit per component type
+using ComponentMask = uint64_t;
+
+// Fixed-size block of an archetype's entities. Each component is one array
+// in the block (structure of arrays), starting on a cache line.
+struct EntityChunk {
+    static constexpr size_t SIZE = 16 * 1024;
+
+    alignas(64) uint8_t data[SIZE];
+    uint32_t count = 0;
+};
+
+// All entities with exactly the same set of components
+struct Archetype {
+    static constexpr uint16_t ABSENT = 0xFFFF;
+
+    ComponentMask mask = 0;
+    uint32_t capacity = 0;               // Entities per chunk
+    uint16_t offsets[64];                // Byte offset of each component's array, ABSENT if not here
+    uint16_t sizes[64];                  // Bytes per entity of each component
+    std::vector<uint32_t> components;    // Ids of the components present, ascending
+    std::vector<std::unique_ptr<EntityChunk>> chunks;  // All full but the last
+    size_t size = 0;
+};
+
+// Archetype/chunk entity component system. Components are plain data
+// (trivially copyable, like InstanceData), at most 64 types per program:
+//
+//   EntityWorld world;
+//   Entity plant = world.create(Placement{...}, InstanceData{...});
+//   world.each<Placement, InstanceData>([&](Entity e, Placement& p, InstanceData& d) { ... });
+//   world.parallelEach<Sway, InstanceData>([&](Entity e, Sway& s, InstanceData& d) { ... });
+//
+// Entities with the same set of components share an archetype and are packed
+// into its 16 KB chunks without holes (a removal moves the archetype's last
+// entity into the gap), so a query walks a few arrays front to back. Adding
+// or removing a component moves the entity to another archetype; pointers
+// from get() and the iteration order change with every such structural
+// change, which therefore must not happen during each(). Record them in an
+// EntityCommandBuffer instead and play it back afterwards.
+//
+// Main thread only, except for the functions parallelEach() runs, which may
+// read and write the components they are given.
+class EntityWorld {
+public:
+    EntityWorld();
+    ~EntityWorld();
+
+    EntityWorld(const EntityWorld&) = delete;
+    EntityWorld& operator=(const EntityWorld&) = delete;
+
+    template <typename T>
+    static uint32_t componentId() {
+        static_assert(std::is_trivially_copyable<T>::value, "Components must be trivially copyable");
+        static const uint32_t id = registerComponent(sizeof(T), alignof(T));
+        return id;
+    }
+
+    template <typename... T>
+    static ComponentMask maskOf() {
+        return (ComponentMask(0) | ... | (ComponentMask(1) << componentId<T>()));
+    }
+
+    Entity create();
+
+    template <typename... T>
+    Entity create(const T&... components) {
+        Entity entity = createWithMask(maskOf<T...>());
+        (std::memcpy(componentData(entity, componentId<T>()), &components, sizeof(T)), ...);
+        return entity;
+    }
+
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+
+    // Adds the component, or overwrites it if the entity has it already
+    template <typename T>
+    void add(Entity entity, const T& component) {
+        addComponent(entity, componentId<T>(), &component);
+    }
+
+    template <typename T>
+    void remove(Entity entity) {
+        removeComponent(entity, componentId<T>());
+    }
+
+    template <typename T>
+    bool has(Entity entity) const {
+        return isAlive(entity) && (records[entity.index].archetype->mask & maskOf<T>()) != 0;
+    }
+
+    // nullptr if the entity is gone or lacks the component. Valid until the
+    // next structural change.
+    template <typename T>
+    T* get(Entity entity) {
+        return has<T>(entity) ? static_cast<T*>(componentData(entity, componentId<T>())) : nullptr;
+    }
+
+    // function(Entity, T&...) for every entity having all of T
+    template <typename... T, typename Function>
+    void each(Function&& function) {
+        ComponentMask mask = maskOf<T...>();
+        for (const auto& archetype : archetypes) {
+            if ((archetype->mask & mask) != mask) continue;
+            for (const auto& chunk : archetype->chunks) {
+                eachInChunk<T...>(*archetype, *chunk, function);
+            }
+        }
+    }
+
+    // each() with the matching chunks spread over the job system. Returns
+    // when all are done.
+    template <typename... T, typename Function>
+    void parallelEach(Function&& function) {
+        std::vector<std::pair<Archetype*, EntityChunk*>> chunks;
+        matchingChunks(maskOf<T...>(), chunks);
+        JobSystem::parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                eachInChunk<T...>(*chunks[i].first, *chunks[i].second, function);
+            }
+        });
+    }
+
+    // function(const Entity*, T*..., count) once per matching chunk, for
+    // kernels that work on whole arrays
+    template <typename... T, typename Function>
+    void eachChunk(Function&& function) {
+        ComponentMask mask = maskOf<T...>();
+        for (const auto& archetype : archetypes) {
+            if ((archetype->mask & mask) != mask) continue;
+            for (const auto& chunk : archetype->chunks) {
+                function(entityArray(*chunk), componentArray<T>(*archetype, *chunk)..., static_cast<size_t>(chunk->count));
+            }
+        }
+    }
+
+    // Entities having all of T
+    template <typename... T>
+    size_t count() const {
+        ComponentMask mask = maskOf<T...>();
+        size_t total = 0;
+        for (const auto& archetype : archetypes) {
+            if ((archetype->mask & mask) == mask) total += archetype->size;
+        }
+        return total;
+    }
+
+    size_t size() const { return records.size() - freeIndices.size(); }
+    size_t getArchetypeCount() const { return archetypes.size(); }
+    size_t getChunkCount() const;
+
+private:
+    friend class EntityCommandBuffer;
+
+    struct Record {
+        Archetype* archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> archetypeByMask;
+    std::vector<Record> records;
+    std::vector<uint32_t> freeIndices;
+
+    static uint32_t registerComponent(size_t size, size_t alignment);
+
+    Archetype* findArchetype(ComponentMask mask);
+    Entity createWithMask(ComponentMask mask);
+    void addComponent(Entity entity, uint32_t component, const void* data);
+    void removeComponent(Entity entity, uint32_t component);
+    void moveEntity(Entity entity, Archetype* target);
+    void pushRow(Entity entity, Archetype* archetype);
+    void removeRow(Archetype* archetype, uint32_t chunk, uint32_t row);
+    void* componentData(Entity entity, uint32_t component);
+    void matchingChunks(ComponentMask mask, std::vector<std::pair<Archetype*, EntityChunk*>>& chunks);
+
+    static Entity* entityArray(EntityChunk& chunk) { return reinterpret_cast<Entity*>(chunk.data); }
+
+    template <typename T>
+    static T* componentArray(const Archetype& archetype, EntityChunk& chunk) {
+        return reinterpret_cast<T*>(chunk.data + archetype.offsets[componentId<T>()]);
+    }
+
+    template <typename... T, typename Function>
+    static void eachInChunk(const Archetype& archetype, EntityChunk& chunk, Function& function) {
+        const Entity* entities = entityArray(chunk);
+        std::tuple<T*...> arrays(componentArray<T>(archetype, chunk)...);
+        for (uint32_t row = 0; row < chunk.count; row++) {
+            function(entities[row], std::get<T*>(arrays)[row]...);
+        }
+    }
+};
+
+// Structural changes recorded while a world is being iterated (possibly from
+// several jobs at once) and applied in recording order by playback():
+//
+//   EntityCommandBuffer commands;
+//   world.parallelEach<Health>([&](Entity e, Health& h) { if (h.value <= 0) commands.destroy(e); });
+//   commands.playback(world);
+//
+// Recording takes a lock, so jobs that record a lot should use a buffer each.
+class EntityCommandBuffer {
+public:
+    template <typename... T>
+    void create(const T&... components) {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back({Op::Create, Entity(), EntityWorld::maskOf<T...>(), 0, 0});
+        (push(Op::Set, Entity(), EntityWorld::componentId<T>(), &components, sizeof(T)), ...);
+    }
+
+    void destroy(Entity entity);
+
+    template <typename T>
+    void add(Entity entity, const T& component) {
+        std::lock_guard<std::mutex> lock(mutex);
+        push(Op::Add, entity, EntityWorld::componentId<T>(), &component, sizeof(T));
+    }
+
+    template <typename T>
+    void remove(Entity entity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        push(Op::Remove, entity, EntityWorld::componentId<T>(), nullptr, 0);
+    }
+
+    // Apply and clear. Commands on entities destroyed meanwhile are skipped.
+    void playback(EntityWorld& world);
+
+    size_t size() const { return commands.size(); }
+
+private:
+    enum class Op : uint8_t { Create, Set, Destroy, Add, Remove };
+
+    struct Command {
+        Op op;
+        Entity entity;
+        ComponentMask mask;   // Create
+        uint32_t component;   // Set, Add, Remove
+        uint32_t dataOffset;  // Set, Add
+    };
+
+    std::mutex mutex;
+    std::vector<Command> commands;
+    std::vector<uint8_t> data;
+
+    // The mutex must be held
+    void push(Op op, Entity entity, uint32_t component, const void* bytes, size_t size);
+};
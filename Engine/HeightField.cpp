@@ -0,0 +1,60 @@
+#include "HeightField.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+void HeightField::generate(const NoiseParams& params, float originX, float originZ, float spacing,
+                           int width, int depth) {
+    this->originX = originX;
+    this->originZ = originZ;
+    this->spacing = spacing;
+    this->width = std::max(width, 1);
+    this->depth = std::max(depth, 1);
+    heights.assign(static_cast<size_t>(this->width) * this->depth, 0.0f);
+
+    // Every row shares the same x coordinates
+    std::vector<float> rowX(this->width);
+    for (int x = 0; x < this->width; x++) {
+        rowX[x] = originX + x * spacing;
+    }
+
+    // A few rows per job are plenty to cover the scheduling cost
+    JobSystem::parallelFor(this->depth, 4, [&](size_t firstRow, size_t lastRow) {
+        std::vector<float> rowZ(this->width);
+        for (size_t z = firstRow; z < lastRow; z++) {
+            std::fill(rowZ.begin(), rowZ.end(), originZ + z * spacing);
+            Noise::heights(params, rowX.data(), rowZ.data(), heights.data() + z * this->width, this->width);
+        }
+    });
+}
+
+bool HeightField::contains(float x, float z) const {
+    float maxX = originX + (width - 1) * spacing;
+    float maxZ = originZ + (depth - 1) * spacing;
+    return !heights.empty() && x >= originX && x <= maxX && z >= originZ && z <= maxZ;
+}
+
+float HeightField::getHeight(float x, float z) const {
+    if (heights.empty()) return 0.0f;
+
+    float gx = std::max(0.0f, std::min((x - originX) / spacing, static_cast<float>(width - 1)));
+    float gz = std::max(0.0f, std::min((z - originZ) / spacing, static_cast<float>(depth - 1)));
+    int x0 = std::min(static_cast<int>(gx), std::max(width - 2, 0));
+    int z0 = std::min(static_cast<int>(gz), std::max(depth - 2, 0));
+    int x1 = std::min(x0 + 1, width - 1);
+    int z1 = std::min(z0 + 1, depth - 1);
+    float tx = gx - x0;
+    float tz = gz - z0;
+
+    float top = getSample(x0, z0) + (getSample(x1, z0) - getSample(x0, z0)) * tx;
+    float bottom = getSample(x0, z1) + (getSample(x1, z1) - getSample(x0, z1)) * tx;
+    return top + (bottom - top) * tz;
+}
+
+Vector3 HeightField::getNormal(float x, float z) const {
+    // Same stencil the terrain chunks use for their vertex normals
+    float left = getHeight(x - spacing, z);
+    float right = getHeight(x + spacing, z);
+    float back = getHeight(x, z - spacing);
+    float front = getHeight(x, z + spacing);
+    return Vector3(left - right, 2.0f * spacing, back - front).normalize();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "Vector3.h"
+#include "Noise.h"
+
+// Terrain heights sampled once on a regular grid, so placement and collision
+// queries are a bilinear lookup instead of a full noise evaluation.
+class HeightField {
+private:
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    float spacing = 1.0f;
+    int width = 0;
+    int depth = 0;
+    std::vector<float> heights;  // Row-major, width samples per row
+
+public:
+    // Sample width x depth points spaced `spacing` apart starting at
+    // (originX, originZ) with the SIMD noise kernel. Rows are generated in
+    // parallel on the job system.
+    void generate(const NoiseParams& params, float originX, float originZ, float spacing,
+                  int width, int depth);
+
+    // Whether (x, z) lies inside the sampled area
+    bool contains(float x, float z) const;
+
+    // Bilinear height; positions outside the area are clamped to its border
+    float getHeight(float x, float z) const;
+
+    // Surface normal from central differences one sample apart
+    Vector3 getNormal(float x, float z) const;
+
+    float getSample(int x, int z) const { return heights[z * width + x]; }
+    const std::vector<float>& getSamples() const { return heights; }
+    float getOriginX() const { return originX; }
+    float getOriginZ() const { return originZ; }
+    int getWidth() const { return width; }
+    int getDepth() const { return depth; }
+    float getSpacing() const { return spacing; }
+};
@@ -0,0 +1,76 @@
+#include "InstanceBuffer.h"
+#include <cstddef>
+
+static_assert(sizeof(InstanceData) == 22 * sizeof(float), "InstanceData must stay tightly packed");
+
+InstanceBuffer::InstanceBuffer() : VBO(0), count(0), capacity(0) {
+    glGenBuffers(1, &VBO);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    glDeleteBuffers(1, &VBO);
+}
+
+void InstanceBuffer::upload(const std::vector<InstanceData>& instances, bool dynamic) {
+    upload(instances.data(), instances.size(), dynamic);
+}
+
+void InstanceBuffer::upload(const InstanceData* instances, size_t instanceCount, bool dynamic) {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (instanceCount > capacity) {
+        glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(InstanceData), instances,
+                     dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+        capacity = instanceCount;
+    } else if (instanceCount > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(InstanceData), instances);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count = instanceCount;
+}
+
+void InstanceBuffer::update(const InstanceData* instances, size_t instanceCount, size_t first) {
+    if (instanceCount == 0 || first + instanceCount > capacity) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(InstanceData), instanceCount * sizeof(InstanceData), instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (first + instanceCount > count) count = first + instanceCount;
+}
+
+void InstanceBuffer::bindAttributes(size_t firstInstance) const {
+    bindAttributes(VBO, firstInstance * sizeof(InstanceData));
+}
+
+void InstanceBuffer::bindAttributes(GLuint buffer, size_t base) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // mat4 transform takes four consecutive vec4 locations
+    for (unsigned int column = 0; column < 4; column++) {
+        unsigned int location = FIRST_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, transform) + column * 4 * sizeof(float)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    // Height and intensity
+    glVertexAttribPointer(FIRST_LOCATION + 4, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(base + offsetof(InstanceData, height)));
+    glVertexAttribDivisor(FIRST_LOCATION + 4, 1);
+    glEnableVertexAttribArray(FIRST_LOCATION + 4);
+
+    // Tint color and mix factor
+    glVertexAttribPointer(FIRST_LOCATION + 5, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(base + offsetof(InstanceData, color)));
+    glVertexAttribDivisor(FIRST_LOCATION + 5, 1);
+    glEnableVertexAttribArray(FIRST_LOCATION + 5);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::unbindAttributes() {
+    for (unsigned int location = FIRST_LOCATION; location < FIRST_LOCATION + 6; location++) {
+        glDisableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 0);
+    }
+}
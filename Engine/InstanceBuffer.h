@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Rendering/GL.h"
+#include <cstddef>
+#include <vector>
+#include "Vector3.h"
+
+// Per-instance attributes read by the INSTANCED variant of basic.vert
+struct InstanceData {
+    float transform[16];  // Column-major model matrix (locations 5-8)
+    float height;         // Blade height, scales the wind bend (location 9.x)
+    float intensity;      // Wind response, 0 keeps the instance still (location 9.y)
+    Vector3 color;        // Tint blended over the vertex color (location 10.xyz)
+    float colorMix;       // 0 = vertex color, 1 = tint (location 10.w)
+};
+
+// GPU buffer of InstanceData that any Mesh can draw with one instanced call.
+// Kept separate from Mesh so one mesh can be drawn with several instance sets.
+class InstanceBuffer {
+private:
+    unsigned int VBO;
+    size_t count;
+    size_t capacity;
+
+public:
+    static const unsigned int FIRST_LOCATION = 5;
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // Replace the contents, reallocating only when the buffer has to grow
+    void upload(const std::vector<InstanceData>& instances, bool dynamic = false);
+    void upload(const InstanceData* instances, size_t instanceCount, bool dynamic = false);
+
+    // Overwrite a range of already uploaded instances
+    void update(const InstanceData* instances, size_t instanceCount, size_t first = 0);
+
+    size_t size() const { return count; }
+
+    // Point the instance attribute locations of the bound VAO at this buffer,
+    // starting at instance firstInstance
+    void bindAttributes(size_t firstInstance = 0) const;
+    // The same for InstanceData stored in another buffer (StreamBuffer)
+    static void bindAttributes(GLuint buffer, size_t byteOffset);
+    static void unbindAttributes();
+};
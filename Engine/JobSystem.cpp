@@ -0,0 +1,317 @@
+#include "JobSystem.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job {
+    std::function<void()> function;
+    JobCounter* counter;
+
+    void execute() {
+        function();
+        if (counter) counter->value.fetch_sub(1, std::memory_order_release);
+    }
+};
+
+// Chase-Lev deque of fixed capacity (Lê et al., "Correct and efficient
+// work-stealing for weak memory models"). Only the owner calls push and pop,
+// any thread may steal.
+struct alignas(64) JobDeque {
+    static const int64_t CAPACITY = 4096;
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Job*> slots[CAPACITY];
+
+    // Written by the owner only, read by getStats()
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> stolen{0};
+
+    // False when full; the caller runs the job itself
+    bool push(Job* job) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) return false;
+
+        // Release on the slot publishes the job to whoever reads it
+        slots[b & (CAPACITY - 1)].store(job, std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    Job* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last job, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        Job* job = slots[t & (CAPACITY - 1)].load(std::memory_order_acquire);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+};
+
+struct JobSystemState {
+    std::vector<std::unique_ptr<JobDeque>> deques;  // One per thread, 0 = the thread that called init()
+    std::vector<std::thread> workers;
+    std::atomic<bool> running{false};
+    std::mutex lifecycle;
+
+    // Jobs queued but not taken yet, and workers asleep waiting for one
+    std::atomic<int> queued{0};
+    std::atomic<int> sleeping{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    // Jobs from threads outside the system
+    std::mutex externalMutex;
+    std::deque<Job*> external;
+    std::atomic<uint64_t> externalExecuted{0};
+
+    ~JobSystemState() { stop(); }
+
+    void stop() {
+        if (!running) return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running = false;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+};
+
+static JobSystemState& state() {
+    static JobSystemState s;
+    return s;
+}
+
+// Index of the calling thread's deque, -1 outside the system
+static thread_local int threadIndex = -1;
+
+static uint32_t nextVictim() {
+    // xorshift, only needs to spread the thieves over the deques
+    static thread_local uint32_t seed = 0x9e3779b9u ^ static_cast<uint32_t>(
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static Job* takeExternal() {
+    JobSystemState& s = state();
+    std::lock_guard<std::mutex> lock(s.externalMutex);
+    if (s.external.empty()) return nullptr;
+    Job* job = s.external.front();
+    s.external.pop_front();
+    return job;
+}
+
+// Own deque first, then jobs from outside, then a steal from the others
+// starting at a random victim
+static Job* findJob(bool& stolen) {
+    JobSystemState& s = state();
+    stolen = false;
+    if (s.deques.empty() || s.queued.load(std::memory_order_relaxed) <= 0) return nullptr;
+
+    Job* job = nullptr;
+    if (threadIndex >= 0) job = s.deques[threadIndex]->pop();
+    if (!job) job = takeExternal();
+    if (!job) {
+        size_t count = s.deques.size();
+        size_t start = nextVictim() % count;
+        for (size_t i = 0; i < count && !job; i++) {
+            size_t victim = (start + i) % count;
+            if (static_cast<int>(victim) == threadIndex) continue;
+            job = s.deques[victim]->steal();
+        }
+        stolen = job != nullptr;
+    }
+    if (job) s.queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+static void execute(Job* job, bool stolen) {
+    job->execute();
+    delete job;
+
+    JobSystemState& s = state();
+    if (threadIndex >= 0) {
+        JobDeque& deque = *s.deques[threadIndex];
+        deque.executed.store(deque.executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (stolen) deque.stolen.store(deque.stolen.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        s.externalExecuted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void workerLoop(int index) {
+    threadIndex = index;
+    JobSystemState& s = state();
+    const int SPINS = 64;
+
+    while (s.running.load(std::memory_order_acquire)) {
+        bool stolen;
+        Job* job = nullptr;
+        for (int spin = 0; spin < SPINS && !job; spin++) {
+            job = findJob(stolen);
+            if (!job) std::this_thread::yield();
+        }
+        if (job) {
+            execute(job, stolen);
+            continue;
+        }
+
+        // Pairs with the check of `sleeping` in run(): either the submitter
+        // sees this thread asleep or this thread sees the queued job
+        std::unique_lock<std::mutex> lock(s.sleepMutex);
+        s.sleeping.fetch_add(1);
+        s.wake.wait(lock, [&] { return !s.running.load() || s.queued.load() > 0; });
+        s.sleeping.fetch_sub(1);
+    }
+    threadIndex = -1;
+}
+
+static void initLocked(int threadCount) {
+    JobSystemState& s = state();
+    if (threadCount <= 0) {
+        // At least one worker, so background jobs progress while the main thread renders
+        threadCount = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    s.deques.clear();
+    for (int i = 0; i < threadCount; i++) {
+        s.deques.push_back(std::make_unique<JobDeque>());
+    }
+    s.externalExecuted = 0;
+    s.running = true;
+
+    threadIndex = 0;
+    for (int i = 1; i < threadCount; i++) {
+        s.workers.emplace_back(workerLoop, i);
+    }
+}
+
+void JobSystem::init(int threadCount) {
+    JobSystemState& s = state();
+    std::lock_guard<std::mutex> lock(s.lifecycle);
+    s.stop();
+    initLocked(threadCount);
+}
+
+void JobSystem::shutdown() {
+    JobSystemState& s = state();
+    std::lock_guard<std::mutex> lock(s.lifecycle);
+    s.stop();
+    threadIndex = -1;
+}
+
+bool JobSystem::isRunning() {
+    return state().running.load(std::memory_order_acquire);
+}
+
+int JobSystem::getThreadCount() {
+    return static_cast<int>(state().deques.size());
+}
+
+void JobSystem::run(std::function<void()> function, JobCounter* counter) {
+    JobSystemState& s = state();
+    if (!isRunning()) {
+        std::lock_guard<std::mutex> lock(s.lifecycle);
+        if (!s.running) initLocked(0);
+    }
+
+    if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+    Job* job = new Job{std::move(function), counter};
+
+    if (threadIndex >= 0) {
+        if (!s.deques[threadIndex]->push(job)) {
+            // Deque full, which means plenty of work for the others already
+            execute(job, false);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(s.externalMutex);
+        s.external.push_back(job);
+    }
+
+    s.queued.fetch_add(1);
+    if (s.sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(s.sleepMutex);
+        s.wake.notify_one();
+    }
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+    while (!counter.isDone()) {
+        bool stolen;
+        Job* job = findJob(stolen);
+        if (job) {
+            execute(job, stolen);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelForRanges(size_t count, size_t ranges, const std::function<void(size_t, size_t)>& function) {
+    if (!isRunning()) init();
+
+    // A few ranges per thread, so threads that finish early have some to steal
+    ranges = std::min(ranges, static_cast<size_t>(getThreadCount()) * 4);
+    if (ranges <= 1) {
+        function(0, count);
+        return;
+    }
+
+    JobCounter done;
+    for (size_t i = 1; i < ranges; i++) {
+        size_t begin = count * i / ranges;
+        size_t end = count * (i + 1) / ranges;
+        run([&function, begin, end] { function(begin, end); }, &done);
+    }
+    function(0, count / ranges);
+    wait(done);
+}
+
+JobSystemStats JobSystem::getStats() {
+    JobSystemState& s = state();
+    JobSystemStats stats;
+    stats.executed = s.externalExecuted.load(std::memory_order_relaxed);
+    for (const auto& deque : s.deques) {
+        stats.executed += deque->executed.load(std::memory_order_relaxed);
+        stats.stolen += deque->stolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Jobs still running under this counter. run() increments it, the job
+// decrements it when done, so waiting on it is waiting for a group of jobs.
+// Jobs that depend on a group either run after waiting for it or wait for it
+// themselves (the wait runs other jobs meanwhile).
+class JobCounter {
+private:
+    friend struct Job;
+    friend class JobSystem;
+    std::atomic<int> value{0};
+
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+    int get() const { return value.load(std::memory_order_acquire); }
+};
+
+struct JobSystemStats {
+    uint64_t executed = 0;  // Jobs run since init()
+    uint64_t stolen = 0;    // ... of which were taken from another thread's deque
+};
+
+// Work-stealing job system shared by the whole engine:
+//
+//   JobCounter chunks;
+//   JobSystem::run([&] { generate(a); }, &chunks);
+//   JobSystem::run([&] { generate(b); }, &chunks);
+//   JobSystem::wait(chunks);
+//
+//   JobSystem::parallelFor(blades.size(), 1024, [&](size_t begin, size_t end) { ... });
+//
+// Every thread owns a Chase-Lev deque: it pushes and pops its own jobs at the
+// bottom without locks (newest first, still warm in cache), idle threads
+// steal the oldest ones from the top of someone else's. The thread that calls
+// init() takes part as thread 0 whenever it waits. Threads outside the system
+// may submit too, through a locked queue.
+//
+// Workers spin briefly before sleeping on a condition variable, so a burst
+// of frame jobs does not pay for a wake-up per job.
+class JobSystem {
+public:
+    // Start the workers; threadCount includes the calling thread, 0 = one per
+    // hardware thread but at least two. With a single thread, jobs only run
+    // inside wait().
+    // Restarting requires all jobs to have finished.
+    static void init(int threadCount = 0);
+    static void shutdown();
+    static bool isRunning();
+
+    // Worker threads plus the thread that called init()
+    static int getThreadCount();
+
+    // Queue a job, starting the system with the defaults if needed
+    static void run(std::function<void()> job, JobCounter* counter = nullptr);
+
+    // Run queued jobs until the counter reaches zero
+    static void wait(const JobCounter& counter);
+
+    // Call function(begin, end) over ranges covering [0, count) in parallel
+    // and return when all are done. Ranges are at least `grain` long, and there
+    // are never many more of them than threads to steal them.
+    template <typename Function>
+    static void parallelFor(size_t count, size_t grain, Function&& function) {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+        size_t ranges = (count + grain - 1) / grain;
+        if (ranges <= 1) {
+            function(size_t(0), count);
+            return;
+        }
+        parallelForRanges(count, ranges, function);
+    }
+
+    static JobSystemStats getStats();
+
+private:
+    static void parallelForRanges(size_t count, size_t ranges, const std::function<void(size_t, size_t)>& function);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read ahead in the
+// background as soon as the file is opened, so callers that walk it front to
+// back mostly find them resident.
+class MappedFile {
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False (with the reason on stderr) for missing or empty files
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    const uint8_t* getData() const { return data; }
+    size_t getSize() const { return size; }
+};
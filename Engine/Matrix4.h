@@ -1,6 +1,7 @@
 #include <cmath>
 #include <vector>
 #include "Vector3.h"
+#include "Quaternion.h"
 
 using namespace std;
 
@@ -12,7 +13,7 @@ public: float arr[16] = {1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1};
         Matrix4() {   
         }
 
-        Matrix4(float values[16]) {
+        Matrix4(const float values[16]) {
             for (int i = 0; i < 16; i++) {
                 arr[i] = values[i];
             }
@@ -82,6 +83,107 @@ public: float arr[16] = {1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1};
             return result;
         }
 
+        // Rotation around an arbitrary axis (Rodrigues), axis is normalized here
+        static Matrix4 axisRotation(float angle, const Vector3& axis) {
+            Matrix4 result;
+            Vector3 a = axis.normalize();
+            float c = cos(angle);
+            float s = sin(angle);
+            float t = 1.0f - c;
+
+            result.arr[0] = c + t * a.x * a.x;
+            result.arr[1] = t * a.x * a.y - s * a.z;
+            result.arr[2] = t * a.x * a.z + s * a.y;
+            result.arr[4] = t * a.x * a.y + s * a.z;
+            result.arr[5] = c + t * a.y * a.y;
+            result.arr[6] = t * a.y * a.z - s * a.x;
+            result.arr[8] = t * a.x * a.z - s * a.y;
+            result.arr[9] = t * a.y * a.z + s * a.x;
+            result.arr[10] = c + t * a.z * a.z;
+
+            return result;
+        }
+
+        static Matrix4 rotation(const Quaternion& q) {
+            return compose(Vector3(0, 0, 0), q, Vector3(1, 1, 1));
+        }
+
+        // translation * rotation * scale, the matrix of a local transform,
+        // built directly instead of with two matrixMult calls
+        static Matrix4 compose(const Vector3& t, const Quaternion& q, const Vector3& s) {
+            Matrix4 result;
+            float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+            float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+            float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+            result.arr[0] = (1.0f - 2.0f * (yy + zz)) * s.x;
+            result.arr[1] = 2.0f * (xy - wz) * s.y;
+            result.arr[2] = 2.0f * (xz + wy) * s.z;
+            result.arr[3] = t.x;
+            result.arr[4] = 2.0f * (xy + wz) * s.x;
+            result.arr[5] = (1.0f - 2.0f * (xx + zz)) * s.y;
+            result.arr[6] = 2.0f * (yz - wx) * s.z;
+            result.arr[7] = t.y;
+            result.arr[8] = 2.0f * (xz - wy) * s.x;
+            result.arr[9] = 2.0f * (yz + wx) * s.y;
+            result.arr[10] = (1.0f - 2.0f * (xx + yy)) * s.z;
+            result.arr[11] = t.z;
+
+            return result;
+        }
+
+        // General inverse by cofactors. A singular matrix has none; the
+        // identity is returned then.
+        Matrix4 inverse() const {
+            const float* m = arr;
+            float inv[16];
+            inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+            inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+            inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+            inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+            inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+            inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+            inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+            inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+            inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+            inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+            inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+            inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+            inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+            inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+            inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+            inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+            float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+            if (det == 0) return Matrix4();
+
+            Matrix4 result;
+            for (int i = 0; i < 16; i++) {
+                result.arr[i] = inv[i] / det;
+            }
+            return result;
+        }
+
+        // Inverse of a translation * rotation * scale matrix without shear
+        // (compose() results): the transposed 3x3 part divided by the squared
+        // axis scales, then the translation undone. Cheaper than inverse().
+        Matrix4 affineInverse() const {
+            Matrix4 result;
+            for (int column = 0; column < 3; column++) {
+                float lengthSquared = arr[column] * arr[column] + arr[4 + column] * arr[4 + column] +
+                                      arr[8 + column] * arr[8 + column];
+                float invLengthSquared = lengthSquared > 0 ? 1.0f / lengthSquared : 0.0f;
+                for (int row = 0; row < 3; row++) {
+                    result.arr[column * 4 + row] = arr[row * 4 + column] * invLengthSquared;
+                }
+            }
+            for (int row = 0; row < 3; row++) {
+                result.arr[row * 4 + 3] = -(result.arr[row * 4] * arr[3] + result.arr[row * 4 + 1] * arr[7] +
+                                            result.arr[row * 4 + 2] * arr[11]);
+            }
+            return result;
+        }
+
         static Matrix4 scale(float sx, float sy, float sz) {
             Matrix4 result;
             result.arr[0] = sx;
@@ -1,57 +1,137 @@
 #include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "Profiler.h"
 #include <cmath>
+#include <cstddef>
+#include <algorithm>
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
-    : vertices(vertices), indices(indices) {
-    setupMesh();
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, bool keepData)
+    : Mesh(MeshArena::shared(), vertices, indices, keepData) {
+}
+
+Mesh::Mesh(std::shared_ptr<MeshArena> arena, const std::vector<Vertex>& vertices,
+           const std::vector<unsigned int>& indices, bool keepData)
+    : arena(std::move(arena)), bounds(computeBounds(vertices.data(), vertices.size())) {
+    allocation = this->arena->allocate(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+    MeshLod full;
+    full.indexCount = allocation.indexCount;
+    lods.push_back(full);
+
+    if (keepData) {
+        this->vertices = vertices;
+        this->indices = indices;
+        this->arena->trackCpuBytes(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int));
+    }
+}
+
+Mesh::Mesh(std::shared_ptr<MeshArena> arena, const MeshAllocation& allocation, const Bounds& bounds,
+           const std::vector<MeshLod>& lods)
+    : arena(std::move(arena)), allocation(allocation), bounds(bounds), lods(lods) {
 }
 
 Mesh::~Mesh() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    release();
 }
 
-void Mesh::setupMesh() {
-    // Create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+Mesh::Mesh(Mesh&& other) noexcept
+    : arena(std::move(other.arena)), allocation(other.allocation),
+      vertices(std::move(other.vertices)), indices(std::move(other.indices)), bounds(other.bounds),
+      lods(std::move(other.lods)) {
+    other.allocation = MeshAllocation();
+}
 
-    glBindVertexArray(VAO);
-    
-    // Load data into vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    // Load data into element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // Set vertex attribute pointers
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
-    glEnableVertexAttribArray(1);
-    
-    // Normal attribute
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(2);
-    
-    // Texture coordinate attribute
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(3);
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if (this != &other) {
+        release();
+        arena = std::move(other.arena);
+        allocation = other.allocation;
+        vertices = std::move(other.vertices);
+        indices = std::move(other.indices);
+        bounds = other.bounds;
+        lods = std::move(other.lods);
+        other.allocation = MeshAllocation();
+    }
+    return *this;
+}
+
+void Mesh::release() {
+    if (!arena) return;
+
+    releaseData();
+    arena->free(allocation);
+    arena.reset();
+    allocation = MeshAllocation();
+    lods.clear();
+}
+
+void Mesh::releaseData() {
+    if (arena) {
+        arena->untrackCpuBytes(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int));
+    }
+    vertices = std::vector<Vertex>();
+    indices = std::vector<unsigned int>();
+}
+
+Bounds Mesh::computeBounds(const Vertex* vertices, size_t vertexCount) {
+    Bounds bounds;
+    if (vertexCount == 0) return bounds;
+
+    bounds.min = vertices[0].position;
+    bounds.max = vertices[0].position;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const Vector3& p = vertices[i].position;
+        bounds.min = Vector3(std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y), std::min(bounds.min.z, p.z));
+        bounds.max = Vector3(std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y), std::max(bounds.max.z, p.z));
+    }
 
-    glBindVertexArray(0);
+    // Sphere around the box center, sized by the farthest vertex rather than the
+    // box corner so thin meshes get a tight radius
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    bounds.radius = 0.0f;
+    for (size_t i = 0; i < vertexCount; i++) {
+        bounds.radius = std::max(bounds.radius, vertices[i].position.distance(bounds.center));
+    }
+    return bounds;
 }
 
 void Mesh::draw() const {
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (lods.empty()) return;
+    drawRange(lods[0].firstIndex, lods[0].indexCount);
+}
+
+void Mesh::drawRange(size_t firstIndex, size_t indexCount) const {
+    if (!arena || indexCount == 0) return;
+
+    arena->bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indexCount), allocation.indexType,
+                             (void*)allocation.indexOffset(firstIndex),
+                             static_cast<GLint>(allocation.firstVertex));
+    Profiler::countDraw(indexCount / 3);
+}
+
+void Mesh::drawInstanced(const InstanceBuffer& instances) const {
+    drawInstanced(instances, instances.size());
+}
+
+void Mesh::drawInstanced(const InstanceBuffer& instances, size_t instanceCount) const {
+    if (!arena || lods.empty() || instanceCount == 0) return;
+
+    // Instance attributes live on the shared VAO only for the duration of this call
+    arena->bind();
+    instances.bindAttributes();
+    drawInstancedRange(lods[0].firstIndex, lods[0].indexCount, instanceCount);
+    InstanceBuffer::unbindAttributes();
+}
+
+void Mesh::drawInstancedRange(size_t firstIndex, size_t indexCount, size_t instanceCount) const {
+    if (!arena || indexCount == 0 || instanceCount == 0) return;
+
+    arena->bind();
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indexCount), allocation.indexType,
+                                      (void*)allocation.indexOffset(firstIndex),
+                                      static_cast<GLsizei>(instanceCount), static_cast<GLint>(allocation.firstVertex));
+    Profiler::countDraw(static_cast<uint64_t>(indexCount / 3) * instanceCount);
 }
 
 Mesh Mesh::createCube(float size) {
@@ -181,5 +261,9 @@ Mesh Mesh::createSphere(float radius, int sectors, int stacks) {
         }
     }
     
-    return Mesh(vertices, indices);
+    // Optimized for the vertex cache along with the simplified levels
+    std::vector<MeshLod> lods = MeshSimplifier::buildLodChain(vertices, indices);
+    Mesh mesh(vertices, indices);
+    mesh.setLods(lods);
+    return mesh;
 } 
\ No newline at end of file
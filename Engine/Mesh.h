@@ -1,46 +1,101 @@
 #pragma once
 
-#define GL_SILENCE_DEPRECATION
-#include <OpenGL/gl3.h>
+#include "Rendering/GL.h"
+#include <memory>
 #include <vector>
 #include <string>
 #include "Vector3.h"
+#include "InstanceBuffer.h"
+#include "MeshArena.h"
+#include "MeshLod.h"
 
-struct Vertex {
-    Vector3 position;
-    Vector3 color;
-    Vector3 normal;
-    Vector3 texCoords;  // Using Vector3 for future flexibility (3D textures)
+// Axis-aligned box and enclosing sphere of a mesh's vertex positions
+struct Bounds {
+    Vector3 min;
+    Vector3 max;
+    Vector3 center;
+    float radius = 0.0f;
 };
 
+// Handle to geometry stored in a MeshArena. Meshes are move-only: the arena
+// range is released exactly once, when the owning handle is destroyed.
 class Mesh {
 private:
     // Render data
-    unsigned int VAO, VBO, EBO;
+    std::shared_ptr<MeshArena> arena;
+    MeshAllocation allocation;
     
-    // Mesh data
+    // Mesh data, empty after releaseData()
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
+    Bounds bounds;
+
+    // Detail levels, level 0 draws by default
+    std::vector<MeshLod> lods;
     
-    // Setup mesh on GPU
-    void setupMesh();
+    void release();
 
 public:
-    // Constructor
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+    // Empty handle that draws nothing
+    Mesh() = default;
+
+    // Upload into the shared standard-layout arena (or the given one, which
+    // packs the vertices into its layout). keepData = false drops
+    // the CPU copy right away; bounds are computed before that.
+    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, bool keepData = true);
+    Mesh(std::shared_ptr<MeshArena> arena, const std::vector<Vertex>& vertices,
+         const std::vector<unsigned int>& indices, bool keepData = true);
+
+    // Take over geometry already uploaded to the arena (MeshFile), with no
+    // CPU copy. lods must not be empty.
+    Mesh(std::shared_ptr<MeshArena> arena, const MeshAllocation& allocation, const Bounds& bounds,
+         const std::vector<MeshLod>& lods);
     
     // Destructor
     ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
     
-    // Render the mesh
+    // Render the full-detail level. Leaves the arena's VAO bound, so
+    // consecutive draws from one arena do not switch vertex arrays.
     void draw() const;
+
+    // Render a sub-range of the index buffer (e.g. one detail level)
+    void drawRange(size_t firstIndex, size_t indexCount) const;
+
+    // Render instanceCount copies in one call, attributes come from instances
+    void drawInstanced(const InstanceBuffer& instances) const;
+    void drawInstanced(const InstanceBuffer& instances, size_t instanceCount) const;
+
+    // Instanced draw of a sub-range with the instance attributes already bound
+    // on the arena's VAO (InstanceBuffer::bindAttributes), so batches drawn
+    // from one instance buffer do not rebind them for every call
+    void drawInstancedRange(size_t firstIndex, size_t indexCount, size_t instanceCount) const;
+
+    // Free the CPU copy of the vertices and indices, the GPU copy stays
+    void releaseData();
+
+    // Replace the single full-detail level with ranges of the index buffer,
+    // e.g. from MeshSimplifier::buildLodChain. Level 0 must come first.
+    void setLods(const std::vector<MeshLod>& lods) { this->lods = lods; }
+    const std::vector<MeshLod>& getLods() const { return lods; }
     
     // Getters
     const std::vector<Vertex>& getVertices() const { return vertices; }
     const std::vector<unsigned int>& getIndices() const { return indices; }
+    const Bounds& getBounds() const { return bounds; }
+    const MeshAllocation& getAllocation() const { return allocation; }
+    const MeshArena* getArena() const { return arena.get(); }
+    size_t getIndexCount() const { return allocation.indexCount; }  // Of all levels
     
+    static Bounds computeBounds(const Vertex* vertices, size_t vertexCount);
+
     // Static helper methods
     static Mesh createCube(float size = 1.0f);
     static Mesh createPlane(float size = 1.0f, Vector3 color = Vector3(1.0f, 1.0f, 1.0f));
+    // With a detail chain for distant spheres
     static Mesh createSphere(float radius = 1.0f, int sectors = 20, int stacks = 20);
 };
@@ -0,0 +1,179 @@
+#include "MeshArena.h"
+#include "Rendering/GLState.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+size_t RangeAllocator::allocate(size_t size) {
+    if (size == 0) return 0;
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < size) continue;
+
+        size_t offset = it->first;
+        size_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0) freeRanges.emplace(offset + size, remaining);
+        used += size;
+        return offset;
+    }
+    return INVALID;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+    if (size == 0) return;
+    used -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    freeRanges.emplace(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    size_t added = newCapacity - capacity;
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    // Treat the new space as a freed range so it merges with a free tail
+    used += added;
+    free(oldCapacity, added);
+}
+
+MeshArena::MeshArena(const VertexFormat& format, size_t vertexCapacity, size_t indexCapacity)
+    : format(format) {
+    vertexCapacity = std::max<size_t>(vertexCapacity, 1);
+    indexCapacity = std::max<size_t>(indexCapacity, 1);
+    vertexRanges.grow(vertexCapacity);
+    indexRanges.grow(indexCapacity);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * format.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * INDEX_UNIT, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    setupAttributes();
+}
+
+MeshArena::~MeshArena() {
+    GLState::forgetVertexArray(VAO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void MeshArena::setupAttributes() {
+    GLState::bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    format.setupAttributes();
+
+    GLState::bindVertexArray(0);
+}
+
+void MeshArena::growBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes) {
+    unsigned int grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+    stats.growCount++;
+}
+
+size_t MeshArena::allocateOrGrow(RangeAllocator& ranges, unsigned int& buffer, size_t elementSize, size_t count) {
+    size_t offset = ranges.allocate(count);
+    if (offset != RangeAllocator::INVALID) return offset;
+
+    // Double until the appended space alone holds the request, so the
+    // allocation below cannot fail
+    size_t capacity = ranges.getCapacity();
+    size_t newCapacity = capacity;
+    while (newCapacity - capacity < count) newCapacity *= 2;
+
+    growBuffer(buffer, capacity * elementSize, newCapacity * elementSize);
+    ranges.grow(newCapacity);
+
+    // The VAO still points at the deleted buffer
+    setupAttributes();
+    return ranges.allocate(count);
+}
+
+MeshAllocation MeshArena::allocate(const Vertex* vertices, size_t vertexCount,
+                                   const unsigned int* indices, size_t indexCount) {
+    std::vector<uint8_t> packed(vertexCount * format.stride);
+    format.pack(vertices, vertexCount, packed.data());
+
+    if (vertexCount <= 65536) {
+        std::vector<uint16_t> narrow(indices, indices + indexCount);
+        return allocatePacked(packed.data(), vertexCount, narrow.data(), indexCount, GL_UNSIGNED_SHORT);
+    }
+    return allocatePacked(packed.data(), vertexCount, indices, indexCount, GL_UNSIGNED_INT);
+}
+
+MeshAllocation MeshArena::allocatePacked(const void* vertices, size_t vertexCount,
+                                         const void* indices, size_t indexCount, GLenum indexType) {
+    MeshAllocation allocation;
+    allocation.indexType = indexType;
+    allocation.indexCount = static_cast<uint32_t>(indexCount);
+
+    size_t firstVertex = allocateOrGrow(vertexRanges, VBO, format.stride, vertexCount);
+    size_t firstUnit = allocateOrGrow(indexRanges, EBO, INDEX_UNIT, indexUnits(allocation));
+    allocation.firstVertex = static_cast<uint32_t>(firstVertex);
+    allocation.vertexCount = static_cast<uint32_t>(vertexCount);
+    allocation.firstIndex = static_cast<uint32_t>(firstUnit * INDEX_UNIT / allocation.indexSize());
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstVertex * format.stride, vertexCount * format.stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset(0), indexCount * allocation.indexSize(), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    stats.allocations++;
+    return allocation;
+}
+
+size_t MeshArena::indexUnits(const MeshAllocation& allocation) {
+    return (allocation.indexCount * allocation.indexSize() + INDEX_UNIT - 1) / INDEX_UNIT;
+}
+
+void MeshArena::free(const MeshAllocation& allocation) {
+    vertexRanges.free(allocation.firstVertex, allocation.vertexCount);
+    indexRanges.free(allocation.indexOffset(0) / INDEX_UNIT, indexUnits(allocation));
+    stats.allocations--;
+}
+
+void MeshArena::bind() const {
+    GLState::bindVertexArray(VAO);
+}
+
+MeshArenaStats MeshArena::getStats() const {
+    MeshArenaStats result = stats;
+    result.vertexBytesUsed = vertexRanges.getUsed() * format.stride;
+    result.vertexBytesCapacity = vertexRanges.getCapacity() * format.stride;
+    result.indexBytesUsed = indexRanges.getUsed() * INDEX_UNIT;
+    result.indexBytesCapacity = indexRanges.getCapacity() * INDEX_UNIT;
+    result.freeRanges = vertexRanges.getFreeRangeCount() + indexRanges.getFreeRangeCount();
+    return result;
+}
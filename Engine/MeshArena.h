@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Rendering/GL.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include "VertexLayout.h"
+
+// First-fit allocator over a linear range, in elements. Freed ranges are
+// merged with their neighbours so the arena does not fragment into slivers.
+class RangeAllocator {
+private:
+    std::map<size_t, size_t> freeRanges;  // Offset -> size, sorted by offset
+    size_t capacity = 0;
+    size_t used = 0;
+
+public:
+    static const size_t INVALID = SIZE_MAX;
+
+    // Offset of a free range of the given size, or INVALID if none is large enough
+    size_t allocate(size_t size);
+    void free(size_t offset, size_t size);
+
+    // Extend the range; the new space joins a trailing free range
+    void grow(size_t newCapacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+    size_t getFreeRangeCount() const { return freeRanges.size(); }
+};
+
+// Location of one mesh inside a MeshArena. Indices are relative to the
+// first vertex, so any mesh of up to 65536 vertices stores 16-bit ones.
+struct MeshAllocation {
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;              // In elements of indexType
+    uint32_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;   // Or GL_UNSIGNED_SHORT
+
+    size_t indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+    // Byte offset of the mesh's index-th index in the arena's index buffer
+    size_t indexOffset(size_t index) const { return (firstIndex + index) * indexSize(); }
+};
+
+struct MeshArenaStats {
+    size_t vertexBytesUsed = 0;
+    size_t vertexBytesCapacity = 0;
+    size_t indexBytesUsed = 0;
+    size_t indexBytesCapacity = 0;
+    size_t cpuBytes = 0;          // Vertex and index copies kept by meshes
+    size_t allocations = 0;
+    size_t freeRanges = 0;        // Vertex plus index free ranges (fragmentation)
+    size_t growCount = 0;         // Buffer reallocations since creation
+};
+
+// One vertex buffer, one index buffer and one VAO shared by many meshes of
+// the same vertex layout.
+// Meshes sub-allocate ranges and draw with a base vertex, so drawing a series
+// of them never switches buffers and loading one costs no driver allocation.
+// Full buffers are regrown by copying on the GPU. The index buffer is handed
+// out in 4-byte units, which hold one 32-bit or two 16-bit indices.
+class MeshArena {
+private:
+    unsigned int VAO, VBO, EBO;
+    VertexFormat format;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    MeshArenaStats stats;
+
+    // Index buffer allocation granularity, in bytes
+    static const size_t INDEX_UNIT = 4;
+    static size_t indexUnits(const MeshAllocation& allocation);
+
+    void setupAttributes();
+    void growBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes);
+    size_t allocateOrGrow(RangeAllocator& ranges, unsigned int& buffer, size_t elementSize, size_t count);
+
+public:
+    // Capacities in vertices and in 32-bit indices
+    explicit MeshArena(const VertexFormat& format = StandardVertexLayout::format(),
+                       size_t vertexCapacity = 65536, size_t indexCapacity = 262144);
+    ~MeshArena();
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    // Arena per layout used by meshes created without an explicit one. It
+    // lives as long as some mesh references it.
+    template <typename Layout>
+    static std::shared_ptr<MeshArena> shared() {
+        static std::weak_ptr<MeshArena> instance;
+        std::shared_ptr<MeshArena> arena = instance.lock();
+        if (!arena) {
+            arena = std::make_shared<MeshArena>(Layout::format());
+            instance = arena;
+        }
+        return arena;
+    }
+    static std::shared_ptr<MeshArena> shared() { return shared<StandardVertexLayout>(); }
+
+    // Pack a mesh into the arena's layout and upload it. Indices stay relative
+    // to the mesh's first vertex and are offset at draw time through the base
+    // vertex; they are narrowed to 16 bits when the vertex count allows.
+    MeshAllocation allocate(const Vertex* vertices, size_t vertexCount,
+                            const unsigned int* indices, size_t indexCount);
+
+    // Upload vertices already in the arena's layout and indices of indexType
+    // as they are, e.g. straight from a mapped MeshFile
+    MeshAllocation allocatePacked(const void* vertices, size_t vertexCount,
+                                  const void* indices, size_t indexCount, GLenum indexType);
+    void free(const MeshAllocation& allocation);
+
+    // Bookkeeping for CPU copies kept by meshes (memory statistics only)
+    void trackCpuBytes(size_t bytes) { stats.cpuBytes += bytes; }
+    void untrackCpuBytes(size_t bytes) { stats.cpuBytes -= bytes; }
+
+    void bind() const;
+    const VertexFormat& getFormat() const { return format; }
+    MeshArenaStats getStats() const;
+};
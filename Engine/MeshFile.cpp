@@ -0,0 +1,231 @@
+#include "MeshFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static const char MESH_MAGIC[4] = {'E', 'M', 'S', 'H'};
+
+static_assert(sizeof(MeshFileHeader) == 144, "Mesh file header layout changed");
+static_assert(sizeof(MeshLod) == 12, "MeshLod is stored as is");
+static_assert(sizeof(Meshlet) == 48, "Meshlet is stored as is");
+
+static uint64_t alignSection(uint64_t offset) {
+    return (offset + MeshFile::SECTION_ALIGNMENT - 1) / MeshFile::SECTION_ALIGNMENT * MeshFile::SECTION_ALIGNMENT;
+}
+
+MeshFile::~MeshFile() {
+    close();
+}
+
+bool MeshFile::open(const std::string& filePath) {
+    close();
+    path = filePath;
+    if (!file.open(filePath)) return false;
+
+    if (file.getSize() < sizeof(MeshFileHeader)) {
+        std::cerr << "Mesh file " << filePath << " is too small" << std::endl;
+        close();
+        return false;
+    }
+    header = reinterpret_cast<const MeshFileHeader*>(file.getData());
+    if (!validate()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::close() {
+    file.close();
+    header = nullptr;
+}
+
+// Only the header and the section ranges are checked; the contents are
+// trusted like any other asset
+bool MeshFile::validate() const {
+    auto fail = [&](const char* reason) {
+        std::cerr << "Invalid mesh file " << path << ": " << reason << std::endl;
+        return false;
+    };
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % SECTION_ALIGNMENT == 0 && offset <= file.getSize() && bytes <= file.getSize() - offset;
+    };
+
+    if (std::memcmp(header->magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0) return fail("not a mesh file");
+    if (header->version != VERSION) return fail("unsupported version");
+    if (header->fileSize != file.getSize()) return fail("truncated");
+    if (header->indexSize != 2 && header->indexSize != 4) return fail("bad index size");
+    if (header->indexSize == 2 && header->vertexCount > 65536) return fail("16-bit indices over 65536 vertices");
+    if (header->lodCount == 0) return fail("no detail levels");
+
+    if (!fits(header->vertexOffset, static_cast<uint64_t>(header->vertexCount) * header->vertexStride) ||
+        !fits(header->indexOffset, static_cast<uint64_t>(header->indexCount) * header->indexSize) ||
+        !fits(header->lodOffset, static_cast<uint64_t>(header->lodCount) * sizeof(MeshLod)) ||
+        !fits(header->meshletOffset, static_cast<uint64_t>(header->meshletCount) * sizeof(Meshlet)) ||
+        !fits(header->meshletVertexOffset, static_cast<uint64_t>(header->meshletVertexCount) * sizeof(uint32_t)) ||
+        !fits(header->meshletTriangleOffset, header->meshletTriangleBytes)) {
+        return fail("section out of range");
+    }
+
+    const MeshLod* lods = static_cast<const MeshLod*>(section(header->lodOffset));
+    for (uint32_t i = 0; i < header->lodCount; i++) {
+        if (static_cast<uint64_t>(lods[i].firstIndex) + lods[i].indexCount > header->indexCount) {
+            return fail("detail level out of range");
+        }
+    }
+    return true;
+}
+
+Bounds MeshFile::getBounds() const {
+    Bounds bounds;
+    bounds.min = Vector3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+    bounds.max = Vector3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+    bounds.center = Vector3(header->boundsCenter[0], header->boundsCenter[1], header->boundsCenter[2]);
+    bounds.radius = header->boundsRadius;
+    return bounds;
+}
+
+std::vector<MeshLod> MeshFile::getLods() const {
+    const MeshLod* lods = static_cast<const MeshLod*>(section(header->lodOffset));
+    return std::vector<MeshLod>(lods, lods + header->lodCount);
+}
+
+Mesh MeshFile::createMesh(std::shared_ptr<MeshArena> arena) const {
+    if (!isOpen()) return Mesh();
+
+    if (!arena) {
+        if (header->layoutSignature == StandardVertexLayout::signature()) {
+            arena = MeshArena::shared();
+        } else if (header->layoutSignature == PackedVertexLayout::signature()) {
+            arena = MeshArena::shared<PackedVertexLayout>();
+        }
+    }
+    if (!arena || arena->getFormat().signature != header->layoutSignature ||
+        arena->getFormat().stride != header->vertexStride) {
+        std::cerr << "Mesh file " << path << " does not match the arena's vertex layout" << std::endl;
+        return Mesh();
+    }
+
+    MeshAllocation allocation = arena->allocatePacked(getVertexData(), header->vertexCount, getIndexData(),
+                                                      header->indexCount, getIndexType());
+    return Mesh(std::move(arena), allocation, getBounds(), getLods());
+}
+
+// Section writer that pads to the alignment first
+static void writeSection(std::ofstream& file, uint64_t& offset, uint64_t& sectionOffset, const void* data,
+                         size_t bytes) {
+    static const char padding[MeshFile::SECTION_ALIGNMENT] = {};
+    uint64_t aligned = alignSection(offset);
+    file.write(padding, static_cast<std::streamsize>(aligned - offset));
+    if (bytes > 0) file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    sectionOffset = aligned;
+    offset = aligned + bytes;
+}
+
+bool MeshFile::write(const std::string& path, const std::vector<Vertex>& vertices,
+                     const std::vector<unsigned int>& indices, const std::vector<MeshLod>& lods,
+                     const VertexFormat& format) {
+    if (vertices.empty() || indices.empty()) {
+        std::cerr << "Refusing to write empty mesh file " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> packed(vertices.size() * format.stride);
+    format.pack(vertices.data(), vertices.size(), packed.data());
+
+    bool narrow = vertices.size() <= 65536;
+    std::vector<uint16_t> narrowIndices;
+    if (narrow) narrowIndices.assign(indices.begin(), indices.end());
+
+    std::vector<MeshLod> levels = lods;
+    if (levels.empty()) {
+        MeshLod full;
+        full.indexCount = static_cast<uint32_t>(indices.size());
+        levels.push_back(full);
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint8_t> meshletTriangles;
+    MeshOptimizer::buildMeshlets(indices.data() + levels[0].firstIndex, levels[0].indexCount, vertices.data(),
+                                 vertices.size(), meshlets, meshletVertices, meshletTriangles);
+
+    Bounds bounds = Mesh::computeBounds(vertices.data(), vertices.size());
+
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+    header.version = VERSION;
+    header.layoutSignature = format.signature;
+    header.vertexStride = static_cast<uint32_t>(format.stride);
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+    header.indexSize = narrow ? 2 : 4;
+    header.lodCount = static_cast<uint32_t>(levels.size());
+    header.meshletCount = static_cast<uint32_t>(meshlets.size());
+    header.meshletVertexCount = static_cast<uint32_t>(meshletVertices.size());
+    header.meshletTriangleBytes = static_cast<uint32_t>(meshletTriangles.size());
+    const Vector3* corners[3] = {&bounds.min, &bounds.max, &bounds.center};
+    float* targets[3] = {header.boundsMin, header.boundsMax, header.boundsCenter};
+    for (int i = 0; i < 3; i++) {
+        targets[i][0] = corners[i]->x;
+        targets[i][1] = corners[i]->y;
+        targets[i][2] = corners[i]->z;
+    }
+    header.boundsRadius = bounds.radius;
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty()) std::filesystem::create_directories(directory, error);
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write mesh file " << temporary << std::endl;
+            return false;
+        }
+
+        // The header goes first with zero offsets and is rewritten at the end
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t offset = sizeof(header);
+        writeSection(file, offset, header.vertexOffset, packed.data(), packed.size());
+        if (narrow) {
+            writeSection(file, offset, header.indexOffset, narrowIndices.data(), narrowIndices.size() * 2);
+        } else {
+            writeSection(file, offset, header.indexOffset, indices.data(), indices.size() * 4);
+        }
+        writeSection(file, offset, header.lodOffset, levels.data(), levels.size() * sizeof(MeshLod));
+        writeSection(file, offset, header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+        writeSection(file, offset, header.meshletVertexOffset, meshletVertices.data(),
+                     meshletVertices.size() * sizeof(uint32_t));
+        writeSection(file, offset, header.meshletTriangleOffset, meshletTriangles.data(), meshletTriangles.size());
+        header.fileSize = offset;
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            std::cerr << "Failed to write mesh file " << temporary << std::endl;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        std::cerr << "Failed to write mesh file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MeshFile::write(const std::string& path, const Mesh& mesh, const VertexFormat& format) {
+    if (mesh.getVertices().empty()) {
+        std::cerr << "Mesh has no CPU copy to write to " << path << std::endl;
+        return false;
+    }
+    return write(path, mesh.getVertices(), mesh.getIndices(), mesh.getLods(), format);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshArena.h"
+#include "MeshOptimizer.h"
+
+// Binary mesh container, laid out so a memory-mapped file is used in place:
+//
+//   MeshFileHeader                 magic, version, counts, bounds, offsets
+//   vertices                       vertexCount * vertexStride bytes, already
+//                                  packed in the layout named by the signature
+//   indices                        16-bit when vertexCount <= 65536, else 32
+//   MeshLod[lodCount]              ranges of the indices, level 0 first
+//   Meshlet[meshletCount]          clusters of level 0 (MeshOptimizer)
+//   uint32_t[meshletVertexCount]   meshlet vertex lists
+//   uint8_t[meshletTriangleBytes]  meshlet triangles, 3 bytes each
+//
+// Every section starts on a 64-byte boundary. Numbers are little endian as
+// written; the file is meant for the machine family that built it.
+//
+// Opening only validates the header and the section ranges, nothing is parsed
+// or copied: createMesh uploads the vertex and index sections straight from
+// the mapping, so loading costs the page faults and the driver copy.
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t layoutSignature;   // VertexFormat::signature of the vertex section
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;        // All levels
+    uint32_t indexSize;         // 2 or 4 bytes
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleBytes;
+    uint32_t reserved;
+    float boundsMin[3];
+    float boundsMax[3];
+    float boundsCenter[3];
+    float boundsRadius;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t lodOffset;
+    uint64_t meshletOffset;
+    uint64_t meshletVertexOffset;
+    uint64_t meshletTriangleOffset;
+    uint64_t fileSize;
+};
+
+class MeshFile {
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t SECTION_ALIGNMENT = 64;
+
+    MeshFile() = default;
+    ~MeshFile();
+
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    // Map a file read-only. False (with the reason on stderr) for missing,
+    // truncated or foreign files and other versions.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    // Upload into arena, whose layout must match the file's. Without an arena
+    // the shared one of the standard or packed layout is used.
+    Mesh createMesh(std::shared_ptr<MeshArena> arena = nullptr) const;
+
+    const MeshFileHeader& getHeader() const { return *header; }
+    size_t getFileSize() const { return file.getSize(); }
+    const void* getVertexData() const { return section(header->vertexOffset); }
+    const void* getIndexData() const { return section(header->indexOffset); }
+    GLenum getIndexType() const { return header->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+    Bounds getBounds() const;
+    std::vector<MeshLod> getLods() const;
+    const Meshlet* getMeshlets() const { return static_cast<const Meshlet*>(section(header->meshletOffset)); }
+    const uint32_t* getMeshletVertices() const {
+        return static_cast<const uint32_t*>(section(header->meshletVertexOffset));
+    }
+    const uint8_t* getMeshletTriangles() const {
+        return static_cast<const uint8_t*>(section(header->meshletTriangleOffset));
+    }
+
+    // Pack the vertices into format and write a complete file, meshlets
+    // included. Written next to the final name and renamed, so readers never
+    // map a half-written file.
+    static bool write(const std::string& path, const std::vector<Vertex>& vertices,
+                      const std::vector<unsigned int>& indices, const std::vector<MeshLod>& lods,
+                      const VertexFormat& format);
+
+    // From a mesh that kept its CPU copy
+    static bool write(const std::string& path, const Mesh& mesh, const VertexFormat& format);
+
+private:
+    MappedFile file;
+    const MeshFileHeader* header = nullptr;
+    std::string path;
+
+    const void* section(uint64_t offset) const { return file.getData() + offset; }
+    bool validate() const;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Camera.h"
+
+// One detail level of a mesh: a range of its index buffer over the shared
+// vertices, level 0 being the full-detail mesh
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;  // Largest distance from the full-detail surface, model units
+};
+
+// Picks the coarsest level whose error covers at most maxPixelError pixels
+// on screen. An error e at distance d projects to e * pixelsPerUnit / d
+// pixels, so every doubling of the distance allows twice the error.
+class LodSelector {
+private:
+    float pixelsPerUnit;  // Pixels covered by one unit at distance 1
+    float maxPixelError;
+
+public:
+    // Always selects level 0
+    LodSelector() : pixelsPerUnit(0.0f), maxPixelError(1.0f) {}
+
+    static LodSelector fromCamera(const Camera& camera, float viewportHeight, float maxPixelError = 1.0f) {
+        LodSelector selector;
+        float tanHalfFov = std::tan(camera.fov * (static_cast<float>(M_PI) / 180.0f) * 0.5f);
+        selector.pixelsPerUnit = viewportHeight / (2.0f * tanHalfFov);
+        selector.maxPixelError = maxPixelError;
+        return selector;
+    }
+
+    // distance is to the nearest point of the instance's bounds, scale its
+    // largest axis scale
+    size_t select(const std::vector<MeshLod>& lods, float distance, float scale = 1.0f) const {
+        if (pixelsPerUnit <= 0.0f) return 0;
+        for (size_t level = lods.size(); level-- > 1;) {
+            if (lods[level].error * scale * pixelsPerUnit <= maxPixelError * distance) return level;
+        }
+        return 0;
+    }
+};
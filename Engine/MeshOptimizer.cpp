@@ -0,0 +1,435 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Forsyth's scoring. The LRU cache it models is larger than the FIFO used for
+// the statistics, which makes the order robust to the real cache size.
+static const int SCORE_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const int MAX_SCORED_VALENCE = 64;
+
+struct VertexScoreTables {
+    float cache[SCORE_CACHE_SIZE];
+    float valence[MAX_SCORED_VALENCE + 1];
+
+    VertexScoreTables() {
+        for (int i = 0; i < SCORE_CACHE_SIZE; i++) {
+            if (i < 3) {
+                // The last triangle's vertices score a fixed amount, so the
+                // next triangle does not simply continue its strip
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+                cache[i] = std::pow(1.0f - (i - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+        // Vertices with few triangles left are worth finishing
+        valence[0] = 0.0f;
+        for (int i = 1; i <= MAX_SCORED_VALENCE; i++) {
+            valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    float score(int cachePosition, unsigned int remaining) const {
+        if (remaining == 0) return -1.0f;
+        float result = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+        return result + valence[std::min<unsigned int>(remaining, MAX_SCORED_VALENCE)];
+    }
+};
+
+static bool indicesInRange(const unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    for (size_t i = 0; i < indexCount; i++) {
+        if (indices[i] >= vertexCount) return false;
+    }
+    return true;
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                                   unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || !indicesInRange(indices, indexCount, vertexCount)) return stats;
+
+    // A vertex is still cached while fewer than cacheSize misses happened
+    // since it was loaded
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    unsigned int misses = 0;
+    unsigned int clock = cacheSize + 1;
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int v = indices[i];
+        if (clock - loadedAt[v] > cacheSize) {
+            loadedAt[v] = clock++;
+            misses++;
+        }
+        if (!referenced[v]) {
+            referenced[v] = true;
+            unique++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+    stats.atvr = static_cast<float>(misses) / unique;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    static const VertexScoreTables tables;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2 || !indicesInRange(indices, triangleCount * 3, vertexCount)) return;
+
+    // Triangles of every vertex; the first remaining[v] entries of its range
+    // are the ones not emitted yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) remaining[indices[i]]++;
+
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    std::vector<unsigned int> filled(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            vertexTriangles[firstTriangle[v] + filled[v]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = tables.score(-1, remaining[v]);
+
+    // Scores only change near the cache, so after the first triangle the
+    // next one is searched among the cached vertices' triangles
+    std::vector<bool> emitted(triangleCount, false);
+    size_t best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const unsigned int* tri = indices + t * 3;
+        float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+        if (score > bestScore) {
+            bestScore = score;
+            best = t;
+        }
+    }
+
+    std::vector<unsigned int> output(triangleCount * 3);
+    unsigned int cache[SCORE_CACHE_SIZE + 3];
+    unsigned int nextCache[SCORE_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;  // Triangles before it are all emitted
+
+    for (size_t written = 0; written < triangleCount; written++) {
+        if (best == SIZE_MAX) {
+            // Nothing in the cache has triangles left, start somewhere new
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const unsigned int tri[3] = {indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+        output[written * 3] = tri[0];
+        output[written * 3 + 1] = tri[1];
+        output[written * 3 + 2] = tri[2];
+        emitted[best] = true;
+
+        for (unsigned int v : tri) {
+            unsigned int* list = vertexTriangles.data() + firstTriangle[v];
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                if (list[i] == best) {
+                    std::swap(list[i], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // Most recent first: the triangle, then what was cached before it
+        int nextCount = 0;
+        for (unsigned int v : tri) {
+            bool duplicate = false;
+            for (int i = 0; i < nextCount; i++) duplicate = duplicate || nextCache[i] == v;
+            if (!duplicate) nextCache[nextCount++] = v;
+        }
+        for (int i = 0; i < cacheCount; i++) {
+            unsigned int v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache[nextCount++] = v;
+        }
+
+        for (int i = 0; i < nextCount; i++) {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < SCORE_CACHE_SIZE ? i : -1;
+            vertexScore[v] = tables.score(cachePosition[v], remaining[v]);
+        }
+
+        best = SIZE_MAX;
+        bestScore = -1.0f;
+        for (int i = 0; i < nextCount; i++) {
+            unsigned int v = nextCache[i];
+            const unsigned int* list = vertexTriangles.data() + firstTriangle[v];
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                unsigned int t = list[j];
+                const unsigned int* other = indices + t * 3;
+                float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(nextCount, SCORE_CACHE_SIZE);
+        std::copy(nextCache, nextCache + cacheCount, cache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                                     size_t vertexCount, float threshold) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2 || !indicesInRange(indices, triangleCount * 3, vertexCount)) return;
+
+    // Same FIFO as analyzeVertexCache; bumping the clock by the cache size
+    // empties it
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int clock = CACHE_SIZE + 1;
+    auto triangleMisses = [&](size_t t) {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            if (clock - loadedAt[v] > CACHE_SIZE) {
+                loadedAt[v] = clock++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    auto flush = [&] { clock += CACHE_SIZE + 1; };
+
+    // Hard boundaries: triangles that miss on every vertex start over anyway,
+    // so cutting there costs nothing
+    std::vector<size_t> hard;
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (triangleMisses(t) == 3) hard.push_back(t);
+    }
+    if (hard.empty() || hard[0] != 0) hard.insert(hard.begin(), 0);
+    hard.push_back(triangleCount);
+
+    // Soft boundaries: within a hard cluster, cut as soon as the part since
+    // the last cut is no worse than threshold times the whole cluster
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t start = hard[h];
+        size_t end = hard[h + 1];
+
+        flush();
+        unsigned int clusterMisses = 0;
+        for (size_t t = start; t < end; t++) clusterMisses += triangleMisses(t);
+        float limit = threshold * clusterMisses / (end - start);
+
+        flush();
+        clusters.push_back(start);
+        size_t partStart = start;
+        unsigned int partMisses = 0;
+        for (size_t t = start; t + 1 < end; t++) {
+            partMisses += triangleMisses(t);
+            if (partMisses <= limit * (t + 1 - partStart)) {
+                clusters.push_back(t + 1);
+                partStart = t + 1;
+                partMisses = 0;
+                flush();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Mesh center, area weighted
+    Vector3 meshCenter(0.0f, 0.0f, 0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const Vector3& a = vertices[indices[t * 3]].position;
+        const Vector3& b = vertices[indices[t * 3 + 1]].position;
+        const Vector3& c = vertices[indices[t * 3 + 2]].position;
+        float area = (b - a).crossProduct(c - a).length();
+        meshCenter = meshCenter + (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) meshCenter = meshCenter * (1.0f / meshArea);
+
+    // Clusters pointing away from the center are the outer surface, drawing
+    // them first lets early depth testing reject what is behind them
+    struct Cluster {
+        size_t start;
+        size_t end;
+        float facing;
+    };
+    std::vector<Cluster> order;
+    for (size_t i = 0; i + 1 < clusters.size(); i++) {
+        Cluster cluster = {clusters[i], clusters[i + 1], 0.0f};
+        Vector3 center(0.0f, 0.0f, 0.0f);
+        Vector3 normal(0.0f, 0.0f, 0.0f);
+        float area = 0.0f;
+        for (size_t t = cluster.start; t < cluster.end; t++) {
+            const Vector3& a = vertices[indices[t * 3]].position;
+            const Vector3& b = vertices[indices[t * 3 + 1]].position;
+            const Vector3& c = vertices[indices[t * 3 + 2]].position;
+            Vector3 cross = (b - a).crossProduct(c - a);
+            float triangleArea = cross.length();
+            center = center + (a + b + c) * (triangleArea / 3.0f);
+            normal = normal + cross;
+            area += triangleArea;
+        }
+        if (area > 0.0f) {
+            center = center * (1.0f / area);
+            cluster.facing = (center - meshCenter).dotProduct(normal.normalize());
+        }
+        order.push_back(cluster);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Cluster& a, const Cluster& b) { return a.facing > b.facing; });
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    for (const Cluster& cluster : order) {
+        output.insert(output.end(), indices + cluster.start * 3, indices + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount) {
+    if (!indicesInRange(indices, indexCount, vertexCount)) return vertexCount;
+
+    const unsigned int UNUSED = UINT32_MAX;
+    std::vector<unsigned int> remap(vertexCount, UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int& target = remap[indices[i]];
+        if (target == UNUSED) {
+            target = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = target;
+    }
+
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return reordered.size();
+}
+
+// Sphere around the box of the meshlet's vertices and the cone of its
+// triangle normals
+static void computeMeshletBounds(Meshlet& meshlet, const uint32_t* meshletVertices, const uint8_t* triangles,
+                                 const Vertex* vertices) {
+    const Vertex* first = &vertices[meshletVertices[0]];
+    Vector3 min = first->position, max = first->position;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        const Vector3& p = vertices[meshletVertices[i]].position;
+        min = Vector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max = Vector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+    Vector3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        radius = std::max(radius, vertices[meshletVertices[i]].position.distance(center));
+    }
+
+    Vector3 axis(0.0f, 0.0f, 0.0f);
+    std::vector<Vector3> normals(meshlet.triangleCount);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const Vector3& a = vertices[meshletVertices[triangles[t * 3]]].position;
+        const Vector3& b = vertices[meshletVertices[triangles[t * 3 + 1]]].position;
+        const Vector3& c = vertices[meshletVertices[triangles[t * 3 + 2]]].position;
+        Vector3 cross = (b - a).crossProduct(c - a);
+        normals[t] = cross.length() > 0.0f ? cross.normalize() : Vector3(0.0f, 0.0f, 0.0f);
+        axis = axis + cross;
+    }
+
+    // The cone is only useful while all normals lie within 90 degrees of the
+    // axis; otherwise no view direction sees every triangle's back and the
+    // cutoff stays out of reach
+    float cutoff = 2.0f;
+    if (axis.length() > 0.0f) {
+        axis = axis.normalize();
+        float minDot = 1.0f;
+        for (const Vector3& normal : normals) minDot = std::min(minDot, normal.dotProduct(axis));
+        if (minDot > 0.0f) cutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    meshlet.center[0] = center.x;
+    meshlet.center[1] = center.y;
+    meshlet.center[2] = center.z;
+    meshlet.radius = radius;
+    meshlet.coneAxis[0] = axis.x;
+    meshlet.coneAxis[1] = axis.y;
+    meshlet.coneAxis[2] = axis.z;
+    meshlet.coneCutoff = cutoff;
+}
+
+size_t MeshOptimizer::buildMeshlets(const unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                                    size_t vertexCount, std::vector<Meshlet>& meshlets,
+                                    std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles,
+                                    size_t maxVertices, size_t maxTriangles) {
+    meshlets.clear();
+    meshletVertices.clear();
+    meshletTriangles.clear();
+    maxVertices = std::min<size_t>(std::max<size_t>(maxVertices, 3), 255);
+    maxTriangles = std::max<size_t>(maxTriangles, 1);
+    if (indexCount < 3 || !indicesInRange(indices, indexCount, vertexCount)) return 0;
+
+    // Local index of every vertex in the meshlet being filled
+    const uint8_t ABSENT = 0xff;
+    std::vector<uint8_t> local(vertexCount, ABSENT);
+    std::vector<unsigned int> localVertices;
+    Meshlet meshlet = {};
+
+    auto finish = [&] {
+        if (meshlet.triangleCount == 0) return;
+        computeMeshletBounds(meshlet, meshletVertices.data() + meshlet.vertexOffset,
+                             meshletTriangles.data() + meshlet.triangleOffset, vertices);
+        meshlets.push_back(meshlet);
+        for (unsigned int v : localVertices) local[v] = ABSENT;
+        localVertices.clear();
+        meshlet = Meshlet();
+        meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const unsigned int* tri = indices + i;
+        size_t added = 0;
+        for (int k = 0; k < 3; k++) {
+            bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            if (local[tri[k]] == ABSENT && !repeated) added++;
+        }
+        if (meshlet.vertexCount + added > maxVertices || meshlet.triangleCount == maxTriangles) finish();
+
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = tri[k];
+            if (local[v] == ABSENT) {
+                local[v] = static_cast<uint8_t>(meshlet.vertexCount++);
+                localVertices.push_back(v);
+                meshletVertices.push_back(v);
+            }
+            meshletTriangles.push_back(local[v]);
+        }
+        meshlet.triangleCount++;
+    }
+    finish();
+    return meshlets.size();
+}
+
+MeshOptimizeStats MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                          float overdrawThreshold) {
+    MeshOptimizeStats stats;
+    stats.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    optimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size(), overdrawThreshold);
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), indices.data(), indices.size()));
+
+    stats.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    return stats;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "VertexLayout.h"
+
+// Post-transform cache efficiency of an index order, simulated with a FIFO
+// cache like the ones GPUs keep between the vertex shader and the rasterizer
+struct VertexCacheStats {
+    float acmr = 0.0f;  // Vertex shader runs per triangle: 3 worst, about 0.5 best on grids
+    float atvr = 0.0f;  // Vertex shader runs per referenced vertex: 1 is ideal
+};
+
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// A small cluster of a mesh's triangles, for culling below the mesh level:
+// the triangles index the meshlet's own vertex list with 8-bit indices
+struct Meshlet {
+    uint32_t vertexOffset;    // Into the meshlet vertex list
+    uint32_t triangleOffset;  // Into the meshlet triangle list, 3 bytes per triangle
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    float center[3];          // Bounding sphere
+    float radius;
+    float coneAxis[3];        // Average facing; every triangle faces away from
+    float coneCutoff;         // a viewer with dot(view direction, axis) >= cutoff, above 1 if none
+};
+
+// Load-time reordering of indexed triangle lists, in three steps that each
+// keep the previous one's gains:
+//
+//   optimizeVertexCache  triangles in an order that reuses recent vertices
+//                        (Forsyth, "Linear-speed vertex cache optimisation")
+//   optimizeOverdraw     clusters of that order sorted so outward-facing ones
+//                        draw first and hide the rest (Sander et al., "Fast
+//                        triangle reordering for vertex locality and reduced
+//                        overdraw"), at a bounded cost in cache misses
+//   optimizeVertexFetch  vertices renumbered in first-use order, so the
+//                        vertex fetch walks memory forward
+//
+// None of them changes what is drawn, only the order.
+class MeshOptimizer {
+public:
+    // FIFO entries assumed by analyzeVertexCache and the overdraw clusters
+    static const unsigned int CACHE_SIZE = 16;
+
+    static VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                               unsigned int cacheSize = CACHE_SIZE);
+
+    static void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+    // threshold bounds the ACMR of the result relative to the input, 1.05 =
+    // at most 5% more vertex shader runs. The input should be cache-optimized.
+    static void optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                                 size_t vertexCount, float threshold = 1.05f);
+
+    // Renumber the vertices in the order the indices first use them and drop
+    // unreferenced ones. Returns the new vertex count.
+    static size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+    // Split the triangles, in order, into meshlets of at most maxVertices
+    // (up to 255) vertices and maxTriangles triangles. Run after the other steps, so each
+    // meshlet is a compact patch. Returns the meshlet count.
+    static size_t buildMeshlets(const unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                                size_t vertexCount, std::vector<Meshlet>& meshlets,
+                                std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles,
+                                size_t maxVertices = 64, size_t maxTriangles = 124);
+
+    // All three steps on a whole mesh, with its cache stats before and after
+    static MeshOptimizeStats optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                      float overdrawThreshold = 1.05f);
+};
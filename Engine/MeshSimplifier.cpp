@@ -0,0 +1,408 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+// Open borders weigh their planes like this many triangles of the same size,
+// so the outline stays in place until the interior is used up
+static const double BORDER_WEIGHT = 10.0;
+
+// A collapse may turn a triangle at most this far: cos of about 75 degrees
+static const double MIN_NORMAL_DOT = 0.25;
+
+// Sum of weighted squared distances to planes, as the symmetric matrix of
+// (nx, ny, nz, d) outer products
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+    double weight = 0;
+
+    void addPlane(const Vector3& normal, float d, double planeWeight) {
+        double x = normal.x, y = normal.y, z = normal.z, w = d;
+        xx += planeWeight * x * x; xy += planeWeight * x * y; xz += planeWeight * x * z; xw += planeWeight * x * w;
+        yy += planeWeight * y * y; yz += planeWeight * y * z; yw += planeWeight * y * w;
+        zz += planeWeight * z * z; zw += planeWeight * z * w;
+        ww += planeWeight * w * w;
+        weight += planeWeight;
+    }
+
+    void add(const Quadric& other) {
+        xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+        yy += other.yy; yz += other.yz; yw += other.yw;
+        zz += other.zz; zw += other.zw;
+        ww += other.ww;
+        weight += other.weight;
+    }
+
+    // Weighted sum of squared distances from p to the planes
+    double evaluate(const Vector3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return xx * x * x + yy * y * y + zz * z * z + ww +
+               2.0 * (xy * x * y + xz * x * z + xw * x + yz * y * z + yw * y + zw * z);
+    }
+};
+
+static Vector3 triangleCross(const Vector3& a, const Vector3& b, const Vector3& c) {
+    return (b - a).crossProduct(c - a);
+}
+
+static float attributeDistance2(const Vertex& a, const Vertex& b) {
+    Vector3 normal = a.normal - b.normal;
+    Vector3 color = a.color - b.color;
+    float u = a.texCoords.x - b.texCoords.x;
+    float v = a.texCoords.y - b.texCoords.y;
+    return normal.dotProduct(normal) + color.dotProduct(color) + u * u + v * v;
+}
+
+static uint64_t edgeKey(unsigned int from, unsigned int to) {
+    return static_cast<uint64_t>(from) << 32 | to;
+}
+
+// Vertices with identical bytes become one (unique), vertices with identical
+// positions share a representative (position) that carries the topology
+static void weldVertices(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& unique,
+                         std::vector<unsigned int>& position) {
+    std::vector<unsigned int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        int byPosition = std::memcmp(&vertices[a].position, &vertices[b].position, sizeof(Vector3));
+        if (byPosition != 0) return byPosition < 0;
+        int byBytes = std::memcmp(&vertices[a], &vertices[b], sizeof(Vertex));
+        return byBytes != 0 ? byBytes < 0 : a < b;
+    });
+
+    unique.resize(vertexCount);
+    position.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        unsigned int v = order[i];
+        if (i > 0 && std::memcmp(&vertices[v].position, &vertices[order[i - 1]].position, sizeof(Vector3)) == 0) {
+            unsigned int previous = order[i - 1];
+            position[v] = position[previous];
+            unique[v] = std::memcmp(&vertices[v], &vertices[previous], sizeof(Vertex)) == 0 ? unique[previous] : v;
+        } else {
+            position[v] = v;
+            unique[v] = v;
+        }
+    }
+}
+
+// Compressed lists: the entries of key k are items[first[k]] to items[first[k + 1]]
+struct Adjacency {
+    std::vector<unsigned int> first;
+    std::vector<unsigned int> items;
+
+    template <typename KeyOf>
+    void build(size_t keyCount, size_t itemCount, KeyOf keyOf) {
+        first.assign(keyCount + 1, 0);
+        for (size_t i = 0; i < itemCount; i++) first[keyOf(i) + 1]++;
+        for (size_t k = 0; k < keyCount; k++) first[k + 1] += first[k];
+        items.resize(itemCount);
+        std::vector<unsigned int> filled(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < itemCount; i++) items[filled[keyOf(i)]++] = static_cast<unsigned int>(i);
+    }
+};
+
+// One simplification in progress. Runs can continue where the last stopped
+// with a lower target, so a whole detail chain is one sequence of collapses.
+struct Simplification {
+    const Vertex* vertices;
+    size_t vertexCount;
+    double attributeScale;
+    std::vector<unsigned int> unique, position;
+    std::vector<unsigned int> current;  // Live triangles over unique vertices
+    std::vector<Quadric> quadrics;      // Kept on the position representatives
+    double largestError = 0.0;          // Squared, of the collapses so far
+
+    std::vector<uint64_t> directedEdges;
+    std::vector<char> reversed;  // Per directed edge, whether the opposite one exists
+    std::vector<unsigned int> remap;
+    std::vector<char> touched;
+    std::vector<char> border;
+
+    Simplification(const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                   float attributeWeight);
+
+    const Vector3& pointOf(unsigned int v) const { return vertices[position[v]].position; }
+
+    // Collapse until targetIndexCount is reached or the next collapse would
+    // cost more than errorLimit (squared)
+    void run(size_t targetIndexCount, double errorLimit);
+};
+
+Simplification::Simplification(const unsigned int* indices, size_t indexCount, const Vertex* vertices,
+                               size_t vertexCount, float attributeWeight)
+    : vertices(vertices), vertexCount(vertexCount),
+      attributeScale(static_cast<double>(attributeWeight) * attributeWeight),
+      quadrics(vertexCount), remap(vertexCount), touched(vertexCount), border(vertexCount) {
+    weldVertices(vertices, vertexCount, unique, position);
+
+    // Triangles that are already degenerate are dropped
+    current.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        unsigned int a = unique[indices[i]], b = unique[indices[i + 1]], c = unique[indices[i + 2]];
+        if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a]) continue;
+        current.insert(current.end(), {a, b, c});
+    }
+
+    // Planes of the input surface
+    for (size_t i = 0; i < current.size(); i += 3) {
+        unsigned int corner[3] = {position[current[i]], position[current[i + 1]], position[current[i + 2]]};
+        Vector3 cross = triangleCross(pointOf(corner[0]), pointOf(corner[1]), pointOf(corner[2]));
+        float length = cross.length();
+        if (length <= 0.0f) continue;
+        Vector3 normal = cross * (1.0f / length);
+        float d = -normal.dotProduct(pointOf(corner[0]));
+        for (unsigned int r : corner) quadrics[r].addPlane(normal, d, length * 0.5);
+        for (int k = 0; k < 3; k++) directedEdges.push_back(edgeKey(corner[k], corner[(k + 1) % 3]));
+    }
+    std::sort(directedEdges.begin(), directedEdges.end());
+
+    // Planes through every open edge, perpendicular to its triangle, hold the
+    // border where it is
+    for (size_t i = 0; i < current.size(); i += 3) {
+        unsigned int corner[3] = {position[current[i]], position[current[i + 1]], position[current[i + 2]]};
+        Vector3 cross = triangleCross(pointOf(corner[0]), pointOf(corner[1]), pointOf(corner[2]));
+        if (cross.length() <= 0.0f) continue;
+        for (int k = 0; k < 3; k++) {
+            unsigned int a = corner[k], b = corner[(k + 1) % 3];
+            if (std::binary_search(directedEdges.begin(), directedEdges.end(), edgeKey(b, a))) continue;
+            Vector3 edge = pointOf(b) - pointOf(a);
+            Vector3 normal = edge.crossProduct(cross).normalize();
+            float d = -normal.dotProduct(pointOf(a));
+            double weight = BORDER_WEIGHT * edge.dotProduct(edge);
+            quadrics[a].addPlane(normal, d, weight);
+            quadrics[b].addPlane(normal, d, weight);
+        }
+    }
+}
+
+void Simplification::run(size_t targetIndexCount, double errorLimit) {
+    // Collapses happen in passes: each pass scores every edge, then collapses
+    // the cheapest ones that do not touch each other, so the scores stay
+    // valid without a priority queue
+    while (current.size() > targetIndexCount) {
+        size_t triangleCount = current.size() / 3;
+
+        Adjacency trianglesOf;
+        trianglesOf.build(vertexCount, current.size(), [&](size_t i) { return position[current[i]]; });
+        // Corner lists hold corner indices, i / 3 is the triangle
+
+        directedEdges.clear();
+        for (size_t i = 0; i < current.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                directedEdges.push_back(edgeKey(position[current[i + k]], position[current[i + (k + 1) % 3]]));
+            }
+        }
+        std::sort(directedEdges.begin(), directedEdges.end());
+        // An edge without its opposite direction lies on an open border
+        reversed.resize(directedEdges.size());
+        std::fill(border.begin(), border.end(), 0);
+        for (size_t i = 0; i < directedEdges.size(); i++) {
+            unsigned int a = static_cast<unsigned int>(directedEdges[i] >> 32);
+            unsigned int b = static_cast<unsigned int>(directedEdges[i]);
+            reversed[i] = std::binary_search(directedEdges.begin(), directedEdges.end(), edgeKey(b, a));
+            if (!reversed[i]) border[a] = border[b] = 1;
+        }
+
+        // Live vertices of every position
+        std::vector<unsigned int> live;
+        std::vector<char> seen(vertexCount, 0);
+        for (unsigned int v : current) {
+            if (!seen[v]) {
+                seen[v] = 1;
+                live.push_back(v);
+            }
+        }
+        Adjacency wedges;
+        wedges.build(vertexCount, live.size(), [&](size_t i) { return position[live[i]]; });
+
+        // The vertex at b's position that va's corners continue into: one
+        // sharing a triangle with va, else the closest in attributes
+        auto match = [&](unsigned int va, unsigned int a, unsigned int b) {
+            if (wedges.first[b + 1] - wedges.first[b] == 1) return live[wedges.items[wedges.first[b]]];
+            for (unsigned int j = trianglesOf.first[a]; j < trianglesOf.first[a + 1]; j++) {
+                unsigned int corner = trianglesOf.items[j];
+                if (current[corner] != va) continue;
+                size_t t = corner / 3 * 3;
+                for (int k = 0; k < 3; k++) {
+                    if (position[current[t + k]] == b) return current[t + k];
+                }
+            }
+            unsigned int best = live[wedges.items[wedges.first[b]]];
+            float bestDistance = attributeDistance2(vertices[va], vertices[best]);
+            for (unsigned int j = wedges.first[b] + 1; j < wedges.first[b + 1]; j++) {
+                unsigned int vb = live[wedges.items[j]];
+                float distance = attributeDistance2(vertices[va], vertices[vb]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = vb;
+                }
+            }
+            return best;
+        };
+
+        auto collapseCost = [&](unsigned int a, unsigned int b, bool borderEdge) {
+            // A border vertex leaving its border would tear the outline
+            if (border[a] && !borderEdge) return HUGE_VAL;
+            double weight = quadrics[a].weight + quadrics[b].weight;
+            double geometric = (quadrics[a].evaluate(pointOf(b)) + quadrics[b].evaluate(pointOf(b))) /
+                               std::max(weight, 1e-20);
+            double attributes = 0.0;
+            for (unsigned int j = wedges.first[a]; j < wedges.first[a + 1]; j++) {
+                unsigned int va = live[wedges.items[j]];
+                attributes += attributeDistance2(vertices[va], vertices[match(va, a, b)]);
+            }
+            return std::max(geometric, 0.0) + attributeScale * attributes;
+        };
+
+        struct Collapse {
+            unsigned int from;
+            unsigned int to;
+            double cost;
+        };
+        std::vector<Collapse> collapses;
+        for (size_t i = 0; i < directedEdges.size(); i++) {
+            unsigned int a = static_cast<unsigned int>(directedEdges[i] >> 32);
+            unsigned int b = static_cast<unsigned int>(directedEdges[i]);
+            // Each undirected edge once, from its directed copy with a < b or
+            // from the only copy of a border edge
+            if (a > b && reversed[i]) continue;
+            if (i > 0 && directedEdges[i - 1] == directedEdges[i]) continue;
+            double forward = collapseCost(a, b, !reversed[i]);
+            double backward = collapseCost(b, a, !reversed[i]);
+            Collapse collapse = forward <= backward ? Collapse{a, b, forward} : Collapse{b, a, backward};
+            if (collapse.cost <= errorLimit) collapses.push_back(collapse);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+            return x.cost < y.cost || (x.cost == y.cost && (x.from < y.from || (x.from == y.from && x.to < y.to)));
+        });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (triangleCount * 3 <= targetIndexCount) break;
+            unsigned int a = collapse.from, b = collapse.to;
+            if (touched[a] || touched[b]) continue;
+
+            // Triangles around a that survive must not flip or fold over
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int j = trianglesOf.first[a]; j < trianglesOf.first[a + 1] && !flips; j++) {
+                size_t t = trianglesOf.items[j] / 3 * 3;
+                unsigned int corner[3] = {position[current[t]], position[current[t + 1]], position[current[t + 2]]};
+                if (corner[0] == b || corner[1] == b || corner[2] == b) {
+                    removed++;
+                    continue;
+                }
+                Vector3 before = triangleCross(pointOf(corner[0]), pointOf(corner[1]), pointOf(corner[2]));
+                Vector3 after = triangleCross(corner[0] == a ? pointOf(b) : pointOf(corner[0]),
+                                              corner[1] == a ? pointOf(b) : pointOf(corner[1]),
+                                              corner[2] == a ? pointOf(b) : pointOf(corner[2]));
+                double dot = before.dotProduct(after);
+                flips = dot <= MIN_NORMAL_DOT * before.length() * after.length();
+            }
+            if (flips) continue;
+
+            for (unsigned int j = wedges.first[a]; j < wedges.first[a + 1]; j++) {
+                unsigned int va = live[wedges.items[j]];
+                remap[va] = match(va, a, b);
+            }
+            for (unsigned int j = trianglesOf.first[a]; j < trianglesOf.first[a + 1]; j++) {
+                size_t t = trianglesOf.items[j] / 3 * 3;
+                for (int k = 0; k < 3; k++) touched[position[current[t + k]]] = 1;
+            }
+            touched[b] = 1;
+            quadrics[b].add(quadrics[a]);
+            largestError = std::max(largestError, collapse.cost);
+            triangleCount -= removed;
+            collapsed++;
+        }
+        if (collapsed == 0) break;
+
+        size_t written = 0;
+        for (size_t i = 0; i < current.size(); i += 3) {
+            unsigned int a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+            if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a]) continue;
+            current[written++] = a;
+            current[written++] = b;
+            current[written++] = c;
+        }
+        current.resize(written);
+    }
+}
+
+size_t MeshSimplifier::simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+                                const Vertex* vertices, size_t vertexCount, size_t targetIndexCount,
+                                float targetError, float attributeWeight, float* resultError) {
+    if (resultError) *resultError = 0.0f;
+    indexCount -= indexCount % 3;
+    for (size_t i = 0; i < indexCount; i++) {
+        if (indices[i] >= vertexCount) {
+            std::copy(indices, indices + indexCount, destination);
+            return indexCount;
+        }
+    }
+
+    Simplification simplification(indices, indexCount, vertices, vertexCount, attributeWeight);
+    simplification.run(targetIndexCount, static_cast<double>(targetError) * targetError);
+
+    std::copy(simplification.current.begin(), simplification.current.end(), destination);
+    if (resultError) *resultError = static_cast<float>(std::sqrt(simplification.largestError));
+    return simplification.current.size();
+}
+
+std::vector<MeshLod> MeshSimplifier::buildLodChain(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                                   const LodChainSettings& settings) {
+    std::vector<MeshLod> lods;
+    if (indices.empty() || vertices.empty()) return lods;
+
+    Vector3 min = vertices[0].position, max = vertices[0].position;
+    for (const Vertex& vertex : vertices) {
+        const Vector3& p = vertex.position;
+        min = Vector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max = Vector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+    float radius = (max - min).length() * 0.5f;
+
+    MeshLod full;
+    full.indexCount = static_cast<uint32_t>(indices.size());
+    lods.push_back(full);
+
+    // Every level continues the collapses of the one before, with the
+    // quadrics of the full mesh, so its error is measured against the real
+    // surface
+    Simplification simplification(indices.data(), indices.size(), vertices.data(), vertices.size(),
+                                  settings.attributeWeight * radius);
+    const double errorLimit = static_cast<double>(settings.maxError) * radius * settings.maxError * radius;
+    while (static_cast<int>(lods.size()) < settings.maxLevels) {
+        size_t previous = lods.back().indexCount;
+        size_t target = static_cast<size_t>(previous / 3 * settings.reduction) * 3;
+        if (target / 3 < settings.minTriangles) break;
+
+        simplification.run(target, errorLimit);
+        size_t count = simplification.current.size();
+        // Levels that barely shrink cost memory without saving anything
+        if (count == 0 || count > previous - previous / 8) break;
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(indices.size());
+        lod.indexCount = static_cast<uint32_t>(count);
+        lod.error = static_cast<float>(std::sqrt(simplification.largestError));
+        lods.push_back(lod);
+        indices.insert(indices.end(), simplification.current.begin(), simplification.current.end());
+    }
+
+    for (size_t i = 0; i < lods.size(); i++) {
+        unsigned int* levelIndices = indices.data() + lods[i].firstIndex;
+        MeshOptimizer::optimizeVertexCache(levelIndices, lods[i].indexCount, vertices.size());
+        MeshOptimizer::optimizeOverdraw(levelIndices, lods[i].indexCount, vertices.data(), vertices.size());
+    }
+    vertices.resize(MeshOptimizer::optimizeVertexFetch(vertices.data(), vertices.size(), indices.data(), indices.size()));
+    return lods;
+}
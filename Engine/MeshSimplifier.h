@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "VertexLayout.h"
+#include "MeshLod.h"
+
+struct LodChainSettings {
+    int maxLevels = 5;             // Including the full-detail level
+    float reduction = 0.5f;        // Triangles of each level relative to the one before
+    float maxError = 0.25f;        // No level deviates more than this, relative to the mesh radius
+    float attributeWeight = 0.1f;  // Distance, relative to the radius, a unit of normal, uv or color change costs
+    size_t minTriangles = 2;
+};
+
+// Quadric error metric edge collapse (Garland and Heckbert, "Surface
+// simplification using quadric error metrics"). Every vertex sums the planes
+// of its triangles; collapsing an edge onto one endpoint costs the squared
+// distance of that point to all planes merged into it, so flat regions go
+// first and silhouettes last.
+//
+// Collapses always move a vertex onto an existing one, so the result indexes
+// the original vertex buffer. Vertices sharing a position (uv seams, hard
+// edges) collapse together, each onto the vertex on the other side whose
+// attributes continue its own; attribute changes add to the cost. Open
+// borders only slide along themselves, and collapses that would flip a
+// triangle are skipped.
+class MeshSimplifier {
+public:
+    // Write a simplified copy of indices to destination, which holds at least
+    // indexCount entries. Stops at targetIndexCount or before the error would
+    // exceed targetError (model units). attributeWeight converts attribute
+    // differences into model units. Returns the index count; resultError
+    // receives the largest distance from the input surface.
+    static size_t simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+                           const Vertex* vertices, size_t vertexCount, size_t targetIndexCount,
+                           float targetError, float attributeWeight, float* resultError = nullptr);
+
+    // Append simplified levels to indices, each simplified from the full mesh,
+    // and optimize all of them (MeshOptimizer). Vertices are renumbered and
+    // unreferenced ones dropped. Returns the levels, level 0 first.
+    static std::vector<MeshLod> buildLodChain(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                              const LodChainSettings& settings = LodChainSettings());
+};
@@ -0,0 +1,1022 @@
+#include "ModelImporter.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+// Text parsed by one job; large enough that the per-chunk bookkeeping is
+// noise, small enough that a few hundred MB keep every thread busy
+static const size_t OBJ_CHUNK_BYTES = 1 << 20;
+
+// Corners deduplicated per job, by the top bits of their hash
+static const unsigned int PARTITION_BITS = 6;
+static const size_t PARTITIONS = size_t(1) << PARTITION_BITS;
+static const size_t CORNER_BLOCK = 65536;
+
+static const int32_t MISSING = -1;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Area-weighted normals for the vertices flagged in needsNormal (all of
+// them when null), from the triangles using them
+static void generateNormals(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                            const uint8_t* needsNormal) {
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const unsigned int* triangle = indices + i;
+        Vector3 edge1 = vertices[triangle[1]].position - vertices[triangle[0]].position;
+        Vector3 edge2 = vertices[triangle[2]].position - vertices[triangle[0]].position;
+        Vector3 normal = edge1.crossProduct(edge2);
+        for (int k = 0; k < 3; k++) {
+            if (needsNormal && !needsNormal[triangle[k]]) continue;
+            vertices[triangle[k]].normal = vertices[triangle[k]].normal + normal;
+        }
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (!needsNormal || needsNormal[v]) vertices[v].normal = vertices[v].normal.normalize();
+    }
+}
+
+// --- Wavefront OBJ ---
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::vector<float> positions;    // xyz
+    std::vector<float> colors;       // rgb per position, empty while the chunk has none
+    std::vector<float> texCoords;    // uv
+    std::vector<float> normals;      // xyz
+    std::vector<int32_t> corners;    // Position, uv and normal index of every triangle corner
+    std::vector<uint32_t> relative;  // Entries of corners still relative to this chunk's first elements
+    size_t lines = 0;
+    size_t errorLine = 0;            // 1-based within the chunk, 0 when it parsed
+};
+
+struct ObjCorner {
+    int32_t index[3];
+    uint8_t relative;  // Bit per index given as a negative (relative) OBJ index
+};
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) p++;
+    return p;
+}
+
+// Up to maxCount numbers before the end of the line or a comment; -1 when
+// something else follows them
+static int parseFloats(const char* p, const char* end, float* values, int maxCount) {
+    int count = 0;
+    for (p = skipSpaces(p, end); p < end && *p != '#' && count < maxCount; p = skipSpaces(p, end)) {
+        if (*p == '+') p++;
+        std::from_chars_result result = std::from_chars(p, end, values[count]);
+        if (result.ec != std::errc() || (result.ptr < end && !isSpace(*result.ptr))) return -1;
+        p = result.ptr;
+        count++;
+    }
+    return p < end && *p != '#' ? -1 : count;
+}
+
+// "p", "p/t", "p//n" or "p/t/n"; OBJ indices are 1-based, negative ones count
+// back from the latest element
+static const char* parseCorner(const char* p, const char* end, const ObjChunk& chunk, ObjCorner& corner) {
+    const size_t counts[3] = {chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3};
+    corner.index[0] = corner.index[1] = corner.index[2] = MISSING;
+    corner.relative = 0;
+    for (int a = 0; a < 3; a++) {
+        if (a > 0) {
+            if (p >= end || *p != '/') break;
+            p++;
+        }
+        if (p >= end || *p == '/' || isSpace(*p)) {
+            if (a == 0) return nullptr;
+            continue;
+        }
+        int32_t value = 0;
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value == 0) return nullptr;
+        p = result.ptr;
+        if (value > 0) {
+            corner.index[a] = value - 1;
+        } else {
+            corner.index[a] = static_cast<int32_t>(counts[a]) + value;
+            corner.relative |= 1 << a;
+        }
+    }
+    return p < end && !isSpace(*p) ? nullptr : p;
+}
+
+static void emitCorner(ObjChunk& chunk, const ObjCorner& corner) {
+    for (int a = 0; a < 3; a++) {
+        if (corner.relative & (1 << a)) chunk.relative.push_back(static_cast<uint32_t>(chunk.corners.size()));
+        chunk.corners.push_back(corner.index[a]);
+    }
+}
+
+// Polygons are fanned from their first corner
+static bool parseFace(const char* p, const char* end, ObjChunk& chunk) {
+    ObjCorner first, previous, corner;
+    int count = 0;
+    for (p = skipSpaces(p, end); p < end && *p != '#'; p = skipSpaces(p, end)) {
+        p = parseCorner(p, end, chunk, corner);
+        if (!p) return false;
+        if (count == 0) {
+            first = corner;
+        } else if (count >= 2) {
+            emitCorner(chunk, first);
+            emitCorner(chunk, previous);
+            emitCorner(chunk, corner);
+        }
+        previous = corner;
+        count++;
+    }
+    return count >= 3;
+}
+
+static bool parseObjLine(const char* p, const char* end, ObjChunk& chunk) {
+    if (p >= end || *p == '#') return true;
+    bool keyword1 = end - p >= 2 && isSpace(p[1]);
+    bool keyword2 = end - p >= 3 && isSpace(p[2]);
+    float values[7];
+
+    if (p[0] == 'v' && keyword1) {
+        // x y z [w], or x y z r g b
+        int count = parseFloats(p + 2, end, values, 7);
+        if (count < 3) return false;
+        chunk.positions.insert(chunk.positions.end(), values, values + 3);
+        if (count >= 6) {
+            if (chunk.colors.empty()) chunk.colors.assign(chunk.positions.size() - 3, 1.0f);
+            chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+        } else if (!chunk.colors.empty()) {
+            chunk.colors.insert(chunk.colors.end(), 3, 1.0f);
+        }
+    } else if (keyword2 && p[0] == 'v' && p[1] == 'n') {
+        if (parseFloats(p + 3, end, values, 3) != 3) return false;
+        chunk.normals.insert(chunk.normals.end(), values, values + 3);
+    } else if (keyword2 && p[0] == 'v' && p[1] == 't') {
+        int count = parseFloats(p + 3, end, values, 3);
+        if (count < 1) return false;
+        chunk.texCoords.push_back(values[0]);
+        chunk.texCoords.push_back(count > 1 ? values[1] : 0.0f);
+    } else if (p[0] == 'f' && keyword1) {
+        return parseFace(p + 2, end, chunk);
+    }
+    // Anything else (groups, materials, smoothing, lines) is skipped
+    return true;
+}
+
+static void parseObjChunk(ObjChunk& chunk) {
+    for (const char* p = chunk.begin; p < chunk.end;) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        if (!lineEnd) lineEnd = chunk.end;
+        chunk.lines++;
+        if (!parseObjLine(skipSpaces(p, lineEnd), lineEnd, chunk)) {
+            chunk.errorLine = chunk.lines;
+            return;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+static uint32_t hashCorner(const int32_t* corner) {
+    uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(corner[0])) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(corner[1])) * 0xC2B2AE3D27D4EB4Full;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(corner[2])) * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+bool ModelImporter::parseObj(const char* text, size_t size, ModelData& model, ModelImportStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Chunks end after a newline, so no line is split between two jobs
+    size_t chunkCount = std::max<size_t>(1, (size + OBJ_CHUNK_BYTES - 1) / OBJ_CHUNK_BYTES);
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* end = text + size;
+    const char* begin = text;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* chunkEnd = end;
+        if (i + 1 < chunkCount) {
+            const char* split = std::max(begin, text + size / chunkCount * (i + 1));
+            const char* newline = static_cast<const char*>(std::memchr(split, '\n', end - split));
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = chunkEnd;
+        begin = chunkEnd;
+    }
+
+    JobSystem::parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) parseObjChunk(chunks[i]);
+    });
+
+    // Where every chunk's elements start in the whole file
+    std::vector<size_t> bases[4];
+    size_t totals[4] = {};
+    bool hasColors = false;
+    size_t lineBase = 0;
+    for (ObjChunk& chunk : chunks) {
+        if (chunk.errorLine > 0) {
+            std::cerr << "OBJ line " << lineBase + chunk.errorLine << ": malformed statement" << std::endl;
+            return false;
+        }
+        lineBase += chunk.lines;
+        const size_t counts[4] = {chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3,
+                                  chunk.corners.size() / 3};
+        for (int a = 0; a < 4; a++) {
+            bases[a].push_back(totals[a]);
+            totals[a] += counts[a];
+        }
+        hasColors |= !chunk.colors.empty();
+    }
+    size_t cornerCount = totals[3];
+    if (cornerCount == 0) {
+        std::cerr << "OBJ file has no faces" << std::endl;
+        return false;
+    }
+    if (totals[0] > static_cast<size_t>(INT32_MAX) || cornerCount > UINT32_MAX / 3) {
+        std::cerr << "OBJ file is too large" << std::endl;
+        return false;
+    }
+
+    // Gather the chunks into whole-file arrays and resolve relative indices
+    std::vector<float> positions(totals[0] * 3);
+    std::vector<float> colors(hasColors ? totals[0] * 3 : 0);
+    std::vector<float> texCoords(totals[1] * 2);
+    std::vector<float> normals(totals[2] * 3);
+    std::vector<int32_t> corners(cornerCount * 3);
+    std::atomic<bool> badIndex{false};
+    JobSystem::parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + bases[0][i] * 3);
+            if (hasColors && chunk.colors.empty()) {
+                std::fill_n(colors.begin() + bases[0][i] * 3, chunk.positions.size(), 1.0f);
+            } else if (hasColors) {
+                std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + bases[0][i] * 3);
+            }
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + bases[1][i] * 2);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + bases[2][i] * 3);
+
+            int32_t* out = corners.data() + bases[3][i] * 3;
+            std::copy(chunk.corners.begin(), chunk.corners.end(), out);
+            bool bad = false;
+            for (uint32_t entry : chunk.relative) {
+                out[entry] += static_cast<int32_t>(bases[entry % 3][i]);
+                bad |= out[entry] < 0;
+            }
+            for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+                bad |= out[c] < 0 || static_cast<size_t>(out[c]) >= totals[0];
+                bad |= out[c + 1] != MISSING && static_cast<size_t>(out[c + 1]) >= totals[1];
+                bad |= out[c + 2] != MISSING && static_cast<size_t>(out[c + 2]) >= totals[2];
+            }
+            if (bad) badIndex.store(true, std::memory_order_relaxed);
+            chunk = ObjChunk();
+        }
+    });
+    if (badIndex.load()) {
+        std::cerr << "OBJ face refers to a missing element" << std::endl;
+        return false;
+    }
+    double parseMs = elapsedMs(start);
+
+    // Deduplicate: count and scatter the corners into hash partitions, block
+    // by block, then let every partition find its unique corners
+    auto dedupeStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> hashes(cornerCount);
+    size_t blockCount = (cornerCount + CORNER_BLOCK - 1) / CORNER_BLOCK;
+    std::vector<uint32_t> cursors(blockCount * PARTITIONS, 0);
+    JobSystem::parallelFor(blockCount, 1, [&](size_t first, size_t last) {
+        for (size_t block = first; block < last; block++) {
+            uint32_t* counts = cursors.data() + block * PARTITIONS;
+            size_t blockEnd = std::min(cornerCount, (block + 1) * CORNER_BLOCK);
+            for (size_t c = block * CORNER_BLOCK; c < blockEnd; c++) {
+                hashes[c] = hashCorner(corners.data() + c * 3);
+                counts[hashes[c] >> (32 - PARTITION_BITS)]++;
+            }
+        }
+    });
+
+    std::vector<size_t> partitionStart(PARTITIONS + 1, 0);
+    size_t offset = 0;
+    for (size_t partition = 0; partition < PARTITIONS; partition++) {
+        partitionStart[partition] = offset;
+        for (size_t block = 0; block < blockCount; block++) {
+            uint32_t count = cursors[block * PARTITIONS + partition];
+            cursors[block * PARTITIONS + partition] = static_cast<uint32_t>(offset);
+            offset += count;
+        }
+    }
+    partitionStart[PARTITIONS] = offset;
+
+    std::vector<uint32_t> order(cornerCount);
+    JobSystem::parallelFor(blockCount, 1, [&](size_t first, size_t last) {
+        for (size_t block = first; block < last; block++) {
+            uint32_t* cursor = cursors.data() + block * PARTITIONS;
+            size_t blockEnd = std::min(cornerCount, (block + 1) * CORNER_BLOCK);
+            for (size_t c = block * CORNER_BLOCK; c < blockEnd; c++) {
+                order[cursor[hashes[c] >> (32 - PARTITION_BITS)]++] = static_cast<uint32_t>(c);
+            }
+        }
+    });
+
+    // Open addressing on the low hash bits; the stored hash skips most
+    // mismatches without touching the corner
+    std::vector<unsigned int>& indices = model.indices;
+    indices.assign(cornerCount, 0);
+    std::vector<std::vector<uint32_t>> uniques(PARTITIONS);
+    JobSystem::parallelFor(PARTITIONS, 1, [&](size_t first, size_t last) {
+        for (size_t partition = first; partition < last; partition++) {
+            size_t count = partitionStart[partition + 1] - partitionStart[partition];
+            size_t tableSize = 16;
+            while (tableSize < count * 2) tableSize *= 2;
+            std::vector<uint64_t> table(tableSize, UINT64_MAX);  // Hash << 32 | unique
+            std::vector<uint32_t>& unique = uniques[partition];
+
+            for (size_t k = partitionStart[partition]; k < partitionStart[partition + 1]; k++) {
+                uint32_t corner = order[k];
+                uint32_t hash = hashes[corner];
+                const int32_t* key = corners.data() + size_t(corner) * 3;
+                size_t slot = hash & (tableSize - 1);
+                for (;; slot = (slot + 1) & (tableSize - 1)) {
+                    uint64_t entry = table[slot];
+                    if (entry == UINT64_MAX) {
+                        table[slot] = (uint64_t(hash) << 32) | unique.size();
+                        indices[corner] = static_cast<unsigned int>(unique.size());
+                        unique.push_back(corner);
+                        break;
+                    }
+                    uint32_t candidate = unique[static_cast<uint32_t>(entry)];
+                    if (static_cast<uint32_t>(entry >> 32) == hash &&
+                        std::memcmp(corners.data() + size_t(candidate) * 3, key, 3 * sizeof(int32_t)) == 0) {
+                        indices[corner] = static_cast<uint32_t>(entry);
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<size_t> vertexBase(PARTITIONS + 1, 0);
+    for (size_t partition = 0; partition < PARTITIONS; partition++) {
+        vertexBase[partition + 1] = vertexBase[partition] + uniques[partition].size();
+    }
+    size_t vertexCount = vertexBase[PARTITIONS];
+
+    std::vector<Vertex>& vertices = model.vertices;
+    vertices.assign(vertexCount, Vertex());
+    std::vector<uint8_t> needsNormal(vertexCount, 0);
+    std::atomic<bool> missingNormals{false};
+    JobSystem::parallelFor(PARTITIONS, 1, [&](size_t first, size_t last) {
+        for (size_t partition = first; partition < last; partition++) {
+            bool missing = false;
+            const std::vector<uint32_t>& unique = uniques[partition];
+            for (size_t u = 0; u < unique.size(); u++) {
+                const int32_t* key = corners.data() + size_t(unique[u]) * 3;
+                size_t v = vertexBase[partition] + u;
+                Vertex& vertex = vertices[v];
+                const float* position = positions.data() + size_t(key[0]) * 3;
+                vertex.position = Vector3(position[0], position[1], position[2]);
+                if (hasColors) {
+                    const float* color = colors.data() + size_t(key[0]) * 3;
+                    vertex.color = Vector3(color[0], color[1], color[2]);
+                } else {
+                    vertex.color = Vector3(1.0f, 1.0f, 1.0f);
+                }
+                if (key[1] != MISSING) {
+                    const float* uv = texCoords.data() + size_t(key[1]) * 2;
+                    vertex.texCoords = Vector3(uv[0], uv[1], 0.0f);
+                }
+                if (key[2] != MISSING) {
+                    const float* normal = normals.data() + size_t(key[2]) * 3;
+                    vertex.normal = Vector3(normal[0], normal[1], normal[2]);
+                } else {
+                    needsNormal[v] = 1;
+                    missing = true;
+                }
+            }
+            for (size_t k = partitionStart[partition]; k < partitionStart[partition + 1]; k++) {
+                indices[order[k]] += static_cast<unsigned int>(vertexBase[partition]);
+            }
+            if (missing) missingNormals.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    // Only files without normals pay for this serial pass
+    if (missingNormals.load()) {
+        generateNormals(vertices.data(), vertexCount, indices.data(), indices.size(), needsNormal.data());
+    }
+
+    if (stats) {
+        stats->bytes = size;
+        stats->chunks = chunkCount;
+        stats->corners = cornerCount;
+        stats->parseMs = parseMs;
+        stats->dedupeMs = elapsedMs(dedupeStart);
+        stats->totalMs = elapsedMs(start);
+    }
+    return true;
+}
+
+// --- Binary glTF ---
+
+// Enough JSON for a glTF scene description
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;   // Array elements, or object members in order
+    std::vector<std::string> keys;  // Object member names, parallel to items
+
+    const JsonValue* find(const char* key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return &items[i];
+        }
+        return nullptr;
+    }
+
+    double getNumber(const char* key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value && value->type == Number ? value->number : fallback;
+    }
+
+    const JsonValue* at(const char* key, size_t index) const {
+        const JsonValue* array = find(key);
+        return array && array->type == Array && index < array->items.size() ? &array->items[index] : nullptr;
+    }
+};
+
+class JsonParser {
+private:
+    const char* p;
+    const char* end;
+    int depth = 0;
+
+    static const int MAX_DEPTH = 64;
+
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::strlen(word);
+        if (static_cast<size_t>(end - p) < length || std::memcmp(p, word, length) != 0) return false;
+        p += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool parseString(std::string& out) {
+        if (p >= end || *p != '"') return false;
+        for (p++; p < end && *p != '"'; p++) {
+            if (*p != '\\') {
+                out += *p;
+                continue;
+            }
+            if (++p >= end) return false;
+            switch (*p) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (end - p < 5 || std::from_chars(p + 1, p + 5, code, 16).ptr != p + 5) return false;
+                appendUtf8(out, code);
+                p += 4;
+                break;
+            }
+            default: out += *p; break;  // \" \\ \/
+            }
+        }
+        if (p >= end) return false;
+        p++;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipWhitespace();
+        if (p >= end || depth > MAX_DEPTH) return false;
+        switch (*p) {
+        case '{': {
+            value.type = JsonValue::Object;
+            depth++;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == '}') {
+                p++;
+                depth--;
+                return true;
+            }
+            while (true) {
+                skipWhitespace();
+                value.keys.emplace_back();
+                if (!parseString(value.keys.back())) return false;
+                skipWhitespace();
+                if (p >= end || *p++ != ':') return false;
+                value.items.emplace_back();
+                if (!parseValue(value.items.back())) return false;
+                skipWhitespace();
+                if (p < end && *p == ',') {
+                    p++;
+                } else if (p < end && *p == '}') {
+                    p++;
+                    depth--;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+        }
+        case '[': {
+            value.type = JsonValue::Array;
+            depth++;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == ']') {
+                p++;
+                depth--;
+                return true;
+            }
+            while (true) {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back())) return false;
+                skipWhitespace();
+                if (p < end && *p == ',') {
+                    p++;
+                } else if (p < end && *p == ']') {
+                    p++;
+                    depth--;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+        }
+        case '"':
+            value.type = JsonValue::String;
+            return parseString(value.string);
+        case 't':
+            value.type = JsonValue::Bool;
+            value.boolean = true;
+            return literal("true");
+        case 'f':
+            value.type = JsonValue::Bool;
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default: {
+            value.type = JsonValue::Number;
+            std::from_chars_result result = std::from_chars(p, end, value.number);
+            if (result.ec != std::errc()) return false;
+            p = result.ptr;
+            return true;
+        }
+        }
+    }
+
+public:
+    JsonParser(const char* text, size_t size) : p(text), end(text + size) {}
+
+    bool parse(JsonValue& root) {
+        if (!parseValue(root)) return false;
+        skipWhitespace();
+        return p == end;
+    }
+};
+
+// Typed view of a glTF accessor inside the binary chunk
+struct GltfAccessor {
+    const uint8_t* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+    bool normalized = false;
+
+    static size_t componentSize(int componentType) {
+        switch (componentType) {
+        case 5120: case 5121: return 1;  // (Unsigned) byte
+        case 5122: case 5123: return 2;  // (Unsigned) short
+        case 5125: case 5126: return 4;  // Unsigned int, float
+        default: return 0;
+        }
+    }
+
+    float read(size_t index, int component) const {
+        const uint8_t* p = data + index * stride + component * componentSize(componentType);
+        switch (componentType) {
+        case 5126: {
+            float value;
+            std::memcpy(&value, p, 4);
+            return value;
+        }
+        case 5121: return normalized ? *p / 255.0f : *p;
+        case 5120: {
+            float value = static_cast<int8_t>(*p);
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case 5123: {
+            uint16_t value;
+            std::memcpy(&value, p, 2);
+            return normalized ? value / 65535.0f : value;
+        }
+        case 5122: {
+            int16_t value;
+            std::memcpy(&value, p, 2);
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        default: {
+            uint32_t value;
+            std::memcpy(&value, p, 4);
+            return static_cast<float>(value);
+        }
+        }
+    }
+
+    uint32_t readIndex(size_t index) const {
+        const uint8_t* p = data + index * stride;
+        if (componentType == 5121) return *p;
+        if (componentType == 5123) {
+            uint16_t value;
+            std::memcpy(&value, p, 2);
+            return value;
+        }
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+};
+
+static bool getAccessor(const JsonValue& root, const uint8_t* binary, size_t binarySize, const JsonValue* index,
+                        GltfAccessor& accessor) {
+    if (!index || index->type != JsonValue::Number) return false;
+    const JsonValue* json = root.at("accessors", static_cast<size_t>(index->number));
+    if (!json || json->find("sparse")) return false;
+    const JsonValue* view = root.at("bufferViews", static_cast<size_t>(json->getNumber("bufferView", -1)));
+    if (!view || view->getNumber("buffer", 0) != 0) return false;
+
+    static const char* types[] = {"SCALAR", "VEC2", "VEC3", "VEC4"};
+    const JsonValue* type = json->find("type");
+    accessor.components = 0;
+    for (int i = 0; i < 4; i++) {
+        if (type && type->string == types[i]) accessor.components = i + 1;
+    }
+    accessor.componentType = static_cast<int>(json->getNumber("componentType", 0));
+    accessor.count = static_cast<size_t>(json->getNumber("count", 0));
+    const JsonValue* normalized = json->find("normalized");
+    accessor.normalized = normalized && normalized->boolean;
+    size_t elementSize = GltfAccessor::componentSize(accessor.componentType) * accessor.components;
+    if (elementSize == 0) return false;
+
+    size_t viewOffset = static_cast<size_t>(view->getNumber("byteOffset", 0));
+    size_t viewLength = static_cast<size_t>(view->getNumber("byteLength", 0));
+    size_t offset = static_cast<size_t>(json->getNumber("byteOffset", 0));
+    accessor.stride = static_cast<size_t>(view->getNumber("byteStride", static_cast<double>(elementSize)));
+    if (viewOffset > binarySize || viewLength > binarySize - viewOffset || accessor.stride < elementSize) {
+        return false;
+    }
+    if (accessor.count > 0 && (offset > viewLength || (accessor.count - 1) * accessor.stride + elementSize >
+                                                          viewLength - offset)) {
+        return false;
+    }
+    accessor.data = binary + viewOffset + offset;
+    return true;
+}
+
+// Column-major 4x4 transforms, as glTF stores them
+static void multiplyMatrix(const float* a, const float* b, float* out) {
+    float result[16];
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[column * 4 + k];
+            result[column * 4 + row] = sum;
+        }
+    }
+    std::memcpy(out, result, sizeof(result));
+}
+
+static void nodeMatrix(const JsonValue& node, float* out) {
+    const JsonValue* matrix = node.find("matrix");
+    if (matrix && matrix->items.size() == 16) {
+        for (int i = 0; i < 16; i++) out[i] = static_cast<float>(matrix->items[i].number);
+        return;
+    }
+    float t[3] = {0.0f, 0.0f, 0.0f};
+    float r[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    float s[3] = {1.0f, 1.0f, 1.0f};
+    const JsonValue* value;
+    if ((value = node.find("translation")) && value->items.size() == 3) {
+        for (int i = 0; i < 3; i++) t[i] = static_cast<float>(value->items[i].number);
+    }
+    if ((value = node.find("rotation")) && value->items.size() == 4) {
+        for (int i = 0; i < 4; i++) r[i] = static_cast<float>(value->items[i].number);
+    }
+    if ((value = node.find("scale")) && value->items.size() == 3) {
+        for (int i = 0; i < 3; i++) s[i] = static_cast<float>(value->items[i].number);
+    }
+    float x = r[0], y = r[1], z = r[2], w = r[3];
+    float rotation[9] = {1 - 2 * (y * y + z * z), 2 * (x * y + z * w),     2 * (x * z - y * w),
+                         2 * (x * y - z * w),     1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+                         2 * (x * z + y * w),     2 * (y * z - x * w),     1 - 2 * (x * x + y * y)};
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) out[column * 4 + row] = rotation[column * 3 + row] * s[column];
+        out[column * 4 + 3] = 0.0f;
+    }
+    out[12] = t[0];
+    out[13] = t[1];
+    out[14] = t[2];
+    out[15] = 1.0f;
+}
+
+struct GltfDraw {
+    size_t mesh;
+    float matrix[16];
+};
+
+static void collectDraws(const JsonValue& root, size_t nodeIndex, const float* parent, int depth,
+                         std::vector<GltfDraw>& draws) {
+    const JsonValue* node = root.at("nodes", nodeIndex);
+    if (!node || depth > 64) return;
+    float local[16], world[16];
+    nodeMatrix(*node, local);
+    multiplyMatrix(parent, local, world);
+    if (const JsonValue* mesh = node->find("mesh")) {
+        GltfDraw draw;
+        draw.mesh = static_cast<size_t>(mesh->number);
+        std::memcpy(draw.matrix, world, sizeof(world));
+        draws.push_back(draw);
+    }
+    if (const JsonValue* children = node->find("children")) {
+        for (const JsonValue& child : children->items) {
+            collectDraws(root, static_cast<size_t>(child.number), world, depth + 1, draws);
+        }
+    }
+}
+
+struct GltfPrimitive {
+    const JsonValue* json;
+    const float* matrix;
+    GltfAccessor positions;
+    size_t firstVertex;
+    size_t firstIndex;
+    size_t indexCount;
+};
+
+bool ModelImporter::parseGlb(const uint8_t* data, size_t size, ModelData& model, ModelImportStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 12-byte header, then chunks of length, type and data: JSON first, the
+    // binary buffer second
+    uint32_t header[5];
+    if (size < sizeof(header)) {
+        std::cerr << "GLB file is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(header, data, sizeof(header));
+    if (header[0] != 0x46546C67 || header[1] != 2 || header[2] > size || header[2] < sizeof(header) ||
+        header[4] != 0x4E4F534A ||
+        header[3] > header[2] - sizeof(header)) {
+        std::cerr << "Not a glTF 2.0 binary file" << std::endl;
+        return false;
+    }
+    size = header[2];
+    const char* jsonText = reinterpret_cast<const char*>(data + sizeof(header));
+    size_t jsonSize = header[3];
+
+    const uint8_t* binary = nullptr;
+    size_t binarySize = 0;
+    size_t binaryChunk = (sizeof(header) + jsonSize + 3) & ~size_t(3);
+    if (binaryChunk + 8 <= size) {
+        uint32_t chunk[2];
+        std::memcpy(chunk, data + binaryChunk, sizeof(chunk));
+        if (chunk[1] == 0x004E4942 && chunk[0] <= size - binaryChunk - 8) {
+            binary = data + binaryChunk + 8;
+            binarySize = chunk[0];
+        }
+    }
+
+    JsonValue root;
+    if (!JsonParser(jsonText, jsonSize).parse(root) || root.type != JsonValue::Object) {
+        std::cerr << "GLB scene description is not valid JSON" << std::endl;
+        return false;
+    }
+    const JsonValue* buffer = root.at("buffers", 0);
+    if (buffer && buffer->find("uri")) {
+        std::cerr << "GLB files with external buffers are not supported" << std::endl;
+        return false;
+    }
+
+    // The default scene, or every mesh once when there is none
+    static const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    std::vector<GltfDraw> draws;
+    const JsonValue* scene = root.at("scenes", static_cast<size_t>(root.getNumber("scene", 0)));
+    if (scene) {
+        if (const JsonValue* nodes = scene->find("nodes")) {
+            for (const JsonValue& node : nodes->items) {
+                collectDraws(root, static_cast<size_t>(node.number), identity, 0, draws);
+            }
+        }
+    } else if (const JsonValue* meshes = root.find("meshes")) {
+        for (size_t i = 0; i < meshes->items.size(); i++) {
+            GltfDraw draw;
+            draw.mesh = i;
+            std::memcpy(draw.matrix, identity, sizeof(identity));
+            draws.push_back(draw);
+        }
+    }
+
+    std::vector<GltfPrimitive> primitives;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t skipped = 0;
+    for (const GltfDraw& draw : draws) {
+        const JsonValue* mesh = root.at("meshes", draw.mesh);
+        const JsonValue* list = mesh ? mesh->find("primitives") : nullptr;
+        if (!list) continue;
+        for (const JsonValue& json : list->items) {
+            if (json.getNumber("mode", 4) != 4) {
+                skipped++;
+                continue;
+            }
+            GltfPrimitive primitive;
+            primitive.json = &json;
+            primitive.matrix = draw.matrix;
+            const JsonValue* attributes = json.find("attributes");
+            if (!attributes ||
+                !getAccessor(root, binary, binarySize, attributes->find("POSITION"), primitive.positions) ||
+                primitive.positions.components != 3) {
+                std::cerr << "GLB primitive has no readable positions" << std::endl;
+                return false;
+            }
+            GltfAccessor indices;
+            const JsonValue* indexAccessor = json.find("indices");
+            if (indexAccessor && !getAccessor(root, binary, binarySize, indexAccessor, indices)) {
+                std::cerr << "GLB primitive has unreadable indices" << std::endl;
+                return false;
+            }
+            primitive.firstVertex = vertexCount;
+            primitive.firstIndex = indexCount;
+            primitive.indexCount = (indexAccessor ? indices.count : primitive.positions.count) / 3 * 3;
+            vertexCount += primitive.positions.count;
+            indexCount += primitive.indexCount;
+            primitives.push_back(primitive);
+        }
+    }
+    if (skipped > 0) std::cerr << "Skipped " << skipped << " GLB primitives that are not triangle lists" << std::endl;
+    if (indexCount == 0) {
+        std::cerr << "GLB file has no triangles" << std::endl;
+        return false;
+    }
+    if (vertexCount > UINT32_MAX) {
+        std::cerr << "GLB file is too large" << std::endl;
+        return false;
+    }
+    double parseMs = elapsedMs(start);
+
+    // Every primitive fills its own ranges
+    auto assembleStart = std::chrono::steady_clock::now();
+    model.vertices.assign(vertexCount, Vertex());
+    model.indices.assign(indexCount, 0);
+    std::atomic<bool> failed{false};
+    JobSystem::parallelFor(primitives.size(), 1, [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; p++) {
+            const GltfPrimitive& primitive = primitives[p];
+            const JsonValue& attributes = *primitive.json->find("attributes");
+            const float* m = primitive.matrix;
+            size_t count = primitive.positions.count;
+            Vertex* vertices = model.vertices.data() + primitive.firstVertex;
+            unsigned int* indices = model.indices.data() + primitive.firstIndex;
+
+            // Normals go through the inverse transpose, here the cofactors of
+            // the upper 3x3, which are that times the determinant: its size
+            // goes with the normalize, its sign is taken out below
+            float normalMatrix[9] = {m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+                                     m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+                                     m[1] * m[6] - m[2] * m[5],  m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]};
+            // Expanded along the first column (m is column-major)
+            float determinant = m[0] * normalMatrix[0] + m[1] * normalMatrix[1] + m[2] * normalMatrix[2];
+            if (determinant < 0.0f) {
+                for (float& element : normalMatrix) element = -element;
+            }
+
+            GltfAccessor normals, texCoords, colors;
+            bool hasNormals = getAccessor(root, binary, binarySize, attributes.find("NORMAL"), normals) &&
+                              normals.components == 3 && normals.count >= count;
+            bool hasTexCoords = getAccessor(root, binary, binarySize, attributes.find("TEXCOORD_0"), texCoords) &&
+                                texCoords.components == 2 && texCoords.count >= count;
+            bool hasColors = getAccessor(root, binary, binarySize, attributes.find("COLOR_0"), colors) &&
+                             colors.components >= 3 && colors.count >= count;
+
+            for (size_t i = 0; i < count; i++) {
+                Vertex& vertex = vertices[i];
+                float x = primitive.positions.read(i, 0);
+                float y = primitive.positions.read(i, 1);
+                float z = primitive.positions.read(i, 2);
+                vertex.position = Vector3(m[0] * x + m[4] * y + m[8] * z + m[12], m[1] * x + m[5] * y + m[9] * z + m[13],
+                                          m[2] * x + m[6] * y + m[10] * z + m[14]);
+                if (hasNormals) {
+                    x = normals.read(i, 0);
+                    y = normals.read(i, 1);
+                    z = normals.read(i, 2);
+                    const float* n = normalMatrix;
+                    vertex.normal = Vector3(n[0] * x + n[3] * y + n[6] * z, n[1] * x + n[4] * y + n[7] * z,
+                                            n[2] * x + n[5] * y + n[8] * z)
+                                        .normalize();
+                }
+                if (hasTexCoords) vertex.texCoords = Vector3(texCoords.read(i, 0), texCoords.read(i, 1), 0.0f);
+                vertex.color = hasColors ? Vector3(colors.read(i, 0), colors.read(i, 1), colors.read(i, 2))
+                                         : Vector3(1.0f, 1.0f, 1.0f);
+            }
+
+            GltfAccessor indexData;
+            bool indexed = getAccessor(root, binary, binarySize, primitive.json->find("indices"), indexData);
+            bool bad = false;
+            for (size_t i = 0; i < primitive.indexCount; i++) {
+                uint32_t index = indexed ? indexData.readIndex(i) : static_cast<uint32_t>(i);
+                bad |= index >= count;
+                indices[i] = index < count ? index : 0;
+            }
+            // Mirroring transforms turn the winding around
+            if (determinant < 0.0f) {
+                for (size_t i = 0; i < primitive.indexCount; i += 3) std::swap(indices[i + 1], indices[i + 2]);
+            }
+            if (!hasNormals) generateNormals(vertices, count, indices, primitive.indexCount, nullptr);
+            for (size_t i = 0; i < primitive.indexCount; i++) {
+                indices[i] += static_cast<unsigned int>(primitive.firstVertex);
+            }
+            if (bad) failed.store(true, std::memory_order_relaxed);
+        }
+    });
+    if (failed.load()) {
+        std::cerr << "GLB primitive index out of range" << std::endl;
+        return false;
+    }
+
+    if (stats) {
+        stats->bytes = size;
+        stats->chunks = primitives.size();
+        stats->corners = indexCount;
+        stats->parseMs = parseMs;
+        stats->dedupeMs = elapsedMs(assembleStart);
+        stats->totalMs = elapsedMs(start);
+    }
+    return true;
+}
+
+bool ModelImporter::load(const std::string& path, ModelData& model, ModelImportStats* stats) {
+    std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension != ".obj" && extension != ".glb") {
+        std::cerr << "Unsupported model format: " << path << std::endl;
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(path)) return false;
+    bool loaded = extension == ".obj"
+                      ? parseObj(reinterpret_cast<const char*>(file.getData()), file.getSize(), model, stats)
+                      : parseGlb(file.getData(), file.getSize(), model, stats);
+    if (!loaded) {
+        std::cerr << "Failed to import " << path << std::endl;
+        model = ModelData();
+    }
+    return loaded;
+}
+
+Mesh ModelImporter::loadMesh(const std::string& path, bool keepData) {
+    ModelData model;
+    if (!load(path, model)) return Mesh();
+    MeshOptimizer::optimize(model.vertices, model.indices);
+    return Mesh(model.vertices, model.indices, keepData);
+}
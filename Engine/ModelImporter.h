@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Indexed geometry of a whole model, all objects merged
+struct ModelData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+struct ModelImportStats {
+    size_t bytes = 0;
+    size_t chunks = 0;      // Pieces of the file parsed in parallel
+    size_t corners = 0;     // Triangle corners before deduplication
+    double parseMs = 0.0;
+    double dedupeMs = 0.0;  // Deduplication and vertex assembly
+    double totalMs = 0.0;
+};
+
+// Wavefront OBJ and binary glTF 2.0 (.glb) import on the job system.
+//
+// OBJ text is split into chunks at line boundaries and every chunk is parsed
+// by its own job with std::from_chars, straight from the mapped file. Faces
+// are fanned into triangles, and their position/uv/normal corners are
+// deduplicated into indexed vertices: corners are partitioned by hash and
+// each partition is deduplicated by a job of its own, so no step walks all
+// corners on one thread. Vertex colors ("v x y z r g b") are read, groups,
+// materials and smoothing groups are ignored.
+//
+// glTF meshes are already indexed; every triangle primitive of the default
+// scene is transformed by its node and copied by its own job. Only the
+// embedded binary buffer is supported (no external files or data URIs), as
+// are plain accessors (no sparse or compressed ones).
+//
+// Vertices without normals get smooth ones from the triangles around them,
+// and vertices without a color are white.
+class ModelImporter {
+public:
+    // By extension, .obj or .glb. False (with the reason on stderr) when the
+    // file is missing or malformed.
+    static bool load(const std::string& path, ModelData& model, ModelImportStats* stats = nullptr);
+
+    static bool parseObj(const char* text, size_t size, ModelData& model, ModelImportStats* stats = nullptr);
+    static bool parseGlb(const uint8_t* data, size_t size, ModelData& model, ModelImportStats* stats = nullptr);
+
+    // Load, optimize for the vertex cache (MeshOptimizer) and upload; an
+    // empty mesh on failure
+    static Mesh loadMesh(const std::string& path, bool keepData = true);
+};
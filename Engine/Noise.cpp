@@ -0,0 +1,251 @@
+#include "Noise.h"
+#include "Simd.h"
+#include <cmath>
+
+static float latticeNoise(int x, int y) {
+    int n = x + y * 57;
+    n = (n << 13) ^ n;
+    return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f);
+}
+
+static float smoothNoise(float x, float y) {
+    float corners = (latticeNoise(x-1, y-1) + latticeNoise(x+1, y-1) + latticeNoise(x-1, y+1) + latticeNoise(x+1, y+1)) / 16;
+    float sides = (latticeNoise(x-1, y) + latticeNoise(x+1, y) + latticeNoise(x, y-1) + latticeNoise(x, y+1)) / 8;
+    float center = latticeNoise(x, y) / 4;
+    return corners + sides + center;
+}
+
+static float interpolate(float a, float b, float x) {
+    float ft = x * 3.1415927f;
+    float f = (1 - std::cos(ft)) * 0.5f;
+    return a * (1 - f) + b * f;
+}
+
+static float interpolatedNoise(float x, float y) {
+    int integer_X = int(x);
+    float fractional_X = x - integer_X;
+    int integer_Y = int(y);
+    float fractional_Y = y - integer_Y;
+
+    float v1 = smoothNoise(integer_X, integer_Y);
+    float v2 = smoothNoise(integer_X + 1, integer_Y);
+    float v3 = smoothNoise(integer_X, integer_Y + 1);
+    float v4 = smoothNoise(integer_X + 1, integer_Y + 1);
+
+    float i1 = interpolate(v1, v2, fractional_X);
+    float i2 = interpolate(v3, v4, fractional_X);
+
+    return interpolate(i1, i2, fractional_Y);
+}
+
+float Noise::perlin(float x, float y, float persistence, int octaves) {
+    float total = 0;
+    float frequency = 1;
+    float amplitude = 1;
+    float maxValue = 0;
+
+    for(int i = 0; i < octaves; i++) {
+        total += interpolatedNoise(x * frequency, y * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= 2;
+    }
+
+    return total / maxValue;
+}
+
+float Noise::height(const NoiseParams& params, float x, float z) {
+    return perlin(x * params.frequency, z * params.frequency, params.persistence, params.octaves) * params.amplitude;
+}
+
+static void heightsScalar(const NoiseParams& params, const float* x, const float* z, float* out, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        out[i] = Noise::height(params, x[i], z[i]);
+    }
+}
+
+#if ENGINE_SIMD_X86
+
+// The interpolation weight (1 - cos(pi t)) / 2 equals sin(pi t / 2)^2; t is in
+// (-1, 1), so the Taylor series of sin up to u^11 is accurate to ~6e-8
+static const float SIN_C3 = -1.0f / 6.0f;
+static const float SIN_C5 = 1.0f / 120.0f;
+static const float SIN_C7 = -1.0f / 5040.0f;
+static const float SIN_C9 = 1.0f / 362880.0f;
+static const float SIN_C11 = -1.0f / 39916800.0f;
+
+// SSE2 has no 32-bit low multiply, combine two 32x32->64 multiplies
+static inline __m128i mulloSSE(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128 latticeNoiseSSE(__m128i x, __m128i y) {
+    __m128i n = _mm_add_epi32(x, mulloSSE(y, _mm_set1_epi32(57)));
+    n = _mm_xor_si128(_mm_slli_epi32(n, 13), n);
+    __m128i t = _mm_add_epi32(mulloSSE(mulloSSE(n, n), _mm_set1_epi32(15731)), _mm_set1_epi32(789221));
+    t = _mm_add_epi32(mulloSSE(n, t), _mm_set1_epi32(1376312589));
+    t = _mm_and_si128(t, _mm_set1_epi32(0x7fffffff));
+    return _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_cvtepi32_ps(t), _mm_set1_ps(1.0f / 1073741824.0f)));
+}
+
+static inline __m128 interpolateSSE(__m128 a, __m128 b, __m128 t) {
+    __m128 u = _mm_mul_ps(t, _mm_set1_ps(3.1415927f * 0.5f));
+    __m128 u2 = _mm_mul_ps(u, u);
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_C11), u2), _mm_set1_ps(SIN_C9));
+    s = _mm_add_ps(_mm_mul_ps(s, u2), _mm_set1_ps(SIN_C7));
+    s = _mm_add_ps(_mm_mul_ps(s, u2), _mm_set1_ps(SIN_C5));
+    s = _mm_add_ps(_mm_mul_ps(s, u2), _mm_set1_ps(SIN_C3));
+    s = _mm_add_ps(_mm_mul_ps(s, u2), _mm_set1_ps(1.0f));
+    s = _mm_mul_ps(s, u);
+    __m128 f = _mm_mul_ps(s, s);
+    return _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(_mm_set1_ps(1.0f), f)), _mm_mul_ps(b, f));
+}
+
+static void heightsSSE(const NoiseParams& params, const float* x, const float* z, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_mul_ps(_mm_loadu_ps(x + i), _mm_set1_ps(params.frequency));
+        __m128 pz = _mm_mul_ps(_mm_loadu_ps(z + i), _mm_set1_ps(params.frequency));
+
+        __m128 total = _mm_setzero_ps();
+        float frequency = 1;
+        float amplitude = 1;
+        float maxValue = 0;
+        for (int octave = 0; octave < params.octaves; octave++) {
+            __m128 fx = _mm_mul_ps(px, _mm_set1_ps(frequency));
+            __m128 fz = _mm_mul_ps(pz, _mm_set1_ps(frequency));
+            __m128i ix = _mm_cvttps_epi32(fx);
+            __m128i iz = _mm_cvttps_epi32(fz);
+            __m128 tx = _mm_sub_ps(fx, _mm_cvtepi32_ps(ix));
+            __m128 tz = _mm_sub_ps(fz, _mm_cvtepi32_ps(iz));
+
+            // The 4x4 lattice around the cell, shared by the four smoothed corners
+            __m128 h[4][4];
+            for (int b = 0; b < 4; b++) {
+                __m128i row = _mm_add_epi32(iz, _mm_set1_epi32(b - 1));
+                for (int a = 0; a < 4; a++) {
+                    h[b][a] = latticeNoiseSSE(_mm_add_epi32(ix, _mm_set1_epi32(a - 1)), row);
+                }
+            }
+
+            __m128 v[2][2];
+            for (int j = 0; j < 2; j++) {
+                for (int k = 0; k < 2; k++) {
+                    __m128 corners = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(
+                        h[j][k], h[j][k + 2]), h[j + 2][k]), h[j + 2][k + 2]), _mm_set1_ps(1.0f / 16));
+                    __m128 sides = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(
+                        h[j + 1][k], h[j + 1][k + 2]), h[j][k + 1]), h[j + 2][k + 1]), _mm_set1_ps(1.0f / 8));
+                    __m128 center = _mm_mul_ps(h[j + 1][k + 1], _mm_set1_ps(1.0f / 4));
+                    v[j][k] = _mm_add_ps(_mm_add_ps(corners, sides), center);
+                }
+            }
+
+            __m128 i1 = interpolateSSE(v[0][0], v[0][1], tx);
+            __m128 i2 = interpolateSSE(v[1][0], v[1][1], tx);
+            total = _mm_add_ps(total, _mm_mul_ps(interpolateSSE(i1, i2, tz), _mm_set1_ps(amplitude)));
+
+            maxValue += amplitude;
+            amplitude *= params.persistence;
+            frequency *= 2;
+        }
+
+        __m128 result = _mm_div_ps(total, _mm_set1_ps(maxValue));
+        _mm_storeu_ps(out + i, _mm_mul_ps(result, _mm_set1_ps(params.amplitude)));
+    }
+    heightsScalar(params, x, z, out, i, count);
+}
+
+ENGINE_TARGET_AVX2
+static inline __m256 latticeNoiseAVX2(__m256i x, __m256i y) {
+    __m256i n = _mm256_add_epi32(x, _mm256_mullo_epi32(y, _mm256_set1_epi32(57)));
+    n = _mm256_xor_si256(_mm256_slli_epi32(n, 13), n);
+    __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(n, n), _mm256_set1_epi32(15731)),
+                                 _mm256_set1_epi32(789221));
+    t = _mm256_add_epi32(_mm256_mullo_epi32(n, t), _mm256_set1_epi32(1376312589));
+    t = _mm256_and_si256(t, _mm256_set1_epi32(0x7fffffff));
+    return _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_cvtepi32_ps(t), _mm256_set1_ps(1.0f / 1073741824.0f)));
+}
+
+ENGINE_TARGET_AVX2
+static inline __m256 interpolateAVX2(__m256 a, __m256 b, __m256 t) {
+    __m256 u = _mm256_mul_ps(t, _mm256_set1_ps(3.1415927f * 0.5f));
+    __m256 u2 = _mm256_mul_ps(u, u);
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_C11), u2), _mm256_set1_ps(SIN_C9));
+    s = _mm256_add_ps(_mm256_mul_ps(s, u2), _mm256_set1_ps(SIN_C7));
+    s = _mm256_add_ps(_mm256_mul_ps(s, u2), _mm256_set1_ps(SIN_C5));
+    s = _mm256_add_ps(_mm256_mul_ps(s, u2), _mm256_set1_ps(SIN_C3));
+    s = _mm256_add_ps(_mm256_mul_ps(s, u2), _mm256_set1_ps(1.0f));
+    s = _mm256_mul_ps(s, u);
+    __m256 f = _mm256_mul_ps(s, s);
+    return _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(_mm256_set1_ps(1.0f), f)), _mm256_mul_ps(b, f));
+}
+
+ENGINE_TARGET_AVX2
+static void heightsAVX2(const NoiseParams& params, const float* x, const float* z, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_set1_ps(params.frequency));
+        __m256 pz = _mm256_mul_ps(_mm256_loadu_ps(z + i), _mm256_set1_ps(params.frequency));
+
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1;
+        float amplitude = 1;
+        float maxValue = 0;
+        for (int octave = 0; octave < params.octaves; octave++) {
+            __m256 fx = _mm256_mul_ps(px, _mm256_set1_ps(frequency));
+            __m256 fz = _mm256_mul_ps(pz, _mm256_set1_ps(frequency));
+            __m256i ix = _mm256_cvttps_epi32(fx);
+            __m256i iz = _mm256_cvttps_epi32(fz);
+            __m256 tx = _mm256_sub_ps(fx, _mm256_cvtepi32_ps(ix));
+            __m256 tz = _mm256_sub_ps(fz, _mm256_cvtepi32_ps(iz));
+
+            __m256 h[4][4];
+            for (int b = 0; b < 4; b++) {
+                __m256i row = _mm256_add_epi32(iz, _mm256_set1_epi32(b - 1));
+                for (int a = 0; a < 4; a++) {
+                    h[b][a] = latticeNoiseAVX2(_mm256_add_epi32(ix, _mm256_set1_epi32(a - 1)), row);
+                }
+            }
+
+            __m256 v[2][2];
+            for (int j = 0; j < 2; j++) {
+                for (int k = 0; k < 2; k++) {
+                    __m256 corners = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                        h[j][k], h[j][k + 2]), h[j + 2][k]), h[j + 2][k + 2]), _mm256_set1_ps(1.0f / 16));
+                    __m256 sides = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                        h[j + 1][k], h[j + 1][k + 2]), h[j][k + 1]), h[j + 2][k + 1]), _mm256_set1_ps(1.0f / 8));
+                    __m256 center = _mm256_mul_ps(h[j + 1][k + 1], _mm256_set1_ps(1.0f / 4));
+                    v[j][k] = _mm256_add_ps(_mm256_add_ps(corners, sides), center);
+                }
+            }
+
+            __m256 i1 = interpolateAVX2(v[0][0], v[0][1], tx);
+            __m256 i2 = interpolateAVX2(v[1][0], v[1][1], tx);
+            total = _mm256_add_ps(total, _mm256_mul_ps(interpolateAVX2(i1, i2, tz), _mm256_set1_ps(amplitude)));
+
+            maxValue += amplitude;
+            amplitude *= params.persistence;
+            frequency *= 2;
+        }
+
+        __m256 result = _mm256_div_ps(total, _mm256_set1_ps(maxValue));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(result, _mm256_set1_ps(params.amplitude)));
+    }
+    heightsScalar(params, x, z, out, i, count);
+}
+
+#endif
+
+void Noise::heights(const NoiseParams& params, const float* x, const float* z, float* out, size_t count) {
+#if ENGINE_SIMD_X86
+    switch (Simd::level()) {
+        case SimdLevel::AVX2: heightsAVX2(params, x, z, out, count); return;
+        case SimdLevel::SSE: heightsSSE(params, x, z, out, count); return;
+        default: break;
+    }
+#endif
+    heightsScalar(params, x, z, out, 0, count);
+}
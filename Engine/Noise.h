@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Octave noise used for the terrain: perlinNoise(x * frequency, z * frequency,
+// persistence, octaves) * amplitude
+struct NoiseParams {
+    float frequency = 0.1f;
+    float persistence = 0.5f;
+    int octaves = 4;
+    float amplitude = 5.0f;
+};
+
+class Noise {
+public:
+    // Value noise with cosine interpolation, the reference implementation
+    static float perlin(float x, float y, float persistence, int octaves);
+
+    // Terrain height at one point (scalar reference)
+    static float height(const NoiseParams& params, float x, float z);
+
+    // Terrain heights for many points. The SIMD paths share the 16 lattice
+    // hashes of each octave between the four smoothed corners (the scalar code
+    // evaluates 36) and approximate the cosine with a polynomial, so results
+    // match height() to about 1e-6.
+    static void heights(const NoiseParams& params, const float* x, const float* z, float* out, size_t count);
+};
@@ -0,0 +1,462 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Cleared depth, the far plane: nothing is hidden behind an empty pixel
+static const float EMPTY_DEPTH = 1.0f;
+
+// Triangles smaller than this many square pixels cover no pixel center worth
+// the setup
+static const float MIN_AREA = 1e-6f;
+
+static const size_t VERTEX_GRAIN = 4096;
+static const size_t TRIANGLE_GRAIN = 1024;
+
+OcclusionCuller::OcclusionCuller(int width, int height) : width(0), height(0) {
+    resize(width, height);
+}
+
+void OcclusionCuller::resize(int newWidth, int newHeight) {
+    newWidth = std::max(1, newWidth);
+    newHeight = std::max(1, newHeight);
+    if (newWidth == width && newHeight == height) return;
+
+    width = newWidth;
+    height = newHeight;
+    stride = (width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    rows = (height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    tilesX = stride / TILE_SIZE;
+    tilesY = rows / TILE_SIZE;
+    tileTriangles.assign(static_cast<size_t>(tilesX) * tilesY, std::vector<uint32_t>());
+
+    // Down to a single texel; odd sizes round up and clamp their reads
+    levels.clear();
+    levelWidth.clear();
+    levelHeight.clear();
+    int levelW = stride, levelH = rows;
+    while (true) {
+        levels.emplace_back(static_cast<size_t>(levelW) * levelH, EMPTY_DEPTH);
+        levelWidth.push_back(levelW);
+        levelHeight.push_back(levelH);
+        if (levelW == 1 && levelH == 1) break;
+        levelW = std::max(1, (levelW + 1) / 2);
+        levelH = std::max(1, (levelH + 1) / 2);
+    }
+    rendered = false;
+}
+
+void OcclusionCuller::begin(const Matrix4& matrix) {
+    viewProjection = matrix;
+    const float* m = matrix.arr;
+    for (int row = 0; row < 4; row++) {
+        rowLength[row] = std::sqrt(m[row * 4] * m[row * 4] + m[row * 4 + 1] * m[row * 4 + 1] +
+                                   m[row * 4 + 2] * m[row * 4 + 2]);
+    }
+    nearRowLength = std::sqrt((m[8] + m[12]) * (m[8] + m[12]) + (m[9] + m[13]) * (m[9] + m[13]) +
+                              (m[10] + m[14]) * (m[10] + m[14]));
+    float wLengthSquared = rowLength[3] * rowLength[3];
+    depthAlpha = wLengthSquared > 0.0f ? (m[8] * m[12] + m[9] * m[13] + m[10] * m[14]) / wLengthSquared : 0.0f;
+    float rx = m[8] - depthAlpha * m[12], ry = m[9] - depthAlpha * m[13], rz = m[10] - depthAlpha * m[14];
+    residualLength = std::sqrt(rx * rx + ry * ry + rz * rz);
+    occluders.clear();
+    stats = OcclusionStats();
+    rendered = false;
+}
+
+void OcclusionCuller::addOccluder(const float* positions, size_t vertexCount, const uint32_t* indices,
+                                  size_t indexCount) {
+    Occluder occluder;
+    occluder.positions = positions;
+    occluder.vertexCount = vertexCount;
+    occluder.indices = indices;
+    occluder.indexCount = indexCount - indexCount % 3;
+    occluder.firstVertex = occluders.empty() ? 0 : occluders.back().firstVertex + occluders.back().vertexCount;
+    occluder.firstTriangle = occluders.empty() ? 0 : occluders.back().firstTriangle + occluders.back().indexCount / 3;
+    occluders.push_back(occluder);
+    stats.occluderTriangles += occluder.indexCount / 3;
+}
+
+// Pixel coordinates, y up from the bottom row like the viewport. Leaves out
+// untouched (empty) when no pixel center is covered.
+bool OcclusionCuller::projectTriangle(const float* c0, const float* c1, const float* c2, ScreenTriangle& out) const {
+    const float* clip[3] = {c0, c1, c2};
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; i++) {
+        float invW = 1.0f / clip[i][3];
+        x[i] = (clip[i][0] * invW * 0.5f + 0.5f) * width;
+        y[i] = (clip[i][1] * invW * 0.5f + 0.5f) * height;
+        z[i] = clip[i][2] * invW;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(area) > MIN_AREA)) return false;
+    if (area < 0.0f) {
+        // Either winding occludes; make the inside positive
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    // Pixels whose centers fall in the bounds, clamped before the conversion
+    // so far off-screen vertices cannot overflow it
+    float minFx = std::max(std::min(x[0], std::min(x[1], x[2])), -1.0f);
+    float maxFx = std::min(std::max(x[0], std::max(x[1], x[2])), static_cast<float>(width) + 1.0f);
+    float minFy = std::max(std::min(y[0], std::min(y[1], y[2])), -1.0f);
+    float maxFy = std::min(std::max(y[0], std::max(y[1], y[2])), static_cast<float>(height) + 1.0f);
+    int minX = std::max(0, static_cast<int>(std::ceil(minFx - 0.5f)));
+    int maxX = std::min(width - 1, static_cast<int>(std::floor(maxFx - 0.5f)));
+    int minY = std::max(0, static_cast<int>(std::ceil(minFy - 0.5f)));
+    int maxY = std::min(height - 1, static_cast<int>(std::floor(maxFy - 0.5f)));
+    if (minX > maxX || minY > maxY) return false;
+    out.minX = minX;
+    out.maxX = maxX;
+    out.minY = minY;
+    out.maxY = maxY;
+
+    // Edge i runs from vertex i to the next; A x + B y + C >= 0 inside
+    for (int i = 0; i < 3; i++) {
+        int next = (i + 1) % 3;
+        out.edgeA[i] = y[i] - y[next];
+        out.edgeB[i] = x[next] - x[i];
+        out.edgeC[i] = -(out.edgeA[i] * x[i] + out.edgeB[i] * y[i]);
+    }
+
+    // Depth plane, pushed to the farthest it gets within half a pixel of
+    // the sample
+    out.depthX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    out.depthY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    out.depthC = z[0] - out.depthX * x[0] - out.depthY * y[0] +
+                 0.5f * (std::fabs(out.depthX) + std::fabs(out.depthY));
+    return true;
+}
+
+// Writes out[0] and out[1], the second only used when clipping the near
+// plane leaves a quad
+void OcclusionCuller::setupTriangle(const float* v0, const float* v1, const float* v2, ScreenTriangle* out) const {
+    out[0].minX = out[1].minX = 1;
+    out[0].maxX = out[1].maxX = 0;
+
+    // All three outside the same clip plane
+    for (int axis = 0; axis < 3; axis++) {
+        if (v0[axis] > v0[3] && v1[axis] > v1[3] && v2[axis] > v2[3]) return;
+        if (v0[axis] < -v0[3] && v1[axis] < -v1[3] && v2[axis] < -v2[3]) return;
+    }
+
+    const float* v[3] = {v0, v1, v2};
+    if (v0[2] >= -v0[3] && v1[2] >= -v1[3] && v2[2] >= -v2[3]) {
+        projectTriangle(v0, v1, v2, out[0]);
+        return;
+    }
+
+    // Sutherland-Hodgman against z + w >= 0; what is left has w >= near > 0
+    float polygon[4][4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const float* a = v[i];
+        const float* b = v[(i + 1) % 3];
+        float da = a[2] + a[3], db = b[2] + b[3];
+        if (da >= 0.0f) {
+            std::copy(a, a + 4, polygon[count++]);
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+            for (int c = 0; c < 4; c++) polygon[count][c] = a[c] + (b[c] - a[c]) * t;
+            count++;
+        }
+    }
+    if (count >= 3) projectTriangle(polygon[0], polygon[1], polygon[2], out[0]);
+    if (count == 4) projectTriangle(polygon[0], polygon[2], polygon[3], out[1]);
+}
+
+static void transformScalar(const float* m, const float* positions, float* clip, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float x = positions[i * 3], y = positions[i * 3 + 1], z = positions[i * 3 + 2];
+        for (int row = 0; row < 4; row++) {
+            clip[i * 4 + row] = x * m[row * 4] + y * m[row * 4 + 1] + z * m[row * 4 + 2] + m[row * 4 + 3];
+        }
+    }
+}
+
+static void rasterizeScalar(const float* edgeA, const float* edgeB, const float* edgeC, float depthX, float depthY,
+                            float depthC, float* depth, int stride, int firstX, int lastX, int firstY, int lastY) {
+    for (int y = firstY; y <= lastY; y++) {
+        float py = y + 0.5f;
+        float* row = depth + static_cast<size_t>(y) * stride;
+        for (int x = firstX; x <= lastX; x++) {
+            float px = x + 0.5f;
+            float e0 = edgeA[0] * px + edgeB[0] * py + edgeC[0];
+            float e1 = edgeA[1] * px + edgeB[1] * py + edgeC[1];
+            float e2 = edgeA[2] * px + edgeB[2] * py + edgeC[2];
+            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                float z = depthX * px + depthY * py + depthC;
+                if (z < row[x]) row[x] = z;
+            }
+        }
+    }
+}
+
+#if ENGINE_SIMD_X86
+
+// Same arithmetic in the same order as the scalar versions, so both give
+// bit-identical buffers
+static void transformSSE(const float* m, const float* positions, float* clip, size_t count) {
+    __m128 column0 = _mm_setr_ps(m[0], m[4], m[8], m[12]);
+    __m128 column1 = _mm_setr_ps(m[1], m[5], m[9], m[13]);
+    __m128 column2 = _mm_setr_ps(m[2], m[6], m[10], m[14]);
+    __m128 column3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+    for (size_t i = 0; i < count; i++) {
+        __m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(positions[i * 3]), column0),
+                                   _mm_mul_ps(_mm_set1_ps(positions[i * 3 + 1]), column1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(positions[i * 3 + 2]), column2));
+        _mm_storeu_ps(clip + i * 4, _mm_add_ps(result, column3));
+    }
+}
+
+// Four pixels of a row at a time, from the group of four holding firstX
+static void rasterizeSSE(const float* edgeA, const float* edgeB, const float* edgeC, float depthX, float depthY,
+                         float depthC, float* depth, int stride, int firstX, int lastX, int firstY, int lastY) {
+    const __m128 centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i afterFirst = _mm_set1_epi32(firstX - 1);
+    const __m128i beforeLast = _mm_set1_epi32(lastX + 1);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+    __m128 c0 = _mm_set1_ps(edgeC[0]), c1 = _mm_set1_ps(edgeC[1]), c2 = _mm_set1_ps(edgeC[2]);
+    __m128 dx = _mm_set1_ps(depthX), dc = _mm_set1_ps(depthC);
+    int groupStart = firstX & ~3;
+
+    for (int y = firstY; y <= lastY; y++) {
+        float py = y + 0.5f;
+        __m128 b0 = _mm_set1_ps(edgeB[0] * py), b1 = _mm_set1_ps(edgeB[1] * py), b2 = _mm_set1_ps(edgeB[2] * py);
+        __m128 dy = _mm_set1_ps(depthY * py);
+        float* row = depth + static_cast<size_t>(y) * stride;
+        for (int x = groupStart; x <= lastX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), centers);
+            __m128 e0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, px), b0), c0);
+            __m128 e1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a1, px), b1), c1);
+            __m128 e2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a2, px), b2), c2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                       _mm_cmpge_ps(e2, zero));
+
+            // Lanes outside [firstX, lastX] belong to the neighbouring tile or
+            // lie past the right edge
+            __m128i column = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+            __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(column, afterFirst), _mm_cmplt_epi32(column, beforeLast));
+            inside = _mm_and_ps(inside, _mm_castsi128_ps(inRange));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, px), dy), dc);
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_and_ps(inside, _mm_cmplt_ps(z, old));
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(nearer, z), _mm_andnot_ps(nearer, old)));
+        }
+    }
+}
+
+#endif
+
+void OcclusionCuller::rasterizeTile(int tile) {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, width) - 1;
+    int y1 = std::min(y0 + TILE_SIZE, height) - 1;
+
+    float* depth = levels[0].data();
+    for (int y = y0; y < y0 + TILE_SIZE; y++) {
+        std::fill(depth + static_cast<size_t>(y) * stride + x0, depth + static_cast<size_t>(y) * stride + x0 + TILE_SIZE,
+                  EMPTY_DEPTH);
+    }
+
+    bool simd = Simd::level() != SimdLevel::Scalar;
+    for (uint32_t index : tileTriangles[tile]) {
+        const ScreenTriangle& t = triangles[index];
+        int firstX = std::max(t.minX, x0), lastX = std::min(t.maxX, x1);
+        int firstY = std::max(t.minY, y0), lastY = std::min(t.maxY, y1);
+#if ENGINE_SIMD_X86
+        if (simd) {
+            rasterizeSSE(t.edgeA, t.edgeB, t.edgeC, t.depthX, t.depthY, t.depthC, depth, stride, firstX, lastX, firstY,
+                         lastY);
+            continue;
+        }
+#else
+        (void)simd;
+#endif
+        rasterizeScalar(t.edgeA, t.edgeB, t.edgeC, t.depthX, t.depthY, t.depthC, depth, stride, firstX, lastX, firstY,
+                        lastY);
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    for (size_t level = 1; level < levels.size(); level++) {
+        const std::vector<float>& below = levels[level - 1];
+        int belowWidth = levelWidth[level - 1], belowHeight = levelHeight[level - 1];
+        std::vector<float>& texels = levels[level];
+        for (int y = 0; y < levelHeight[level]; y++) {
+            const float* row0 = below.data() + static_cast<size_t>(2 * y) * belowWidth;
+            const float* row1 = below.data() + static_cast<size_t>(std::min(2 * y + 1, belowHeight - 1)) * belowWidth;
+            for (int x = 0; x < levelWidth[level]; x++) {
+                int left = 2 * x, right = std::min(2 * x + 1, belowWidth - 1);
+                texels[static_cast<size_t>(y) * levelWidth[level] + x] =
+                    std::max(std::max(row0[left], row0[right]), std::max(row1[left], row1[right]));
+            }
+        }
+    }
+}
+
+// Index of the range holding item `index`, given the first item of each
+static size_t rangeOf(const std::vector<size_t>& firsts, size_t index) {
+    return static_cast<size_t>(std::upper_bound(firsts.begin(), firsts.end(), index) - firsts.begin()) - 1;
+}
+
+void OcclusionCuller::render() {
+    auto start = std::chrono::steady_clock::now();
+    size_t vertexCount = 0, triangleCount = 0;
+    std::vector<size_t> firstVertices, firstTriangles;
+    firstVertices.reserve(occluders.size());
+    firstTriangles.reserve(occluders.size());
+    for (const Occluder& occluder : occluders) {
+        firstVertices.push_back(occluder.firstVertex);
+        firstTriangles.push_back(occluder.firstTriangle);
+        vertexCount += occluder.vertexCount;
+        triangleCount += occluder.indexCount / 3;
+    }
+    clipVertices.resize(vertexCount * 4);
+    triangles.resize(triangleCount * 2);
+    bool simd = Simd::level() != SimdLevel::Scalar;
+
+    // Clip space, in runs that stay within one occluder
+    JobSystem::parallelFor(vertexCount, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = rangeOf(firstVertices, begin); begin < end; k++) {
+            const Occluder& occluder = occluders[k];
+            size_t runEnd = std::min(end, occluder.firstVertex + occluder.vertexCount);
+            if (runEnd <= begin) continue;
+            const float* positions = occluder.positions + (begin - occluder.firstVertex) * 3;
+            float* clip = clipVertices.data() + begin * 4;
+#if ENGINE_SIMD_X86
+            if (simd) {
+                transformSSE(viewProjection.arr, positions, clip, runEnd - begin);
+                begin = runEnd;
+                continue;
+            }
+#else
+            (void)simd;
+#endif
+            transformScalar(viewProjection.arr, positions, clip, runEnd - begin);
+            begin = runEnd;
+        }
+    });
+
+    JobSystem::parallelFor(triangleCount, TRIANGLE_GRAIN, [&](size_t begin, size_t end) {
+        size_t k = rangeOf(firstTriangles, begin);
+        for (size_t i = begin; i < end; i++) {
+            while (i >= occluders[k].firstTriangle + occluders[k].indexCount / 3) k++;
+            const Occluder& occluder = occluders[k];
+            const uint32_t* corner = occluder.indices + (i - occluder.firstTriangle) * 3;
+            const float* clip = clipVertices.data() + occluder.firstVertex * 4;
+            setupTriangle(clip + corner[0] * 4, clip + corner[1] * 4, clip + corner[2] * 4, &triangles[i * 2]);
+        }
+    });
+
+    // Binned in slot order, so every tile draws its triangles in the same
+    // order however the setup was split
+    for (auto& list : tileTriangles) list.clear();
+    for (size_t slot = 0; slot < triangles.size(); slot++) {
+        const ScreenTriangle& t = triangles[slot];
+        if (t.minX > t.maxX) continue;
+        stats.rasterizedTriangles++;
+        for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++) {
+            for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++) {
+                tileTriangles[static_cast<size_t>(ty) * tilesX + tx].push_back(static_cast<uint32_t>(slot));
+            }
+        }
+    }
+
+    JobSystem::parallelFor(tileTriangles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) rasterizeTile(static_cast<int>(tile));
+    });
+    buildPyramid();
+
+    rendered = true;
+    stats.renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionCuller::isOccluded(const Vector3& min, const Vector3& max) const {
+    if (!rendered) return false;
+
+    const float* m = viewProjection.arr;
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    float nearest = 1e30f;
+    for (int corner = 0; corner < 8; corner++) {
+        float x = corner & 1 ? max.x : min.x;
+        float y = corner & 2 ? max.y : min.y;
+        float z = corner & 4 ? max.z : min.z;
+        float clipZ = m[8] * x + m[9] * y + m[10] * z + m[11];
+        float clipW = m[12] * x + m[13] * y + m[14] * z + m[15];
+        if (clipZ < -clipW) return false;
+
+        float invW = 1.0f / clipW;
+        float screenX = ((m[0] * x + m[1] * y + m[2] * z + m[3]) * invW * 0.5f + 0.5f) * width;
+        float screenY = ((m[4] * x + m[5] * y + m[6] * z + m[7]) * invW * 0.5f + 0.5f) * height;
+        minX = std::min(minX, screenX);
+        maxX = std::max(maxX, screenX);
+        minY = std::min(minY, screenY);
+        maxY = std::max(maxY, screenY);
+        nearest = std::min(nearest, clipZ * invW);
+    }
+    return isRectOccluded(minX, minY, maxX, maxY, nearest);
+}
+
+bool OcclusionCuller::isSphereOccluded(const Vector3& center, float radius) const {
+    if (!rendered) return false;
+
+    // Each clip coordinate moves at most radius * rowLength away from the
+    // center's; with the range of w known positive, the range of each ratio
+    // follows from its ends. Depth is taken as depthAlpha + residual / w, as
+    // z and w move together and bounding them apart would be far too loose.
+    const float* m = viewProjection.arr;
+    float clip[4];
+    for (int row = 0; row < 4; row++) {
+        clip[row] = m[row * 4] * center.x + m[row * 4 + 1] * center.y + m[row * 4 + 2] * center.z + m[row * 4 + 3];
+    }
+    if (clip[2] + clip[3] - radius * nearRowLength < 0.0f) return false;
+    float wLow = clip[3] - radius * rowLength[3], wHigh = clip[3] + radius * rowLength[3];
+    if (wLow <= 0.0f) return false;
+
+    auto lowest = [&](float value) { return value / (value >= 0.0f ? wHigh : wLow); };
+    auto highest = [&](float value) { return value / (value >= 0.0f ? wLow : wHigh); };
+    float xLow = clip[0] - radius * rowLength[0], xHigh = clip[0] + radius * rowLength[0];
+    float yLow = clip[1] - radius * rowLength[1], yHigh = clip[1] + radius * rowLength[1];
+    return isRectOccluded((lowest(xLow) * 0.5f + 0.5f) * width, (lowest(yLow) * 0.5f + 0.5f) * height,
+                          (highest(xHigh) * 0.5f + 0.5f) * width, (highest(yHigh) * 0.5f + 0.5f) * height,
+                          depthAlpha + lowest(clip[2] - depthAlpha * clip[3] - radius * residualLength));
+}
+
+// Screen rectangle in pixels and the nearest NDC depth of what it bounds
+bool OcclusionCuller::isRectOccluded(float minX, float minY, float maxX, float maxY, float nearest) const {
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return false;
+
+    // Every pixel the rectangle touches and one more around them: a pixel
+    // whose center an occluder covers may still show what lies beyond its
+    // edge, which the neighbour on that side holds
+    int x0 = std::max(static_cast<int>(std::max(minX, 0.0f)) - 1, 0);
+    int y0 = std::max(static_cast<int>(std::max(minY, 0.0f)) - 1, 0);
+    int x1 = std::min(static_cast<int>(std::min(maxX, static_cast<float>(width))) + 1, width - 1);
+    int y1 = std::min(static_cast<int>(std::min(maxY, static_cast<float>(height))) + 1, height - 1);
+
+    // The level where the rectangle spans at most two texels per axis
+    int extent = std::max(x1 - x0, y1 - y0) + 1;
+    size_t level = 0;
+    while ((1 << level) < extent && level + 1 < levels.size()) level++;
+
+    const std::vector<float>& texels = levels[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (texels[static_cast<size_t>(y) * levelWidth[level] + x] >= nearest) return false;
+        }
+    }
+    return true;
+}
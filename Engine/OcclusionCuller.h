@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4.h"
+
+struct OcclusionStats {
+    size_t occluderTriangles = 0;    // Submitted with addOccluder()
+    size_t rasterizedTriangles = 0;  // Left after clipping and rejecting off-screen or degenerate ones
+    double renderMs = 0.0;           // Transform, setup, rasterization and pyramid
+};
+
+// Software occlusion culling: occluder triangles are rasterized on the CPU
+// into a small depth buffer, which is reduced into a hierarchical-Z pyramid
+// of the farthest depth under each texel. A box is occluded when its nearest
+// depth lies behind every texel of the pyramid level its screen rectangle
+// covers in at most 2x2 texels.
+//
+// The buffer is cut into square tiles rasterized in parallel on the job
+// system, four pixels at a time with SSE where available. Triangles cover
+// the pixels whose centers they contain and write the farthest depth their
+// plane reaches inside those pixels, so a pixel is only ever as near as the
+// occluder gets within it. A silhouette pixel the occluder only partly
+// covers still counts as covered, so tests also read the pixels around the
+// ones a box touches; occluders are meant to sit inside what they stand for.
+//
+// Depth is OpenGL NDC depth, -1 at the near plane and 1 at the far plane.
+// Nothing is retained between frames: begin(), addOccluder() for each
+// occluder, render(), then isOccluded() from any number of threads.
+class OcclusionCuller {
+public:
+    static constexpr int TILE_SIZE = 32;
+
+    explicit OcclusionCuller(int width = 256, int height = 128);
+
+    void resize(int width, int height);
+
+    // Start a frame seen through a row-major view-projection matrix (the
+    // Camera::getViewProjectionMatrix layout). Drops the previous occluders.
+    void begin(const Matrix4& viewProjection);
+
+    // World-space xyz positions and triangle indices. The arrays are read in
+    // render(), so they must stay alive until then.
+    void addOccluder(const float* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+    // Rasterize the occluders and build the pyramid
+    void render();
+
+    // Whether everything inside the box is hidden. Boxes crossing the near
+    // plane or off screen are never occluded.
+    bool isOccluded(const Vector3& min, const Vector3& max) const;
+
+    // The same for a sphere, bounded from one transform of its center (a
+    // little looser than the box around it, and far cheaper)
+    bool isSphereOccluded(const Vector3& center, float radius) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Level 0 of the pyramid, row y of the image starts at y * getStride()
+    const float* getDepth() const { return levels.empty() ? nullptr : levels[0].data(); }
+    int getStride() const { return stride; }
+    const OcclusionStats& getStats() const { return stats; }
+
+private:
+    struct Occluder {
+        const float* positions;
+        size_t vertexCount;
+        const uint32_t* indices;
+        size_t indexCount;
+        size_t firstVertex;    // Into the clip-space vertices
+        size_t firstTriangle;  // Into the triangle slots
+    };
+
+    // Edge functions and depth plane in pixel coordinates. A triangle clipped
+    // at the near plane takes two slots, unused slots have an empty box.
+    struct ScreenTriangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthX, depthY, depthC;
+        int minX, minY, maxX, maxY;
+    };
+
+    int width, height;
+    int stride, rows;  // Rounded up to whole tiles
+    int tilesX, tilesY;
+    Matrix4 viewProjection;
+    float rowLength[4];    // Of the 3x3 part of each row: how far clip x, y, z, w move per unit
+    float nearRowLength;   // Of row 2 + row 3, for z + w
+    float depthAlpha;      // Row 2 = depthAlpha * row 3 + a residual that is constant for a perspective
+    float residualLength;  // Of the 3x3 part of that residual
+    bool rendered = false;
+
+    std::vector<Occluder> occluders;
+    std::vector<float> clipVertices;  // x, y, z, w per vertex
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<uint32_t>> tileTriangles;
+
+    // Level l is (levelWidth[l] x levelHeight[l]), level 0 the depth buffer
+    std::vector<std::vector<float>> levels;
+    std::vector<int> levelWidth, levelHeight;
+
+    OcclusionStats stats;
+
+    void setupTriangle(const float* v0, const float* v1, const float* v2, ScreenTriangle* out) const;
+    bool projectTriangle(const float* c0, const float* c1, const float* c2, ScreenTriangle& out) const;
+    void rasterizeTile(int tile);
+    bool isRectOccluded(float minX, float minY, float maxX, float maxY, float nearest) const;
+    void buildPyramid();
+};
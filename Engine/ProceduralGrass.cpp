@@ -0,0 +1,128 @@
+#include "ProceduralGrass.h"
+#include "Rendering/GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+ProceduralGrass::ProceduralGrass() {}
+
+ProceduralGrass::~ProceduralGrass() {
+    if (heightTexture) glDeleteTextures(1, &heightTexture);
+}
+
+bool ProceduralGrass::init(const ProceduralGrassSettings& settings, const HeightField& ground, const Shader& shader,
+                           const Mesh& blade) {
+    if (ground.getSamples().empty() || blade.getLods().empty() || shader.getProgram() == 0) {
+        std::cerr << "Procedural grass needs a height field, a blade mesh and its program" << std::endl;
+        return false;
+    }
+    this->settings = settings;
+    this->shader = &shader;
+    this->blade = &blade;
+
+    columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(settings.bladeCount)))));
+    int tileSide = std::max(1, std::min(settings.tileSide, columns));
+    tilesPerRow = (columns + tileSide - 1) / tileSide;
+    this->settings.tileSide = tileSide;
+    float spacing = settings.fieldSize / columns;
+
+    // Linear filtering gives the same bilinear height as HeightField::getHeight
+    if (!heightTexture) glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, ground.getWidth(), ground.getDepth(), 0, GL_RED, GL_FLOAT,
+                 ground.getSamples().data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Everything but the tile is fixed for the field
+    float fieldMin = -0.5f * settings.fieldSize;
+    shader.use();
+    shader.getIntUniform("heightMap").set(0);
+    shader.getVec3Uniform("heightMapArea").set(ground.getOriginX(), ground.getOriginZ(), ground.getSpacing());
+    shader.getVec3Uniform("grassField").set(fieldMin, fieldMin, spacing);
+    shader.getIntUniform("grassColumns").set(columns);
+    shader.getIntUniform("grassTileSide").set(tileSide);
+    shader.getIntUniform("grassTilesPerRow").set(tilesPerRow);
+    shader.getIntUniform("grassSeed").set(static_cast<int>(settings.seed));
+    tileUniform = shader.getIntUniform("grassTile");
+
+    buildTiles(ground, spacing);
+    return true;
+}
+
+// Box around every blade a tile can hold: the ground under the tile, raised
+// by the tallest blade and widened by how far a tilted, bent blade reaches
+void ProceduralGrass::buildTiles(const HeightField& ground, float spacing) {
+    const Bounds& bounds = blade->getBounds();
+    float reach = 1.2f * (bounds.center.length() + bounds.radius) + settings.windPadding;
+    float tileSize = settings.tileSide * spacing;
+    float fieldMin = -0.5f * settings.fieldSize;
+    float fieldMax = 0.5f * settings.fieldSize;
+    float sampleSpacing = ground.getSpacing();
+
+    tiles.resize(static_cast<size_t>(tilesPerRow) * tilesPerRow);
+    for (int tileZ = 0; tileZ < tilesPerRow; tileZ++) {
+        for (int tileX = 0; tileX < tilesPerRow; tileX++) {
+            float minX = fieldMin + tileX * tileSize;
+            float minZ = fieldMin + tileZ * tileSize;
+            float maxX = std::min(minX + tileSize, fieldMax);
+            float maxZ = std::min(minZ + tileSize, fieldMax);
+
+            // Samples around the tile, clamped like the texture lookup
+            int x0 = std::max(0, static_cast<int>(std::floor((minX - ground.getOriginX()) / sampleSpacing)));
+            int z0 = std::max(0, static_cast<int>(std::floor((minZ - ground.getOriginZ()) / sampleSpacing)));
+            int x1 = std::min(ground.getWidth() - 1, static_cast<int>(std::ceil((maxX - ground.getOriginX()) / sampleSpacing)));
+            int z1 = std::min(ground.getDepth() - 1, static_cast<int>(std::ceil((maxZ - ground.getOriginZ()) / sampleSpacing)));
+            x0 = std::min(x0, x1);
+            z0 = std::min(z0, z1);
+            float low = ground.getSample(x0, z0);
+            float high = low;
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++) {
+                    low = std::min(low, ground.getSample(x, z));
+                    high = std::max(high, ground.getSample(x, z));
+                }
+            }
+
+            Tile& tile = tiles[tileZ * tilesPerRow + tileX];
+            tile.min = Vector3(minX - reach, low - reach, minZ - reach);
+            tile.max = Vector3(maxX + reach, high + reach, maxZ + reach);
+            tile.blades = static_cast<size_t>(std::min(settings.tileSide, columns - tileX * settings.tileSide)) *
+                          std::min(settings.tileSide, columns - tileZ * settings.tileSide);
+        }
+    }
+}
+
+void ProceduralGrass::draw(const Frustum& frustum, const Vector3& cameraPosition, const LodSelector& lod) {
+    stats = ProceduralGrassStats();
+    if (tiles.empty()) return;
+
+    GLState::setBlend(false);
+    GLState::setDepthWrite(true);
+    GLState::setDepthFunc(GL_LESS);
+    shader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+
+    const std::vector<MeshLod>& lods = blade->getLods();
+    size_t bladesPerTile = static_cast<size_t>(settings.tileSide) * settings.tileSide;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const Tile& tile = tiles[i];
+        if (frustum.classifyBox(tile.min, tile.max) == CullResult::Outside) continue;
+
+        // Nearest point of the tile, scaled by the tallest blade
+        Vector3 nearest(std::max(tile.min.x, std::min(cameraPosition.x, tile.max.x)),
+                        std::max(tile.min.y, std::min(cameraPosition.y, tile.max.y)),
+                        std::max(tile.min.z, std::min(cameraPosition.z, tile.max.z)));
+        const MeshLod& level = lods[lod.select(lods, nearest.distance(cameraPosition), 1.2f)];
+
+        tileUniform.set(static_cast<int>(i));
+        blade->drawInstancedRange(level.firstIndex, level.indexCount, bladesPerTile);
+        stats.drawnTiles++;
+        stats.drawnBlades += tile.blades;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Vector3.h"
+#include "Mesh.h"
+#include "MeshLod.h"
+#include "Culling.h"
+#include "HeightField.h"
+#include "Rendering/GL.h"
+#include "Rendering/Shader.h"
+
+struct ProceduralGrassSettings {
+    size_t bladeCount = 1 << 20;  // Rounded up to a square field
+    float fieldSize = 80.0f;      // Side of the square field, centered on the origin
+    int tileSide = 64;            // Blades per tile side; tiles are culled and pick their detail level
+    unsigned int seed = 1;
+    float windPadding = 0.5f;     // How far wind may bend a blade out of its tile
+};
+
+struct ProceduralGrassStats {
+    size_t drawnTiles = 0;
+    size_t drawnBlades = 0;
+};
+
+// Grass with no per-blade data anywhere. The field is a grid of cells, one
+// blade per cell; basic.vert with PROCEDURAL_GRASS hashes a blade's index into
+// its offset in the cell, rotation, tilt, height, wind response and tint, and
+// reads the ground under it from the height field uploaded as a texture.
+// Memory and setup time do not depend on the number of blades.
+//
+// The field is drawn in square tiles of blades, one instanced draw each, so
+// tiles outside the frustum are skipped and distant ones use coarser levels
+// of the blade mesh. Needs a current GL context from init() on.
+class ProceduralGrass {
+public:
+    // Defines of the basic.vert / basic.frag program init() expects
+    static std::vector<std::string> shaderDefines() { return {"INSTANCED", "PROCEDURAL_GRASS"}; }
+
+    ProceduralGrass();
+    ~ProceduralGrass();
+
+    ProceduralGrass(const ProceduralGrass&) = delete;
+    ProceduralGrass& operator=(const ProceduralGrass&) = delete;
+
+    // Upload the ground and set the field's uniforms on the program. The
+    // field should lie inside the height field, which is clamped at its edges.
+    bool init(const ProceduralGrassSettings& settings, const HeightField& ground, const Shader& shader,
+              const Mesh& blade);
+
+    // Draw the tiles touching the frustum with opaque state, at the detail
+    // level lod picks for their nearest point
+    void draw(const Frustum& frustum, const Vector3& cameraPosition, const LodSelector& lod);
+
+    size_t getBladeCount() const { return static_cast<size_t>(columns) * columns; }
+    size_t getTileCount() const { return tiles.size(); }
+    const ProceduralGrassStats& getStats() const { return stats; }
+
+private:
+    struct Tile {
+        Vector3 min;
+        Vector3 max;
+        size_t blades;  // Inside the field; the last row and column of tiles may be cut
+    };
+
+    ProceduralGrassSettings settings;
+    const Shader* shader = nullptr;
+    const Mesh* blade = nullptr;
+    GLuint heightTexture = 0;
+    int columns = 0;
+    int tilesPerRow = 0;
+    std::vector<Tile> tiles;
+    UniformInt tileUniform;
+    ProceduralGrassStats stats;
+
+    void buildTiles(const HeightField& ground, float spacing);
+};
@@ -0,0 +1,281 @@
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// Timer queries of one frame; frames alternate between two of these
+struct ProfilerQuerySlot {
+    std::vector<GLuint> queries;
+    size_t used = 0;
+    uint64_t frame = 0;
+    bool pending = false;
+};
+
+struct ProfilerState {
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    size_t historySize = 300;
+    std::deque<FrameStats> history;
+
+    FrameStats current;
+    bool inFrame = false;
+    uint64_t frameNumber = 0;
+    ProfileCounters frameStart;
+    std::vector<size_t> scopeStack;  // Indices into current.scopes
+
+    bool inPass = false;
+    int ignoredPasses = 0;  // Nested passes skipped by beginPass
+    ProfileCounters passStart;
+    ProfilerQuerySlot slots[2];
+};
+
+static ProfilerState& state() {
+    static ProfilerState s;
+    return s;
+}
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+static ProfileCounters difference(const ProfileCounters& end, const ProfileCounters& start) {
+    ProfileCounters result;
+    result.drawCalls = end.drawCalls - start.drawCalls;
+    result.triangles = end.triangles - start.triangles;
+    result.uniformUploads = end.uniformUploads - start.uniformUploads;
+    result.streamBytes = end.streamBytes - start.streamBytes;
+    result.streamStalls = end.streamStalls - start.streamStalls;
+    return result;
+}
+
+// Copy finished query results into the history entry of the frame that
+// issued them. Results that are still not available are dropped.
+static void resolve(ProfilerQuerySlot& slot) {
+    if (!slot.pending) return;
+    slot.pending = false;
+
+    ProfilerState& s = state();
+    FrameStats* frame = nullptr;
+    for (auto it = s.history.rbegin(); it != s.history.rend(); ++it) {
+        if (it->frame == slot.frame) {
+            frame = &*it;
+            break;
+        }
+    }
+    if (!frame) return;
+
+    bool complete = true;
+    double total = 0.0;
+    for (size_t i = 0; i < slot.used && i < frame->passes.size(); i++) {
+        GLint available = 0;
+        glGetQueryObjectiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            complete = false;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &nanoseconds);
+        frame->passes[i].gpuMs = nanoseconds / 1.0e6;
+        total += frame->passes[i].gpuMs;
+    }
+    if (complete) frame->gpuMs = total;
+}
+
+static void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+void Profiler::setEnabled(bool enabled) {
+    ProfilerState& s = state();
+    if (!enabled && enabledFlag()) {
+        for (auto& slot : s.slots) {
+            if (!slot.queries.empty()) {
+                glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+            }
+            slot = ProfilerQuerySlot();
+        }
+        s.inFrame = false;
+        s.inPass = false;
+        s.ignoredPasses = 0;
+        s.scopeStack.clear();
+    }
+    enabledFlag() = enabled;
+}
+
+void Profiler::setHistorySize(size_t frames) {
+    ProfilerState& s = state();
+    s.historySize = frames > 0 ? frames : 1;
+    while (s.history.size() > s.historySize) s.history.pop_front();
+}
+
+void Profiler::beginFrame() {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (s.inFrame) endFrame();
+
+    // This slot was last used two frames ago
+    ProfilerQuerySlot& slot = s.slots[s.frameNumber % 2];
+    resolve(slot);
+    slot.used = 0;
+
+    s.current = FrameStats();
+    s.current.frame = s.frameNumber;
+    s.current.startMs = nowMs();
+    s.frameStart = counters();
+    s.scopeStack.clear();
+    s.inFrame = true;
+}
+
+void Profiler::endFrame() {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (!s.inFrame) return;
+
+    s.ignoredPasses = 0;
+    if (s.inPass) endPass();
+    while (!s.scopeStack.empty()) endScope();
+
+    s.current.cpuMs = nowMs() - s.current.startMs;
+    s.current.counters = difference(counters(), s.frameStart);
+    if (s.current.passes.empty()) s.current.gpuMs = 0.0;
+
+    ProfilerQuerySlot& slot = s.slots[s.frameNumber % 2];
+    slot.frame = s.current.frame;
+    slot.pending = slot.used > 0;
+
+    s.history.push_back(std::move(s.current));
+    while (s.history.size() > s.historySize) s.history.pop_front();
+
+    s.frameNumber++;
+    s.inFrame = false;
+}
+
+void Profiler::beginScope(const char* name) {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (!s.inFrame) return;
+
+    ScopeEvent scope;
+    scope.name = name;
+    scope.depth = static_cast<int>(s.scopeStack.size());
+    scope.startMs = nowMs();
+    s.scopeStack.push_back(s.current.scopes.size());
+    s.current.scopes.push_back(scope);
+}
+
+void Profiler::endScope() {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (s.scopeStack.empty()) return;
+
+    ScopeEvent& scope = s.current.scopes[s.scopeStack.back()];
+    scope.durationMs = nowMs() - scope.startMs;
+    s.scopeStack.pop_back();
+}
+
+void Profiler::beginPass(const char* name) {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (!s.inFrame) return;
+    if (s.inPass) {
+        std::cerr << "Profiler: pass '" << name << "' started inside another pass, ignored" << std::endl;
+        s.ignoredPasses++;
+        return;
+    }
+
+    beginScope(name);
+
+    PassStats pass;
+    pass.name = name;
+    pass.startMs = nowMs();
+    s.current.passes.push_back(pass);
+    s.passStart = counters();
+
+    ProfilerQuerySlot& slot = s.slots[s.frameNumber % 2];
+    if (slot.used == slot.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        slot.queries.push_back(query);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used]);
+    s.inPass = true;
+}
+
+void Profiler::endPass() {
+    if (!enabledFlag()) return;
+    ProfilerState& s = state();
+    if (!s.inPass) return;
+    if (s.ignoredPasses > 0) {
+        s.ignoredPasses--;
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    s.slots[s.frameNumber % 2].used++;
+
+    PassStats& pass = s.current.passes.back();
+    pass.cpuMs = nowMs() - pass.startMs;
+    pass.counters = difference(counters(), s.passStart);
+    endScope();
+    s.inPass = false;
+}
+
+const std::deque<FrameStats>& Profiler::getHistory() {
+    return state().history;
+}
+
+const FrameStats* Profiler::getLatestResolvedFrame() {
+    const auto& history = state().history;
+    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+        if (it->gpuMs >= 0.0) return &*it;
+    }
+    return nullptr;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open trace file: " << path << std::endl;
+        return false;
+    }
+
+    // Trace timestamps are in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    for (const auto& frame : state().history) {
+        out << ",\n{\"name\":\"Frame " << frame.frame << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+            << frame.startMs * 1000.0 << ",\"dur\":" << frame.cpuMs * 1000.0 << ",\"args\":{\"gpuMs\":"
+            << frame.gpuMs << "}}";
+        out << ",\n{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.startMs * 1000.0
+            << ",\"args\":{\"drawCalls\":" << frame.counters.drawCalls << ",\"triangles\":" << frame.counters.triangles
+            << ",\"uniformUploads\":" << frame.counters.uniformUploads << ",\"streamBytes\":"
+            << frame.counters.streamBytes << ",\"streamStalls\":" << frame.counters.streamStalls << "}}";
+
+        for (const auto& scope : frame.scopes) {
+            out << ",\n{\"name\":";
+            writeString(out, scope.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << scope.startMs * 1000.0
+                << ",\"dur\":" << scope.durationMs * 1000.0 << "}";
+        }
+
+        for (const auto& pass : frame.passes) {
+            if (pass.gpuMs < 0.0) continue;
+            out << ",\n{\"name\":";
+            writeString(out, pass.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":" << pass.startMs * 1000.0
+                << ",\"dur\":" << pass.gpuMs * 1000.0 << ",\"args\":{\"drawCalls\":" << pass.counters.drawCalls
+                << ",\"triangles\":" << pass.counters.triangles << ",\"uniformUploads\":"
+                << pass.counters.uniformUploads << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Rendering/GL.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Draw and upload counters, per pass and per frame
+struct ProfileCounters {
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+    uint32_t uniformUploads = 0;
+    uint64_t streamBytes = 0;    // Written to StreamBuffers
+    uint32_t streamStalls = 0;   // StreamBuffer waits for the GPU
+};
+
+// A GPU-timed section of the frame (skybox, terrain, grass...)
+struct PassStats {
+    const char* name = "";
+    double startMs = 0.0;
+    double cpuMs = 0.0;
+    double gpuMs = -1.0;  // -1 until the timer query result arrives
+    ProfileCounters counters;
+};
+
+// A CPU scope; depth 0 is directly inside the frame
+struct ScopeEvent {
+    const char* name = "";
+    int depth = 0;
+    double startMs = 0.0;
+    double durationMs = 0.0;
+};
+
+struct FrameStats {
+    uint64_t frame = 0;
+    double startMs = 0.0;
+    double cpuMs = 0.0;
+    double gpuMs = -1.0;  // Sum of the pass times once all have arrived
+    ProfileCounters counters;
+    std::vector<PassStats> passes;
+    std::vector<ScopeEvent> scopes;
+};
+
+// Frame instrumentation for the render loop (main thread only):
+//
+//   Profiler::beginFrame();
+//   { ProfilePass pass("Terrain"); terrain.draw(...); }
+//   { PROFILE_SCOPE("Culling"); grid.cull(...); }
+//   Profiler::endFrame();
+//
+// Scopes nest and measure CPU time. Passes are scopes that also time the GPU
+// with a GL_TIME_ELAPSED query and collect their own counters. Such queries
+// cannot nest, so passes must not either. Queries are double buffered: a
+// frame's GPU times are read two frames later, when the driver has them,
+// and are dropped rather than stalling if they are still not ready.
+//
+// While disabled every call returns after testing one flag.
+class Profiler {
+public:
+    static bool isEnabled() { return enabledFlag(); }
+    static void setEnabled(bool enabled);
+
+    // Frames kept in the rolling history (default 300)
+    static void setHistorySize(size_t frames);
+
+    static void beginFrame();
+    static void endFrame();
+
+    static void beginScope(const char* name);
+    static void endScope();
+
+    static void beginPass(const char* name);
+    static void endPass();
+
+    // Hooks for the draw and uniform paths
+    static void countDraw(uint64_t triangles) {
+        if (!enabledFlag()) return;
+        counters().drawCalls++;
+        counters().triangles += triangles;
+    }
+    static void countUniformUpload() {
+        if (!enabledFlag()) return;
+        counters().uniformUploads++;
+    }
+    static void countStreamWrite(uint64_t bytes) {
+        if (!enabledFlag()) return;
+        counters().streamBytes += bytes;
+    }
+    static void countStreamStall() {
+        if (!enabledFlag()) return;
+        counters().streamStalls++;
+    }
+
+    // Completed frames, oldest first. GPU times of the newest two frames may
+    // still be pending (-1).
+    static const std::deque<FrameStats>& getHistory();
+
+    // Newest frame whose GPU times have all arrived, or nullptr
+    static const FrameStats* getLatestResolvedFrame();
+
+    // Write the history as Chrome trace JSON (chrome://tracing, Perfetto).
+    // CPU scopes go on one track, GPU passes on another, aligned to the CPU
+    // start of their pass since elapsed-time queries carry no timestamp.
+    static bool exportChromeTrace(const std::string& path);
+
+private:
+    static bool& enabledFlag() {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    // Running totals since the profiler was enabled; passes and frames keep
+    // the difference between their begin and end
+    static ProfileCounters& counters() {
+        static ProfileCounters totals;
+        return totals;
+    }
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : active(Profiler::isEnabled()) {
+        if (active) Profiler::beginScope(name);
+    }
+    ~ProfileScope() {
+        if (active) Profiler::endScope();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+class ProfilePass {
+public:
+    explicit ProfilePass(const char* name) : active(Profiler::isEnabled()) {
+        if (active) Profiler::beginPass(name);
+    }
+    ~ProfilePass() {
+        if (active) Profiler::endPass();
+    }
+
+    ProfilePass(const ProfilePass&) = delete;
+    ProfilePass& operator=(const ProfilePass&) = delete;
+
+private:
+    bool active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
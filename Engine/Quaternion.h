@@ -0,0 +1,54 @@
+#include <cmath>
+#include "Vector3.h"
+
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+// Rotation as a unit quaternion, the rotation part of a local transform
+class Quaternion {
+public: float x, y, z, w;
+        Quaternion() {
+            x = 0;
+            y = 0;
+            z = 0;
+            w = 1;
+        }
+
+        Quaternion(float xCord, float yCord, float zCord, float wCord) {
+            x = xCord;
+            y = yCord;
+            z = zCord;
+            w = wCord;
+        }
+
+        // Same convention as Matrix4::axisRotation, axis is normalized here
+        static Quaternion axisRotation(float angle, const Vector3& axis) {
+            Vector3 a = axis.normalize();
+            float s = sin(angle * 0.5f);
+            return Quaternion(a.x * s, a.y * s, a.z * s, cos(angle * 0.5f));
+        }
+
+        // Rotation by other first, then by this
+        Quaternion operator*(const Quaternion& other) const {
+            return Quaternion(w * other.x + x * other.w + y * other.z - z * other.y,
+                              w * other.y - x * other.z + y * other.w + z * other.x,
+                              w * other.z + x * other.y - y * other.x + z * other.w,
+                              w * other.w - x * other.x - y * other.y - z * other.z);
+        }
+
+        Quaternion normalize() const {
+            float len = sqrt(x * x + y * y + z * z + w * w);
+            if (len <= 0) return Quaternion();
+            return Quaternion(x / len, y / len, z / len, w / len);
+        }
+
+        bool operator==(const Quaternion& other) const {
+            return x == other.x && y == other.y && z == other.z && w == other.w;
+        }
+
+        bool operator!=(const Quaternion& other) const {
+            return !this->operator==(other);
+        }
+};
+
+#endif
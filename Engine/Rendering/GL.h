@@ -0,0 +1,38 @@
+#pragma once
+
+// OpenGL 3.3 core declarations for every platform the engine builds on.
+// macOS ships them in the OpenGL framework; elsewhere the Khronos core
+// profile header is used and the functions come from libGL (Mesa or the
+// vendor driver), which exports the whole core API.
+#if defined(__APPLE__)
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl3.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/glcorearb.h>
+#endif
+
+// Entry points newer than 4.1 are only declared by the Khronos header (macOS
+// stops at 4.1). Whether the context actually supports them is a runtime
+// question, see GLCapabilities.
+#if defined(GL_VERSION_4_3)
+#define ENGINE_GL_MULTI_DRAW_INDIRECT 1
+#else
+#define ENGINE_GL_MULTI_DRAW_INDIRECT 0
+#endif
+
+#if defined(GL_VERSION_4_4)
+#define ENGINE_GL_BUFFER_STORAGE 1
+#else
+#define ENGINE_GL_BUFFER_STORAGE 0
+#endif
+
+// KHR_parallel_shader_compile is an extension everywhere; the Khronos header
+// declares it, macOS does not have it
+#if defined(GL_KHR_parallel_shader_compile)
+#define ENGINE_GL_PARALLEL_SHADER_COMPILE 1
+#else
+#define ENGINE_GL_PARALLEL_SHADER_COMPILE 0
+#endif
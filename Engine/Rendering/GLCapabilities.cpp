@@ -0,0 +1,45 @@
+#include "GLCapabilities.h"
+#include <cstring>
+
+static bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+void GLCapabilities::detect() {
+    GLCapabilities& caps = current();
+    caps = GLCapabilities();
+    glGetIntegerv(GL_MAJOR_VERSION, &caps.majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &caps.minorVersion);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &caps.uniformBufferOffsetAlignment);
+
+    bool version43 = caps.majorVersion > 4 || (caps.majorVersion == 4 && caps.minorVersion >= 3);
+    caps.multiDrawIndirect = ENGINE_GL_MULTI_DRAW_INDIRECT &&
+        (version43 || (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_base_instance")));
+
+    bool version44 = caps.majorVersion > 4 || (caps.majorVersion == 4 && caps.minorVersion >= 4);
+    caps.bufferStorage = ENGINE_GL_BUFFER_STORAGE && (version44 || hasExtension("GL_ARB_buffer_storage"));
+
+    bool version41 = caps.majorVersion > 4 || (caps.majorVersion == 4 && caps.minorVersion >= 1);
+    if (version41 || hasExtension("GL_ARB_get_program_binary")) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        caps.programBinary = formats > 0;
+    }
+
+#if ENGINE_GL_PARALLEL_SHADER_COMPILE
+    // 0xffffffff = as many threads as the implementation wants
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+        glMaxShaderCompilerThreadsKHR(0xffffffffu);
+        caps.parallelShaderCompile = true;
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+        glMaxShaderCompilerThreadsARB(0xffffffffu);
+        caps.parallelShaderCompile = true;
+    }
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "GL.h"
+
+// Optional features of the current context. The engine only requires 3.3
+// core; faster paths check here and fall back when a feature is missing.
+struct GLCapabilities {
+    int majorVersion = 0;
+    int minorVersion = 0;
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the strictest offset alignment a
+    // buffer range binding needs (256 on most desktop drivers)
+    int uniformBufferOffsetAlignment = 0;
+
+    // glMultiDrawElementsIndirect with per-command base instance (4.3, or
+    // ARB_multi_draw_indirect + ARB_base_instance), compiled in as well
+    bool multiDrawIndirect = false;
+
+    // glGetProgramBinary / glProgramBinary with at least one binary format
+    // (4.1 or ARB_get_program_binary); macOS reports none
+    bool programBinary = false;
+
+    // glBufferStorage with persistent, coherent mappings (4.4 or
+    // ARB_buffer_storage), compiled in as well
+    bool bufferStorage = false;
+
+    // Compiles and links run on driver threads, GL_COMPLETION_STATUS_KHR
+    // polls them without blocking (KHR or ARB_parallel_shader_compile)
+    bool parallelShaderCompile = false;
+
+    // Read the current context; Window and HeadlessContext call this once the
+    // context is current. Also lets the driver pick its number of compiler
+    // threads when it supports parallel compilation.
+    static void detect();
+
+    static const GLCapabilities& get() { return current(); }
+
+private:
+    static GLCapabilities& current() {
+        static GLCapabilities capabilities;
+        return capabilities;
+    }
+};
@@ -0,0 +1,100 @@
+#include "GLState.h"
+
+// -1 (or an impossible enum) means unknown, so the next set always goes through
+struct GLStateShadow {
+    int64_t program = -1;
+    int64_t vertexArray = -1;
+    int blend = -1;
+    GLenum blendSource = GL_NONE;
+    GLenum blendDestination = GL_NONE;
+    int depthTest = -1;
+    int depthWrite = -1;
+    GLenum depthFunc = GL_NONE;
+    GLStateStats stats;
+};
+
+static GLStateShadow& shadow() {
+    static GLStateShadow s;
+    return s;
+}
+
+// True if value differs from the shadow, which is then updated
+template <typename T, typename U>
+static bool change(T& current, U value) {
+    GLStateShadow& s = shadow();
+    if (current == static_cast<T>(value)) {
+        s.stats.skipped++;
+        return false;
+    }
+    current = static_cast<T>(value);
+    s.stats.changes++;
+    return true;
+}
+
+void GLState::useProgram(GLuint program) {
+    if (change(shadow().program, program)) glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+    if (change(shadow().vertexArray, vertexArray)) glBindVertexArray(vertexArray);
+}
+
+void GLState::setBlend(bool enabled) {
+    if (!change(shadow().blend, enabled ? 1 : 0)) return;
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+void GLState::setBlendFunc(GLenum source, GLenum destination) {
+    GLStateShadow& s = shadow();
+    if (s.blendSource == source && s.blendDestination == destination) {
+        s.stats.skipped++;
+        return;
+    }
+    s.blendSource = source;
+    s.blendDestination = destination;
+    s.stats.changes++;
+    glBlendFunc(source, destination);
+}
+
+void GLState::setDepthTest(bool enabled) {
+    if (!change(shadow().depthTest, enabled ? 1 : 0)) return;
+    if (enabled) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void GLState::setDepthWrite(bool enabled) {
+    if (change(shadow().depthWrite, enabled ? 1 : 0)) glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::setDepthFunc(GLenum func) {
+    if (change(shadow().depthFunc, func)) glDepthFunc(func);
+}
+
+void GLState::forgetProgram(GLuint program) {
+    if (shadow().program == program) shadow().program = -1;
+}
+
+void GLState::forgetVertexArray(GLuint vertexArray) {
+    if (shadow().vertexArray == vertexArray) shadow().vertexArray = -1;
+}
+
+void GLState::invalidate() {
+    GLStateStats stats = shadow().stats;
+    shadow() = GLStateShadow();
+    shadow().stats = stats;
+}
+
+const GLStateStats& GLState::getStats() {
+    return shadow().stats;
+}
+
+void GLState::resetStats() {
+    shadow().stats = GLStateStats();
+}
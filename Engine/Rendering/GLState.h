@@ -0,0 +1,35 @@
+#pragma once
+
+#include "GL.h"
+#include <cstdint>
+
+struct GLStateStats {
+    uint64_t changes = 0;  // Calls that reached the driver
+    uint64_t skipped = 0;  // Calls that matched the shadow copy and were dropped
+};
+
+// Shadow copy of the GL state that changes between draws. Setting a value the
+// shadow already holds returns without a driver call. Code that changes this
+// state directly must call invalidate() afterwards, or the shadow goes stale.
+// One context per process, main thread only, like the rest of the renderer.
+class GLState {
+public:
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+    static void setBlend(bool enabled);
+    static void setBlendFunc(GLenum source, GLenum destination);
+    static void setDepthTest(bool enabled);
+    static void setDepthWrite(bool enabled);
+    static void setDepthFunc(GLenum func);
+
+    // Call before deleting a program or vertex array: GL reuses names, and a
+    // new object with the same name must not be mistaken for the bound one
+    static void forgetProgram(GLuint program);
+    static void forgetVertexArray(GLuint vertexArray);
+
+    // Mark everything unknown, e.g. when a new context becomes current
+    static void invalidate();
+
+    static const GLStateStats& getStats();
+    static void resetStats();
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GL.h"
+
+// OpenGL 3.3 core context without a display, for benchmarks and CI machines
+// with no X server or GPU (Mesa llvmpipe works). Rendering goes to an
+// offscreen framebuffer of the given size that stays bound, so code written
+// against Window draws the same way:
+//
+//   HeadlessContext context(1280, 720);
+//   if (!context.init()) return -1;
+//   context.clear();
+//   scene.render(...);
+//   context.finish();
+//
+// Built on EGL; only available where CMake found it (ENGINE_HEADLESS).
+class HeadlessContext {
+private:
+    int width;
+    int height;
+    void* display;  // EGLDisplay, EGL types stay out of the header
+    void* context;
+    void* surface;  // Only used when the driver cannot go surfaceless
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+
+    bool createFramebuffer();
+
+public:
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool init();
+    void clear();
+
+    // Wait until the GPU has finished everything submitted so far, the
+    // offscreen equivalent of presenting a frame
+    void finish();
+
+    // RGBA8 pixels of the framebuffer, bottom row first
+    void readPixels(unsigned char* out) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
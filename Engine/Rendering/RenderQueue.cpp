@@ -0,0 +1,410 @@
+#include "RenderQueue.h"
+#include "GLCapabilities.h"
+#include "GLState.h"
+#include "../Profiler.h"
+#include "../Culling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// The top 16 bits of a non-negative float keep its order: 8 exponent bits and
+// 7 mantissa bits, about 1% steps at any distance
+static uint16_t quantizeDepth(float depth) {
+    uint32_t bits;
+    depth = std::max(depth, 0.0f);
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return static_cast<uint16_t>(bits >> 15);
+}
+
+// out = a * b for column-major 4x4 matrices
+static void multiplyColumnMajor(const float* a, const float* b, float* out) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[column * 4 + k];
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+RenderQueue::RenderQueue() : multiDraw(GLCapabilities::get().multiDrawIndirect) {
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+void RenderQueue::setMultiDraw(bool enabled) {
+    multiDraw = enabled && GLCapabilities::get().multiDrawIndirect;
+}
+
+uint8_t RenderQueue::addPass(const char* name, PassOrder order) {
+    passes.push_back({name, order});
+    return static_cast<uint8_t>(passes.size() - 1);
+}
+
+uint16_t RenderQueue::addMaterial(const RenderMaterial& material) {
+    MaterialEntry entry;
+    entry.material = material;
+
+    // Materials sharing a program share a shader id, so they sort together
+    const Shader* program = material.instancedShader ? material.instancedShader : material.shader;
+    auto found = std::find(shaders.begin(), shaders.end(), program);
+    entry.shaderId = static_cast<uint16_t>(found - shaders.begin());
+    if (found == shaders.end()) shaders.push_back(program);
+
+    if (material.shader) {
+        entry.modelUniform = material.shader->getMat4Uniform("model");
+        entry.transformUniform = material.shader->getMat4Uniform("transform");
+    }
+    materials.push_back(entry);
+    return static_cast<uint16_t>(materials.size() - 1);
+}
+
+void RenderQueue::begin(const float* viewProjection, const Vector3& viewPosition) {
+    std::memcpy(this->viewProjection, viewProjection, sizeof(this->viewProjection));
+    this->viewPosition = viewPosition;
+    items.clear();
+    instances.clear();
+    keys.clear();
+    meshIds.clear();
+    stats = RenderQueueStats();
+    stream.beginFrame();
+}
+
+uint16_t RenderQueue::meshId(const Mesh& mesh, size_t firstIndex) {
+    // User-space pointers fit in 48 bits. A collision only costs a merge, the
+    // batches compare the actual mesh and range.
+    uint64_t identity = reinterpret_cast<uintptr_t>(&mesh) ^ (static_cast<uint64_t>(firstIndex) << 48);
+    auto inserted = meshIds.emplace(identity, static_cast<uint16_t>(std::min<size_t>(meshIds.size(), 0xffff)));
+    return inserted.first->second;
+}
+
+void RenderQueue::addItem(uint8_t pass, uint16_t material, const Mesh& mesh, size_t firstIndex, size_t indexCount,
+                          size_t firstInstance, size_t instanceCount, float depth) {
+    Item item;
+    item.mesh = &mesh;
+    item.firstIndex = static_cast<uint32_t>(firstIndex);
+    item.indexCount = static_cast<uint32_t>(indexCount);
+    item.firstInstance = static_cast<uint32_t>(firstInstance);
+    item.instanceCount = static_cast<uint32_t>(instanceCount);
+    item.material = material;
+    item.pass = pass;
+
+    uint64_t shaderBits = materials[material].shaderId & 0xfff;
+    uint64_t materialBits = material & 0xfff;
+    uint64_t meshBits = meshId(mesh, firstIndex);
+    uint64_t depthBits = quantizeDepth(depth);
+
+    uint64_t key = static_cast<uint64_t>(pass) << 56;
+    if (passes[pass].order == PassOrder::BackToFront) {
+        key |= (0xffff - depthBits) << 40 | shaderBits << 28 | materialBits << 16 | meshBits;
+    } else {
+        key |= shaderBits << 44 | materialBits << 32 | meshBits << 16 | depthBits;
+    }
+
+    keys.emplace_back(key, static_cast<uint32_t>(items.size()));
+    items.push_back(item);
+    stats.items++;
+    stats.instances += instanceCount;
+}
+
+size_t RenderQueue::selectLod(const Mesh& mesh, const InstanceData& instance, const LodSelector& lod) const {
+    const std::vector<MeshLod>& lods = mesh.getLods();
+    if (lods.size() < 2) return 0;
+
+    Vector3 center;
+    float radius;
+    transformBounds(mesh.getBounds(), instance.transform, center, radius);
+    float distance = std::max(0.0f, center.distance(viewPosition) - radius);
+    float scale = mesh.getBounds().radius > 0.0f ? radius / mesh.getBounds().radius : 1.0f;
+    return lod.select(lods, distance, scale);
+}
+
+void RenderQueue::submit(uint8_t pass, uint16_t material, const Mesh& mesh, const InstanceData& instance) {
+    if (mesh.getLods().empty()) return;
+    const MeshLod& full = mesh.getLods()[0];
+    submitRange(pass, material, mesh, full.firstIndex, full.indexCount, instance);
+}
+
+void RenderQueue::submitLod(uint8_t pass, uint16_t material, const Mesh& mesh, const InstanceData& instance,
+                            const LodSelector& lod) {
+    if (mesh.getLods().empty()) return;
+    const MeshLod& level = mesh.getLods()[selectLod(mesh, instance, lod)];
+    submitRange(pass, material, mesh, level.firstIndex, level.indexCount, instance);
+}
+
+void RenderQueue::submitRange(uint8_t pass, uint16_t material, const Mesh& mesh,
+                              size_t firstIndex, size_t indexCount, const InstanceData& instance) {
+    if (indexCount == 0) return;
+
+    float dx = instance.transform[12] - viewPosition.x;
+    float dy = instance.transform[13] - viewPosition.y;
+    float dz = instance.transform[14] - viewPosition.z;
+    float depth = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    addItem(pass, material, mesh, firstIndex, indexCount, instances.size(), 1, depth);
+    instances.push_back(instance);
+}
+
+void RenderQueue::submitInstances(uint8_t pass, uint16_t material, const Mesh& mesh,
+                                  const InstanceData* source, const uint32_t* ids, size_t count) {
+    if (count == 0 || mesh.getLods().empty()) return;
+
+    size_t first = instances.size();
+    instances.resize(first + count);
+    for (size_t i = 0; i < count; i++) {
+        instances[first + i] = source[ids[i]];
+    }
+    const MeshLod& full = mesh.getLods()[0];
+    addItem(pass, material, mesh, full.firstIndex, full.indexCount, first, count, 0.0f);
+}
+
+void RenderQueue::submitInstances(uint8_t pass, uint16_t material, const Mesh& mesh, const InstanceData* source,
+                                  const uint32_t* ids, size_t count, const LodSelector& lod) {
+    const std::vector<MeshLod>& lods = mesh.getLods();
+    if (lods.size() < 2) {
+        submitInstances(pass, material, mesh, source, ids, count);
+        return;
+    }
+
+    // Count the instances of every level, then gather them level by level
+    // so each level is one contiguous item
+    instanceLods.resize(count);
+    lodCounts.assign(lods.size(), 0);
+    for (size_t i = 0; i < count; i++) {
+        instanceLods[i] = static_cast<uint8_t>(selectLod(mesh, source[ids[i]], lod));
+        lodCounts[instanceLods[i]]++;
+    }
+
+    size_t first = instances.size();
+    instances.resize(first + count);
+    lodOffsets.resize(lods.size());
+    for (size_t level = 0, offset = first; level < lods.size(); level++) {
+        lodOffsets[level] = static_cast<uint32_t>(offset);
+        offset += lodCounts[level];
+    }
+    for (size_t i = 0; i < count; i++) {
+        instances[lodOffsets[instanceLods[i]]++] = source[ids[i]];
+    }
+
+    for (size_t level = 0, offset = first; level < lods.size(); level++) {
+        if (lodCounts[level] == 0) continue;
+        addItem(pass, material, mesh, lods[level].firstIndex, lods[level].indexCount, offset, lodCounts[level], 0.0f);
+        offset += lodCounts[level];
+    }
+}
+
+// Merge runs of sorted items with the same mesh range and material. A run
+// whose instances already sit next to each other is drawn in place, other
+// runs are copied to the end of the instance array.
+void RenderQueue::buildBatches() {
+    batches.clear();
+
+    size_t start = 0;
+    while (start < keys.size()) {
+        const Item& first = items[keys[start].second];
+        size_t end = start + 1;
+        bool contiguous = true;
+        uint32_t nextInstance = first.firstInstance + first.instanceCount;
+        while (end < keys.size()) {
+            const Item& item = items[keys[end].second];
+            if (item.pass != first.pass || item.material != first.material || item.mesh != first.mesh ||
+                item.firstIndex != first.firstIndex || item.indexCount != first.indexCount) {
+                break;
+            }
+            contiguous = contiguous && item.firstInstance == nextInstance;
+            nextInstance = item.firstInstance + item.instanceCount;
+            end++;
+        }
+
+        Batch batch;
+        batch.item = keys[start].second;
+        if (contiguous) {
+            batch.firstInstance = first.firstInstance;
+            batch.instanceCount = nextInstance - first.firstInstance;
+        } else {
+            batch.firstInstance = static_cast<uint32_t>(instances.size());
+            for (size_t i = start; i < end; i++) {
+                const Item& item = items[keys[i].second];
+                // Copy before appending, the array may reallocate
+                for (uint32_t j = 0; j < item.instanceCount; j++) {
+                    InstanceData instance = instances[item.firstInstance + j];
+                    instances.push_back(instance);
+                }
+            }
+            batch.instanceCount = static_cast<uint32_t>(instances.size() - batch.firstInstance);
+        }
+        batches.push_back(batch);
+        start = end;
+    }
+}
+
+bool RenderQueue::drawsInstanced(const Batch& batch) const {
+    const RenderMaterial& material = materials[items[batch.item].material].material;
+    if (!material.instancedShader) return false;
+    // Single instances take the uniform path when the material has one, except
+    // under multi-draw where they cost nothing extra as another command
+    return multiDraw || !material.shader || batch.instanceCount > 1;
+}
+
+bool RenderQueue::canShareMultiDraw(const Batch& first, const Batch& next) const {
+    const Item& a = items[first.item];
+    const Item& b = items[next.item];
+    if (a.pass != b.pass || a.mesh->getArena() != b.mesh->getArena()) return false;
+    // One call has one index type
+    if (a.mesh->getAllocation().indexType != b.mesh->getAllocation().indexType) return false;
+    if (!drawsInstanced(next)) return false;
+
+    const RenderMaterial& x = materials[a.material].material;
+    const RenderMaterial& y = materials[b.material].material;
+    return x.instancedShader == y.instancedShader && x.blend == y.blend &&
+           x.depthWrite == y.depthWrite && x.depthFunc == y.depthFunc;
+}
+
+// Split the batches into driver calls and collect the indirect commands
+void RenderQueue::buildSubmissions() {
+    submissions.clear();
+    commands.clear();
+
+    size_t start = 0;
+    while (start < batches.size()) {
+        if (!multiDraw || !drawsInstanced(batches[start])) {
+            submissions.push_back({start, 1, NO_COMMANDS});
+            start++;
+            continue;
+        }
+
+        size_t end = start + 1;
+        while (end < batches.size() && canShareMultiDraw(batches[start], batches[end])) end++;
+
+        submissions.push_back({start, end - start, commands.size()});
+        for (size_t i = start; i < end; i++) {
+            const Item& item = items[batches[i].item];
+            const MeshAllocation& allocation = item.mesh->getAllocation();
+            DrawElementsIndirectCommand command;
+            command.count = item.indexCount;
+            command.instanceCount = batches[i].instanceCount;
+            command.firstIndex = allocation.firstIndex + item.firstIndex;
+            command.baseVertex = static_cast<GLint>(allocation.firstVertex);
+            command.baseInstance = batches[i].firstInstance;
+            commands.push_back(command);
+        }
+        start = end;
+    }
+}
+
+void RenderQueue::applyMaterialState(const RenderMaterial& material) {
+    GLState::setBlend(material.blend);
+    if (material.blend) GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setDepthWrite(material.depthWrite);
+    GLState::setDepthFunc(material.depthFunc);
+}
+
+void RenderQueue::bindInstanceAttributes(const MeshArena* arena, size_t firstInstance,
+                                         std::vector<const MeshArena*>& instancedArenas) {
+    arena->bind();
+    InstanceBuffer::bindAttributes(instanceData.buffer, instanceData.offset + firstInstance * sizeof(InstanceData));
+    if (std::find(instancedArenas.begin(), instancedArenas.end(), arena) == instancedArenas.end()) {
+        instancedArenas.push_back(arena);
+    }
+}
+
+void RenderQueue::drawBatch(const Batch& batch, std::vector<const MeshArena*>& instancedArenas) {
+    const Item& item = items[batch.item];
+    const MaterialEntry& entry = materials[item.material];
+    const RenderMaterial& material = entry.material;
+    applyMaterialState(material);
+
+    if (!drawsInstanced(batch)) {
+        if (!material.shader) return;
+        material.shader->use();
+        float transform[16];
+        for (uint32_t i = 0; i < batch.instanceCount; i++) {
+            const InstanceData& instance = instances[batch.firstInstance + i];
+            multiplyColumnMajor(viewProjection, instance.transform, transform);
+            entry.modelUniform.set(instance.transform);
+            entry.transformUniform.set(transform);
+            item.mesh->drawRange(item.firstIndex, item.indexCount);
+        }
+        stats.drawCalls += batch.instanceCount;
+        return;
+    }
+
+    material.instancedShader->use();
+    bindInstanceAttributes(item.mesh->getArena(), batch.firstInstance, instancedArenas);
+    item.mesh->drawInstancedRange(item.firstIndex, item.indexCount, batch.instanceCount);
+    stats.drawCalls++;
+}
+
+void RenderQueue::drawMultiple(const Submission& submission, std::vector<const MeshArena*>& instancedArenas) {
+#if ENGINE_GL_MULTI_DRAW_INDIRECT
+    const Item& first = items[batches[submission.firstBatch].item];
+    const RenderMaterial& material = materials[first.material].material;
+    applyMaterialState(material);
+    material.instancedShader->use();
+
+    // Base instances are absolute, so the attributes start at instance 0
+    bindInstanceAttributes(first.mesh->getArena(), 0, instancedArenas);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, first.mesh->getAllocation().indexType,
+                                (void*)(commandData.offset + submission.firstCommand * sizeof(DrawElementsIndirectCommand)),
+                                static_cast<GLsizei>(submission.batchCount), 0);
+
+    uint64_t triangles = 0;
+    for (size_t i = 0; i < submission.batchCount; i++) {
+        const DrawElementsIndirectCommand& command = commands[submission.firstCommand + i];
+        triangles += static_cast<uint64_t>(command.count / 3) * command.instanceCount;
+    }
+    Profiler::countDraw(triangles);
+    stats.drawCalls++;
+#else
+    (void)submission;
+    (void)instancedArenas;
+#endif
+}
+
+void RenderQueue::flush() {
+    if (keys.empty()) return;
+
+    // Ties keep submission order, so equal frames draw identically
+    std::sort(keys.begin(), keys.end());
+    buildBatches();
+    buildSubmissions();
+    stats.batches = batches.size();
+
+    instanceData = stream.allocate(instances.size() * sizeof(InstanceData));
+    std::memcpy(instanceData.data, instances.data(), instanceData.size);
+    if (!commands.empty()) {
+        commandData = stream.allocate(commands.size() * sizeof(DrawElementsIndirectCommand));
+        std::memcpy(commandData.data, commands.data(), commandData.size);
+    }
+    stream.commit();
+    if (!commands.empty()) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandData.buffer);
+
+    std::vector<const MeshArena*> instancedArenas;
+    int currentPass = -1;
+    for (const Submission& submission : submissions) {
+        const Item& item = items[batches[submission.firstBatch].item];
+        if (item.pass != currentPass) {
+            if (currentPass >= 0) Profiler::endPass();
+            currentPass = item.pass;
+            Profiler::beginPass(passes[currentPass].name);
+        }
+        if (submission.firstCommand == NO_COMMANDS) {
+            drawBatch(batches[submission.firstBatch], instancedArenas);
+        } else {
+            drawMultiple(submission, instancedArenas);
+        }
+    }
+    if (currentPass >= 0) Profiler::endPass();
+
+    if (!commands.empty()) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // Instance attributes were left on between batches; turn them off so
+    // plain draws from these arenas do not read stale instance data
+    for (const MeshArena* arena : instancedArenas) {
+        arena->bind();
+        InstanceBuffer::unbindAttributes();
+    }
+
+    keys.clear();
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "GL.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Shader.h"
+#include "StreamBuffer.h"
+#include "../Mesh.h"
+#include "../InstanceBuffer.h"
+#include "../Vector3.h"
+
+// How the draws of a pass are ordered
+enum class PassOrder {
+    StateFirst,   // Group by shader, material and mesh, then front to back (opaque)
+    BackToFront   // Farthest first, state only breaks ties (blended)
+};
+
+// Programs and fixed-function state of a group of draws
+struct RenderMaterial {
+    // Draws a single instance with the "model" and "transform" uniforms
+    // (basic.vert without INSTANCED). Only the instance transform is used, so
+    // leave it null when the other InstanceData fields matter.
+    const Shader* shader = nullptr;
+    // Draws batches from InstanceData attributes (the INSTANCED variants)
+    const Shader* instancedShader = nullptr;
+    bool blend = false;  // Alpha blending
+    bool depthWrite = true;
+    GLenum depthFunc = GL_LESS;
+};
+
+struct RenderQueueStats {
+    size_t items = 0;      // Submit calls this frame
+    size_t instances = 0;  // Instances in those items
+    size_t batches = 0;    // Draws after merging
+    size_t drawCalls = 0;  // Driver submissions, a multi-draw counts once
+};
+
+// Collects the draws of a frame and issues them sorted by a 64-bit key:
+//
+//   StateFirst:  pass:8 | shader:12 | material:12 | mesh:16 | depth:16
+//   BackToFront: pass:8 | ~depth:16 | shader:12 | material:12 | mesh:16
+//
+// Sorting puts draws of the same program and material next to each other, so
+// state changes (through GLState) happen once per group, and consecutive
+// draws of the same mesh range with the same material are merged into one
+// instanced call. All instance data of a frame is written in one go into a
+// persistently mapped StreamBuffer, so uploading it never waits for the GPU
+// to finish drawing the previous frames.
+//
+// Where the context supports multi-draw indirect (GLCapabilities), runs of
+// instanced batches with the same program, state, mesh arena and index width
+// go out as one glMultiDrawElementsIndirect call: every batch is a command
+// whose base instance points the instance attributes at its own InstanceData,
+// so a whole pass over shared arenas costs one submission instead of one per
+// mesh.
+//
+//   queue.begin(viewProjection, cameraPosition);
+//   queue.submit(opaquePass, rockMaterial, rockMesh, instance);
+//   queue.flush();
+class RenderQueue {
+public:
+    RenderQueue();
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // Passes are drawn in the order they are added. The name is used for the
+    // pass's Profiler entry.
+    uint8_t addPass(const char* name, PassOrder order = PassOrder::StateFirst);
+    uint16_t addMaterial(const RenderMaterial& material);
+
+    // Start a frame. viewProjection is column-major (as uploaded to GL). Also
+    // moves the stream buffer on to the next frame's region.
+    void begin(const float* viewProjection, const Vector3& viewPosition);
+
+    // Draws the mesh's full-detail level
+    void submit(uint8_t pass, uint16_t material, const Mesh& mesh, const InstanceData& instance);
+
+    // Draws the level lod picks for the instance's distance and scale
+    void submitLod(uint8_t pass, uint16_t material, const Mesh& mesh, const InstanceData& instance,
+                   const LodSelector& lod);
+
+    // Draw only part of the mesh's indices (e.g. one detail level)
+    void submitRange(uint8_t pass, uint16_t material, const Mesh& mesh,
+                     size_t firstIndex, size_t indexCount, const InstanceData& instance);
+
+    // Pre-batched instances[ids[i]], e.g. the visible part of a grid. Sorted
+    // as one item at depth 0.
+    void submitInstances(uint8_t pass, uint16_t material, const Mesh& mesh,
+                         const InstanceData* instances, const uint32_t* ids, size_t count);
+
+    // The same, split into one item per detail level picked by lod
+    void submitInstances(uint8_t pass, uint16_t material, const Mesh& mesh,
+                         const InstanceData* instances, const uint32_t* ids, size_t count, const LodSelector& lod);
+
+    // Sort, upload and draw everything submitted since begin(). Leaves the
+    // state of the last material set.
+    void flush();
+
+    // Multi-draw is on wherever it is supported; turning it off forces one
+    // call per batch (comparisons, debugging)
+    void setMultiDraw(bool enabled);
+    bool isMultiDraw() const { return multiDraw; }
+
+    const RenderQueueStats& getStats() const { return stats; }
+    const StreamBufferStats& getStreamStats() const { return stream.getStats(); }
+    bool isStreamPersistent() const { return stream.isPersistent(); }
+
+private:
+    struct Pass {
+        const char* name;
+        PassOrder order;
+    };
+
+    struct MaterialEntry {
+        RenderMaterial material;
+        uint16_t shaderId;
+        UniformMat4 modelUniform;
+        UniformMat4 transformUniform;
+    };
+
+    struct Item {
+        const Mesh* mesh;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstInstance;  // Into instances
+        uint32_t instanceCount;
+        uint16_t material;
+        uint8_t pass;
+    };
+
+    // A merged run of items, ready to draw
+    struct Batch {
+        size_t item;             // First item of the run, for mesh, range and material
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Layout fixed by GL for glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Consecutive batches sent with one driver call
+    struct Submission {
+        size_t firstBatch;
+        size_t batchCount;
+        size_t firstCommand;  // NO_COMMANDS when drawn batch by batch
+    };
+
+    static const size_t NO_COMMANDS = SIZE_MAX;
+
+    std::vector<Pass> passes;
+    std::vector<MaterialEntry> materials;
+    std::vector<const Shader*> shaders;  // Index = shader id
+
+    float viewProjection[16] = {};
+    Vector3 viewPosition;
+
+    std::vector<Item> items;
+    std::vector<InstanceData> instances;
+    std::vector<std::pair<uint64_t, uint32_t>> keys;  // Key, item index
+    std::vector<Batch> batches;
+    std::vector<Submission> submissions;
+    std::vector<DrawElementsIndirectCommand> commands;
+    bool multiDraw;
+    std::unordered_map<uint64_t, uint16_t> meshIds;   // Per frame, by mesh and range
+    std::vector<uint8_t> instanceLods;                // Scratch for submitInstances
+    std::vector<uint32_t> lodCounts;
+    std::vector<uint32_t> lodOffsets;
+    StreamBuffer stream;                              // Instances and indirect commands
+    StreamAllocation instanceData;                    // This frame's
+    StreamAllocation commandData;
+    RenderQueueStats stats;
+
+    void addItem(uint8_t pass, uint16_t material, const Mesh& mesh, size_t firstIndex, size_t indexCount,
+                 size_t firstInstance, size_t instanceCount, float depth);
+    uint16_t meshId(const Mesh& mesh, size_t firstIndex);
+    size_t selectLod(const Mesh& mesh, const InstanceData& instance, const LodSelector& lod) const;
+    void buildBatches();
+    bool drawsInstanced(const Batch& batch) const;
+    bool canShareMultiDraw(const Batch& first, const Batch& next) const;
+    void buildSubmissions();
+    void applyMaterialState(const RenderMaterial& material);
+    void bindInstanceAttributes(const MeshArena* arena, size_t firstInstance,
+                                std::vector<const MeshArena*>& instancedArenas);
+    void drawBatch(const Batch& batch, std::vector<const MeshArena*>& instancedArenas);
+    void drawMultiple(const Submission& submission, std::vector<const MeshArena*>& instancedArenas);
+};
@@ -1,100 +1,284 @@
 #include "Shader.h"
+#include "GLState.h"
+#include "GLCapabilities.h"
+#include "ShaderCache.h"
 #include <fstream>
-#include <sstream>
 #include <iostream>
 
-Shader::Shader() : programID(0), vertexShaderID(0), fragmentShaderID(0) {
+// Read a shader file, replacing #include "file" lines with the file contents.
+// Includes are resolved relative to the including file.
+static bool readShaderFile(const std::string& path, std::string& source, int depth = 0) {
+    if (depth > 8) {
+        std::cerr << "Shader include depth exceeded in " << path << std::endl;
+        return false;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open shader file " << path << std::endl;
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 8, "#include") == 0) {
+            size_t open = line.find('"');
+            size_t close = line.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos) {
+                std::cerr << "Malformed include in " << path << ": " << line << std::endl;
+                return false;
+            }
+            if (!readShaderFile(directory + line.substr(open + 1, close - open - 1), source, depth + 1)) {
+                return false;
+            }
+            continue;
+        }
+        source += line;
+        source += '\n';
+    }
+    return true;
+}
+
+// Insert the variant defines after the #version directive, which must stay first
+static std::string applyDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty()) return source;
+
+    std::string block;
+    for (const auto& define : defines) {
+        block += "#define " + define + "\n";
+    }
+
+    size_t insertAt = 0;
+    if (source.compare(0, 8, "#version") == 0) {
+        size_t lineEnd = source.find('\n');
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    return source.substr(0, insertAt) + block + source.substr(insertAt);
+}
+
+Shader::Shader()
+    : programID(0), vertexShaderID(0), fragmentShaderID(0), loading(false), fromBinaryCache(false), cacheKey(0) {
     programID = glCreateProgram();
 }
 
 Shader::~Shader() {
     if (vertexShaderID) glDeleteShader(vertexShaderID);
     if (fragmentShaderID) glDeleteShader(fragmentShaderID);
-    if (programID) glDeleteProgram(programID);
+    if (programID) {
+        GLState::forgetProgram(programID);
+        glDeleteProgram(programID);
+    }
 }
 
-bool Shader::compileShader(const std::string& source, GLuint shaderID) {
+// Queue the compile; the status is read later by checkShader
+GLuint Shader::compileShader(GLenum type, const std::string& source) {
+    GLuint shaderID = glCreateShader(type);
     const char* src = source.c_str();
     glShaderSource(shaderID, 1, &src, nullptr);
     glCompileShader(shaderID);
+    return shaderID;
+}
+
+bool Shader::checkShader(GLuint shaderID, const std::string& path) const {
+    if (!shaderID) return true;
 
     GLint success;
     glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
     if (!success) {
         GLchar infoLog[512];
         glGetShaderInfoLog(shaderID, 512, nullptr, infoLog);
-        std::cerr << "Shader compilation error: " << infoLog << std::endl;
+        std::cerr << "Shader compilation error in " << path << ": " << infoLog << std::endl;
         return false;
     }
     return true;
 }
 
-bool Shader::linkProgram() {
-    glAttachShader(programID, vertexShaderID);
-    glAttachShader(programID, fragmentShaderID);
+void Shader::cacheUniforms() {
+    uniforms.clear();
 
-    glLinkProgram(programID);
-    GLint success;
-    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
 
-    if (!success) {
-        GLchar infoLog[512];
-        glGetProgramInfoLog(programID, 512, nullptr, infoLog);
-        std::cerr << "Program linking error: " << infoLog << std::endl;
-        return false;
+    std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, static_cast<GLuint>(i), maxLength, &length, &size, &type, nameBuffer.data());
+
+        std::string name(nameBuffer.data(), length);
+        // Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(programID, name.c_str());
+        if (location < 0) continue;
+
+        // Arrays are reported as "name[0]", allow looking them up by "name" too
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            uniforms[name.substr(0, name.size() - 3)] = {location, type, false};
+        }
+        uniforms[name] = {location, type, false};
+    }
+}
+
+GLint Shader::findUniform(const std::string& name, GLenum expectedType) const {
+    auto it = uniforms.find(name);
+    if (it == uniforms.end()) return -1;
+
+    const UniformInfo& info = it->second;
+    bool matches = info.type == expectedType;
+    // Integer setters are also used for booleans and sampler units
+    if (expectedType == GL_INT) {
+        matches = matches || info.type == GL_BOOL || info.type == GL_SAMPLER_2D ||
+                  info.type == GL_SAMPLER_3D || info.type == GL_SAMPLER_CUBE ||
+                  info.type == GL_SAMPLER_BUFFER;
+    }
+    if (!matches) {
+        if (!info.mismatchReported) {
+            std::cerr << "Uniform " << name << " has a different type than requested" << std::endl;
+            info.mismatchReported = true;
+        }
+        return -1;
     }
+    return info.location;
+}
+
+bool Shader::bindUniformBlock(const std::string& blockName, GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(programID, blockName.c_str());
+    if (index == GL_INVALID_INDEX) return false;
+
+    glUniformBlockBinding(programID, index, binding);
     return true;
 }
 
-bool Shader::loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
-    std::cout << "Trying to load vertex shader from: " << vertexPath << std::endl;
-    std::cout << "Trying to load fragment shader from: " << fragmentPath << std::endl;
+UniformFloat Shader::getFloatUniform(const std::string& name) const {
+    UniformFloat uniform;
+    uniform.location = findUniform(name, GL_FLOAT);
+    return uniform;
+}
+
+UniformInt Shader::getIntUniform(const std::string& name) const {
+    UniformInt uniform;
+    uniform.location = findUniform(name, GL_INT);
+    return uniform;
+}
+
+UniformVec3 Shader::getVec3Uniform(const std::string& name) const {
+    UniformVec3 uniform;
+    uniform.location = findUniform(name, GL_FLOAT_VEC3);
+    return uniform;
+}
+
+UniformMat4 Shader::getMat4Uniform(const std::string& name) const {
+    UniformMat4 uniform;
+    uniform.location = findUniform(name, GL_FLOAT_MAT4);
+    return uniform;
+}
+
+bool Shader::loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                           const std::vector<std::string>& defines) {
+    return startLoadFromFiles(vertexPath, fragmentPath, defines) && finishLoad();
+}
 
-    vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+bool Shader::startLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                                const std::vector<std::string>& defines) {
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
 
-    std::ifstream vertexFile(vertexPath);
-    if (!vertexFile.is_open()) {
-        std::cerr << "Failed to open vertex shader file" << std::endl;
+    std::string vertexCode;
+    if (!readShaderFile(vertexPath, vertexCode)) {
+        std::cerr << "Failed to load vertex shader " << vertexPath << std::endl;
         return false;
     }
-    std::stringstream vertexStream;
-    vertexStream << vertexFile.rdbuf();
-    std::string vertexCode = vertexStream.str();
-    std::cout << "Vertex shader code:\n" << vertexCode << std::endl;
 
-    std::ifstream fragmentFile(fragmentPath);
-    if (!fragmentFile.is_open()) {
-        std::cerr << "Failed to open fragment shader file" << std::endl;
+    std::string fragmentCode;
+    if (!readShaderFile(fragmentPath, fragmentCode)) {
+        std::cerr << "Failed to load fragment shader " << fragmentPath << std::endl;
         return false;
     }
-    std::stringstream fragmentStream;
-    fragmentStream << fragmentFile.rdbuf();
-    std::string fragmentCode = fragmentStream.str();
-    std::cout << "Fragment shader code:\n" << fragmentCode << std::endl;
 
-    if (!compileShader(vertexCode, vertexShaderID)) return false;
-    if (!compileShader(fragmentCode, fragmentShaderID)) return false;
+    vertexCode = applyDefines(vertexCode, defines);
+    fragmentCode = applyDefines(fragmentCode, defines);
+
+    loading = true;
+    fromBinaryCache = false;
+    if (ShaderCache::isEnabled()) {
+        cacheKey = ShaderCache::makeKey(vertexCode, fragmentCode);
+        if (ShaderCache::load(programID, cacheKey)) {
+            fromBinaryCache = true;
+            return true;
+        }
+        glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
-    return linkProgram();
+    vertexShaderID = compileShader(GL_VERTEX_SHADER, vertexCode);
+    fragmentShaderID = compileShader(GL_FRAGMENT_SHADER, fragmentCode);
+    glAttachShader(programID, vertexShaderID);
+    glAttachShader(programID, fragmentShaderID);
+    glLinkProgram(programID);
+    return true;
+}
+
+bool Shader::finishLoad() {
+    if (!loading) return false;
+    loading = false;
+
+    GLint success;
+    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    if (!success) {
+        // A failed compile fails the link; its log says more
+        if (checkShader(vertexShaderID, vertexPath) && checkShader(fragmentShaderID, fragmentPath)) {
+            GLchar infoLog[512];
+            glGetProgramInfoLog(programID, 512, nullptr, infoLog);
+            std::cerr << "Program linking error (" << vertexPath << ", " << fragmentPath << "): " << infoLog << std::endl;
+        }
+        return false;
+    }
+
+    if (!fromBinaryCache && ShaderCache::isEnabled()) {
+        ShaderCache::store(programID, cacheKey);
+    }
+
+    cacheUniforms();
+    bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    return true;
+}
+
+bool Shader::isLoadFinished() const {
+    if (!loading || fromBinaryCache) return true;
+#if ENGINE_GL_PARALLEL_SHADER_COMPILE
+    if (GLCapabilities::get().parallelShaderCompile) {
+        GLint done = GL_TRUE;
+        glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+#endif
+    return true;
 }
 
 void Shader::use() const {
-    glUseProgram(programID);
+    GLState::useProgram(programID);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1f(findUniform(name, GL_FLOAT), value);
+    Profiler::countUniformUpload();
 }
 
 void Shader::setInt(const std::string&name, int value) const {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1i(findUniform(name, GL_INT), value);
+    Profiler::countUniformUpload();
 }
 
 void Shader::setVec3(const std::string&name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(programID, name.c_str()), x, y, z);
+    glUniform3f(findUniform(name, GL_FLOAT_VEC3), x, y, z);
+    Profiler::countUniformUpload();
 }
 
 void Shader::setMat4(const std::string&name, const float* matrix) const {
-    glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, matrix);
-}
\ No newline at end of file
+    glUniformMatrix4fv(findUniform(name, GL_FLOAT_MAT4), 1, GL_FALSE, matrix);
+    Profiler::countUniformUpload();
+}
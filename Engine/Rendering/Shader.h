@@ -1,30 +1,121 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include "GL.h"
 #include <string>
-#include </opt/homebrew/include/GLFW/glfw3.h>
+#include <unordered_map>
+#include <vector>
+#include "../Profiler.h"
+
+// Pre-resolved uniform handles. Location -1 (unknown or optimized-out uniform)
+// makes set() a no-op, like glUniform* itself. The program must be in use.
+struct UniformFloat {
+    GLint location = -1;
+    void set(float value) const {
+        glUniform1f(location, value);
+        Profiler::countUniformUpload();
+    }
+};
+
+struct UniformInt {
+    GLint location = -1;
+    void set(int value) const {
+        glUniform1i(location, value);
+        Profiler::countUniformUpload();
+    }
+};
+
+struct UniformVec3 {
+    GLint location = -1;
+    void set(float x, float y, float z) const {
+        glUniform3f(location, x, y, z);
+        Profiler::countUniformUpload();
+    }
+};
+
+struct UniformMat4 {
+    GLint location = -1;
+    void set(const float* matrix) const {
+        glUniformMatrix4fv(location, 1, GL_FALSE, matrix);
+        Profiler::countUniformUpload();
+    }
+};
 
 class Shader {
 private:
+    struct UniformInfo {
+        GLint location;
+        GLenum type;
+        mutable bool mismatchReported;  // A wrong-type lookup is reported once, not every frame
+    };
+
     GLuint programID;
     GLuint vertexShaderID;
     GLuint fragmentShaderID;
 
-    bool compileShader(const std::string& source, GLuint shaderID);
-    bool linkProgram();
+    // Between startLoadFromFiles and finishLoad
+    bool loading;
+    bool fromBinaryCache;
+    uint64_t cacheKey;
+    std::string vertexPath;
+    std::string fragmentPath;
+
+    // Active uniforms, read once after linking
+    std::unordered_map<std::string, UniformInfo> uniforms;
+
+    GLuint compileShader(GLenum type, const std::string& source);
+    bool checkShader(GLuint shaderID, const std::string& path) const;
+    void cacheUniforms();
+    GLint findUniform(const std::string& name, GLenum expectedType) const;
 
 public:
+    // Binding point of the per-frame FrameData uniform block (see UniformBuffer.h)
+    static const GLuint FRAME_DATA_BINDING = 0;
+
     Shader();
     ~Shader();
 
-    bool loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // Each define is inserted as "#define <define>" right after the #version line,
+    // so one source file can produce several program variants. Lines of the form
+    // #include "file" are replaced by that file, relative to the including shader.
+    // Programs are taken from the ShaderCache when it has them.
+    bool loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                       const std::vector<std::string>& defines = {});
+
+    // loadFromFiles in two steps. The start reads the sources and hands them
+    // to the driver without asking for the result, the finish waits for the
+    // link and reports errors. Starting every program before finishing any
+    // lets the driver compile them in parallel (KHR_parallel_shader_compile),
+    // or at least in the background.
+    bool startLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                            const std::vector<std::string>& defines = {});
+    bool finishLoad();
+
+    // Whether finishLoad() would return without waiting. Always true without
+    // parallel compilation support, where there is no way to ask.
+    bool isLoadFinished() const;
+
     void use() const;
-    
-    // Uniform setters
+    GLuint getProgram() const { return programID; }
+
+    // Attach a uniform block of this program to a buffer binding point.
+    // FrameData is bound to FRAME_DATA_BINDING automatically after linking.
+    bool bindUniformBlock(const std::string& blockName, GLuint binding) const;
+
+    // Typed handles for per-draw uniforms, resolved once instead of per call
+    UniformFloat getFloatUniform(const std::string& name) const;
+    UniformInt getIntUniform(const std::string& name) const;
+    UniformVec3 getVec3Uniform(const std::string& name) const;
+    UniformMat4 getMat4Uniform(const std::string& name) const;
+
+    // Uniform setters, looked up in the cache by name
     void setFloat(const std::string& name, float value) const;
     void setInt(const std::string& name, int value) const;
     void setVec3(const std::string& name, float x, float y, float z) const;
     void setMat4(const std::string& name, const float* matrix) const;
 };
 
-#endif
\ No newline at end of file
+#endif
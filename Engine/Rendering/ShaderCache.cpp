@@ -0,0 +1,174 @@
+#include "ShaderCache.h"
+#include "GLCapabilities.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Bump when the file layout changes
+static const uint32_t CACHE_VERSION = 1;
+static const char CACHE_MAGIC[4] = {'E', 'S', 'P', 'B'};
+
+// Written as is; the cache never leaves the machine that wrote it
+struct ShaderCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t checksum;  // Of the binary that follows
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+static std::string& directory() {
+    static std::string path;
+    return path;
+}
+
+// FNV-1a, continued from a previous hash
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const char* text, uint64_t hash) {
+    // The terminator separates consecutive strings
+    return hashBytes(text ? text : "", text ? std::strlen(text) + 1 : 1, hash);
+}
+
+static std::string pathFor(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory() + "/" + name;
+}
+
+void ShaderCache::setDirectory(const std::string& path) {
+    directory() = path;
+}
+
+const std::string& ShaderCache::getDirectory() {
+    return directory();
+}
+
+bool ShaderCache::isEnabled() {
+    return !directory().empty() && GLCapabilities::get().programBinary;
+}
+
+uint64_t ShaderCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t hash = hashBytes(&CACHE_VERSION, sizeof(CACHE_VERSION));
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+    hash = hashString(vertexSource.c_str(), hash);
+    return hashString(fragmentSource.c_str(), hash);
+}
+
+bool ShaderCache::load(GLuint program, uint64_t key) {
+    if (!isEnabled()) return false;
+
+    std::string path = pathFor(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        stats().misses++;
+        return false;
+    }
+
+    ShaderCacheHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header))) &&
+                 std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+                 header.version == CACHE_VERSION && header.key == key && header.binaryLength > 0;
+    if (valid) {
+        binary.resize(header.binaryLength);
+        valid = static_cast<bool>(file.read(binary.data(), binary.size())) &&
+                hashBytes(binary.data(), binary.size()) == header.checksum;
+    }
+    file.close();
+
+    if (valid) {
+        glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked) {
+            stats().hits++;
+            return true;
+        }
+    }
+
+    // Truncated, corrupt, or from a driver build that no longer accepts it
+    std::cerr << "Discarding stale shader cache entry " << path << std::endl;
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    stats().rejected++;
+    stats().misses++;
+    return false;
+}
+
+bool ShaderCache::store(GLuint program, uint64_t key) {
+    if (!isEnabled()) return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+
+    ShaderCacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return false;
+    binary.resize(written);
+    header.binaryFormat = format;
+    header.binaryLength = static_cast<uint32_t>(written);
+    header.checksum = hashBytes(binary.data(), binary.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory(), error);
+
+    // Write next to the final name and rename, so a crash or a second
+    // process never leaves a half-written entry behind
+    std::string path = pathFor(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write shader cache entry " << temporary << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    stats().stored++;
+    return true;
+}
+
+void ShaderCache::clear() {
+    if (directory().empty()) return;
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory(), error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() == ".bin") {
+            std::error_code ignored;
+            std::filesystem::remove(it->path(), ignored);
+        }
+    }
+}
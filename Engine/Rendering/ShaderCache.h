@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GL.h"
+#include <cstdint>
+#include <string>
+
+struct ShaderCacheStats {
+    uint32_t hits = 0;      // Programs loaded from a binary
+    uint32_t misses = 0;    // Programs compiled from source
+    uint32_t rejected = 0;  // Binaries found but unreadable or refused by the driver
+    uint32_t stored = 0;    // Binaries written after compiling
+};
+
+// Linked program binaries on disk, one file per program, so later launches
+// skip compiling and linking. Files are named after a key hashed from the
+// final sources (variant defines and includes already applied) and the
+// driver's vendor, renderer and version strings, so editing a shader or
+// updating the driver simply misses. Every file carries its key and a
+// checksum; corrupt or refused binaries are deleted and the program is
+// compiled from source again.
+//
+// Disabled (every lookup misses) until a directory is set, and while the
+// context reports no binary formats (GLCapabilities::programBinary).
+class ShaderCache {
+public:
+    // Created on the first store; "" disables the cache
+    static void setDirectory(const std::string& directory);
+    static const std::string& getDirectory();
+    static bool isEnabled();
+
+    static uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // Load the binary for key into program. True when the program is now
+    // linked; on false the program is untouched and must be built from source.
+    static bool load(GLuint program, uint64_t key);
+
+    // Save a linked program. It must have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    static bool store(GLuint program, uint64_t key);
+
+    // Delete every cached binary in the directory
+    static void clear();
+
+    static const ShaderCacheStats& getStats() { return stats(); }
+    static void resetStats() { stats() = ShaderCacheStats(); }
+
+private:
+    static ShaderCacheStats& stats() {
+        static ShaderCacheStats s;
+        return s;
+    }
+};
@@ -6,9 +6,9 @@ in vec3 FragPos;
 
 out vec4 FragColor;
 
+#include "frame.glsl"
+
 uniform vec3 lightDir;    // Directional light direction (normalized)
-uniform vec3 viewPos;     // Camera position
-uniform float time;       // Time for sun movement
 
 void main() {
     // Calculate sun position based on time
@@ -5,6 +5,29 @@ layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec3 aTexCoords;
 layout (location = 4) in vec2 aTexCoord;
 
+#if defined(PROCEDURAL_GRASS)
+// No instance attributes: each blade is derived from its index in the field,
+// see Engine/ProceduralGrass.h. Filled by placeBlade() under the attribute
+// names, so the instanced path below works on them unchanged.
+mat4 aInstanceModel;
+vec2 aInstanceWind;
+vec4 aInstanceColor;
+
+uniform sampler2D heightMap;
+uniform vec3 heightMapArea;   // x, z of the first sample, sample spacing
+uniform vec3 grassField;      // x, z of the field corner, blade spacing
+uniform int grassColumns;     // Blades per field row and column
+uniform int grassTileSide;    // Blades per tile row and column
+uniform int grassTilesPerRow;
+uniform int grassTile;        // Tile of this draw
+uniform int grassSeed;
+#elif defined(INSTANCED)
+// Per-instance attributes, see InstanceData in Engine/InstanceBuffer.h
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec2 aInstanceWind;    // x = height, y = wind intensity
+layout (location = 10) in vec4 aInstanceColor;  // rgb = tint, a = tint amount
+#endif
+
 out vec3 ourColor;
 out vec3 ourNormal;
 out vec3 ourTexCoords;
@@ -12,15 +35,73 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
+#include "frame.glsl"
+
 uniform mat4 transform;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 windDirection;
-uniform float windStrength;
-uniform float time;
+
+// Rotation around a normalized axis, same convention as glm::rotate
+mat4 axisRotation(vec3 axis, float angle) {
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 t = (1.0 - c) * axis;
+    return mat4(
+        vec4(c + t.x * axis.x, t.x * axis.y + s * axis.z, t.x * axis.z - s * axis.y, 0.0),
+        vec4(t.y * axis.x - s * axis.z, c + t.y * axis.y, t.y * axis.z + s * axis.x, 0.0),
+        vec4(t.z * axis.x + s * axis.y, t.z * axis.y - s * axis.x, c + t.z * axis.z, 0.0),
+        vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+#ifdef PROCEDURAL_GRASS
+// Integer hash with good avalanche (lowbias32)
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Independent uniform numbers in [0, 1) per blade and stream
+float bladeRandom(uint blade, uint stream) {
+    return float(hash(hash(blade ^ uint(grassSeed)) + stream) >> 8) / 16777216.0;
+}
+
+// Same ranges as the blades GrassScene places on the CPU
+void placeBlade() {
+    int tileX = grassTile % grassTilesPerRow;
+    int tileZ = grassTile / grassTilesPerRow;
+    int column = tileX * grassTileSide + gl_InstanceID % grassTileSide;
+    int row = tileZ * grassTileSide + gl_InstanceID / grassTileSide;
+    uint blade = uint(row * grassColumns + column);
+
+    vec2 position = grassField.xy + (vec2(column, row) + vec2(bladeRandom(blade, 0u), bladeRandom(blade, 1u))) * grassField.z;
+    vec2 texel = (position - heightMapArea.xy) / heightMapArea.z + 0.5;
+    float ground = textureLod(heightMap, texel / vec2(textureSize(heightMap, 0)), 0.0).r;
+
+    float height = 0.8 + 0.4 * bladeRandom(blade, 2u);
+    float intensity = 0.8 + 0.4 * bladeRandom(blade, 3u);
+    float rotation = radians(360.0 * bladeRandom(blade, 4u));
+    float tilt = radians(20.0 * bladeRandom(blade, 5u) - 10.0);
+
+    aInstanceModel = mat4(1.0);
+    aInstanceModel[3] = vec4(position.x, ground, position.y, 1.0);
+    aInstanceModel = aInstanceModel * axisRotation(vec3(0.0, 1.0, 0.0), rotation) * axisRotation(vec3(1.0, 0.0, 0.0), tilt);
+    aInstanceModel[1] *= height;
+    aInstanceWind = vec2(height, intensity);
+    aInstanceColor = vec4(mix(vec3(0.45, 0.75, 0.2), vec3(0.2, 0.9, 0.35), bladeRandom(blade, 6u)), 0.3 * bladeRandom(blade, 7u));
+
+    // Tiles on the last row and column may run past the field
+    if (column >= grassColumns || row >= grassColumns) aInstanceModel = mat4(0.0);
+}
+#endif
 
 void main() {
+#ifdef PROCEDURAL_GRASS
+    placeBlade();
+#endif
+
     // Calculate wind effect
     float windEffect = sin(time + aPos.y * 2.0) * windStrength;
     vec3 windOffset = vec3(windDirection.x, 0.0, windDirection.z) * windEffect * aPos.y;
@@ -28,8 +109,20 @@ void main() {
     // Apply wind to vertex position
     vec3 windPos = aPos + windOffset;
     
+#ifdef INSTANCED
+    // Bend each blade around the wind axis by its height and intensity, plus a
+    // slight forward lean for everything that reacts to wind at all
+    float bend = windSway * aInstanceWind.y * aInstanceWind.x;
+    float lean = aInstanceWind.y > 0.0 ? windSway * 0.2 : 0.0;
+    vec3 windAxis = normalize(vec3(windDirection.x, 0.0, windDirection.z));
+    mat4 instanceModel = aInstanceModel * axisRotation(windAxis, bend) * axisRotation(vec3(1.0, 0.0, 0.0), lean);
+
+    gl_Position = projection * view * instanceModel * vec4(windPos, 1.0);
+    FragPos = vec3(instanceModel * vec4(windPos, 1.0));
+#else
     gl_Position = transform * vec4(windPos, 1.0);
     FragPos = vec3(model * vec4(windPos, 1.0));
+#endif
     
     // Add subtle grid pattern for ground plane
     if (abs(aPos.y) < 0.01) {  // If this is a ground plane vertex
@@ -47,7 +140,12 @@ void main() {
     ourColor = aColor;
     }
     
+#ifdef INSTANCED
+    ourColor = mix(ourColor, aInstanceColor.rgb, aInstanceColor.a);
+    Normal = mat3(transpose(inverse(instanceModel))) * aNormal;
+#else
     Normal = mat3(transpose(inverse(model))) * aNormal;
+#endif
     ourNormal = aNormal;
     ourTexCoords = aTexCoords;
     TexCoord = aTexCoord;
@@ -4,7 +4,8 @@ out vec4 FragColor;
 in vec2 TexCoord;
 in vec3 FragPos;
 
-uniform float time;
+#include "frame.glsl"
+
 uniform vec3 sunDirection;
 
 // Cloud noise functions
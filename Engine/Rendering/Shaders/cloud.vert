@@ -2,21 +2,31 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
+#ifdef INSTANCED
+// Model matrix of InstanceData, see Engine/InstanceBuffer.h
+layout (location = 5) in mat4 aInstanceModel;
+#endif
+
 out vec2 TexCoord;
 out vec3 FragPos;
 
+#include "frame.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;
 
 void main() {
+#ifdef INSTANCED
+    mat4 cloudModel = aInstanceModel;
+#else
+    mat4 cloudModel = model;
+#endif
+
     // Add gentle movement to clouds
     vec3 cloudPos = aPos;
     cloudPos.x += sin(time * 0.1 + aPos.y) * 0.1;
     cloudPos.z += cos(time * 0.1 + aPos.x) * 0.1;
     
-    FragPos = vec3(model * vec4(cloudPos, 1.0));
+    FragPos = vec3(cloudModel * vec4(cloudPos, 1.0));
     TexCoord = aTexCoord;
-    gl_Position = projection * view * model * vec4(cloudPos, 1.0);
-} 
\ No newline at end of file
+    gl_Position = projection * view * cloudModel * vec4(cloudPos, 1.0);
+} 
@@ -0,0 +1,11 @@
+// Per-frame data shared by all programs, filled from FrameData in
+// Engine/Rendering/UniformBuffer.h (std140, keep both in sync)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;         // Camera position
+    float time;           // Seconds since start
+    vec3 windDirection;
+    float windStrength;
+    float windSway;       // Base bend angle of grass this frame
+};
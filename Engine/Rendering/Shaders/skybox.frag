@@ -3,8 +3,9 @@ out vec4 FragColor;
 
 in vec3 TexCoords;
 
+#include "frame.glsl"
+
 uniform vec3 sunDirection;
-uniform float time;
 
 void main() {
     // Normalize the direction vector
@@ -0,0 +1,145 @@
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "GLCapabilities.h"
+#include "../Profiler.h"
+
+// Buffers are only ever bound here, to a target no VAO or draw state uses
+static const GLenum STAGING_TARGET = GL_COPY_WRITE_BUFFER;
+
+// Regions start at multiples of this, whatever the driver reports
+static const size_t MIN_REGION_ALIGNMENT = 256;
+
+StreamBuffer::StreamBuffer(size_t bytesPerFrame, bool persistent)
+    : persistent(persistent && GLCapabilities::get().bufferStorage), baseAlignment(MIN_REGION_ALIGNMENT) {
+    size_t required = static_cast<size_t>(std::max(GLCapabilities::get().uniformBufferOffsetAlignment, 1));
+    while (baseAlignment < required) baseAlignment *= 2;
+    createBlock(block, bytesPerFrame);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (Block& old : retired) destroyBlock(old);
+    destroyBlock(block);
+}
+
+void StreamBuffer::createBlock(Block& target, size_t regionBytes) {
+    // Region offsets are multiples of regionBytes
+    regionBytes = std::max((regionBytes + baseAlignment - 1) & ~(baseAlignment - 1), baseAlignment);
+    target = Block();
+    target.regionBytes = regionBytes;
+    glGenBuffers(1, &target.buffer);
+    glBindBuffer(STAGING_TARGET, target.buffer);
+#if ENGINE_GL_BUFFER_STORAGE
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(STAGING_TARGET, regionBytes * FRAMES, nullptr, flags);
+        target.mapped = static_cast<uint8_t*>(glMapBufferRange(STAGING_TARGET, 0, regionBytes * FRAMES, flags));
+        if (!target.mapped) {
+            std::cerr << "Persistent mapping failed, streaming through glBufferSubData" << std::endl;
+            glDeleteBuffers(1, &target.buffer);
+            persistent = false;
+            glGenBuffers(1, &target.buffer);
+            glBindBuffer(STAGING_TARGET, target.buffer);
+        }
+    }
+#endif
+    if (!persistent) {
+        glBufferData(STAGING_TARGET, regionBytes, nullptr, GL_STREAM_DRAW);
+        target.staging.resize(regionBytes);
+    }
+    glBindBuffer(STAGING_TARGET, 0);
+    stats.regionBytes = regionBytes;
+}
+
+// GL keeps the storage until draws already issued from it are done
+void StreamBuffer::destroyBlock(Block& target) {
+    for (GLsync& fence : target.fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (target.mapped) {
+        glBindBuffer(STAGING_TARGET, target.buffer);
+        glUnmapBuffer(STAGING_TARGET);
+        glBindBuffer(STAGING_TARGET, 0);
+    }
+    if (target.buffer) glDeleteBuffers(1, &target.buffer);
+    target = Block();
+}
+
+void StreamBuffer::beginFrame() {
+    stats.frames++;
+    for (Block& old : retired) destroyBlock(old);
+    retired.clear();
+
+    if (persistent) {
+        // The fence covers every command issued so far, the previous frame's
+        // draws included
+        if (started) {
+            block.fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % FRAMES;
+        }
+        GLsync& fence = block.fences[region];
+        if (fence) {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                auto start = std::chrono::steady_clock::now();
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+                }
+                stats.stalls++;
+                stats.stallMs +=
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                Profiler::countStreamStall();
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    } else {
+        // Orphan: draws still reading the old storage keep it, the driver
+        // hands out new storage without waiting for them
+        glBindBuffer(STAGING_TARGET, block.buffer);
+        glBufferData(STAGING_TARGET, block.regionBytes, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(STAGING_TARGET, 0);
+        block.committed = 0;
+    }
+    block.head = 0;
+    stats.frameBytes = 0;
+    started = true;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t bytes, size_t alignment) {
+    size_t offset = (block.head + alignment - 1) & ~(alignment - 1);
+    if (offset + bytes > block.regionBytes) {
+        // Earlier allocations of this frame keep pointing into the old block
+        size_t regionBytes = block.regionBytes * 2;
+        while (regionBytes < bytes + alignment) regionBytes *= 2;
+        retired.push_back(std::move(block));
+        createBlock(block, regionBytes);
+        stats.grows++;
+        offset = 0;
+    }
+    block.head = offset + bytes;
+
+    StreamAllocation allocation;
+    allocation.buffer = block.buffer;
+    allocation.offset = regionOffset() + offset;
+    allocation.data = persistent ? block.mapped + allocation.offset : block.staging.data() + offset;
+    allocation.size = bytes;
+    stats.bytes += bytes;
+    stats.frameBytes += bytes;
+    Profiler::countStreamWrite(bytes);
+    return allocation;
+}
+
+void StreamBuffer::commitBlock(Block& target) {
+    if (persistent || target.head <= target.committed) return;
+    glBindBuffer(STAGING_TARGET, target.buffer);
+    glBufferSubData(STAGING_TARGET, target.committed, target.head - target.committed,
+                    target.staging.data() + target.committed);
+    glBindBuffer(STAGING_TARGET, 0);
+    target.committed = target.head;
+}
+
+void StreamBuffer::commit() {
+    for (Block& old : retired) commitBlock(old);
+    commitBlock(block);
+}
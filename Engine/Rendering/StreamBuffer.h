@@ -0,0 +1,104 @@
+#pragma once
+
+#include "GL.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Space for one write, valid until the next beginFrame()
+struct StreamAllocation {
+    void* data = nullptr;  // Write here
+    GLuint buffer = 0;     // Bind this buffer ...
+    size_t offset = 0;     // ... at this byte offset
+    size_t size = 0;
+};
+
+struct StreamBufferStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;        // Allocated since creation
+    uint64_t stalls = 0;       // Frames that waited for the GPU to release their region
+    double stallMs = 0.0;      // Time spent in those waits
+    uint64_t grows = 0;        // A frame outgrew its region and the buffer was doubled
+    size_t frameBytes = 0;     // Allocated in the current frame
+    size_t regionBytes = 0;    // Capacity of a frame
+};
+
+// Ring of per-frame regions for data rewritten every frame (instance
+// attributes, indirect commands, uniforms):
+//
+//   stream.beginFrame();
+//   StreamAllocation a = stream.allocate(count * sizeof(InstanceData));
+//   memcpy(a.data, instances, a.size);
+//   stream.commit();
+//   ... draw from a.buffer at a.offset ...
+//
+// Where the context has buffer storage (GLCapabilities) the buffer is mapped
+// once, persistent and coherent, and split into FRAMES regions. Allocations
+// point straight into GPU-visible memory; a fence placed when a frame's
+// region is left is waited on only when the ring comes back to it, so the CPU
+// runs up to two frames ahead without ever synchronizing with the driver.
+// Such waits are counted as stalls (also in the Profiler counters).
+//
+// Elsewhere (GL 3.3) allocations go to a CPU copy of one region, commit()
+// uploads them with glBufferSubData, and every frame starts by orphaning the
+// buffer so the driver hands out fresh storage instead of waiting.
+//
+// A frame that outgrows its region continues in a buffer twice the size; the
+// old one is released at the next beginFrame(), once nothing points into it.
+//
+// Region sizes are rounded up to a multiple of the largest alignment a
+// binding may need (regionAlignment()), so an aligned offset inside a region
+// is aligned in the buffer as well.
+class StreamBuffer {
+public:
+    static const int FRAMES = 3;
+
+    // persistent = false forces the orphaning path (comparisons, debugging)
+    explicit StreamBuffer(size_t bytesPerFrame = 1 << 20, bool persistent = true);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Close the previous frame's region and move to the next, waiting only
+    // if the GPU may still read it
+    void beginFrame();
+
+    // alignment must be a power of two, at most regionAlignment(); 256
+    // covers uniform buffer offsets
+    StreamAllocation allocate(size_t bytes, size_t alignment = 16);
+
+    // Make everything allocated so far visible to the commands issued next.
+    // Only the orphaning path has work to do.
+    void commit();
+
+    bool isPersistent() const { return persistent; }
+    size_t regionAlignment() const { return baseAlignment; }
+    const StreamBufferStats& getStats() const { return stats; }
+
+private:
+    // One GL buffer with its regions; retired blocks stay mapped until the
+    // frame that wrote to them is over
+    struct Block {
+        GLuint buffer = 0;
+        uint8_t* mapped = nullptr;         // Persistent path
+        std::vector<uint8_t> staging;      // Orphaning path, one region
+        size_t regionBytes = 0;
+        size_t committed = 0;              // Orphaning path, bytes of the region uploaded
+        size_t head = 0;                   // Bytes of the current region allocated
+        GLsync fences[FRAMES] = {};
+    };
+
+    bool persistent;
+    size_t baseAlignment;  // Of every region's start, a power of two
+    int region = 0;
+    bool started = false;
+    Block block;
+    std::vector<Block> retired;
+    StreamBufferStats stats;
+
+    void createBlock(Block& target, size_t regionBytes);
+    void destroyBlock(Block& target);
+    void commitBlock(Block& target);
+    size_t regionOffset() const { return persistent ? region * block.regionBytes : 0; }
+};
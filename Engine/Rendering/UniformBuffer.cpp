@@ -0,0 +1,35 @@
+#include "UniformBuffer.h"
+#include "../Profiler.h"
+
+static_assert(sizeof(FrameData) == 176, "FrameData must match the std140 layout of the FrameData block");
+
+UniformBuffer::UniformBuffer(size_t size, GLuint binding) : UBO(0), size(size), binding(binding) {
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &UBO);
+}
+
+void UniformBuffer::update(const void* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    Profiler::countUniformUpload();
+}
+
+void UniformBuffer::update(const void* data, size_t bytes, size_t offset) {
+    if (offset + bytes > size) return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    Profiler::countUniformUpload();
+}
+
+void UniformBuffer::bind() const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "GL.h"
+#include <cstddef>
+
+// std140 mirror of the FrameData block in Shaders/frame.glsl. Shared by every
+// program, uploaded and bound once per frame at Shader::FRAME_DATA_BINDING.
+struct FrameData {
+    float view[16];
+    float projection[16];
+    float viewPos[3];
+    float time;
+    float windDirection[3];
+    float windStrength;
+    float windSway;
+    float padding[3];
+};
+
+// Uniform buffer object attached to a fixed binding point
+class UniformBuffer {
+private:
+    unsigned int UBO;
+    size_t size;
+    GLuint binding;
+
+public:
+    UniformBuffer(size_t size, GLuint binding);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Replace the whole buffer (orphaned, so no wait on draws still reading it)
+    void update(const void* data);
+    // Overwrite part of the buffer
+    void update(const void* data, size_t bytes, size_t offset);
+
+    // Bind to the binding point; programs see it until something else is bound there
+    void bind() const;
+
+    size_t getSize() const { return size; }
+};
@@ -1,4 +1,6 @@
 #include "Window.h"
+#include "GLCapabilities.h"
+#include "GLState.h"
 #include <iostream>
 
 Window::Window(int width, int height, const std::string& title) 
@@ -31,6 +33,8 @@ bool Window::init() {
     }
 
     glfwMakeContextCurrent(window);
+    GLState::invalidate();
+    GLCapabilities::detect();
     glClearColor(0.1f, 0.12f, 0.15f, 1.0f);
     return true;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "GL.h"
+#define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <string>
 
@@ -0,0 +1,240 @@
+#include "Scatter.h"
+#include "CounterRandom.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+// Tile side in grid cells, far more than the two cells a check reaches, so
+// tiles of one pass never see each other
+static const int TILE_CELLS = 32;
+static const int GATHER_ROWS = 16;
+
+// How far past the radius growth candidates go, so rounding never puts one
+// inside the radius of the sample it grew from
+static const float CANDIDATE_MARGIN = 1e-3f;
+
+// Streams besides the per-tile ones, all offset by the type
+static const uint32_t THINNING_STREAM = 0x68e31da4u;
+static const uint32_t INSTANCE_STREAM = 0xb5297a4du;
+
+struct GridSample {
+    float x, z;  // x is NaN in empty cells
+};
+
+struct TypeGrid {
+    float originX, originZ;
+    float cell;
+    float radius;
+    int width, depth;
+    std::vector<GridSample> cells;  // Row-major
+};
+
+// Instances of the earlier types, bucketed by a hash of their cell. Cells
+// sharing a bucket only cost a few extra distance checks.
+class ExclusionHash {
+public:
+    void build(const ScatterInstance* instances, size_t count, float cellSize) {
+        this->cellSize = cellSize;
+        size_t buckets = 16;
+        while (buckets < count * 2) buckets *= 2;
+        mask = static_cast<uint32_t>(buckets - 1);
+        start.assign(buckets + 1, 0);
+        std::vector<uint32_t> bucketOf(count);
+        for (size_t i = 0; i < count; i++) {
+            bucketOf[i] = bucket(cellOf(instances[i].x), cellOf(instances[i].z));
+            start[bucketOf[i] + 1]++;
+        }
+        for (size_t b = 0; b < buckets; b++) start[b + 1] += start[b];
+        std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+        xs.resize(count);
+        zs.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t slot = cursor[bucketOf[i]]++;
+            xs[slot] = instances[i].x;
+            zs[slot] = instances[i].z;
+        }
+    }
+
+    // Whether any instance lies closer than the cell size
+    bool near(float x, float z) const {
+        if (xs.empty()) return false;
+        int cx = cellOf(x), cz = cellOf(z);
+        float limit = cellSize * cellSize;
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                uint32_t b = bucket(cx + dx, cz + dz);
+                for (uint32_t i = start[b]; i < start[b + 1]; i++) {
+                    float ox = xs[i] - x, oz = zs[i] - z;
+                    if (ox * ox + oz * oz < limit) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    float cellSize = 1.0f;
+    uint32_t mask = 0;
+    std::vector<uint32_t> start;
+    std::vector<float> xs, zs;
+
+    int cellOf(float v) const { return static_cast<int>(std::floor(v / cellSize)); }
+
+    uint32_t bucket(int cx, int cz) const {
+        return CounterRandom::hash(static_cast<uint32_t>(cx) * 0x9e3779b1u ^ static_cast<uint32_t>(cz)) & mask;
+    }
+};
+
+// Bridson inside one tile: seed it with random candidates, then grow around
+// active samples until none can place another within `attempts` tries
+static void growTile(TypeGrid& grid, int tileX, int tileZ, const ScatterSettings& settings,
+                     const ExclusionHash* exclusion, CounterRandom random) {
+    int cx0 = tileX * TILE_CELLS, cz0 = tileZ * TILE_CELLS;
+    int cx1 = std::min(cx0 + TILE_CELLS, grid.width), cz1 = std::min(cz0 + TILE_CELLS, grid.depth);
+    float x0 = grid.originX + cx0 * grid.cell, z0 = grid.originZ + cz0 * grid.cell;
+    float x1 = std::min(grid.originX + cx1 * grid.cell, settings.maxX);
+    float z1 = std::min(grid.originZ + cz1 * grid.cell, settings.maxZ);
+    float minDistance = grid.radius * grid.radius;
+    float candidateDistance = grid.radius * (1.0f + CANDIDATE_MARGIN);
+    float stepCos = std::cos(6.2831853f / settings.attempts), stepSin = std::sin(6.2831853f / settings.attempts);
+
+    std::vector<GridSample> active;
+    auto tryInsert = [&](float x, float z) {
+        if (!(x >= x0 && x < x1 && z >= z0 && z < z1)) return false;
+        int cx = std::min(std::max(static_cast<int>((x - grid.originX) / grid.cell), cx0), cx1 - 1);
+        int cz = std::min(std::max(static_cast<int>((z - grid.originZ) / grid.cell), cz0), cz1 - 1);
+        if (!std::isnan(grid.cells[cz * grid.width + cx].x)) return false;
+        for (int nz = std::max(cz - 2, 0); nz <= std::min(cz + 2, grid.depth - 1); nz++) {
+            for (int nx = std::max(cx - 2, 0); nx <= std::min(cx + 2, grid.width - 1); nx++) {
+                const GridSample& other = grid.cells[nz * grid.width + nx];
+                float dx = other.x - x, dz = other.z - z;
+                if (dx * dx + dz * dz < minDistance) return false;  // Empty cells compare false
+            }
+        }
+        if (exclusion && exclusion->near(x, z)) return false;
+        grid.cells[cz * grid.width + cx] = {x, z};
+        active.push_back({x, z});
+        return true;
+    };
+
+    for (int i = 0; i < settings.attempts; i++) {
+        tryInsert(x0 + random.unit() * (x1 - x0), z0 + random.unit() * (z1 - z0));
+    }
+    while (!active.empty()) {
+        uint32_t pick = random.below(static_cast<uint32_t>(active.size()));
+        GridSample around = active[pick];
+        bool grown = false;
+        // Candidates just outside the radius at evenly spaced angles from a
+        // random start (Roberts' variant of Bridson): they pack tighter than
+        // random points in [r, 2r] and a sample dies after far fewer misses.
+        // The direction is rotated by a fixed step instead of a sine and
+        // cosine per candidate.
+        float angle = random.unit() * 6.2831853f;
+        float dx = std::cos(angle) * candidateDistance, dz = std::sin(angle) * candidateDistance;
+        for (int k = 0; k < settings.attempts && !grown; k++) {
+            grown = tryInsert(around.x + dx, around.z + dz);
+            float rotated = dx * stepCos - dz * stepSin;
+            dz = dx * stepSin + dz * stepCos;
+            dx = rotated;
+        }
+        if (!grown) {
+            active[pick] = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+void Scatter::scatter(const HeightField& ground, const ScatterSettings& settings,
+                      const std::vector<ScatterType>& types, std::vector<ScatterInstance>& out,
+                      ScatterStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    size_t first = out.size();
+    size_t samples = 0;
+    if (settings.maxX <= settings.minX || settings.maxZ <= settings.minZ) {
+        std::cerr << "Scatter region is empty" << std::endl;
+        return;
+    }
+
+    ExclusionHash exclusion;
+    for (uint32_t type = 0; type < types.size(); type++) {
+        const ScatterType& scatterType = types[type];
+        if (!(scatterType.radius > 0.0f)) {
+            std::cerr << "Scatter type " << type << " needs a positive radius" << std::endl;
+            continue;
+        }
+        bool excludes = scatterType.exclusion > 0.0f && out.size() > first;
+        if (excludes) exclusion.build(out.data() + first, out.size() - first, scatterType.exclusion);
+
+        TypeGrid grid;
+        grid.originX = settings.minX;
+        grid.originZ = settings.minZ;
+        grid.radius = scatterType.radius;
+        grid.cell = scatterType.radius / std::sqrt(2.0f);
+        grid.width = std::max(1, static_cast<int>(std::ceil((settings.maxX - settings.minX) / grid.cell)));
+        grid.depth = std::max(1, static_cast<int>(std::ceil((settings.maxZ - settings.minZ) / grid.cell)));
+        float empty = std::numeric_limits<float>::quiet_NaN();
+        grid.cells.assign(static_cast<size_t>(grid.width) * grid.depth, {empty, empty});
+
+        // Checkerboard passes: (even, even) tiles, (odd, even), (even, odd), (odd, odd)
+        int tilesX = (grid.width + TILE_CELLS - 1) / TILE_CELLS;
+        int tilesZ = (grid.depth + TILE_CELLS - 1) / TILE_CELLS;
+        uint32_t typeStream = CounterRandom::hash(type + 1);
+        for (int pass = 0; pass < 4; pass++) {
+            std::vector<int> tiles;
+            for (int tz = pass >> 1; tz < tilesZ; tz += 2) {
+                for (int tx = pass & 1; tx < tilesX; tx += 2) tiles.push_back(tz * tilesX + tx);
+            }
+            JobSystem::parallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    CounterRandom random(settings.seed, typeStream + static_cast<uint32_t>(tiles[i]));
+                    growTile(grid, tiles[i] % tilesX, tiles[i] / tilesX, settings, excludes ? &exclusion : nullptr,
+                             random);
+                }
+            });
+        }
+
+        // Thin by the density mask and place on the ground, in blocks of rows
+        // joined in order
+        int blockCount = (grid.depth + GATHER_ROWS - 1) / GATHER_ROWS;
+        std::vector<std::vector<ScatterInstance>> blocks(blockCount);
+        std::vector<size_t> blockSamples(blockCount, 0);
+        JobSystem::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++) {
+                int rowEnd = std::min(static_cast<int>(b + 1) * GATHER_ROWS, grid.depth);
+                for (int cz = static_cast<int>(b) * GATHER_ROWS; cz < rowEnd; cz++) {
+                    for (int cx = 0; cx < grid.width; cx++) {
+                        uint32_t index = static_cast<uint32_t>(cz * grid.width + cx);
+                        const GridSample& sample = grid.cells[index];
+                        if (std::isnan(sample.x)) continue;
+                        blockSamples[b]++;
+                        if (scatterType.density &&
+                            CounterRandom::unitAt(settings.seed, typeStream ^ THINNING_STREAM, index) >=
+                                scatterType.density(sample.x, sample.z)) {
+                            continue;
+                        }
+                        ScatterInstance instance;
+                        instance.x = sample.x;
+                        instance.y = ground.getHeight(sample.x, sample.z);
+                        instance.z = sample.z;
+                        instance.type = type;
+                        instance.random = CounterRandom::at(settings.seed, typeStream ^ INSTANCE_STREAM, index);
+                        blocks[b].push_back(instance);
+                    }
+                }
+            }
+        });
+        for (int b = 0; b < blockCount; b++) {
+            samples += blockSamples[b];
+            out.insert(out.end(), blocks[b].begin(), blocks[b].end());
+        }
+    }
+
+    if (stats) {
+        stats->samples = samples;
+        stats->instances = out.size() - first;
+        stats->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "HeightField.h"
+
+struct ScatterType {
+    float radius = 1.0f;     // No two instances of this type closer than this
+    float exclusion = 0.0f;  // Distance kept from the instances of every type before it
+
+    // Share of the Poisson samples kept at (x, z), 0 to 1; empty keeps all.
+    // Called from job system threads, so it must be thread safe.
+    std::function<float(float x, float z)> density;
+};
+
+struct ScatterSettings {
+    float minX = -40.0f, minZ = -40.0f;
+    float maxX = 40.0f, maxZ = 40.0f;
+    uint32_t seed = 1;
+    int attempts = 30;  // Candidates around a sample before it stops growing (Bridson's k)
+};
+
+struct ScatterInstance {
+    float x, y, z;    // y is the ground height
+    uint32_t type;    // Index into the types
+    uint32_t random;  // Bits for the caller's rotation, scale, variant...
+};
+
+struct ScatterStats {
+    size_t samples = 0;    // Poisson samples before the density masks
+    size_t instances = 0;
+    double ms = 0.0;
+};
+
+// Poisson-disk scattering over a height field region (Bridson, "Fast
+// Poisson disk sampling in arbitrary dimensions"), one type after another.
+//
+// Each type fills a background grid of cells radius / sqrt(2) wide, at most
+// one sample per cell, so a candidate is checked against the 5x5 cells
+// around it. The grid is cut into tiles that grow in four passes, each pass
+// a checkerboard of tiles far enough apart to run in parallel on the job
+// system; a tile sees the finished tiles of earlier passes next to it and
+// nothing else. Random numbers come from CounterRandom streams per type and
+// tile, so the result only depends on the seed, never on the thread count.
+//
+// The density mask thins the finished samples, so kept instances still keep
+// their distance and sparse areas stay evenly spread. Instances of earlier
+// types are looked up in a spatial hash grid for the exclusion test.
+class Scatter {
+public:
+    // Appends to out, type by type, each in grid order
+    static void scatter(const HeightField& ground, const ScatterSettings& settings,
+                        const std::vector<ScatterType>& types, std::vector<ScatterInstance>& out,
+                        ScatterStats* stats = nullptr);
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+// Shared SIMD detection for the batch kernels (BatchMath, culling, noise...).
+// x86 builds compile SSE unconditionally and AVX2 per function through the
+// ENGINE_TARGET_AVX2 attribute, so one binary runs on any x86-64 CPU and picks
+// the widest path at runtime. Other architectures use the scalar fallback.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define ENGINE_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ENGINE_SIMD_X86 0
+#endif
+
+#if ENGINE_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ENGINE_TARGET_AVX2
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+class Simd {
+public:
+    // Widest instruction set supported by this CPU
+    static SimdLevel detect() {
+#if ENGINE_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        return SimdLevel::SSE;
+#elif ENGINE_SIMD_X86
+        return SimdLevel::SSE;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    // Level the kernels currently dispatch to
+    static SimdLevel level() { return activeLevel(); }
+
+    // Force a narrower path (benchmarks and accuracy comparisons). Requests
+    // wider than the CPU supports are clamped to detect().
+    static void setLevel(SimdLevel level) {
+        SimdLevel supported = detect();
+        activeLevel() = static_cast<int>(level) > static_cast<int>(supported) ? supported : level;
+    }
+
+    static const char* name(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX2: return "avx2";
+            case SimdLevel::SSE: return "sse";
+            default: return "scalar";
+        }
+    }
+
+private:
+    static SimdLevel& activeLevel() {
+        static SimdLevel current = detect();
+        return current;
+    }
+};
@@ -0,0 +1,420 @@
+#include "Terrain.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+TerrainStreamer::TerrainStreamer(const TerrainSettings& settings, HeightFunction height)
+    : settings(settings), height(std::move(height)) {
+    // Levels beyond the point where a chunk is a single quad add nothing
+    int maxLevels = 1;
+    while ((1 << maxLevels) < this->settings.chunkResolution - 1) maxLevels++;
+    this->settings.lodLevels = std::max(1, std::min(this->settings.lodLevels, maxLevels));
+    this->settings.concurrentChunks = std::max(1, this->settings.concurrentChunks);
+    this->settings.occluderLevel = std::max(0, std::min(this->settings.occluderLevel, maxLevels));
+}
+
+TerrainStreamer::~TerrainStreamer() {
+    {
+        // Running jobs find nothing left to chain into
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+    }
+    JobSystem::wait(generating);
+}
+
+ChunkCoord TerrainStreamer::chunkAt(const Vector3& position) const {
+    return {static_cast<int>(std::floor(position.x / settings.chunkSize)),
+            static_cast<int>(std::floor(position.z / settings.chunkSize))};
+}
+
+std::vector<ChunkCoord> TerrainStreamer::chunksInRange(const ChunkCoord& center) const {
+    int radius = settings.viewDistance;
+    std::vector<ChunkCoord> result;
+    for (int dz = -radius; dz <= radius; dz++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            if (dx * dx + dz * dz <= radius * radius) {
+                result.push_back({center.x + dx, center.z + dz});
+            }
+        }
+    }
+
+    // Nearest first, so the ground under the camera is generated before the horizon
+    std::sort(result.begin(), result.end(), [&](const ChunkCoord& a, const ChunkCoord& b) {
+        int da = (a.x - center.x) * (a.x - center.x) + (a.z - center.z) * (a.z - center.z);
+        int db = (b.x - center.x) * (b.x - center.x) + (b.z - center.z) * (b.z - center.z);
+        return da < db;
+    });
+    return result;
+}
+
+// Requests for the free job slots, nearest first. The mutex must be held.
+std::vector<ChunkCoord> TerrainStreamer::takeRequests() {
+    std::vector<ChunkCoord> taken;
+    while (runningJobs < settings.concurrentChunks && !requests.empty()) {
+        ChunkCoord coord = requests.front();
+        requests.pop_front();
+        inFlight.insert(coord);
+        runningJobs++;
+        taken.push_back(coord);
+    }
+    return taken;
+}
+
+// Outside the mutex: a full job deque runs the job right away
+void TerrainStreamer::startJobs(const std::vector<ChunkCoord>& coords) {
+    for (const auto& coord : coords) {
+        JobSystem::run([this, coord] { generateJob(coord); }, &generating);
+    }
+}
+
+void TerrainStreamer::generateJob(ChunkCoord coord) {
+    std::unique_ptr<ChunkData> data = generateChunk(coord);
+
+    std::vector<ChunkCoord> next;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(data));
+        runningJobs--;
+        next = takeRequests();
+    }
+    startJobs(next);
+}
+
+std::unique_ptr<TerrainStreamer::ChunkData> TerrainStreamer::generateChunk(ChunkCoord coord) const {
+    auto data = std::make_unique<ChunkData>();
+    data->coord = coord;
+
+    const int n = settings.chunkResolution;
+    const float step = settings.chunkSize / (n - 1);
+    const float originX = coord.x * settings.chunkSize;
+    const float originZ = coord.z * settings.chunkSize;
+
+    // Heights with a one sample border, so normals on the edges match the
+    // neighbouring chunks
+    const int border = n + 2;
+    std::vector<float> sampleX(border * border);
+    std::vector<float> sampleZ(border * border);
+    std::vector<float> heights(border * border);
+    for (int z = -1; z <= n; z++) {
+        for (int x = -1; x <= n; x++) {
+            sampleX[(z + 1) * border + (x + 1)] = originX + x * step;
+            sampleZ[(z + 1) * border + (x + 1)] = originZ + z * step;
+        }
+    }
+    height(sampleX.data(), sampleZ.data(), heights.data(), heights.size());
+    auto heightAt = [&](int x, int z) { return heights[(z + 1) * border + (x + 1)]; };
+
+    // Grid vertices in chunk-local coordinates, the chunk origin goes in the model matrix
+    data->vertices.reserve(n * n + 4 * n);
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            float h = heightAt(x, z);
+            Vector3 normal = Vector3(heightAt(x - 1, z) - heightAt(x + 1, z), 2.0f * step,
+                                     heightAt(x, z - 1) - heightAt(x, z + 1)).normalize();
+            Vector3 color(0.2f, 0.6f + h * 0.1f, 0.2f);
+            Vector3 texCoords(static_cast<float>(x) / (n - 1), static_cast<float>(z) / (n - 1), 0.0f);
+            data->vertices.push_back({{x * step, h, z * step}, color, normal, texCoords});
+        }
+    }
+
+    // Edge vertex i of side s (0: z = 0, 1: x = n-1, 2: z = n-1, 3: x = 0)
+    auto edgeVertex = [&](int side, int i) -> unsigned int {
+        switch (side) {
+            case 0: return i;
+            case 1: return i * n + (n - 1);
+            case 2: return (n - 1) * n + i;
+            default: return i * n;
+        }
+    };
+
+    // Skirt copies of every edge vertex, pushed down below the surface
+    const unsigned int skirtBase = static_cast<unsigned int>(data->vertices.size());
+    for (int side = 0; side < 4; side++) {
+        for (int i = 0; i < n; i++) {
+            Vertex skirt = data->vertices[edgeVertex(side, i)];
+            skirt.position.y -= settings.skirtDepth;
+            data->vertices.push_back(skirt);
+        }
+    }
+
+    for (int level = 0; level < settings.lodLevels; level++) {
+        const int stride = 1 << level;
+        LodRange range;
+        range.firstIndex = static_cast<unsigned int>(data->indices.size());
+
+        for (int z = 0; z + stride < n; z += stride) {
+            for (int x = 0; x + stride < n; x += stride) {
+                unsigned int topLeft = z * n + x;
+                unsigned int topRight = topLeft + stride;
+                unsigned int bottomLeft = (z + stride) * n + x;
+                unsigned int bottomRight = bottomLeft + stride;
+
+                data->indices.insert(data->indices.end(), {topLeft, bottomLeft, topRight});
+                data->indices.insert(data->indices.end(), {topRight, bottomLeft, bottomRight});
+            }
+        }
+
+        // Skirts follow this level's edge samples
+        for (int side = 0; side < 4; side++) {
+            for (int i = 0; i + stride < n; i += stride) {
+                unsigned int a = edgeVertex(side, i);
+                unsigned int b = edgeVertex(side, i + stride);
+                unsigned int skirtA = skirtBase + side * n + i;
+                unsigned int skirtB = skirtBase + side * n + i + stride;
+
+                data->indices.insert(data->indices.end(), {a, skirtA, b});
+                data->indices.insert(data->indices.end(), {b, skirtA, skirtB});
+            }
+        }
+
+        range.indexCount = static_cast<unsigned int>(data->indices.size()) - range.firstIndex;
+
+        // Row by row the grid reloads every vertex once per row it touches;
+        // ordered for the cache each vertex is shaded about once
+        unsigned int* levelIndices = data->indices.data() + range.firstIndex;
+        MeshOptimizer::optimizeVertexCache(levelIndices, range.indexCount, data->vertices.size());
+        MeshOptimizer::optimizeOverdraw(levelIndices, range.indexCount, data->vertices.data(), data->vertices.size());
+        data->lods.push_back(range);
+    }
+
+    // Every level samples the full-detail grid, so renumbering by first use
+    // in level 0 keeps all of them reading forward
+    data->vertices.resize(MeshOptimizer::optimizeVertexFetch(data->vertices.data(), data->vertices.size(),
+                                                             data->indices.data(), data->indices.size()));
+    if (!settings.occluders) return data;
+
+    // Height of the level with the given stride at grid sample (x, z),
+    // interpolated on the same triangles the indices above use
+    auto levelHeight = [&](int stride, int x, int z) {
+        int qx = std::min(x / stride * stride, n - 1 - stride);
+        int qz = std::min(z / stride * stride, n - 1 - stride);
+        float fx = static_cast<float>(x - qx) / stride, fz = static_cast<float>(z - qz) / stride;
+        float topLeft = heightAt(qx, qz), topRight = heightAt(qx + stride, qz);
+        float bottomLeft = heightAt(qx, qz + stride), bottomRight = heightAt(qx + stride, qz + stride);
+        if (fx + fz <= 1.0f) return topLeft + (topRight - topLeft) * fx + (bottomLeft - topLeft) * fz;
+        return bottomRight + (bottomLeft - bottomRight) * (1.0f - fx) + (topRight - bottomRight) * (1.0f - fz);
+    };
+
+    // Every level's triangles are unions of full-detail ones, so the gap
+    // between two levels is largest at a grid sample. Each occluder vertex
+    // sinks by the largest gap in the occluder quads around it.
+    const int occluderStride = 1 << settings.occluderLevel;
+    const int occluderSide = (n - 1) / occluderStride + 1;
+    const int quadSide = occluderSide - 1;
+    std::vector<float> quadSink(quadSide * quadSide, 0.0f);
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            float occluderHeight = levelHeight(occluderStride, x, z);
+            float gap = 0.0f;
+            for (int level = 0; level < settings.lodLevels; level++) {
+                gap = std::max(gap, occluderHeight - levelHeight(1 << level, x, z));
+            }
+            // Samples on a quad border belong to the quads on both sides
+            for (int qz = std::max(0, (z - 1) / occluderStride); qz <= std::min(z / occluderStride, quadSide - 1); qz++) {
+                for (int qx = std::max(0, (x - 1) / occluderStride); qx <= std::min(x / occluderStride, quadSide - 1); qx++) {
+                    quadSink[qz * quadSide + qx] = std::max(quadSink[qz * quadSide + qx], gap);
+                }
+            }
+        }
+    }
+
+    data->occluderPositions.reserve((occluderSide * occluderSide + 4 * occluderSide) * 3);
+    for (int z = 0; z < occluderSide; z++) {
+        for (int x = 0; x < occluderSide; x++) {
+            float sink = 0.0f;
+            for (int qz = std::max(0, z - 1); qz <= std::min(z, quadSide - 1); qz++) {
+                for (int qx = std::max(0, x - 1); qx <= std::min(x, quadSide - 1); qx++) {
+                    sink = std::max(sink, quadSink[qz * quadSide + qx]);
+                }
+            }
+            data->occluderPositions.insert(data->occluderPositions.end(),
+                                           {originX + x * occluderStride * step,
+                                            heightAt(x * occluderStride, z * occluderStride) - sink,
+                                            originZ + z * occluderStride * step});
+        }
+    }
+    for (int z = 0; z + 1 < occluderSide; z++) {
+        for (int x = 0; x + 1 < occluderSide; x++) {
+            uint32_t topLeft = z * occluderSide + x;
+            uint32_t bottomLeft = topLeft + occluderSide;
+            data->occluderIndices.insert(data->occluderIndices.end(),
+                                         {topLeft, bottomLeft, topLeft + 1, topLeft + 1, bottomLeft, bottomLeft + 1});
+        }
+    }
+
+    // Neighbours sink by different amounts; skirts close the steps between
+    // them, hanging below the shared edge where the ground is at least as high
+    auto occluderEdge = [&](int side, int i) -> uint32_t {
+        switch (side) {
+            case 0: return i;
+            case 1: return i * occluderSide + (occluderSide - 1);
+            case 2: return (occluderSide - 1) * occluderSide + i;
+            default: return i * occluderSide;
+        }
+    };
+    const uint32_t occluderSkirtBase = static_cast<uint32_t>(data->occluderPositions.size() / 3);
+    for (int side = 0; side < 4; side++) {
+        for (int i = 0; i < occluderSide; i++) {
+            const float* top = &data->occluderPositions[occluderEdge(side, i) * 3];
+            float skirt[3] = {top[0], top[1] - settings.skirtDepth, top[2]};
+            data->occluderPositions.insert(data->occluderPositions.end(), skirt, skirt + 3);
+        }
+    }
+    for (int side = 0; side < 4; side++) {
+        for (int i = 0; i + 1 < occluderSide; i++) {
+            uint32_t a = occluderEdge(side, i), b = occluderEdge(side, i + 1);
+            uint32_t skirtA = occluderSkirtBase + side * occluderSide + i;
+            data->occluderIndices.insert(data->occluderIndices.end(), {a, skirtA, b, b, skirtA, skirtA + 1});
+        }
+    }
+
+    return data;
+}
+
+void TerrainStreamer::uploadFinished(size_t budget) {
+    std::vector<std::unique_ptr<ChunkData>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!finished.empty() && ready.size() < budget) {
+            ready.push_back(std::move(finished.front()));
+            finished.pop_front();
+        }
+    }
+
+    for (auto& data : ready) {
+        ChunkCoord coord = data->coord;
+        if (chunks.find(coord) == chunks.end()) {
+            Chunk chunk;
+            chunk.coord = coord;
+            // Chunk-local positions fit half floats; chunks are never read
+            // back on the CPU, so only the packed GPU copy is kept
+            chunk.mesh = Mesh(MeshArena::shared<PackedVertexLayout>(), data->vertices, data->indices, false);
+            chunk.lods = data->lods;
+            chunk.occluderPositions = std::move(data->occluderPositions);
+            chunk.occluderIndices = std::move(data->occluderIndices);
+
+            const Bounds& bounds = chunk.mesh.getBounds();
+            Vector3 origin(coord.x * settings.chunkSize, 0.0f, coord.z * settings.chunkSize);
+            chunk.min = origin + bounds.min;
+            chunk.max = origin + bounds.max;
+
+            lru.push_front(coord);
+            chunk.lruPosition = lru.begin();
+            chunks.emplace(coord, std::move(chunk));
+            stats.generatedChunks++;
+        }
+
+        // Only now may the chunk be requested again
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.erase(coord);
+    }
+}
+
+void TerrainStreamer::evict(const ChunkCoord& center) {
+    size_t wanted = chunksInRange(center).size();
+    size_t capacity = settings.cacheCapacity > 0 ? std::max(settings.cacheCapacity, wanted) : wanted * 2;
+
+    int radius = settings.viewDistance;
+    while (chunks.size() > capacity && !lru.empty()) {
+        ChunkCoord coord = lru.back();
+        int dx = coord.x - center.x;
+        int dz = coord.z - center.z;
+        if (dx * dx + dz * dz <= radius * radius) break;
+
+        lru.pop_back();
+        chunks.erase(coord);
+        stats.evictedChunks++;
+    }
+}
+
+void TerrainStreamer::update(const Vector3& cameraPosition) {
+    ChunkCoord center = chunkAt(cameraPosition);
+    std::vector<ChunkCoord> wanted = chunksInRange(center);
+
+    std::vector<ChunkCoord> started;
+    {
+        // Replace the queue so chunks the camera moved away from are never built
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+        for (const auto& coord : wanted) {
+            auto it = chunks.find(coord);
+            if (it != chunks.end()) {
+                lru.splice(lru.begin(), lru, it->second.lruPosition);
+            } else if (inFlight.find(coord) == inFlight.end()) {
+                requests.push_back(coord);
+            }
+        }
+        stats.pendingChunks = requests.size() + inFlight.size();
+        started = takeRequests();
+    }
+    startJobs(started);
+
+    uploadFinished(static_cast<size_t>(std::max(1, settings.uploadsPerFrame)));
+    evict(center);
+    stats.residentChunks = chunks.size();
+}
+
+void TerrainStreamer::waitUntilLoaded(const Vector3& cameraPosition) {
+    std::vector<ChunkCoord> wanted = chunksInRange(chunkAt(cameraPosition));
+    while (true) {
+        update(cameraPosition);
+
+        bool loaded = true;
+        for (const auto& coord : wanted) {
+            if (chunks.find(coord) == chunks.end()) {
+                loaded = false;
+                break;
+            }
+        }
+        if (loaded) return;
+
+        // Help generating instead of sleeping
+        JobSystem::wait(generating);
+    }
+}
+
+int TerrainStreamer::selectLod(const Chunk& chunk, const Vector3& cameraPosition) const {
+    // Distance from the camera to the closest point of the chunk box
+    Vector3 closest(std::max(chunk.min.x, std::min(cameraPosition.x, chunk.max.x)),
+                    std::max(chunk.min.y, std::min(cameraPosition.y, chunk.max.y)),
+                    std::max(chunk.min.z, std::min(cameraPosition.z, chunk.max.z)));
+    float distance = closest.distance(cameraPosition);
+    if (distance < settings.lodDistance) return 0;
+
+    int level = static_cast<int>(std::log2(distance / settings.lodDistance)) + 1;
+    return std::min(level, static_cast<int>(chunk.lods.size()) - 1);
+}
+
+void TerrainStreamer::submit(RenderQueue& queue, uint8_t pass, uint16_t material, const Frustum& frustum,
+                             const Vector3& cameraPosition) {
+    stats.drawnChunks = 0;
+    stats.drawnTriangles = 0;
+
+    // Chunks only translate; no wind, no tint
+    InstanceData instance = {};
+    instance.transform[0] = instance.transform[5] = instance.transform[10] = instance.transform[15] = 1.0f;
+    instance.color = Vector3(1.0f, 1.0f, 1.0f);
+
+    for (const auto& entry : chunks) {
+        const Chunk& chunk = entry.second;
+        if (frustum.classifyBox(chunk.min, chunk.max) == CullResult::Outside) continue;
+
+        instance.transform[12] = chunk.coord.x * settings.chunkSize;
+        instance.transform[14] = chunk.coord.z * settings.chunkSize;
+
+        const LodRange& range = chunk.lods[selectLod(chunk, cameraPosition)];
+        queue.submitRange(pass, material, chunk.mesh, range.firstIndex, range.indexCount, instance);
+
+        stats.drawnChunks++;
+        stats.drawnTriangles += range.indexCount / 3;
+    }
+}
+
+void TerrainStreamer::submitOccluders(OcclusionCuller& culler, const Frustum& frustum) const {
+    for (const auto& entry : chunks) {
+        const Chunk& chunk = entry.second;
+        if (frustum.classifyBox(chunk.min, chunk.max) == CullResult::Outside) continue;
+        culler.addOccluder(chunk.occluderPositions.data(), chunk.occluderPositions.size() / 3,
+                           chunk.occluderIndices.data(), chunk.occluderIndices.size());
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Vector3.h"
+#include "Mesh.h"
+#include "Culling.h"
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "Rendering/RenderQueue.h"
+
+struct TerrainSettings {
+    float chunkSize = 32.0f;          // World units per chunk side
+    int chunkResolution = 33;         // Vertices per side at full detail, 2^n + 1
+    int lodLevels = 4;                // Level l samples every 2^l-th vertex
+    float lodDistance = 48.0f;        // Distance where level 1 starts, doubles per level
+    float skirtDepth = 2.0f;          // How far the seam skirts hang below the edges
+    int viewDistance = 6;             // Chunks kept loaded around the camera (radius)
+    size_t cacheCapacity = 0;         // Resident chunk limit, 0 = derived from viewDistance
+    int concurrentChunks = 4;         // Chunks generated at once on the job system
+    int uploadsPerFrame = 4;          // Finished chunks turned into meshes per update()
+    bool occluders = false;           // Keep the CPU occlusion mesh submitOccluders() draws
+    int occluderLevel = 2;            // Its detail level
+};
+
+struct ChunkCoord {
+    int x;
+    int z;
+
+    bool operator==(const ChunkCoord& other) const { return x == other.x && z == other.z; }
+};
+
+struct ChunkCoordHash {
+    size_t operator()(const ChunkCoord& c) const {
+        return std::hash<uint64_t>()((static_cast<uint64_t>(static_cast<uint32_t>(c.x)) << 32) |
+                                     static_cast<uint32_t>(c.z));
+    }
+};
+
+// Writes the terrain height at (x[i], z[i]) to out[i] for a whole chunk at
+// once, so batch kernels like Noise::heights can be used. Called from job
+// system threads, so it must be thread safe.
+using HeightFunction = std::function<void(const float* x, const float* z, float* out, size_t count)>;
+
+// Fixed-size terrain chunks generated as jobs around the camera. Every chunk
+// stores all its detail levels in one index buffer over a shared vertex grid;
+// skirts along the edges hide the cracks where chunks of different levels
+// meet. Chunks outside the view distance are kept in an LRU cache until the
+// capacity is exceeded, so memory and generation work depend on the view
+// distance only, never on the size of the world.
+class TerrainStreamer {
+public:
+    struct Stats {
+        size_t residentChunks = 0;
+        size_t pendingChunks = 0;
+        size_t generatedChunks = 0;
+        size_t evictedChunks = 0;
+        size_t drawnChunks = 0;
+        size_t drawnTriangles = 0;
+    };
+
+    TerrainStreamer(const TerrainSettings& settings, HeightFunction height);
+    ~TerrainStreamer();
+
+    TerrainStreamer(const TerrainStreamer&) = delete;
+    TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+    // Queue missing chunks around the camera (nearest first), turn finished
+    // ones into meshes and evict the least recently used beyond capacity
+    void update(const Vector3& cameraPosition);
+
+    // Queue resident chunks touching the frustum at their detail level. The
+    // instances only carry the chunk translation, so the material can draw
+    // them with basic.vert's non-instanced path.
+    void submit(RenderQueue& queue, uint8_t pass, uint16_t material, const Frustum& frustum,
+                const Vector3& cameraPosition);
+
+    // Add resident chunks touching the frustum to an occlusion culler (only
+    // with TerrainSettings::occluders, chunks have no occluder otherwise). Each
+    // chunk keeps a world-space copy of its grid at occluderLevel, each vertex
+    // lowered by the most any drawn level dips below the quads around it, so
+    // it never covers terrain the GPU actually draws.
+    void submitOccluders(OcclusionCuller& culler, const Frustum& frustum) const;
+
+    // Block until every chunk within the view distance is resident
+    void waitUntilLoaded(const Vector3& cameraPosition);
+
+    const Stats& getStats() const { return stats; }
+    const TerrainSettings& getSettings() const { return settings; }
+
+private:
+    struct LodRange {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+    };
+
+    // CPU-side result of a generation job, turned into a Mesh on the GL thread
+    struct ChunkData {
+        ChunkCoord coord;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<LodRange> lods;
+        std::vector<float> occluderPositions;
+        std::vector<uint32_t> occluderIndices;
+    };
+
+    struct Chunk {
+        ChunkCoord coord;
+        Mesh mesh;
+        std::vector<LodRange> lods;
+        std::vector<float> occluderPositions;  // World space
+        std::vector<uint32_t> occluderIndices;
+        Vector3 min;
+        Vector3 max;
+        std::list<ChunkCoord>::iterator lruPosition;
+    };
+
+    TerrainSettings settings;
+    HeightFunction height;
+    Stats stats;
+
+    std::unordered_map<ChunkCoord, Chunk, ChunkCoordHash> chunks;
+    std::list<ChunkCoord> lru;  // Front = most recently used
+
+    // Shared with the generation jobs. A finished job starts the next request
+    // itself, so generation keeps going between update() calls.
+    std::mutex mutex;
+    std::deque<ChunkCoord> requests;
+    std::unordered_set<ChunkCoord, ChunkCoordHash> inFlight;
+    std::deque<std::unique_ptr<ChunkData>> finished;
+    int runningJobs = 0;
+    JobCounter generating;
+
+    std::vector<ChunkCoord> takeRequests();
+    void startJobs(const std::vector<ChunkCoord>& coords);
+    void generateJob(ChunkCoord coord);
+    std::unique_ptr<ChunkData> generateChunk(ChunkCoord coord) const;
+    void uploadFinished(size_t budget);
+    void evict(const ChunkCoord& center);
+    std::vector<ChunkCoord> chunksInRange(const ChunkCoord& center) const;
+    ChunkCoord chunkAt(const Vector3& position) const;
+    int selectLod(const Chunk& chunk, const Vector3& cameraPosition) const;
+};
@@ -0,0 +1,245 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <iostream>
+
+// parentWorld * local for matrices whose last row is 0 0 0 1, which world
+// matrices built from compose() always are: 36 multiplies instead of 64
+static void multiplyAffine(const Matrix4& a, const Matrix4& b, Matrix4& out) {
+    for (int row = 0; row < 3; row++) {
+        const float* r = a.arr + row * 4;
+        for (int column = 0; column < 4; column++) {
+            out.arr[row * 4 + column] = r[0] * b.arr[column] + r[1] * b.arr[4 + column] + r[2] * b.arr[8 + column];
+        }
+        out.arr[row * 4 + 3] += r[3];
+    }
+    out.arr[12] = 0.0f;
+    out.arr[13] = 0.0f;
+    out.arr[14] = 0.0f;
+    out.arr[15] = 1.0f;
+}
+
+// values[i] = old values[order[i]]
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> sorted(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+TransformId TransformHierarchy::create(TransformId parentId) {
+    uint32_t parentIndex = NO_INDEX;
+    if (parentId != NO_TRANSFORM) {
+        if (!isValid(parentId)) {
+            std::cerr << "Transform parent " << parentId << " does not exist" << std::endl;
+            return NO_TRANSFORM;
+        }
+        parentIndex = indexOf[parentId];
+    }
+
+    // Appending keeps the order only if it extends the parent's range
+    uint32_t index = static_cast<uint32_t>(size());
+    if (ordered && parentIndex != NO_INDEX && subtreeEnd[parentIndex] != index) ordered = false;
+    if (ordered) {
+        for (uint32_t p = parentIndex; p != NO_INDEX; p = parent[p]) subtreeEnd[p] = index + 1;
+    }
+
+    TransformId id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = static_cast<TransformId>(indexOf.size());
+        indexOf.push_back(NO_INDEX);
+    }
+    indexOf[id] = index;
+
+    localPosition.push_back(Vector3(0.0f, 0.0f, 0.0f));
+    localRotation.push_back(Quaternion());
+    localScale.push_back(Vector3(1.0f, 1.0f, 1.0f));
+    world.push_back(Matrix4());
+    parent.push_back(parentIndex);
+    subtreeEnd.push_back(index + 1);
+    dirty.push_back(0);
+    idOf.push_back(id);
+    markDirty(index);
+    return id;
+}
+
+void TransformHierarchy::destroy(TransformId id) {
+    if (!isValid(id)) return;
+    if (!ordered) reorder();
+
+    uint32_t first = indexOf[id];
+    uint32_t end = subtreeEnd[first];
+    uint32_t count = end - first;
+    for (uint32_t i = first; i < end; i++) {
+        indexOf[idOf[i]] = NO_INDEX;
+        freeIds.push_back(idOf[i]);
+    }
+
+    localPosition.erase(localPosition.begin() + first, localPosition.begin() + end);
+    localRotation.erase(localRotation.begin() + first, localRotation.begin() + end);
+    localScale.erase(localScale.begin() + first, localScale.begin() + end);
+    world.erase(world.begin() + first, world.begin() + end);
+    parent.erase(parent.begin() + first, parent.begin() + end);
+    subtreeEnd.erase(subtreeEnd.begin() + first, subtreeEnd.begin() + end);
+    dirty.erase(dirty.begin() + first, dirty.begin() + end);
+    idOf.erase(idOf.begin() + first, idOf.begin() + end);
+
+    // Nothing left had a parent inside the range. Ancestors' ranges shrink,
+    // everything after the range moves down.
+    for (size_t i = 0; i < parent.size(); i++) {
+        if (parent[i] != NO_INDEX && parent[i] >= end) parent[i] -= count;
+        if (subtreeEnd[i] > first) subtreeEnd[i] -= count;
+        if (i >= first) indexOf[idOf[i]] = static_cast<uint32_t>(i);
+    }
+}
+
+bool TransformHierarchy::setParent(TransformId id, TransformId parentId) {
+    if (!isValid(id) || (parentId != NO_TRANSFORM && !isValid(parentId))) return false;
+    uint32_t index = indexOf[id];
+    uint32_t parentIndex = parentId == NO_TRANSFORM ? NO_INDEX : indexOf[parentId];
+
+    for (uint32_t p = parentIndex; p != NO_INDEX; p = parent[p]) {
+        if (p == index) {
+            std::cerr << "Transform " << id << " cannot become a child of its own descendant " << parentId
+                      << std::endl;
+            return false;
+        }
+    }
+    if (parent[index] == parentIndex) return true;
+
+    parent[index] = parentIndex;
+    ordered = false;
+    markDirty(index);
+    return true;
+}
+
+TransformId TransformHierarchy::getParent(TransformId id) const {
+    uint32_t parentIndex = parent[indexOf[id]];
+    return parentIndex == NO_INDEX ? NO_TRANSFORM : idOf[parentIndex];
+}
+
+void TransformHierarchy::setLocalPosition(TransformId id, const Vector3& position) {
+    uint32_t index = indexOf[id];
+    localPosition[index] = position;
+    markDirty(index);
+}
+
+void TransformHierarchy::setLocalRotation(TransformId id, const Quaternion& rotation) {
+    uint32_t index = indexOf[id];
+    localRotation[index] = rotation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setLocalScale(TransformId id, const Vector3& scale) {
+    uint32_t index = indexOf[id];
+    localScale[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::setLocal(TransformId id, const Vector3& position, const Quaternion& rotation,
+                                  const Vector3& scale) {
+    uint32_t index = indexOf[id];
+    localPosition[index] = position;
+    localRotation[index] = rotation;
+    localScale[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::markDirty(uint32_t index) {
+    if (dirty[index]) return;
+    dirty[index] = 1;
+    dirtyIds.push_back(idOf[index]);
+}
+
+void TransformHierarchy::update() {
+    stats.nodes = size();
+    stats.updatedNodes = 0;
+    stats.dirtyRoots = 0;
+    if (dirtyIds.empty()) return;
+    if (!ordered) reorder();
+
+    std::vector<uint32_t> dirtyIndices;
+    dirtyIndices.reserve(dirtyIds.size());
+    for (TransformId id : dirtyIds) {
+        if (isValid(id) && dirty[indexOf[id]]) dirtyIndices.push_back(indexOf[id]);
+    }
+    dirtyIds.clear();
+    std::sort(dirtyIndices.begin(), dirtyIndices.end());
+
+    // A dirty node inside a subtree already recomputed is skipped; ancestors
+    // come first, so a parent outside the range is already up to date
+    uint32_t covered = 0;
+    for (uint32_t first : dirtyIndices) {
+        if (first < covered) continue;
+        uint32_t end = subtreeEnd[first];
+        for (uint32_t i = first; i < end; i++) {
+            Matrix4 local = Matrix4::compose(localPosition[i], localRotation[i], localScale[i]);
+            if (parent[i] == NO_INDEX) {
+                world[i] = local;
+            } else {
+                multiplyAffine(world[parent[i]], local, world[i]);
+            }
+            dirty[i] = 0;
+        }
+        stats.dirtyRoots++;
+        stats.updatedNodes += end - first;
+        covered = end;
+    }
+}
+
+// Depth-first from the roots, children in their current order, so a tree
+// that was already ordered keeps its layout
+void TransformHierarchy::reorder() {
+    uint32_t count = static_cast<uint32_t>(size());
+
+    std::vector<uint32_t> childStart(count + 1, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        if (parent[i] != NO_INDEX) childStart[parent[i] + 1]++;
+    }
+    for (uint32_t i = 0; i < count; i++) childStart[i + 1] += childStart[i];
+    std::vector<uint32_t> children(childStart[count]);
+    std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        if (parent[i] != NO_INDEX) children[cursor[parent[i]]++] = i;
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < count; root++) {
+        if (parent[root] != NO_INDEX) continue;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            for (uint32_t c = childStart[node + 1]; c-- > childStart[node];) stack.push_back(children[c]);
+        }
+    }
+
+    std::vector<uint32_t> newIndex(count);
+    for (uint32_t i = 0; i < count; i++) newIndex[order[i]] = i;
+
+    permute(localPosition, order);
+    permute(localRotation, order);
+    permute(localScale, order);
+    permute(world, order);
+    permute(dirty, order);
+    permute(idOf, order);
+    permute(parent, order);
+    for (uint32_t i = 0; i < count; i++) {
+        if (parent[i] != NO_INDEX) parent[i] = newIndex[parent[i]];
+        indexOf[idOf[i]] = i;
+        subtreeEnd[i] = i + 1;
+    }
+    for (uint32_t i = count; i-- > 0;) {
+        if (parent[i] != NO_INDEX) subtreeEnd[parent[i]] = std::max(subtreeEnd[parent[i]], subtreeEnd[i]);
+    }
+
+    ordered = true;
+    stats.reorders++;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vector3.h"
+#include "Quaternion.h"
+#include "Matrix4.h"
+
+// Stable handle of a node; stays valid while the nodes are reordered
+using TransformId = uint32_t;
+static const TransformId NO_TRANSFORM = 0xFFFFFFFFu;
+
+struct TransformStats {
+    size_t nodes = 0;
+    size_t updatedNodes = 0;  // World matrices recomputed by the last update()
+    size_t dirtyRoots = 0;    // Subtrees the last update() visited
+    size_t reorders = 0;      // Depth-first re-sorts after structural changes
+};
+
+// Parent/child transforms for many objects. Each component lives in its own
+// array (local position, rotation and scale, world matrix, parent), indexed
+// by node, and the nodes are kept in depth-first order: a parent comes before
+// its children and every subtree is one contiguous range.
+//
+// Setting a local value marks the node dirty. update() recomputes, for each
+// dirty node, the range of its subtree front to back, every parent's world
+// matrix being ready when its children read it. Untouched subtrees are not
+// visited at all, so a mostly static scene costs next to nothing per frame.
+//
+// Creating a child under the most recently created subtree keeps the order.
+// Other structural changes (creating under an earlier node, setParent,
+// destroy) re-sort all nodes once in the next update().
+class TransformHierarchy {
+public:
+    // Identity local transform under parent (NO_TRANSFORM for a root)
+    TransformId create(TransformId parent = NO_TRANSFORM);
+
+    // Remove the node and its whole subtree
+    void destroy(TransformId id);
+
+    // Move the node with its subtree under another parent, keeping its local
+    // transform. Fails (false) if parent lies in the node's own subtree.
+    bool setParent(TransformId id, TransformId parent);
+    TransformId getParent(TransformId id) const;
+
+    void setLocalPosition(TransformId id, const Vector3& position);
+    void setLocalRotation(TransformId id, const Quaternion& rotation);
+    void setLocalScale(TransformId id, const Vector3& scale);
+    void setLocal(TransformId id, const Vector3& position, const Quaternion& rotation, const Vector3& scale);
+
+    const Vector3& getLocalPosition(TransformId id) const { return localPosition[indexOf[id]]; }
+    const Quaternion& getLocalRotation(TransformId id) const { return localRotation[indexOf[id]]; }
+    const Vector3& getLocalScale(TransformId id) const { return localScale[indexOf[id]]; }
+
+    // Recompute the world matrices of every dirty subtree
+    void update();
+
+    // Row-major like Matrix4, as of the last update()
+    const Matrix4& getWorld(TransformId id) const { return world[indexOf[id]]; }
+
+    bool isValid(TransformId id) const { return id < indexOf.size() && indexOf[id] != NO_INDEX; }
+    size_t size() const { return parent.size(); }
+    const TransformStats& getStats() const { return stats; }
+
+private:
+    static constexpr uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+    // Per node, in depth-first order
+    std::vector<Vector3> localPosition;
+    std::vector<Quaternion> localRotation;
+    std::vector<Vector3> localScale;
+    std::vector<Matrix4> world;
+    std::vector<uint32_t> parent;       // Index, NO_INDEX for roots
+    std::vector<uint32_t> subtreeEnd;   // One past the last descendant
+    std::vector<uint8_t> dirty;
+    std::vector<TransformId> idOf;
+
+    // Per id
+    std::vector<uint32_t> indexOf;
+    std::vector<TransformId> freeIds;
+
+    std::vector<TransformId> dirtyIds;  // Marked since the last update(), may hold stale ids
+    bool ordered = true;                // subtreeEnd and the depth-first order are valid
+    TransformStats stats;
+
+    void markDirty(uint32_t index);
+    void reorder();
+};
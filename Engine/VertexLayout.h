@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Rendering/GL.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Vector3.h"
+
+// Full precision vertex the mesh builders produce. Arenas pack it into their
+// layout on upload.
+struct Vertex {
+    Vector3 position;
+    Vector3 color;
+    Vector3 normal;
+    Vector3 texCoords;  // Using Vector3 for future flexibility (3D textures)
+};
+
+// Runtime view of a VertexLayout, what a MeshArena needs to store vertices
+struct VertexFormat {
+    size_t stride;
+    void (*setupAttributes)();  // Attribute pointers for the bound VAO and VBO
+    void (*pack)(const Vertex* vertices, size_t count, void* out);
+    uint32_t signature;         // Hash of the attribute formats, tells layouts apart in files
+};
+
+// FNV-1a step over one 32-bit value, for layout signatures
+constexpr uint32_t hashLayoutValue(uint32_t hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 16777619u;
+    return hash;
+}
+
+// IEEE half with round to nearest even
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {
+        return static_cast<uint16_t>(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+    }
+    if (magnitude >= 0x477ff000) {
+        return static_cast<uint16_t>(sign | 0x7c00);  // Overflows to infinity
+    }
+    if (magnitude < 0x38800000) {
+        // Subnormal: shift the mantissa with its implicit bit into place
+        if (magnitude < 0x33000000) return static_cast<uint16_t>(sign);
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+// Attribute formats. Each one knows its GL description and how to pack a
+// Vector3 into its bytes.
+struct VertexFloat3 {
+    static constexpr size_t size = 12;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+
+    static void pack(const Vector3& v, uint8_t* out) {
+        float values[3] = {v.x, v.y, v.z};
+        std::memcpy(out, values, sizeof(values));
+    }
+};
+
+// Padded to four halves so the next attribute stays 4-byte aligned; w = 1
+struct VertexHalf4 {
+    static constexpr size_t size = 8;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+
+    static void pack(const Vector3& v, uint8_t* out) {
+        uint16_t values[4] = {floatToHalf(v.x), floatToHalf(v.y), floatToHalf(v.z), 0x3c00};
+        std::memcpy(out, values, sizeof(values));
+    }
+};
+
+// Signed normalized 10:10:10:2 for unit vectors, about 0.002 precision
+struct VertexSnorm10_10_10_2 {
+    static constexpr size_t size = 4;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+
+    static uint32_t component(float value) {
+        int c = static_cast<int>(std::lround(std::max(-1.0f, std::min(1.0f, value)) * 511.0f));
+        return static_cast<uint32_t>(c) & 0x3ff;
+    }
+
+    static void pack(const Vector3& v, uint8_t* out) {
+        uint32_t value = component(v.x) | (component(v.y) << 10) | (component(v.z) << 20);
+        std::memcpy(out, &value, sizeof(value));
+    }
+};
+
+// RGBA8 color, values are clamped to [0, 1]; alpha = 1
+struct VertexUnorm8x4 {
+    static constexpr size_t size = 4;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static constexpr GLboolean normalized = GL_TRUE;
+
+    static uint8_t component(float value) {
+        return static_cast<uint8_t>(std::lround(std::max(0.0f, std::min(1.0f, value)) * 255.0f));
+    }
+
+    static void pack(const Vector3& v, uint8_t* out) {
+        out[0] = component(v.x);
+        out[1] = component(v.y);
+        out[2] = component(v.z);
+        out[3] = 255;
+    }
+};
+
+// Two 16-bit normalized coordinates in [0, 1], z is dropped
+struct VertexUnorm16x2 {
+    static constexpr size_t size = 4;
+    static constexpr GLint components = 2;
+    static constexpr GLenum type = GL_UNSIGNED_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+
+    static void pack(const Vector3& v, uint8_t* out) {
+        uint16_t values[2] = {
+            static_cast<uint16_t>(std::lround(std::max(0.0f, std::min(1.0f, v.x)) * 65535.0f)),
+            static_cast<uint16_t>(std::lround(std::max(0.0f, std::min(1.0f, v.y)) * 65535.0f))};
+        std::memcpy(out, values, sizeof(values));
+    }
+};
+
+// Shader location, storage format and the Vertex member it is packed from
+template <GLuint Location, typename Format, Vector3 Vertex::*Source>
+struct VertexAttribute {
+    static constexpr GLuint location = Location;
+    static constexpr size_t size = Format::size;
+
+    static void setup(size_t stride, size_t offset) {
+        glVertexAttribPointer(Location, Format::components, Format::type, Format::normalized,
+                              static_cast<GLsizei>(stride), (void*)offset);
+        glEnableVertexAttribArray(Location);
+    }
+
+    static void pack(const Vertex& vertex, uint8_t* out) {
+        Format::pack(vertex.*Source, out);
+    }
+
+    static constexpr uint32_t signature(uint32_t hash) {
+        hash = hashLayoutValue(hash, Location);
+        hash = hashLayoutValue(hash, static_cast<uint32_t>(Format::components));
+        hash = hashLayoutValue(hash, Format::type);
+        return hashLayoutValue(hash, Format::normalized);
+    }
+};
+
+// Interleaved vertex layout; attributes are laid out in the order given, so
+// stride and offsets are compile-time constants
+template <typename... Attributes>
+struct VertexLayout {
+    static constexpr size_t stride = (Attributes::size + ...);
+
+    static void setupAttributes() {
+        size_t offset = 0;
+        ((Attributes::setup(stride, offset), offset += Attributes::size), ...);
+    }
+
+    static void pack(const Vertex* vertices, size_t count, void* out) {
+        uint8_t* bytes = static_cast<uint8_t*>(out);
+        for (size_t i = 0; i < count; i++) {
+            uint8_t* vertex = bytes + i * stride;
+            size_t offset = 0;
+            ((Attributes::pack(vertices[i], vertex + offset), offset += Attributes::size), ...);
+        }
+    }
+
+    static constexpr uint32_t signature() {
+        uint32_t hash = 2166136261u;
+        ((hash = Attributes::signature(hash)), ...);
+        return hash;
+    }
+
+    static VertexFormat format() { return {stride, &setupAttributes, &pack, signature()}; }
+};
+
+// The Vertex struct as is, 48 bytes
+using StandardVertexLayout = VertexLayout<
+    VertexAttribute<0, VertexFloat3, &Vertex::position>,
+    VertexAttribute<1, VertexFloat3, &Vertex::color>,
+    VertexAttribute<2, VertexFloat3, &Vertex::normal>,
+    VertexAttribute<3, VertexFloat3, &Vertex::texCoords>>;
+
+// 20 bytes for geometry with small local coordinates (terrain chunks, grass):
+// half positions, 10:10:10:2 normals, RGBA8 color and 16-bit UVs. Positions
+// within 64 units of the mesh origin are off by less than 1/64.
+using PackedVertexLayout = VertexLayout<
+    VertexAttribute<0, VertexHalf4, &Vertex::position>,
+    VertexAttribute<2, VertexSnorm10_10_10_2, &Vertex::normal>,
+    VertexAttribute<1, VertexUnorm8x4, &Vertex::color>,
+    VertexAttribute<3, VertexUnorm16x2, &Vertex::texCoords>>;
+
+static_assert(StandardVertexLayout::stride == sizeof(Vertex), "Standard layout must match Vertex");
+static_assert(PackedVertexLayout::stride == 20, "Packed vertices are 20 bytes");
@@ -0,0 +1,544 @@
+#include "GrassScene.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/MeshSimplifier.h"
+#include "../Engine/Scatter.h"
+#include "../Engine/Rendering/GLState.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Function to create a more realistic grass blade
+static std::vector<Vertex> createGrassBladeVertices() {
+    std::vector<Vertex> vertices;
+    
+    // Base color for grass
+    Vector3 baseColor(0.0f, 0.8f, 0.0f);
+    
+    // Create a curved blade shape with multiple segments
+    const int segments = 4;
+    const float width = 0.1f;
+    const float height = 1.0f;
+    
+    for (int i = 0; i < segments; i++) {
+        float t = static_cast<float>(i) / segments;
+        float nextT = static_cast<float>(i + 1) / segments;
+        
+        // Calculate curved position
+        float x1 = width * (1.0f - t);
+        float x2 = width * (1.0f - nextT);
+        float y1 = height * t;
+        float y2 = height * nextT;
+        
+        // Add slight curve to the blade
+        float curve = sin(t * M_PI) * 0.1f;
+        float nextCurve = sin(nextT * M_PI) * 0.1f;
+        
+        // Calculate color variation (darker at bottom, lighter at top)
+        Vector3 color1 = baseColor * (0.7f + t * 0.3f);
+        Vector3 color2 = baseColor * (0.7f + nextT * 0.3f);
+        
+        // Add vertices for this segment
+        vertices.push_back({{-x1, y1, curve}, color1, {0.0f, 1.0f, 0.0f}, {0.0f, t, 0.0f}});
+        vertices.push_back({{ x1, y1, curve}, color1, {0.0f, 1.0f, 0.0f}, {1.0f, t, 0.0f}});
+        vertices.push_back({{ x2, y2, nextCurve}, color2, {0.0f, 1.0f, 0.0f}, {1.0f, nextT, 0.0f}});
+        vertices.push_back({{-x2, y2, nextCurve}, color2, {0.0f, 1.0f, 0.0f}, {0.0f, nextT, 0.0f}});
+    }
+    
+    return vertices;
+}
+
+static std::vector<unsigned int> createGrassBladeIndices() {
+    std::vector<unsigned int> indices;
+    const int segments = 4;
+    
+    // Create indices for each segment
+    for (int i = 0; i < segments; i++) {
+        unsigned int baseIndex = i * 4;
+        // First triangle
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 1);
+        indices.push_back(baseIndex + 2);
+        // Second triangle
+        indices.push_back(baseIndex);
+        indices.push_back(baseIndex + 2);
+        indices.push_back(baseIndex + 3);
+    }
+    
+    return indices;
+}
+
+// Function to create skybox vertices
+static std::vector<float> createSkyboxVertices() {
+    float size = 1000.0f; // Make skybox much larger
+    return {
+        // positions          
+        -size,  size, -size,
+        -size, -size, -size,
+         size, -size, -size,
+         size, -size, -size,
+         size,  size, -size,
+        -size,  size, -size,
+
+        -size, -size,  size,
+        -size, -size, -size,
+        -size,  size, -size,
+        -size,  size, -size,
+        -size,  size,  size,
+        -size, -size,  size,
+
+         size, -size, -size,
+         size, -size,  size,
+         size,  size,  size,
+         size,  size,  size,
+         size,  size, -size,
+         size, -size, -size,
+
+        -size, -size,  size,
+        -size,  size,  size,
+         size,  size,  size,
+         size,  size,  size,
+         size, -size,  size,
+        -size, -size,  size,
+
+        -size,  size, -size,
+         size,  size, -size,
+         size,  size,  size,
+         size,  size,  size,
+        -size,  size,  size,
+        -size,  size, -size,
+
+        -size, -size, -size,
+        -size, -size,  size,
+         size, -size, -size,
+         size, -size, -size,
+        -size, -size,  size,
+         size, -size,  size
+    };
+}
+
+// Build a culling grid over instances of a mesh. padding covers movement the
+// vertex shader adds on top of the instance transform (wind bend).
+static void buildCullingGrid(CullingGrid& grid, const Mesh& mesh, const std::vector<InstanceData>& instances, float padding) {
+    std::vector<Vector3> centers(instances.size());
+    std::vector<float> radii(instances.size());
+    JobSystem::parallelFor(instances.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            transformBounds(mesh.getBounds(), instances[i].transform, centers[i], radii[i]);
+            radii[i] += padding;
+        }
+    });
+    grid.build(centers, radii);
+}
+
+// Uniform integer in [0, n). std::mt19937 produces the same sequence on every
+// standard library, unlike rand() and the std distributions.
+static int randomInt(std::mt19937& random, int n) {
+    return static_cast<int>(random() % static_cast<unsigned int>(n));
+}
+
+static TerrainSettings makeTerrainSettings(const GrassSceneSettings& settings) {
+    TerrainSettings terrainSettings;
+    terrainSettings.chunkSize = 32.0f;
+    terrainSettings.chunkResolution = 33;
+    terrainSettings.viewDistance = settings.viewDistance;
+    terrainSettings.cacheCapacity = settings.terrainCacheCapacity;
+    terrainSettings.occluders = settings.occlusionWidth > 0;
+    return terrainSettings;
+}
+
+GrassScene::GrassScene(const GrassSceneSettings& settings)
+    : settings(settings),
+      terrain(makeTerrainSettings(settings), [noise = terrainNoise](const float* x, const float* z, float* out, size_t count) {
+          Noise::heights(noise, x, z, out, count);
+      }),
+      sunDirection(Vector3(0.5f, 0.5f, 0.5f).normalize()),
+      time(0.0f), windStrength(0.0f), windSway(0.0f),
+      frameUniforms(sizeof(FrameData), Shader::FRAME_DATA_BINDING),
+      skyboxVAO(0), skyboxVBO(0),
+      grassGrid(8.0f), plantGrid(8.0f), cloudGrid(32.0f) {
+}
+
+GrassScene::~GrassScene() {
+    GLState::forgetVertexArray(skyboxVAO);
+    glDeleteVertexArrays(1, &skyboxVAO);
+    glDeleteBuffers(1, &skyboxVBO);
+}
+
+bool GrassScene::loadShaders(const std::string& directory) {
+    struct Program {
+        Shader& shader;
+        const char* vertex;
+        const char* fragment;
+        std::vector<std::string> defines;
+    };
+
+    // Grass and plants use basic.vert with per-instance attributes, clouds
+    // have both variants for single and batched draws
+    std::vector<Program> programs = {
+        {shader, "basic.vert", "basic.frag", {}},
+        {instancedShader, "basic.vert", "basic.frag", {"INSTANCED"}},
+        {skyboxShader, "skybox.vert", "skybox.frag", {}},
+        {cloudShader, "cloud.vert", "cloud.frag", {}},
+        {instancedCloudShader, "cloud.vert", "cloud.frag", {"INSTANCED"}},
+    };
+    if (settings.proceduralGrass > 0) {
+        programs.push_back({proceduralGrassShader, "basic.vert", "basic.frag", ProceduralGrass::shaderDefines()});
+    }
+
+    // Hand every program to the driver before waiting on any, so they
+    // compile in parallel
+    bool started = true;
+    for (Program& program : programs) {
+        started = program.shader.startLoadFromFiles(directory + "/" + program.vertex, directory + "/" + program.fragment,
+                                                    program.defines) && started;
+    }
+
+    bool loaded = started;
+    for (Program& program : programs) {
+        loaded = program.shader.finishLoad() && loaded;
+    }
+    if (!loaded) {
+        std::cerr << "Failed to load shaders from " << directory << std::endl;
+        return false;
+    }
+
+    // The sun does not move, set it once on both cloud programs
+    cloudShader.use();
+    cloudShader.getVec3Uniform("sunDirection").set(sunDirection.x, sunDirection.y, sunDirection.z);
+    instancedCloudShader.use();
+    instancedCloudShader.getVec3Uniform("sunDirection").set(sunDirection.x, sunDirection.y, sunDirection.z);
+    return true;
+}
+
+void GrassScene::createMaterials() {
+    queue.setMultiDraw(settings.multiDraw);
+    opaquePass = queue.addPass("Opaque");
+    transparentPass = queue.addPass("Transparent", PassOrder::BackToFront);
+
+    // Terrain chunks are all different meshes and draw one by one through
+    // the uniforms; grass and plants share the blade mesh and always batch
+    RenderMaterial terrain;
+    terrain.shader = &shader;
+    terrain.instancedShader = &instancedShader;
+    terrainMaterial = queue.addMaterial(terrain);
+
+    RenderMaterial foliage;
+    foliage.instancedShader = &instancedShader;
+    foliageMaterial = queue.addMaterial(foliage);
+
+    RenderMaterial clouds;
+    clouds.shader = &cloudShader;
+    clouds.instancedShader = &instancedCloudShader;
+    clouds.blend = true;
+    clouds.depthWrite = false;
+    cloudMaterial = queue.addMaterial(clouds);
+}
+
+bool GrassScene::init(const std::string& shaderDirectory) {
+    // Blending is switched per material by the render queue
+    GLState::setDepthTest(true);
+
+    if (!loadShaders(shaderDirectory)) {
+        return false;
+    }
+    createMaterials();
+
+    // Heights around the grass field sampled once for placement and the camera clamp
+    ground.generate(terrainNoise, -64.0f, -64.0f, 0.25f, 513, 513);
+
+    // Create improved grass blade, with simpler versions for the far field
+    std::vector<Vertex> bladeVertices = createGrassBladeVertices();
+    std::vector<unsigned int> bladeIndices = createGrassBladeIndices();
+    std::vector<MeshLod> bladeLods = MeshSimplifier::buildLodChain(bladeVertices, bladeIndices);
+    grassBlade = Mesh(MeshArena::shared<PackedVertexLayout>(), bladeVertices, bladeIndices);
+    grassBlade.setLods(bladeLods);
+    cloudMesh = Mesh::createPlane(cloud.size, Vector3(1.0f, 1.0f, 1.0f));
+
+    // Create skybox
+    std::vector<float> skyboxVertices = createSkyboxVertices();
+    glGenVertexArrays(1, &skyboxVAO);
+    glGenBuffers(1, &skyboxVBO);
+    GLState::bindVertexArray(skyboxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    glBufferData(GL_ARRAY_BUFFER, skyboxVertices.size() * sizeof(float), &skyboxVertices[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    GLState::bindVertexArray(0);
+
+    std::mt19937 random(settings.seed);
+    if (settings.proceduralGrass > 0) {
+        // The blades live in the vertex shader; the field matches the placed one
+        ProceduralGrassSettings grassSettings;
+        grassSettings.bladeCount = settings.proceduralGrass;
+        grassSettings.fieldSize = 80.0f;
+        grassSettings.seed = settings.seed;
+        if (!proceduralGrass.init(grassSettings, ground, proceduralGrassShader, grassBlade)) {
+            return false;
+        }
+    } else {
+        placeGrass(random);
+    }
+    placeClouds(random);
+    placePlants();
+    return true;
+}
+
+void GrassScene::placeGrass(std::mt19937& random) {
+    // Set up instanced grass positions with more natural distribution
+    const int GRASS_COUNT = 10000;
+    
+    // Create a more uniform distribution using a grid with random offsets
+    const float GRID_SIZE = 80.0f;
+    const int GRID_RESOLUTION = 40;
+    const float CELL_SIZE = GRID_SIZE / GRID_RESOLUTION;
+    
+    for (int i = 0; i < GRASS_COUNT; i++) {
+        // Generate position in grid
+        int gridX = i % GRID_RESOLUTION;
+        int gridZ = i / GRID_RESOLUTION;
+        
+        // Add random offset within cell
+        float offsetX = randomInt(random, 100) * 0.01f * CELL_SIZE;
+        float offsetZ = randomInt(random, 100) * 0.01f * CELL_SIZE;
+        
+        // Calculate final position
+        float x = (gridX * CELL_SIZE - GRID_SIZE/2) + offsetX;
+        float z = (gridZ * CELL_SIZE - GRID_SIZE/2) + offsetZ;
+        
+        // Skip if outside terrain bounds
+        if (std::abs(x) > 40.0f || std::abs(z) > 40.0f) continue;
+        
+        // Calculate height at this position from the height field
+        float height = ground.getHeight(x, z);
+        
+        // Add some height variation
+        float bladeHeight = 0.8f + randomInt(random, 40) * 0.01f;
+        
+        // Add slight intensity variation (0.8 to 1.2)
+        float intensity = 0.8f + randomInt(random, 40) * 0.01f;
+        
+        // Random rotation with slight forward tilt
+        float rotation = randomInt(random, 360);
+        float tilt = randomInt(random, 20) - 10;
+        
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(x, height, z));
+        model = glm::rotate(model, glm::radians(static_cast<float>(rotation)), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(static_cast<float>(tilt)), glm::vec3(1.0f, 0.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(1.0f, bladeHeight, 1.0f));
+
+        // Wind bend and lean are applied in basic.vert from height and intensity
+        InstanceData instance;
+        memcpy(instance.transform, glm::value_ptr(model), sizeof(instance.transform));
+        instance.height = bladeHeight;
+        instance.intensity = intensity;
+        instance.color = Vector3(1.0f, 1.0f, 1.0f);
+        instance.colorMix = 0.0f;
+        grassInstances.push_back(instance);
+    }
+
+    // Wind bends a blade by at most ~0.5 units, keep it inside its sphere
+    buildCullingGrid(grassGrid, grassBlade, grassInstances, 0.5f);
+}
+
+void GrassScene::placeClouds(std::mt19937& random) {
+    // Position clouds in the sky
+    for (int i = 0; i < cloud.count; i++) {
+        float x = (randomInt(random, 200) - 100) * 0.5f;
+        float z = (randomInt(random, 200) - 100) * 0.5f;
+        float y = cloud.height + (randomInt(random, 20) - 10);
+        
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(x, y, z));
+        model = glm::rotate(model, glm::radians(static_cast<float>(randomInt(random, 360))), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        InstanceData instance = {};
+        memcpy(instance.transform, glm::value_ptr(model), sizeof(instance.transform));
+        instance.color = Vector3(1.0f, 1.0f, 1.0f);
+        cloudInstances.push_back(instance);
+    }
+
+    // Clouds are few, they still go through a grid so the frame only visits
+    // the visible ones
+    buildCullingGrid(cloudGrid, cloudMesh, cloudInstances, 0.0f);
+}
+
+void GrassScene::placePlants() {
+    // Create a variety of small plants
+    const std::vector<Plant> plants = {
+        {0.3f, Vector3(0.2f, 0.8f, 0.2f), 0.5f},  // Small bush
+        {0.4f, Vector3(0.8f, 0.2f, 0.2f), 0.3f},  // Red flower
+        {0.5f, Vector3(0.2f, 0.2f, 0.8f), 0.4f},  // Blue flower
+        {0.6f, Vector3(0.8f, 0.8f, 0.2f), 0.6f}   // Yellow flower
+    };
+
+    // Each kind spread out on its own and kept clear of the kinds before it,
+    // about as many plants in all as the scene always had
+    ScatterSettings scatterSettings;
+    scatterSettings.seed = settings.seed;
+    std::vector<ScatterType> types(plants.size());
+    for (ScatterType& type : types) {
+        type.radius = 10.0f;
+        type.exclusion = 2.0f;
+    }
+    std::vector<ScatterInstance> placed;
+    Scatter::scatter(ground, scatterSettings, types, placed);
+
+    for (const ScatterInstance& placement : placed) {
+        const Plant& plant = plants[placement.type];
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(placement.x, placement.y, placement.z));
+        model = glm::rotate(model, glm::radians(static_cast<float>(placement.random % 360)), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(plant.scale, plant.height, plant.scale));
+
+        // Plants keep still in the wind and take their type's color
+        InstanceData instance;
+        memcpy(instance.transform, glm::value_ptr(model), sizeof(instance.transform));
+        instance.height = plant.height;
+        instance.intensity = 0.0f;
+        instance.color = plant.color;
+        instance.colorMix = 1.0f;
+        plantInstances.push_back(instance);
+    }
+
+    buildCullingGrid(plantGrid, grassBlade, plantInstances, 0.0f);
+}
+
+void GrassScene::update(const Camera& camera, float currentTime) {
+    time = currentTime;
+
+    // Update wind direction with more natural variation
+    float windTime = time * 0.05f;  // Slower wind direction changes
+    wind.direction.x = sin(windTime) * 0.5f + 0.5f;
+    wind.direction.z = cos(windTime) * 0.5f + 0.5f;
+    wind.direction = wind.direction.normalize();
+
+    // Calculate base wind effect for all grass
+    // Use a smoother curve for wind effect
+    windSway = (sin(time * wind.frequency) + 1.0f) * 0.5f * wind.strength;
+    
+    // Add very subtle turbulence
+    float turbulence = sin(time * wind.turbulenceFrequency) * wind.turbulence;
+    windStrength = wind.strength * (1.0f + turbulence);
+
+    terrain.update(camera.position);
+}
+
+float GrassScene::getGroundHeight(float x, float z) const {
+    return ground.contains(x, z) ? ground.getHeight(x, z) : Noise::height(terrainNoise, x, z);
+}
+
+void GrassScene::render(const Camera& camera, float aspect) {
+    // Create view and projection matrices
+    glm::mat4 view = glm::lookAt(
+        glm::vec3(camera.position.x, camera.position.y, camera.position.z),
+        glm::vec3(camera.position.x + camera.direction.x,
+                 camera.position.y + camera.direction.y,
+                 camera.position.z + camera.direction.z),
+        glm::vec3(camera.up.x, camera.up.y, camera.up.z)
+    );
+
+    glm::mat4 projection = glm::perspective(
+        glm::radians(camera.fov),
+        aspect,
+        camera.nearPlane,
+        camera.farPlane
+    );
+
+    // Same camera as the matrices above, only what touches it gets drawn
+    Frustum frustum = Frustum::fromCamera(camera, aspect);
+
+    // Detail levels are picked for the pixels of the current viewport
+    LodSelector lod;
+    if (settings.lodPixelError > 0.0f) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        lod = LodSelector::fromCamera(camera, static_cast<float>(viewport[3]), settings.lodPixelError);
+    }
+
+    // Upload the data every program shares once for the whole frame
+    FrameData frameData = {};
+    memcpy(frameData.view, glm::value_ptr(view), sizeof(frameData.view));
+    memcpy(frameData.projection, glm::value_ptr(projection), sizeof(frameData.projection));
+    frameData.viewPos[0] = camera.position.x;
+    frameData.viewPos[1] = camera.position.y;
+    frameData.viewPos[2] = camera.position.z;
+    frameData.time = time;
+    frameData.windDirection[0] = wind.direction.x;
+    frameData.windDirection[1] = wind.direction.y;
+    frameData.windDirection[2] = wind.direction.z;
+    frameData.windStrength = windStrength;
+    frameData.windSway = windSway;
+    frameUniforms.update(&frameData);
+    frameUniforms.bind();
+
+    // Draw skybox first
+    {
+        ProfilePass pass("Skybox");
+        GLState::setBlend(false);
+        GLState::setDepthWrite(true);
+        GLState::setDepthFunc(GL_LEQUAL);
+        skyboxShader.use();
+        GLState::bindVertexArray(skyboxVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        Profiler::countDraw(12);
+    }
+
+    // The terrain in view rasterized on the CPU, to skip the foliage cells
+    // behind hills before anything is queued
+    const OcclusionCuller* occluders = nullptr;
+    if (settings.occlusionWidth > 0) {
+        PROFILE_SCOPE("Occlusion");
+        occlusion.resize(settings.occlusionWidth, static_cast<int>(settings.occlusionWidth / aspect + 0.5f));
+        occlusion.begin(camera.getViewProjectionMatrix(aspect));
+        terrain.submitOccluders(occlusion, frustum);
+        occlusion.render();
+        occluders = &occlusion;
+    }
+
+    // Queue everything in view; the queue sorts by program and material and
+    // merges the grass and plant blades into instanced batches
+    {
+        PROFILE_SCOPE("Submit");
+        glm::mat4 viewProjection = projection * view;
+        queue.begin(glm::value_ptr(viewProjection), camera.position);
+
+        // The grids are culled on other threads while this one queues the
+        // terrain; the queue itself is only touched from here
+        JobCounter culled;
+        size_t occludedGrass = 0, occludedPlants = 0;
+        JobSystem::run([&] { grassGrid.cull(frustum, visibleGrass, occluders, &occludedGrass); }, &culled);
+        JobSystem::run([&] { plantGrid.cull(frustum, visiblePlants, occluders, &occludedPlants); }, &culled);
+        JobSystem::run([&] { cloudGrid.cull(frustum, visibleClouds); }, &culled);
+
+        terrain.submit(queue, opaquePass, terrainMaterial, frustum, camera.position);
+        JobSystem::wait(culled);
+
+        foliageStats.instances = grassInstances.size() + plantInstances.size();
+        foliageStats.occluded = occludedGrass + occludedPlants;
+        foliageStats.drawn = visibleGrass.size() + visiblePlants.size();
+        foliageStats.frustumCulled = foliageStats.instances - foliageStats.occluded - foliageStats.drawn;
+
+        queue.submitInstances(opaquePass, foliageMaterial, grassBlade, grassInstances.data(), visibleGrass.data(), visibleGrass.size(), lod);
+
+        // Plants reuse the grass blade mesh with their own instances
+        queue.submitInstances(opaquePass, foliageMaterial, grassBlade, plantInstances.data(), visiblePlants.data(), visiblePlants.size(), lod);
+
+        for (uint32_t id : visibleClouds) {
+            queue.submit(transparentPass, cloudMaterial, cloudMesh, cloudInstances[id]);
+        }
+    }
+
+    // Drawn straight away, the queue has no instances to batch for it
+    if (settings.proceduralGrass > 0) {
+        ProfilePass pass("Grass");
+        proceduralGrass.draw(frustum, camera.position, lod);
+    }
+
+    queue.flush();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../Engine/Rendering/Shader.h"
+#include "../Engine/Rendering/UniformBuffer.h"
+#include "../Engine/Rendering/RenderQueue.h"
+#include "../Engine/Mesh.h"
+#include "../Engine/InstanceBuffer.h"
+#include "../Engine/Camera.h"
+#include "../Engine/Culling.h"
+#include "../Engine/OcclusionCuller.h"
+#include "../Engine/Terrain.h"
+#include "../Engine/HeightField.h"
+#include "../Engine/ProceduralGrass.h"
+#include "../Engine/Noise.h"
+#include <random>
+#include <string>
+#include <vector>
+
+struct GrassSceneSettings {
+    unsigned int seed = 1;            // Placement of grass, plants and clouds
+    int viewDistance = 4;             // Terrain chunks around the camera, covers the far plane
+    size_t terrainCacheCapacity = 0;  // 0 = derived from viewDistance
+    bool multiDraw = true;            // Multi-draw indirect where the context supports it
+    float lodPixelError = 1.0f;       // Screen error allowed for distant detail levels, 0 = full detail
+    size_t proceduralGrass = 0;       // Blades generated on the GPU in place of the placed ones, 0 = off
+    int occlusionWidth = 0;           // Columns of the CPU depth buffer culling foliage behind hills, 0 = off
+};
+
+// Placed grass and plants in the last frame. Instances of occluded cells that
+// reach outside the frustum count as occluded.
+struct FoliageStats {
+    size_t instances = 0;
+    size_t frustumCulled = 0;
+    size_t occluded = 0;
+    size_t drawn = 0;
+};
+
+// The grass field: streamed terrain, instanced grass and plants, clouds and a
+// skybox. Shared by the interactive demo and the headless benchmark, which
+// only differ in where the camera comes from and where the frame goes.
+// Needs a current GL context from construction on.
+class GrassScene {
+public:
+    explicit GrassScene(const GrassSceneSettings& settings = GrassSceneSettings());
+    ~GrassScene();
+
+    GrassScene(const GrassScene&) = delete;
+    GrassScene& operator=(const GrassScene&) = delete;
+
+    // Compile the shaders and place everything. The same seed always gives
+    // the same scene.
+    bool init(const std::string& shaderDirectory = "Engine/Rendering/Shaders");
+
+    // Advance the wind and stream terrain around the camera
+    void update(const Camera& camera, float time);
+
+    // Draw a frame into the bound framebuffer, which the caller clears
+    void render(const Camera& camera, float aspect);
+
+    // Ground under (x, z), from the cached field near the grass and the noise
+    // further out
+    float getGroundHeight(float x, float z) const;
+
+    TerrainStreamer& getTerrain() { return terrain; }
+    const RenderQueue& getRenderQueue() const { return queue; }
+    const ProceduralGrass& getProceduralGrass() const { return proceduralGrass; }
+    const OcclusionCuller& getOcclusion() const { return occlusion; }
+    const FoliageStats& getFoliageStats() const { return foliageStats; }
+
+private:
+    struct Wind {
+        float strength = 0.3f;
+        float frequency = 0.4f;  // Slower frequency for more natural wind
+        Vector3 direction = Vector3(1.0f, 0.0f, 0.5f).normalize();
+
+        // Very subtle turbulence
+        float turbulence = 0.02f;
+        float turbulenceFrequency = 0.2f;
+    };
+
+    struct Cloud {
+        float height = 100.0f;
+        float size = 50.0f;
+        int count = 20;
+    };
+
+    struct Plant {
+        float height;
+        Vector3 color;
+        float scale;
+    };
+
+    GrassSceneSettings settings;
+    NoiseParams terrainNoise;
+    TerrainStreamer terrain;
+    HeightField ground;
+
+    Wind wind;
+    Vector3 sunDirection;
+    Cloud cloud;
+    float time;
+    float windStrength;
+    float windSway;
+
+    Shader shader;
+    Shader instancedShader;
+    Shader skyboxShader;
+    Shader cloudShader;
+    Shader instancedCloudShader;
+    Shader proceduralGrassShader;
+
+    // Everything shared lives in FrameData, per-draw data goes through the queue
+    UniformBuffer frameUniforms;
+
+    RenderQueue queue;
+    uint8_t opaquePass;
+    uint8_t transparentPass;
+    uint16_t terrainMaterial;
+    uint16_t foliageMaterial;
+    uint16_t cloudMaterial;
+
+    Mesh grassBlade;
+    Mesh cloudMesh;
+    unsigned int skyboxVAO, skyboxVBO;
+
+    std::vector<InstanceData> grassInstances;
+    std::vector<InstanceData> plantInstances;
+    std::vector<InstanceData> cloudInstances;
+    CullingGrid grassGrid;
+    CullingGrid plantGrid;
+    CullingGrid cloudGrid;
+    ProceduralGrass proceduralGrass;  // Only initialized in procedural mode
+    OcclusionCuller occlusion;        // Terrain chunks as occluders, foliage cells tested
+    FoliageStats foliageStats;
+
+    // Culled on the job system while the terrain is submitted
+    std::vector<uint32_t> visibleGrass;
+    std::vector<uint32_t> visiblePlants;
+    std::vector<uint32_t> visibleClouds;
+
+    bool loadShaders(const std::string& directory);
+    void createMaterials();
+    void placeGrass(std::mt19937& random);
+    void placeClouds(std::mt19937& random);
+    void placePlants();
+};
@@ -0,0 +1,79 @@
+// Writes the engine's built-in meshes, or models imported from OBJ and glTF
+// binary files, as MeshFile containers. The built-in ones come from the same
+// Mesh factories the scenes use (optimized, with their detail levels):
+//
+//   mesh_convert sphere sphere.emesh --sectors 128 --stacks 64 --layout packed
+//   mesh_convert fern.obj fern.emesh
+//
+// The factories upload to the GPU, so this runs on a headless context.
+#include "../Engine/Rendering/HeadlessContext.h"
+#include "../Engine/Mesh.h"
+#include "../Engine/MeshFile.h"
+#include "../Engine/ModelImporter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static int usage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s cube|plane|sphere|model.obj|model.glb output.emesh [--size N] [--sectors N] [--stacks N]"
+                 " [--layout standard|packed]\n",
+                 program);
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+    std::string shape = argv[1];
+    const char* outputPath = argv[2];
+    float size = 1.0f;
+    int sectors = 20;
+    int stacks = 20;
+    bool packed = false;
+    for (int i = 3; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            size = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--sectors") == 0 && hasValue) {
+            sectors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stacks") == 0 && hasValue) {
+            stacks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--layout") == 0 && hasValue) {
+            std::string layout = argv[++i];
+            if (layout != "standard" && layout != "packed") return usage(argv[0]);
+            packed = layout == "packed";
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    HeadlessContext context(16, 16);
+    if (!context.init()) return -1;
+
+    Mesh mesh;
+    if (shape == "cube") {
+        mesh = Mesh::createCube(size);
+    } else if (shape == "plane") {
+        mesh = Mesh::createPlane(size);
+    } else if (shape == "sphere") {
+        mesh = Mesh::createSphere(size, sectors, stacks);
+    } else if (shape.size() > 4 && (shape.compare(shape.size() - 4, 4, ".obj") == 0 ||
+                                     shape.compare(shape.size() - 4, 4, ".glb") == 0)) {
+        mesh = ModelImporter::loadMesh(shape);
+        if (mesh.getVertices().empty()) return -1;
+    } else {
+        return usage(argv[0]);
+    }
+
+    VertexFormat format = packed ? PackedVertexLayout::format() : StandardVertexLayout::format();
+    if (!MeshFile::write(outputPath, mesh, format)) return -1;
+
+    MeshFile file;
+    if (!file.open(outputPath)) return -1;
+    const MeshFileHeader& header = file.getHeader();
+    std::printf("mesh_convert: %s, %u vertices, %u triangles, %u levels, %u meshlets, %zu bytes\n", outputPath,
+                header.vertexCount, header.lodCount > 0 ? file.getLods()[0].indexCount / 3 : 0, header.lodCount,
+                header.meshletCount, file.getFileSize());
+    return 0;
+}